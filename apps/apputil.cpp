@@ -8,6 +8,7 @@
  * 
  */
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
@@ -307,6 +308,56 @@ string OptionHelpItem(const OptionName& o)
 
 // Stats module
 
+// The histograms are not cleared by the writers, so they cover the whole
+// connection regardless of the interval of the other statistics.
+static SRT_HISTSTATS GetHistograms(int sid)
+{
+    SRT_HISTSTATS hist;
+    if (srt_histstats(sid, &hist, 0) == SRT_ERROR)
+        memset(&hist, 0, sizeof hist);
+    return hist;
+}
+
+// Upper bound of the bucket where the given fraction of samples is reached.
+static uint64_t HistogramPercentile(const SRT_HISTOGRAM& h, double fraction)
+{
+    if (h.count == 0)
+        return 0;
+
+    const uint64_t rank = uint64_t(fraction * h.count + 0.5);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < SRT_HISTOGRAM_BUCKETS - 1; ++i)
+    {
+        cumulative += h.buckets[i];
+        if (cumulative >= rank && cumulative > 0)
+            return min<uint64_t>(srt_histogram_floor(i + 1) - 1, h.usMax);
+    }
+    return h.usMax;
+}
+
+static void WriteHistogramJson(std::ostream& output, const char* name, const SRT_HISTOGRAM& h)
+{
+    output << "\"" << name << "\":{";
+    output << "\"count\":" << h.count << ",";
+    output << "\"usSum\":" << h.usSum << ",";
+    output << "\"usMax\":" << h.usMax << ",";
+    output << "\"usP50\":" << HistogramPercentile(h, 0.5) << ",";
+    output << "\"usP99\":" << HistogramPercentile(h, 0.99) << ",";
+    // Only the non-empty buckets, as [lower bound in us, count]
+    output << "\"buckets\":[";
+    bool first = true;
+    for (int i = 0; i < SRT_HISTOGRAM_BUCKETS; ++i)
+    {
+        if (!h.buckets[i])
+            continue;
+        if (!first)
+            output << ",";
+        output << "[" << srt_histogram_floor(i) << "," << h.buckets[i] << "]";
+        first = false;
+    }
+    output << "]}";
+}
+
 class SrtStatsJson : public SrtStatsWriter
 {
 public: 
@@ -334,6 +385,10 @@ public:
         output << "\"packetsFilterExtra\":" << mon.pktSndFilterExtra << ",";
         output << "\"bytes\":" << mon.byteSent << ",";
         output << "\"bytesDropped\":" << mon.byteSndDrop << ",";
+        output << "\"msPacingDelay\":" << mon.msSndPacingDelay << ",";
+        output << "\"msPacingDelayMax\":" << mon.msSndPacingDelayMax << ",";
+        output << "\"backupSwitches\":" << mon.backupSwitchTotal << ",";
+        output << "\"msBackupSwitch\":" << mon.msBackupSwitch << ",";
         output << "\"mbitRate\":" << mon.mbpsSendRate;
         output << "},";
         output << "\"recv\": {";
@@ -349,6 +404,14 @@ public:
         output << "\"bytesLost\":" << mon.byteRcvLoss << ",";
         output << "\"bytesDropped\":" << mon.byteRcvDrop << ",";
         output << "\"mbitRate\":" << mon.mbpsRecvRate;
+        output << "},";
+        const SRT_HISTSTATS hist = GetHistograms(sid);
+        output << "\"histograms\":{";
+        WriteHistogramJson(output, "rcvTransit", hist.rcvTransit);
+        output << ",";
+        WriteHistogramJson(output, "rcvBuffer", hist.rcvBuffer);
+        output << ",";
+        WriteHistogramJson(output, "sndLag", hist.sndLag);
         output << "}";
         output << "}" << endl;
         return output.str();
@@ -381,7 +444,15 @@ public:
             output << "pktRecv,pktRcvLoss,pktRcvDrop,pktRcvRetrans,pktRcvBelated,";
             output << "byteRecv,byteRcvLoss,byteRcvDrop,mbpsRecvRate,RCVLATENCYms,";
             // Filter stats
-            output << "pktSndFilterExtra,pktRcvFilterExtra,pktRcvFilterSupply,pktRcvFilterLoss";
+            output << "pktSndFilterExtra,pktRcvFilterExtra,pktRcvFilterSupply,pktRcvFilterLoss,";
+            // Pacing stats
+            output << "msSndPacingDelay,msSndPacingDelayMax,";
+            // Backup group stats
+            output << "backupSwitchTotal,msBackupSwitch,";
+            // Delay histograms
+            output << "usRcvTransitP50,usRcvTransitP99,usRcvTransitMax,";
+            output << "usRcvBufferP50,usRcvBufferP99,usRcvBufferMax,";
+            output << "usSndLagP50,usSndLagP99,usSndLagMax";
             output << endl;
             first_line_printed = true;
         }
@@ -419,7 +490,24 @@ public:
         output << mon.pktSndFilterExtra << ",";
         output << mon.pktRcvFilterExtra << ",";
         output << mon.pktRcvFilterSupply << ",";
-        output << mon.pktRcvFilterLoss; //<< ",";
+        output << mon.pktRcvFilterLoss << ",";
+        // Pacing stats
+        output << mon.msSndPacingDelay << ",";
+        output << mon.msSndPacingDelayMax << ",";
+        // Backup group stats
+        output << mon.backupSwitchTotal << ",";
+        output << mon.msBackupSwitch << ",";
+        // Delay histograms
+        const SRT_HISTSTATS hist = GetHistograms(sid);
+        const SRT_HISTOGRAM* const histograms[] = { &hist.rcvTransit, &hist.rcvBuffer, &hist.sndLag };
+        for (const SRT_HISTOGRAM* h : histograms)
+        {
+            if (h != histograms[0])
+                output << ",";
+            output << HistogramPercentile(*h, 0.5) << ",";
+            output << HistogramPercentile(*h, 0.99) << ",";
+            output << h->usMax;
+        }
         output << endl;
         return output.str();
     }
@@ -448,6 +536,8 @@ public:
         output << "RATE     SENDING: " << setw(11) << mon.mbpsSendRate       << "  RECEIVING:  " << setw(11) << mon.mbpsRecvRate         << endl;
         output << "BELATED RECEIVED: " << setw(11) << mon.pktRcvBelated      << "  AVG TIME:   " << setw(11) << mon.pktRcvAvgBelatedTime << endl;
         output << "REORDER DISTANCE: " << setw(11) << mon.pktReorderDistance << endl;
+        output << "PACING DELAY AVG: " << setw(9)  << mon.msSndPacingDelay << "ms  MAX:        " << setw(9)  << mon.msSndPacingDelayMax  << "ms" << endl;
+        output << "BACKUP SWITCHES:  " << setw(11) << mon.backupSwitchTotal  << "  LAST TIME:  " << setw(9)  << mon.msBackupSwitch       << "ms" << endl;
         output << "WINDOW      FLOW: " << setw(11) << mon.pktFlowWindow      << "  CONGESTION: " << setw(11) << mon.pktCongestionWindow  << "  FLIGHT: " << setw(11) << mon.pktFlightSize << endl;
         output << "LINK         RTT: " << setw(9)  << mon.msRTT            << "ms  BANDWIDTH:  " << setw(7)  << mon.mbpsBandwidth    << "Mb/s " << endl;
         output << "BUFFERLEFT:  SND: " << setw(11) << mon.byteAvailSndBuf    << "  RCV:        " << setw(11) << mon.byteAvailRcvBuf      << endl;
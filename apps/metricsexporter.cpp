@@ -0,0 +1,346 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+
+#include "metricsexporter.hpp"
+#include "srt_compat.h"
+
+using namespace std;
+
+#ifdef _WIN32
+static void SysCloseSocket(int sock) { ::closesocket(sock); }
+#else
+static void SysCloseSocket(int sock) { ::close(sock); }
+#endif
+
+// Don't get SIGPIPE when the client has gone meanwhile.
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+namespace
+{
+
+struct MetricDef
+{
+    const char* name;
+    const char* type;
+    const char* help;
+    double (*value)(const SRT_SOCKSTATS&);
+};
+
+// Only the values that don't depend on the interval of clearing; the rates
+// are meant to be calculated by the metrics consumer from the counters.
+const MetricDef metric_defs [] = {
+    { "srt_sent_packets", "counter", "Data packets sent, including retransmissions",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktSentTotal); } },
+    { "srt_received_packets", "counter", "Data packets received",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktRecvTotal); } },
+    { "srt_sent_lost_packets", "counter", "Data packets reported lost by the receiver",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktSndLossTotal); } },
+    { "srt_received_lost_packets", "counter", "Data packets detected lost by the receiver",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktRcvLossTotal); } },
+    { "srt_retransmitted_packets", "counter", "Data packets retransmitted",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktRetransTotal); } },
+    { "srt_sent_dropped_packets", "counter", "Data packets dropped by the sender as too late to send",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktSndDropTotal); } },
+    { "srt_received_dropped_packets", "counter", "Data packets dropped by the receiver as too late to play",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktRcvDropTotal); } },
+    { "srt_sent_bytes", "counter", "Bytes sent, including all headers",
+        [](const SRT_SOCKSTATS& s) { return double(s.byteSentTotal); } },
+    { "srt_received_bytes", "counter", "Bytes received, including all headers",
+        [](const SRT_SOCKSTATS& s) { return double(s.byteRecvTotal); } },
+    { "srt_rtt_seconds", "gauge", "Smoothed round-trip time",
+        [](const SRT_SOCKSTATS& s) { return s.msRTT / 1000.0; } },
+    { "srt_bandwidth_bits_per_second", "gauge", "Estimated link bandwidth",
+        [](const SRT_SOCKSTATS& s) { return s.mbpsBandwidth * 1000000.0; } },
+    { "srt_max_bandwidth_bits_per_second", "gauge", "Maximum sending bandwidth",
+        [](const SRT_SOCKSTATS& s) { return s.mbpsMaxBW * 1000000.0; } },
+    { "srt_flow_window_packets", "gauge", "Flow window size",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktFlowWindow); } },
+    { "srt_congestion_window_packets", "gauge", "Congestion window size",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktCongestionWindow); } },
+    { "srt_flight_packets", "gauge", "Packets sent and not yet acknowledged",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktFlightSize); } },
+    { "srt_send_buffer_packets", "gauge", "Packets in the sender buffer",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktSndBuf); } },
+    { "srt_send_buffer_seconds", "gauge", "Time span of the packets in the sender buffer",
+        [](const SRT_SOCKSTATS& s) { return s.msSndBuf / 1000.0; } },
+    { "srt_receive_buffer_packets", "gauge", "Packets in the receiver buffer",
+        [](const SRT_SOCKSTATS& s) { return double(s.pktRcvBuf); } },
+    { "srt_receive_buffer_seconds", "gauge", "Time span of the packets in the receiver buffer",
+        [](const SRT_SOCKSTATS& s) { return s.msRcvBuf / 1000.0; } },
+};
+
+struct HistogramDef
+{
+    const char* name;
+    const char* help;
+    SRT_HISTOGRAM SRT_HISTSTATS::*hist;
+};
+
+const HistogramDef histogram_defs [] = {
+    { "srt_receive_transit_seconds", "Packet arrival time versus its origin time on the TSBPD time base", &SRT_HISTSTATS::rcvTransit },
+    { "srt_receive_buffer_delay_seconds", "Time from packet arrival to delivery to the application", &SRT_HISTSTATS::rcvBuffer },
+    { "srt_send_lag_seconds", "Delay of sending a packet versus its schedule", &SRT_HISTSTATS::sndLag },
+};
+
+string SocketLabel(SRTSOCKET id)
+{
+    ostringstream out;
+    out << "{socket=\"" << id << "\"";
+    return out.str();
+}
+
+}
+
+SrtMetricsExporter::SrtMetricsExporter(int eid, int refresh_ms)
+    : m_eid(eid)
+    , m_refresh_ms(refresh_ms)
+    , m_snapshot("# EOF\n")
+{
+}
+
+SrtMetricsExporter::~SrtMetricsExporter()
+{
+    Stop();
+}
+
+string SrtMetricsExporter::Format(const vector<SRT_SOCKSTATS>& stats, const vector<SRT_HISTSTATS>& hists)
+{
+    ostringstream out;
+    out.precision(9);
+
+    for (const MetricDef& m: metric_defs)
+    {
+        const bool counter = strcmp(m.type, "counter") == 0;
+        out << "# TYPE " << m.name << " " << m.type << "\n";
+        out << "# HELP " << m.name << " " << m.help << ".\n";
+        for (const SRT_SOCKSTATS& s: stats)
+            out << m.name << (counter ? "_total" : "") << SocketLabel(s.id) << "} " << m.value(s) << "\n";
+    }
+
+    // The buckets are reported per power of two. The samples are in whole
+    // microseconds, so a bucket ending at 2^n us covers up to 2^n-1 us.
+    for (const HistogramDef& h: histogram_defs)
+    {
+        out << "# TYPE " << h.name << " histogram\n";
+        out << "# HELP " << h.name << " " << h.help << ".\n";
+        for (size_t i = 0; i < stats.size(); ++i)
+        {
+            const SRT_HISTOGRAM& hist = hists[i].*h.hist;
+            const string label = SocketLabel(stats[i].id);
+            uint64_t cumulative = 0;
+            for (int b = 0; b < SRT_HISTOGRAM_BUCKETS - 1; ++b)
+            {
+                cumulative += hist.buckets[b];
+                if (b % 4 != 3)
+                    continue;
+                out << h.name << "_bucket" << label << ",le=\""
+                    << (srt_histogram_floor(b + 1) - 1) / 1000000.0 << "\"} " << cumulative << "\n";
+            }
+            out << h.name << "_bucket" << label << ",le=\"+Inf\"} " << hist.count << "\n";
+            out << h.name << "_count" << label << "} " << hist.count << "\n";
+            out << h.name << "_sum" << label << "} " << hist.usSum / 1000000.0 << "\n";
+        }
+    }
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+void SrtMetricsExporter::Refresh()
+{
+    vector<SRT_SOCKSTATS> stats(16);
+    for (;;)
+    {
+        const int n = srt_bulkstats(SRT_STATS_EPOLL, m_eid, SRT_STATSF_TOTAL | SRT_STATSF_LINK | SRT_STATSF_BUFFER,
+                stats.data(), int(stats.size()), 0);
+        if (n == SRT_ERROR)
+            return;
+        if (n <= int(stats.size()))
+        {
+            stats.resize(n);
+            break;
+        }
+        stats.resize(n);
+    }
+
+    // Sockets that aren't connected (such as listeners) have no statistics.
+    vector<SRT_SOCKSTATS> connected;
+    vector<SRT_HISTSTATS> hists;
+    for (const SRT_SOCKSTATS& s: stats)
+    {
+        SRT_HISTSTATS h;
+        if (s.fields == 0 || srt_histstats(s.id, &h, 0) == SRT_ERROR)
+            continue;
+        connected.push_back(s);
+        hists.push_back(h);
+    }
+
+    string text = Format(connected, hists);
+    lock_guard<mutex> lk(m_lock);
+    m_snapshot.swap(text);
+}
+
+string SrtMetricsExporter::Snapshot()
+{
+    lock_guard<mutex> lk(m_lock);
+    return m_snapshot;
+}
+
+void SrtMetricsExporter::Start(const string& address)
+{
+    string host = "127.0.0.1";
+    string port = address;
+    const size_t colon = address.rfind(':');
+    if (colon != string::npos)
+    {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+
+    const sockaddr_in sa = CreateAddrInet(host, (unsigned short)stoi(port));
+    m_listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_listener == -1)
+        throw runtime_error("metrics: can't create socket: " + SysStrError(SysError()));
+
+    const int yes = 1;
+    ::setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof yes);
+    if (::bind(m_listener, (const sockaddr*)&sa, sizeof sa) == -1 || ::listen(m_listener, 5) == -1)
+    {
+        const int err = SysError();
+        SysCloseSocket(m_listener);
+        m_listener = -1;
+        throw runtime_error("metrics: can't listen on " + host + ":" + port + ": " + SysStrError(err));
+    }
+
+    Refresh();
+    m_running = true;
+    m_refresh_thread = thread(&SrtMetricsExporter::RefreshLoop, this);
+    m_serve_thread = thread(&SrtMetricsExporter::ServeLoop, this);
+}
+
+void SrtMetricsExporter::Stop()
+{
+    {
+        lock_guard<mutex> lk(m_lock);
+        if (!m_running)
+            return;
+        m_running = false;
+    }
+    m_stop_cond.notify_all();
+    m_refresh_thread.join();
+    m_serve_thread.join();
+    SysCloseSocket(m_listener);
+    m_listener = -1;
+}
+
+void SrtMetricsExporter::RefreshLoop()
+{
+    unique_lock<mutex> lk(m_lock);
+    while (m_running)
+    {
+        m_stop_cond.wait_for(lk, chrono::milliseconds(m_refresh_ms));
+        if (!m_running)
+            break;
+        lk.unlock();
+        Refresh();
+        lk.lock();
+    }
+}
+
+// Waits until the socket is readable, up to the given time. Used instead of
+// blocking calls, so that the server thread checks for Stop() regularly.
+static bool WaitReadable(int sock, int timeout_ms)
+{
+    fd_set rset;
+    FD_ZERO(&rset);
+    FD_SET(sock, &rset);
+    timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    return ::select(sock + 1, &rset, NULL, NULL, &tv) > 0;
+}
+
+void SrtMetricsExporter::ServeLoop()
+{
+    for (;;)
+    {
+        {
+            lock_guard<mutex> lk(m_lock);
+            if (!m_running)
+                return;
+        }
+
+        if (!WaitReadable(m_listener, 100))
+            continue;
+
+        const int client = ::accept(m_listener, NULL, NULL);
+        if (client == -1)
+            continue;
+        ServeClient(client);
+        SysCloseSocket(client);
+    }
+}
+
+void SrtMetricsExporter::ServeClient(int client)
+{
+    // Only the request line is needed; the rest of the header is
+    // read just so that the client doesn't get a reset.
+    string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == string::npos && request.size() < 8192)
+    {
+        if (!WaitReadable(client, 1000))
+            return;
+        const int n = ::recv(client, buf, sizeof buf, 0);
+        if (n <= 0)
+            return;
+        request.append(buf, n);
+    }
+
+    string status = "200 OK";
+    string content_type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    string body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+    {
+        body = Snapshot();
+    }
+    else
+    {
+        status = "404 Not Found";
+        content_type = "text/plain";
+        body = "Only GET /metrics is supported\n";
+    }
+
+    ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+        << "Content-Type: " << content_type << "\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+
+    const string out = response.str();
+    size_t sent = 0;
+    while (sent < out.size())
+    {
+        const int n = ::send(client, out.data() + sent, int(out.size() - sent), SEND_FLAGS);
+        if (n <= 0)
+            return;
+        sent += n;
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef INC__METRICSEXPORTER_HPP
+#define INC__METRICSEXPORTER_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "apputil.hpp"
+
+// Serves the statistics of all SRT sockets subscribed in an epoll container
+// as OpenMetrics text over HTTP (GET /metrics). The text is generated by
+// a separate thread every refresh period and the HTTP requests are served
+// from this cached snapshot, so the frequency of scraping doesn't influence
+// the transmission. The statistics are read with srt_bulkstats and
+// srt_histstats, which don't clear any counters.
+class SrtMetricsExporter
+{
+public:
+    SrtMetricsExporter(int eid, int refresh_ms);
+    ~SrtMetricsExporter();
+
+    // Starts the HTTP server on the given address, "[host:]port". The host
+    // defaults to 127.0.0.1. Throws std::runtime_error on failure.
+    void Start(const std::string& address);
+    void Stop();
+
+    // Currently cached OpenMetrics text.
+    std::string Snapshot();
+
+    static std::string Format(const std::vector<SRT_SOCKSTATS>& stats, const std::vector<SRT_HISTSTATS>& hists);
+
+private:
+    void RefreshLoop();
+    void ServeLoop();
+    void ServeClient(int client);
+    void Refresh();
+
+    const int m_eid;
+    const int m_refresh_ms;
+
+    int m_listener = -1;
+    bool m_running = false;
+    std::thread m_refresh_thread;
+    std::thread m_serve_thread;
+    std::mutex m_lock;
+    std::condition_variable m_stop_cond;
+    std::string m_snapshot; // guarded by m_lock
+};
+
+#endif // INC__METRICSEXPORTER_HPP
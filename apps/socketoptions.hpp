@@ -235,7 +235,12 @@ const SocketOption srt_options [] {
     { "peeridletimeo", 0, SRTO_PEERIDLETIMEO, SocketOption::PRE, SocketOption::INT, nullptr },
     { "packetfilter", 0, SRTO_PACKETFILTER, SocketOption::PRE, SocketOption::STRING, nullptr },
     { "groupconnect", 0, SRTO_GROUPCONNECT, SocketOption::PRE, SocketOption::INT, nullptr},
-    { "groupstabtimeo", 0, SRTO_GROUPSTABTIMEO, SocketOption::PRE, SocketOption::INT, nullptr}
+    { "groupstabtimeo", 0, SRTO_GROUPSTABTIMEO, SocketOption::PRE, SocketOption::INT, nullptr},
+    { "groupfastswitch", 0, SRTO_GROUPFASTSWITCH, SocketOption::PRE, SocketOption::BOOL, nullptr},
+    { "groupsharedrcv", 0, SRTO_GROUPSHAREDRCV, SocketOption::PRE, SocketOption::BOOL, nullptr},
+    { "acceptthread", 0, SRTO_ACCEPTTHREAD, SocketOption::PRE, SocketOption::BOOL, nullptr},
+    { "ccseed", 0, SRTO_CCSEED, SocketOption::PRE, SocketOption::BOOL, nullptr},
+    { "pacingdelay", 0, SRTO_PACINGDELAY, SocketOption::PRE, SocketOption::INT, nullptr}
 };
 }
 
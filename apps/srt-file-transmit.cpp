@@ -23,9 +23,17 @@ written by
 #include <string>
 #include <csignal>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <chrono>
 #include <cassert>
+#include <fstream>
+#include <iomanip>
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
 #include <srt.h>
 #include <udt.h>
 
@@ -65,6 +73,7 @@ struct FileTransmitConfig
     string stats_out;
     SrtStatsPrintFormat stats_pf = SRTSTATS_PROFMAT_2COLS;
     bool full_stats = false;
+    int streams = 1;
 
     string source;
     string target;
@@ -97,6 +106,7 @@ int parse_args(FileTransmitConfig &cfg, int argc, char** argv)
         o_statsout  = { "statsout" },
         o_statspf   = { "pf", "statspf" },
         o_statsfull = { "f", "fullstats" },
+        o_streams   = { "n", "streams" },
         o_loglevel  = { "ll", "loglevel" },
         o_logfa     = { "logfa" },
         o_logfile   = { "logfile" },
@@ -113,6 +123,7 @@ int parse_args(FileTransmitConfig &cfg, int argc, char** argv)
         { o_statsout,     OptionScheme::ARG_ONE },
         { o_statspf,      OptionScheme::ARG_ONE },
         { o_statsfull,    OptionScheme::ARG_NONE },
+        { o_streams,      OptionScheme::ARG_ONE },
         { o_loglevel,     OptionScheme::ARG_ONE },
         { o_logfa,        OptionScheme::ARG_ONE },
         { o_logfile,      OptionScheme::ARG_ONE },
@@ -159,6 +170,7 @@ int parse_args(FileTransmitConfig &cfg, int argc, char** argv)
         PrintOptionHelp(o_statsout, "<filename>", "output stats to file");
         PrintOptionHelp(o_statspf, "<format=default>", "stats printing format [json|csv|default]");
         PrintOptionHelp(o_statsfull, "", "full counters in stats-report (prints total statistics)");
+        PrintOptionHelp(o_streams, "<n=1>", "number of parallel connections, using ports PORT to PORT+n-1");
         PrintOptionHelp(o_loglevel, "<level=error>", "log level [fatal,error,info,note,warning]");
         PrintOptionHelp(o_logfa, "<fas=general,...>", "log functional area [all,general,bstats,control,data,tsbpd,rexmit]");
         PrintOptionHelp(o_logfile, "<filename="">", "write logs to file");
@@ -211,6 +223,12 @@ int parse_args(FileTransmitConfig &cfg, int argc, char** argv)
     }
 
     cfg.full_stats = Option<OutBool>(params, false, o_statsfull);
+    cfg.streams    = stoi(Option<OutString>(params, "1", o_streams));
+    if (cfg.streams < 1 || cfg.streams > 64)
+    {
+        cerr << "ERROR: Number of streams must be between 1 and 64\n";
+        return 1;
+    }
     cfg.loglevel   = SrtParseLogLevel(Option<OutString>(params, "error", o_loglevel));
     cfg.logfas     = SrtParseLogFA(Option<OutString>(params, "", o_logfa));
     cfg.logfile    = Option<OutString>(params, "", o_logfile);
@@ -317,6 +335,15 @@ bool DoUpload(UriParser& ut, string path, string filename,
             srt_setsockflag(tar->GetSRTSocket(), SRTO_TRANSTYPE,
                 &sockopt, sizeof sockopt);
 
+            // Setting the transmission type resets the congestion
+            // controller, so restore the one requested in the URI.
+            if (ut.parameters().count("congestion"))
+            {
+                const string cc = ut.queryValue("congestion");
+                srt_setsockflag(tar->GetSRTSocket(), SRTO_CONGESTION,
+                    cc.c_str(), cc.size());
+            }
+
             int events = SRT_EPOLL_OUT | SRT_EPOLL_ERR;
             if (srt_epoll_add_usock(pollid,
                     tar->GetSRTSocket(), &events))
@@ -504,6 +531,15 @@ bool DoDownload(UriParser& us, string directory, string filename,
             srt_setsockflag(src->GetSRTSocket(), SRTO_TRANSTYPE,
                 &sockopt, sizeof sockopt);
 
+            // Setting the transmission type resets the congestion
+            // controller, so restore the one requested in the URI.
+            if (us.parameters().count("congestion"))
+            {
+                const string cc = us.queryValue("congestion");
+                srt_setsockflag(src->GetSRTSocket(), SRTO_CONGESTION,
+                    cc.c_str(), cc.size());
+            }
+
             int events = SRT_EPOLL_IN | SRT_EPOLL_ERR;
             if (srt_epoll_add_usock(pollid,
                     src->GetSRTSocket(), &events))
@@ -602,6 +638,12 @@ bool DoDownload(UriParser& us, string directory, string filename,
             }
 
             int n = src->Read(cfg.chunk_size, buf, out_stats);
+            if (n == SRT_ERROR && srt_getlasterror(NULL) == SRT_EASYNCRCV)
+            {
+                // The read-ready event was already cleared, wait for the next one.
+                continue;
+            }
+
             if (n == SRT_ERROR)
             {
                 cerr << "Download: SRT error: " << srt_getlasterror_str() << endl;
@@ -636,6 +678,498 @@ exit:
     return result;
 }
 
+// Parallel transmission.
+//
+// The files are split into ranges, which are sent over several SRT
+// connections at once. The connection number i uses the port PORT+i
+// on both sides, so every connection runs on its own multiplexer with
+// its own sender and receiver queue threads. Every range is preceded
+// by a header:
+//
+//     | name length (32) | offset (64) | length (64) | name ... |
+//
+// (all numbers in network order), followed by the range data. A range
+// is sent with srt_sendfile and received directly into the target file
+// at the given offset. The connection is closed by the sender when
+// there are no more ranges to send.
+
+struct FileRange
+{
+    string path;    // local path (sender only)
+    string name;    // file name as known to the receiver
+    int64_t offset;
+    int64_t length;
+};
+
+// The fields read by the monitoring thread while the stream's
+// thread runs are atomic; 'ok' is read only after joining it.
+struct ParallelStream
+{
+    SRTSOCKET sock = SRT_INVALID_SOCK;
+    atomic<int64_t> bytes {0};
+    atomic<bool> done {false};
+    atomic<chrono::steady_clock::time_point> start {chrono::steady_clock::time_point()};
+    atomic<chrono::steady_clock::time_point> finish {chrono::steady_clock::time_point()};
+    bool ok = false;
+};
+
+static const size_t RANGE_HEADER_SIZE = 4 + 8 + 8;
+static const int64_t RANGE_MIN_SIZE = 1024 * 1024;
+
+// The sender connects all its streams at once, so when one of them is
+// connected, the others are not waited for longer than this.
+static const chrono::seconds ACCEPT_TIMEOUT(10);
+
+static void PutNumber(char* at, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        at[i] = char((value >> (8 * (size - 1 - i))) & 0xFF);
+}
+
+static uint64_t GetNumber(const char* at, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+        value = (value << 8) | uint8_t(at[i]);
+    return value;
+}
+
+static bool SendAll(SRTSOCKET s, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        const int st = srt_send(s, data, int(size));
+        if (st == SRT_ERROR)
+            return false;
+        data += st;
+        size -= st;
+    }
+    return true;
+}
+
+// Returns false on error or when the connection was closed
+// before the whole buffer was filled.
+static bool RecvAll(SRTSOCKET s, char* data, size_t size)
+{
+    while (size > 0)
+    {
+        const int st = srt_recv(s, data, int(size));
+        if (st == SRT_ERROR || st == 0)
+            return false;
+        data += st;
+        size -= st;
+    }
+    return true;
+}
+
+// Waits for a connection on the listener, as long as no stream is
+// connected, and then for at most ACCEPT_TIMEOUT.
+static SRTSOCKET AcceptStream(SRTSOCKET listener, int index, const atomic<bool>& anyconnected)
+{
+    const int eid = srt_epoll_create();
+    const int events = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+    srt_epoll_add_usock(eid, listener, &events);
+
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    bool ready = false;
+    while (!interrupt && !ready)
+    {
+        SRT_EPOLL_EVENT ev;
+        ready = srt_epoll_uwait(eid, &ev, 1, 100) > 0;
+
+        const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (anyconnected && deadline == chrono::steady_clock::time_point::max())
+            deadline = now + ACCEPT_TIMEOUT;
+        if (!ready && now > deadline)
+        {
+            cerr << "Stream " << index << ": no connection within " << ACCEPT_TIMEOUT.count()
+                << " s after the other streams" << endl;
+            break;
+        }
+    }
+    srt_epoll_release(eid);
+
+    if (!ready)
+        return SRT_INVALID_SOCK;
+
+    sockaddr_in scl;
+    int sclen = sizeof scl;
+    const SRTSOCKET a = srt_accept(listener, (sockaddr*)&scl, &sclen);
+    if (a == SRT_INVALID_SOCK)
+        cerr << "Stream " << index << ": srt_accept: " << srt_getlasterror_str() << endl;
+    return a;
+}
+
+// Establishes the connection for the stream number 'index' in blocking
+// mode, as a caller or listener, as the URI defines it. 'w_anyconnected'
+// is set by the first stream that gets connected.
+static SRTSOCKET ConnectStream(const UriParser& uri, int index, atomic<bool>& w_anyconnected)
+{
+    map<string, string> options = uri.parameters();
+    options["transtype"] = "file";
+    const string host = uri.host();
+    const int port = uri.portno() + index;
+
+    SRTSOCKET s = srt_create_socket();
+    if (s == SRT_INVALID_SOCK)
+        return s;
+
+    const SocketOption::Mode mode = SrtConfigurePre(s, host, options);
+    if (mode == SocketOption::CALLER)
+    {
+        sockaddr_in sa = CreateAddrInet(host, port);
+        if (srt_connect(s, (sockaddr*)&sa, sizeof sa) == SRT_ERROR)
+        {
+            cerr << "Stream " << index << ": srt_connect: " << srt_getlasterror_str() << endl;
+            srt_close(s);
+            return SRT_INVALID_SOCK;
+        }
+    }
+    else if (mode == SocketOption::LISTENER)
+    {
+        const string adapter = options.count("adapter") ? options["adapter"] : host;
+        sockaddr_in sa = CreateAddrInet(adapter, port);
+        if (srt_bind(s, (sockaddr*)&sa, sizeof sa) == SRT_ERROR
+                || srt_listen(s, 1) == SRT_ERROR)
+        {
+            cerr << "Stream " << index << ": srt_bind/listen: " << srt_getlasterror_str() << endl;
+            srt_close(s);
+            return SRT_INVALID_SOCK;
+        }
+
+        const SRTSOCKET a = AcceptStream(s, index, w_anyconnected);
+        srt_close(s);
+        if (a == SRT_INVALID_SOCK)
+            return SRT_INVALID_SOCK;
+        s = a;
+    }
+    else
+    {
+        cerr << "Stream " << index << ": only caller and listener modes are supported in parallel mode" << endl;
+        srt_close(s);
+        return SRT_INVALID_SOCK;
+    }
+
+    SrtConfigurePost(s, options);
+    w_anyconnected = true;
+    Verb() << "Stream " << index << " connected on port " << port;
+    return s;
+}
+
+static void ReportParallel(const vector<unique_ptr<ParallelStream>>& streams, bool final_report)
+{
+    int64_t total = 0;
+    chrono::steady_clock::time_point first = chrono::steady_clock::time_point::max(), last;
+    const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        const ParallelStream& st = *streams[i];
+        const chrono::steady_clock::time_point start = st.start, finish = st.finish;
+        if (start == chrono::steady_clock::time_point())
+            continue;
+        const chrono::steady_clock::time_point end = finish == chrono::steady_clock::time_point() ? now : finish;
+        const double secs = chrono::duration<double>(end - start).count();
+        const int64_t bytes = st.bytes;
+        total += bytes;
+        first = min(first, start);
+        last = max(last, end);
+
+        if (final_report)
+        {
+            cerr << "Stream " << i << ": " << bytes << " bytes in " << fixed << setprecision(3) << secs << " s, "
+                << setprecision(2) << (secs > 0 ? bytes * 8 / secs / 1000000 : 0) << " Mbps"
+                << (st.ok ? "" : " (FAILED)") << endl;
+        }
+    }
+
+    const double secs = first < last ? chrono::duration<double>(last - first).count() : 0;
+    cerr << (final_report ? "Total: " : "Progress: ") << total << " bytes in "
+        << fixed << setprecision(3) << secs << " s, aggregate "
+        << setprecision(2) << (secs > 0 ? total * 8 / secs / 1000000 : 0) << " Mbps" << endl;
+}
+
+// Waits for all streams to finish, reporting the progress every second in verbose mode.
+static void MonitorParallel(vector<unique_ptr<ParallelStream>>& streams, vector<thread>& threads)
+{
+    chrono::steady_clock::time_point lastreport = chrono::steady_clock::now();
+    for (;;)
+    {
+        bool running = false;
+        for (auto& st: streams)
+            if (!st->done)
+                running = true;
+        if (!running)
+            break;
+
+        this_thread::sleep_for(chrono::milliseconds(100));
+        if (Verbose::on && chrono::steady_clock::now() - lastreport > chrono::seconds(1))
+        {
+            ReportParallel(streams, false);
+            lastreport = chrono::steady_clock::now();
+        }
+    }
+
+    for (auto& t: threads)
+        t.join();
+
+    ReportParallel(streams, true);
+}
+
+static bool CollectRanges(const string& path, int nstreams, vector<FileRange>& w_ranges)
+{
+    vector<pair<string, string>> files; // path, name
+
+    struct stat state;
+    if (stat(path.c_str(), &state) == -1)
+    {
+        cerr << "Error accessing '" << path << "'" << endl;
+        return false;
+    }
+
+    if (S_ISDIR(state.st_mode))
+    {
+#ifdef _WIN32
+        cerr << "Sending a directory is not supported on this platform" << endl;
+        return false;
+#else
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+        {
+            cerr << "Error opening directory '" << path << "'" << endl;
+            return false;
+        }
+        while (dirent* ent = readdir(dir))
+        {
+            const string fpath = path + "/" + ent->d_name;
+            struct stat fstate;
+            if (stat(fpath.c_str(), &fstate) == 0 && S_ISREG(fstate.st_mode))
+                files.push_back(make_pair(fpath, string(ent->d_name)));
+        }
+        closedir(dir);
+#endif
+    }
+    else
+    {
+        string directory, filename;
+        ExtractPath(path, (directory), (filename));
+        files.push_back(make_pair(path, filename));
+    }
+
+    int64_t total = 0;
+    vector<int64_t> sizes;
+    for (auto& f: files)
+    {
+        stat(f.first.c_str(), &state);
+        sizes.push_back(state.st_size);
+        total += state.st_size;
+    }
+
+    // Roughly 4 ranges per stream, so that the streams that
+    // go faster than others can take over the remaining work.
+    const int64_t rangesize = max(RANGE_MIN_SIZE, total / (nstreams * 4) + 1);
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        int64_t offset = 0;
+        do
+        {
+            const int64_t len = min(rangesize, sizes[i] - offset);
+            w_ranges.push_back(FileRange { files[i].first, files[i].second, offset, len });
+            offset += len;
+        }
+        while (offset < sizes[i]);
+    }
+
+    Verb() << "Sending " << files.size() << " file(s), " << total << " bytes in " << w_ranges.size() << " ranges";
+    return true;
+}
+
+bool UploadParallel(UriParser& ut, const string& path, const FileTransmitConfig& cfg)
+{
+    vector<FileRange> ranges;
+    if (!CollectRanges(path, cfg.streams, (ranges)))
+        return false;
+
+    mutex rangelock;
+    size_t nextrange = 0;
+    atomic<bool> anyconnected {false};
+
+    vector<unique_ptr<ParallelStream>> streams;
+    vector<thread> threads;
+    for (int i = 0; i < cfg.streams; ++i)
+        streams.emplace_back(new ParallelStream);
+
+    auto sendstream = [&](int i)
+    {
+        ParallelStream& st = *streams[i];
+        st.sock = ConnectStream(ut, i, (anyconnected));
+        if (st.sock == SRT_INVALID_SOCK)
+            return;
+        st.start = chrono::steady_clock::now();
+
+        for (;;)
+        {
+            FileRange r;
+            {
+                lock_guard<mutex> lk(rangelock);
+                if (nextrange == ranges.size() || interrupt)
+                    break;
+                r = ranges[nextrange++];
+            }
+
+            vector<char> header(RANGE_HEADER_SIZE + r.name.size());
+            PutNumber(&header[0], r.name.size(), 4);
+            PutNumber(&header[4], r.offset, 8);
+            PutNumber(&header[12], r.length, 8);
+            copy(r.name.begin(), r.name.end(), header.begin() + RANGE_HEADER_SIZE);
+
+            int64_t offset = r.offset;
+            if (!SendAll(st.sock, header.data(), header.size())
+                    || srt_sendfile(st.sock, r.path.c_str(), &offset, r.length, SRT_DEFAULT_SENDFILE_BLOCK) != r.length)
+            {
+                cerr << "Stream " << i << ": SRT error: " << srt_getlasterror_str() << endl;
+                srt_close(st.sock);
+                return;
+            }
+            st.bytes += r.length;
+            Verb() << "Stream " << i << ": sent " << r.name << " [" << r.offset << "+" << r.length << "]";
+        }
+
+        // Wait until everything is acknowledged before closing.
+        size_t bytes = 1, blocks;
+        while (!interrupt && bytes > 0 && srt_getsndbuffer(st.sock, &blocks, &bytes) != SRT_ERROR)
+            this_thread::sleep_for(chrono::milliseconds(10));
+
+        st.finish = chrono::steady_clock::now();
+        st.ok = !interrupt;
+        srt_close(st.sock);
+    };
+
+    for (int i = 0; i < cfg.streams; ++i)
+        threads.emplace_back([&, i] { sendstream(i); streams[i]->done = true; });
+
+    MonitorParallel(streams, threads);
+
+    if (nextrange < ranges.size())
+        return false;
+    for (auto& st: streams)
+        if (!st->ok)
+            return false;
+    return true;
+}
+
+bool DownloadParallel(UriParser& us, const string& directory, const FileTransmitConfig& cfg)
+{
+    // All ranges of a file are received into the same target file, each
+    // at its own offset. srt_recvfile truncates the file only when receiving
+    // at its beginning, so the range at the offset 0 first receives a single
+    // byte, and the other ranges of this file wait for it in the registry
+    // before writing anything. The range at the offset 0 is always handed
+    // out by the sender before the other ranges of the file.
+    mutex filelock;
+    condition_variable filecond;
+    set<string> created;
+    bool failed = false;
+    atomic<bool> anyconnected {false};
+
+    vector<unique_ptr<ParallelStream>> streams;
+    vector<thread> threads;
+    for (int i = 0; i < cfg.streams; ++i)
+        streams.emplace_back(new ParallelStream);
+
+    auto recvstream = [&](int i)
+    {
+        ParallelStream& st = *streams[i];
+        st.sock = ConnectStream(us, i, (anyconnected));
+        if (st.sock == SRT_INVALID_SOCK)
+        {
+            lock_guard<mutex> lk(filelock);
+            failed = true;
+            return;
+        }
+        st.start = chrono::steady_clock::now();
+
+        bool broken = false;
+        char header[RANGE_HEADER_SIZE];
+        while (!interrupt && RecvAll(st.sock, header, RANGE_HEADER_SIZE))
+        {
+            const size_t namelen = GetNumber(header, 4);
+            int64_t offset = GetNumber(header + 4, 8);
+            const int64_t length = GetNumber(header + 12, 8);
+
+            string name(namelen, '\0');
+            if (namelen == 0 || namelen > 4096 || !RecvAll(st.sock, &name[0], namelen)
+                    || name.find('/') != string::npos || name.find('\\') != string::npos || name == "..")
+            {
+                cerr << "Stream " << i << ": invalid range header" << endl;
+                lock_guard<mutex> lk(filelock);
+                failed = true;
+                broken = true;
+                break;
+            }
+
+            const string path = directory + "/" + name;
+            const int64_t first = offset;
+            int64_t head = 0;
+            if (offset == 0)
+            {
+                head = min<int64_t>(length, 1);
+                const bool headok = srt_recvfile(st.sock, path.c_str(), &offset, head, SRT_DEFAULT_RECVFILE_BLOCK) == head;
+                {
+                    lock_guard<mutex> lk(filelock);
+                    if (headok)
+                        created.insert(path);
+                    else
+                        failed = true;
+                }
+                filecond.notify_all();
+                if (!headok)
+                {
+                    cerr << "Stream " << i << ": error receiving " << name << ": " << srt_getlasterror_str() << endl;
+                    broken = true;
+                    break;
+                }
+                cerr << "Writing output to [" << path << "]" << endl;
+            }
+            else
+            {
+                unique_lock<mutex> lk(filelock);
+                while (!created.count(path) && !failed && !interrupt)
+                    filecond.wait_for(lk, chrono::milliseconds(100));
+                if (!created.count(path))
+                {
+                    broken = true;
+                    break;
+                }
+            }
+
+            if (srt_recvfile(st.sock, path.c_str(), &offset, length - head, SRT_DEFAULT_RECVFILE_BLOCK) != length - head)
+            {
+                cerr << "Stream " << i << ": error receiving " << name << ": " << srt_getlasterror_str() << endl;
+                lock_guard<mutex> lk(filelock);
+                failed = true;
+                broken = true;
+                break;
+            }
+            st.bytes += length;
+            Verb() << "Stream " << i << ": received " << name << " [" << first << "+" << length << "]";
+        }
+
+        st.finish = chrono::steady_clock::now();
+        st.ok = !interrupt && !broken;
+        srt_close(st.sock);
+    };
+
+    for (int i = 0; i < cfg.streams; ++i)
+        threads.emplace_back([&, i] { recvstream(i); streams[i]->done = true; });
+
+    MonitorParallel(streams, threads);
+    if (!failed)
+        cerr << "Download COMPLETE." << endl;
+    return !failed;
+}
+
 bool Upload(UriParser& srt_target_uri, UriParser& fileuri,
             const FileTransmitConfig &cfg, std::ostream &out_stats)
 {
@@ -657,6 +1191,9 @@ bool Upload(UriParser& srt_target_uri, UriParser& fileuri,
     // Add some extra parameters.
     srt_target_uri["transtype"] = "file";
 
+    if (cfg.streams > 1)
+        return UploadParallel(srt_target_uri, path, cfg);
+
     return DoUpload(srt_target_uri, path, filename, cfg, out_stats);
 }
 
@@ -673,6 +1210,9 @@ bool Download(UriParser& srt_source_uri, UriParser& fileuri,
     ExtractPath(path, (directory), (filename));
     Verb() << "Extract path '" << path << "': directory=" << directory << " filename=" << filename;
 
+    if (cfg.streams > 1)
+        return DownloadParallel(srt_source_uri, directory, cfg);
+
     return DoDownload(srt_source_uri, directory, filename, cfg, out_stats);
 }
 
@@ -705,6 +1245,15 @@ int main(int argc, char** argv)
     // SRT log handler
     //
     std::ofstream logfile_stream; // leave unused if not set
+
+    // The SRT threads may still log while exiting, so the log stream
+    // must be switched back to cerr before the file stream is destroyed.
+    struct LogStreamReset
+    {
+        bool active;
+        ~LogStreamReset() { if (active) UDT::setlogstream(std::cerr); }
+    } logfile_reset = { false };
+
     if (!cfg.logfile.empty())
     {
         logfile_stream.open(cfg.logfile.c_str());
@@ -715,6 +1264,7 @@ int main(int argc, char** argv)
         else
         {
             UDT::setlogstream(logfile_stream);
+            logfile_reset.active = true;
         }
     }
 
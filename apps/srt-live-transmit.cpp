@@ -72,6 +72,7 @@
 #include "logsupport.hpp"
 #include "transmitmedia.hpp"
 #include "verbose.hpp"
+#include "metricsexporter.hpp"
 
 // NOTE: This is without "haisrt/" because it uses an internal path
 // to the library. Application using the "installed" library should
@@ -141,6 +142,9 @@ struct LiveTransmitConfig
     SrtStatsPrintFormat stats_pf = SRTSTATS_PROFMAT_2COLS;
     bool auto_reconnect = true;
     bool full_stats = false;
+    string metrics;
+    int metrics_refresh = 1000;
+    string trace;
 
     string source;
     string target;
@@ -175,6 +179,9 @@ int parse_args(LiveTransmitConfig &cfg, int argc, char** argv)
         o_statsout      = { "statsout" },
         o_statspf       = { "pf", "statspf" },
         o_statsfull     = { "f", "fullstats" },
+        o_metrics       = { "metrics" },
+        o_metricsrefr   = { "metricsrefresh" },
+        o_trace         = { "trace" },
         o_loglevel      = { "ll", "loglevel" },
         o_logfa         = { "logfa" },
         o_log_internal  = { "loginternal"},
@@ -194,6 +201,9 @@ int parse_args(LiveTransmitConfig &cfg, int argc, char** argv)
         { o_statsout,     OptionScheme::ARG_ONE },
         { o_statspf,      OptionScheme::ARG_ONE },
         { o_statsfull,    OptionScheme::ARG_NONE },
+        { o_metrics,      OptionScheme::ARG_ONE },
+        { o_metricsrefr,  OptionScheme::ARG_ONE },
+        { o_trace,        OptionScheme::ARG_ONE },
         { o_loglevel,     OptionScheme::ARG_ONE },
         { o_logfa,        OptionScheme::ARG_ONE },
         { o_log_internal, OptionScheme::ARG_NONE },
@@ -243,6 +253,9 @@ int parse_args(LiveTransmitConfig &cfg, int argc, char** argv)
         PrintOptionHelp(o_statsout,  "<filename>", "output stats to file");
         PrintOptionHelp(o_statspf,   "<format=default>", "stats printing format [json|csv|default]");
         PrintOptionHelp(o_statsfull, "", "full counters in stats-report (prints total statistics)");
+        PrintOptionHelp(o_metrics,   "<[host:]port>", "serve OpenMetrics stats over HTTP (host default: 127.0.0.1)");
+        PrintOptionHelp(o_metricsrefr, "<ms=1000>", "refresh period of the OpenMetrics stats");
+        PrintOptionHelp(o_trace,     "<filename>", "record SRT events and write them to the file at exit");
         PrintOptionHelp(o_loglevel,  "<level=error>", "log level [fatal,error,info,note,warning]");
         PrintOptionHelp(o_logfa,     "<fas=general,...>", "log functional area [all,general,bstats,control,data,tsbpd,rexmit]");
         //PrintOptionHelp(o_log_internal, "", "use internal logger");
@@ -286,6 +299,14 @@ int parse_args(LiveTransmitConfig &cfg, int argc, char** argv)
     }
 
     cfg.full_stats   = OptionPresent(params, o_statsfull);
+    cfg.metrics      = Option<OutString>(params, o_metrics);
+    cfg.metrics_refresh = Option<OutNumber>(params, "1000", o_metricsrefr);
+    cfg.trace        = Option<OutString>(params, o_trace);
+    if (cfg.metrics_refresh <= 0)
+    {
+        cerr << "ERROR: Invalid metrics refresh period: " << cfg.metrics_refresh << endl;
+        return 1;
+    }
     cfg.loglevel     = SrtParseLogLevel(Option<OutString>(params, "error", o_loglevel));
     cfg.logfas       = SrtParseLogFA(Option<OutString>(params, "", o_logfa));
     cfg.log_internal = OptionPresent(params, o_log_internal);
@@ -330,6 +351,23 @@ int main(int argc, char** argv)
     if (parse_ret != 0)
         return parse_ret == 1 ? EXIT_FAILURE : 0;
 
+    // Write the event trace regardless of how this function returns.
+    struct TraceDump
+    {
+        string path;
+        ~TraceDump()
+        {
+            if (!path.empty() && srt_trace_dump(path.c_str()) == SRT_ERROR)
+                cerr << "ERROR: can't write the trace to " << path << ": " << srt_getlasterror_str() << endl;
+        }
+    } tracedump;
+
+    if (!cfg.trace.empty())
+    {
+        srt_trace_setup(SRT_TRACE_DEFAULT_EVENTS);
+        tracedump.path = cfg.trace;
+    }
+
     //
     // Set global config variables
     //
@@ -438,6 +476,24 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    // All SRT sockets in use are subscribed in pollid
+    unique_ptr<SrtMetricsExporter> metrics;
+    if (!cfg.metrics.empty())
+    {
+        metrics.reset(new SrtMetricsExporter(pollid, cfg.metrics_refresh));
+        try
+        {
+            metrics->Start(cfg.metrics);
+        }
+        catch (const std::exception& x)
+        {
+            cerr << "ERROR: " << x.what() << endl;
+            return 1;
+        }
+        if (!cfg.quiet)
+            cerr << "Serving OpenMetrics stats at http://" << cfg.metrics << "/metrics\n";
+    }
+
     size_t receivedBytes = 0;
     size_t wroteBytes = 0;
     size_t lostBytes = 0;
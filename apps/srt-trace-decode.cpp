@@ -0,0 +1,207 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+// Decodes the event trace written by srt_trace_dump into a timeline.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <ctime>
+#include <srt.h>
+
+#include "apputil.hpp"
+
+using namespace std;
+
+static const char* const event_names[SRT_TRACE_E_SIZE] = {
+    "NONE",
+    "SENT",
+    "RECV",
+    "RETRANS",
+    "SNDDROP",
+    "RCVDROP",
+    "ACK-SENT",
+    "ACK-RECV",
+    "NAK-SENT",
+    "NAK-RECV",
+    "ACKACK-SENT",
+    "ACKACK-RECV",
+    "TSBPD-RELEASE",
+    "CC-RATE"
+};
+
+static string DescribeArg(const SRT_TRACEEVENT& e)
+{
+    ostringstream out;
+    switch (e.type)
+    {
+    case SRT_TRACE_PKT_SENT:
+    case SRT_TRACE_PKT_RECV:
+    case SRT_TRACE_PKT_RETRANS:
+        out << "size=" << e.arg;
+        break;
+    case SRT_TRACE_PKT_SNDDROP:
+    case SRT_TRACE_PKT_RCVDROP:
+    case SRT_TRACE_NAK_SENT:
+    case SRT_TRACE_NAK_RECV:
+        out << "packets=" << e.arg;
+        break;
+    case SRT_TRACE_ACK_SENT:
+    case SRT_TRACE_ACK_RECV:
+        out << "ackno=" << e.arg;
+        break;
+    case SRT_TRACE_ACKACK_RECV:
+        out << "rtt=" << e.arg << "us";
+        break;
+    case SRT_TRACE_TSBPD_RELEASE:
+        out << "belated=" << e.arg << "us";
+        break;
+    case SRT_TRACE_CC_RATE:
+        out << "period=" << e.arg << "us";
+        break;
+    default:
+        break;
+    }
+    return out.str();
+}
+
+// Split to avoid overflow: the steady clock may tick at the CPU frequency.
+static int64_t TicksToMicroseconds(int64_t ticks, int64_t ticks_per_sec)
+{
+    return ticks / ticks_per_sec * 1000000 + ticks % ticks_per_sec * 1000000 / ticks_per_sec;
+}
+
+static string FormatWallTime(int64_t unix_us)
+{
+    const time_t sec = time_t(unix_us / 1000000);
+    tm tmv;
+#ifdef _WIN32
+    localtime_s(&tmv, &sec);
+#else
+    localtime_r(&sec, &tmv);
+#endif
+    char buf[32];
+    strftime(buf, sizeof buf, "%H:%M:%S", &tmv);
+    ostringstream out;
+    out << buf << "." << setw(6) << setfill('0') << (unix_us % 1000000);
+    return out.str();
+}
+
+static void PrintOptionHelp(const OptionName& opt_names, const string &value, const string &desc)
+{
+    cerr << "\t";
+    int i = 0;
+    for (auto opt : opt_names.names)
+    {
+        if (i++) cerr << ", ";
+        cerr << "-" << opt;
+    }
+
+    if (!value.empty())
+        cerr << ":"  << value;
+    cerr << "\t- " << desc << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    const OptionName
+        o_socket = { "s", "socket" },
+        o_csv    = { "csv" },
+        o_help   = { "h", "help" };
+
+    const vector<OptionScheme> optargs = {
+        { o_socket, OptionScheme::ARG_ONE },
+        { o_csv,    OptionScheme::ARG_NONE },
+        { o_help,   OptionScheme::ARG_NONE }
+    };
+
+    options_t params = ProcessOptions(argv, argc, optargs);
+
+    if (params[""].size() != 1 || OptionPresent(params, o_help))
+    {
+        cerr << "Usage: " << argv[0] << " [options] <trace file>\n";
+        cerr << "Decodes the event trace written by srt_trace_dump.\n";
+        PrintOptionHelp(o_socket, "<id>", "show only events of the given socket");
+        PrintOptionHelp(o_csv, "", "print in CSV format");
+        return 1;
+    }
+
+    const string path = params[""][0];
+    const int socket = Option<OutNumber>(params, "0", o_socket);
+    const bool csv = OptionPresent(params, o_csv);
+
+    ifstream in(path.c_str(), ios::in | ios::binary);
+    if (!in)
+    {
+        cerr << "ERROR: can't open '" << path << "'\n";
+        return 1;
+    }
+
+    SRT_TRACEHEADER hdr;
+    if (!in.read((char*)&hdr, sizeof hdr) || memcmp(hdr.magic, "SRTTRACE", sizeof hdr.magic) != 0)
+    {
+        cerr << "ERROR: '" << path << "' is not an SRT event trace\n";
+        return 1;
+    }
+
+    if (hdr.version != 1 || hdr.event_size != int32_t(sizeof(SRT_TRACEEVENT)) || hdr.ticks_per_sec <= 0 || hdr.count < 0)
+    {
+        cerr << "ERROR: unsupported trace version " << hdr.version << " (event size " << hdr.event_size << ")\n";
+        return 1;
+    }
+
+    vector<SRT_TRACEEVENT> events(hdr.count);
+    if (hdr.count > 0 && !in.read((char*)&events[0], sizeof(SRT_TRACEEVENT) * events.size()))
+    {
+        cerr << "ERROR: trace truncated, expected " << hdr.count << " events\n";
+        return 1;
+    }
+
+    if (csv)
+        cout << "Time,RelativeUs,Thread,Socket,Event,SeqNo,Arg\n";
+
+    // Relative times are counted from the first shown event.
+    bool first = true;
+    int64_t first_ts = 0;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const SRT_TRACEEVENT& e = events[i];
+        if (socket && e.socket != socket)
+            continue;
+
+        if (first)
+        {
+            first_ts = e.ts;
+            first = false;
+        }
+
+        const int64_t rel_us = TicksToMicroseconds(e.ts - first_ts, hdr.ticks_per_sec);
+        const int64_t unix_us = hdr.ref_unix_us + TicksToMicroseconds(e.ts - hdr.ref_ticks, hdr.ticks_per_sec);
+        const char* name = e.type < SRT_TRACE_E_SIZE ? event_names[e.type] : "UNKNOWN";
+
+        if (csv)
+        {
+            cout << FormatWallTime(unix_us) << "," << rel_us << "," << e.thread << "," << e.socket << ","
+                << name << "," << e.seqno << "," << e.arg << "\n";
+        }
+        else
+        {
+            cout << FormatWallTime(unix_us) << " +" << setw(10) << setfill(' ') << rel_us << "us T" << setw(3) << left
+                << e.thread << right << " @" << e.socket << " " << setw(13) << left << name << right
+                << " %" << e.seqno << " " << DescribeArg(e) << "\n";
+        }
+    }
+
+    return 0;
+}
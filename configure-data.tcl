@@ -43,6 +43,7 @@ set cmake_options {
     enable-logging "Should logging be enabled (default: ON)"
     enable-debug=<0,1,2> "Enable debug mode (0=disabled, 1=debug, 2=rel-with-debug)"
     enable-haicrypt-logging "Should logging in haicrypt be enabled (default: OFF)"
+    logging-min-level=<level> "The least severe log level compiled in: debug, note, warning, error, fatal (default: debug)"
     enable-inet-pton "Set to OFF to prevent usage of inet_pton when building against modern SDKs (default: ON)"
     enable-code-coverage "Enable code coverage reporting (default: OFF)"
     enable-monotonic-clock "Enforced clock_gettime with monotonic clock on GC CV /temporary fix for #729/ (default: OFF)"
@@ -51,6 +52,8 @@ set cmake_options {
     enable-shared "Should libsrt be built as a shared library (default: ON)"
     enable-static "Should libsrt be built as a static library (default: ON)"
     enable-suflip "Should suflip tool be built (default: OFF)"
+    enable-file-mmap "Use mmap/pwritev for srt_sendfile/srt_recvfile (default: ON)"
+    enable-tsc-clock "Use the CPU timestamp counter for the steady clock (x86 only) (default: OFF)"
     enable-getnameinfo "In-logs sockaddr-to-string should do rev-dns (default: OFF)"
     enable-unittests "Enable unit tests (default: OFF)"
     enable-thread-check "Enable #include <threadcheck.h> that implements THREAD_* macros"
@@ -66,6 +69,7 @@ set cmake_options {
     use-gnutls "DEPRECATED. Use USE_ENCLIB=openssl|gnutls|mbedtls instead"
     use-openssl-pc "Use pkg-config to find OpenSSL libraries (default: ON)"
     use-static-libstdc++ "Should use static rather than shared libstdc++ (default: OFF)"
+    use-timerfd "Use timerfd for waiting between the sent packets (Linux only) (default: OFF)"
 }
 
 set options $internal_options$cmake_options
@@ -0,0 +1,97 @@
+#!/bin/bash
+
+#
+# SRT - Secure, Reliable, Transport
+# Copyright (c) 2020 Haivision Systems Inc.
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+
+# Compares the congestion controllers available for file transmission
+# over a locally impaired link. The loopback interface is shaped with
+# netem (requires root and the sch_netem kernel module), then the same
+# file is transferred with srt-file-transmit using each controller.
+#
+# Usage: cc-compare.sh [options]
+#   -d <delay>   one-way delay added by netem (default: 50ms, so RTT=100ms)
+#   -l <loss>    random loss percentage (default: 1%)
+#   -r <rate>    bottleneck rate (default: 100mbit)
+#   -s <MB>      size of the transferred file in MB (default: 100)
+#   -n <runs>    number of runs per controller (default: 3)
+#   -c <list>    controllers to compare (default: "file bbr")
+#   -b <dir>     directory with srt-file-transmit (default: script's dir)
+
+DELAY=50ms
+LOSS=1%
+RATE=100mbit
+SIZE=100
+RUNS=3
+CONTROLLERS="file bbr"
+BINDIR=`dirname $0`
+PORT=9000
+
+while getopts "d:l:r:s:n:c:b:" opt; do
+	case $opt in
+		d) DELAY=$OPTARG ;;
+		l) LOSS=$OPTARG ;;
+		r) RATE=$OPTARG ;;
+		s) SIZE=$OPTARG ;;
+		n) RUNS=$OPTARG ;;
+		c) CONTROLLERS=$OPTARG ;;
+		b) BINDIR=$OPTARG ;;
+		*) exit 1 ;;
+	esac
+done
+
+APP=$BINDIR/srt-file-transmit
+if [[ ! -x $APP ]]; then
+	echo >&2 "ERROR: 'srt-file-transmit' not found in $BINDIR. Use -b to point to the build directory."
+	exit 1
+fi
+
+if ! tc qdisc replace dev lo root netem delay $DELAY loss $LOSS rate $RATE; then
+	echo >&2 "ERROR: cannot configure netem on lo (root and sch_netem required)."
+	exit 1
+fi
+
+WORKDIR=`mktemp -d`
+cleanup()
+{
+	tc qdisc del dev lo root 2>/dev/null
+	rm -rf $WORKDIR
+}
+trap cleanup EXIT
+
+# Fixed seed, so that every run transfers the same content
+openssl enc -aes-128-ctr -pass pass:srt -nosalt -in /dev/zero 2>/dev/null | head -c $((SIZE*1024*1024)) > $WORKDIR/src.bin
+
+echo "Link: delay=$DELAY loss=$LOSS rate=$RATE, file: ${SIZE}MB, runs: $RUNS"
+
+for cc in $CONTROLLERS; do
+	for run in `seq 1 $RUNS`; do
+		rm -rf $WORKDIR/out
+		mkdir $WORKDIR/out
+		PORT=$((PORT+1))
+
+		$APP -q "srt://:$PORT?transtype=file&congestion=$cc" file://$WORKDIR/out/ &
+		RCVPID=$!
+		sleep 1
+
+		# The options are given in the URI, so that they are applied
+		# before the connection is initiated.
+		START=`date +%s%N`
+		$APP -q file://$WORKDIR/src.bin "srt://127.0.0.1:$PORT?transtype=file&streamid=src.bin&congestion=$cc"
+		RESULT=$?
+		wait $RCVPID
+		END=`date +%s%N`
+
+		MS=$(( (END-START)/1000000 ))
+		if [[ $RESULT != 0 ]] || ! cmp -s $WORKDIR/src.bin $WORKDIR/out/src.bin; then
+			echo "$cc run $run: FAILED"
+			continue
+		fi
+		echo "$cc run $run: ${MS}ms, $(( SIZE*8*1024*1024/1000/MS )) kbps"
+	done
+done
@@ -0,0 +1,138 @@
+#!/bin/bash
+
+#
+# SRT - Secure, Reliable, Transport
+# Copyright (c) 2020 Haivision Systems Inc.
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+
+# Measures the cost of the logging configurations on the packet paths.
+# srt-file-transmit is built with each configuration, then the same file
+# is transferred over the loopback interface and the CPU time used by the
+# sender (CUDT::packData) and the receiver (CUDT::processData) is reported
+# per packet. The difference to the "off" configuration is the cost of the
+# log sites on these paths.
+#
+# Configurations:
+#   off          ENABLE_LOGGING=OFF
+#   min-error    LOGGING_MIN_LEVEL=error, runtime level error
+#   default      default build, runtime level error
+#   heavy        ENABLE_HEAVY_LOGGING=ON, runtime level error
+#   heavy-debug  ENABLE_HEAVY_LOGGING=ON, runtime level debug, logs to /dev/null
+#
+# Usage: log-overhead.sh [options]
+#   -s <MB>      size of the transferred file in MB (default: 200)
+#   -n <runs>    number of runs per configuration (default: 3)
+#   -c <list>    configurations to compare (default: all)
+#   -S <dir>     SRT source directory (default: the script's parent)
+#   -B <dir>     directory for the builds, reused if it exists (default: temporary)
+
+SIZE=200
+RUNS=3
+CONFIGS="off min-error default heavy heavy-debug"
+SRCDIR=`dirname $0`/..
+BUILDROOT=
+PORT=9100
+
+while getopts "s:n:c:S:B:" opt; do
+	case $opt in
+		s) SIZE=$OPTARG ;;
+		n) RUNS=$OPTARG ;;
+		c) CONFIGS=$OPTARG ;;
+		S) SRCDIR=$OPTARG ;;
+		B) BUILDROOT=$OPTARG ;;
+		*) exit 1 ;;
+	esac
+done
+
+WORKDIR=`mktemp -d`
+cleanup()
+{
+	rm -rf $WORKDIR
+}
+trap cleanup EXIT
+
+if [[ -z $BUILDROOT ]]; then
+	BUILDROOT=$WORKDIR
+fi
+
+config_options()
+{
+	case $1 in
+		off) echo "-DENABLE_LOGGING=OFF" ;;
+		min-error) echo "-DLOGGING_MIN_LEVEL=error -DENABLE_HEAVY_LOGGING=OFF" ;;
+		default) echo "-DENABLE_HEAVY_LOGGING=OFF" ;;
+		heavy|heavy-debug) echo "-DENABLE_HEAVY_LOGGING=ON" ;;
+		*) return 1 ;;
+	esac
+}
+
+config_loglevel()
+{
+	if [[ $1 == heavy-debug ]]; then
+		echo debug
+	else
+		echo error
+	fi
+}
+
+# Builds srt-file-transmit for the configuration, prints the binary path
+build()
+{
+	local dir=$BUILDROOT/build-$1
+	local opts=`config_options $1` || { echo >&2 "ERROR: unknown configuration '$1'"; return 1; }
+	mkdir -p $dir
+	if ! cmake -S $SRCDIR -B $dir -DCMAKE_BUILD_TYPE=Release -DENABLE_SHARED=OFF -DENABLE_APPS=ON $opts >$dir/build.log 2>&1 \
+		|| ! cmake --build $dir --target srt-file-transmit -j`nproc` >>$dir/build.log 2>&1; then
+		echo >&2 "ERROR: build of '$1' failed, see $dir/build.log"
+		return 1
+	fi
+	echo $dir/srt-file-transmit
+}
+
+# Prints the user+system CPU time in ms from the output of the 'time' keyword
+cpu_ms()
+{
+	tail -1 $1 | awk '{ printf "%d", ($1 + $2) * 1000 }'
+}
+
+head -c $((SIZE*1024*1024)) /dev/urandom > $WORKDIR/src.bin
+PACKETS=$(( SIZE*1024*1024/1456 ))
+
+echo "File: ${SIZE}MB (~$PACKETS packets), runs: $RUNS"
+printf "%-12s %8s %10s %10s %12s %12s\n" config wall-ms snd-cpu-ms rcv-cpu-ms snd-ns/pkt rcv-ns/pkt
+
+for cfg in $CONFIGS; do
+	APP=`build $cfg` || continue
+	LL=`config_loglevel $cfg`
+
+	for run in `seq 1 $RUNS`; do
+		rm -rf $WORKDIR/out
+		mkdir $WORKDIR/out
+		PORT=$((PORT+1))
+		TIMEFORMAT="%U %S"
+
+		{ time $APP -q -loglevel $LL -logfile /dev/null "srt://:$PORT?transtype=file" file://$WORKDIR/out/ ; } 2>$WORKDIR/rcv.time &
+		RCVPID=$!
+		sleep 1
+
+		START=`date +%s%N`
+		{ time $APP -q -loglevel $LL -logfile /dev/null file://$WORKDIR/src.bin "srt://127.0.0.1:$PORT?transtype=file&streamid=src.bin" ; } 2>$WORKDIR/snd.time
+		RESULT=$?
+		wait $RCVPID
+		END=`date +%s%N`
+
+		if [[ $RESULT != 0 ]] || ! cmp -s $WORKDIR/src.bin $WORKDIR/out/src.bin; then
+			echo "$cfg run $run: FAILED"
+			continue
+		fi
+
+		SND=`cpu_ms $WORKDIR/snd.time`
+		RCV=`cpu_ms $WORKDIR/rcv.time`
+		printf "%-12s %8d %10d %10d %12d %12d\n" $cfg $(( (END-START)/1000000 )) $SND $RCV \
+			$(( SND*1000000/PACKETS )) $(( RCV*1000000/PACKETS ))
+	done
+done
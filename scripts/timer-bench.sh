@@ -0,0 +1,89 @@
+#!/bin/bash
+
+#
+# SRT - Secure, Reliable, Transport
+# Copyright (c) 2020 Haivision Systems Inc.
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+
+# Compares the waiting modes of CTimer, which paces the sent packets.
+# The unit tests are built with each mode and the SyncTimer.PacingError
+# test is run, which sleeps until the next time at fixed intervals and
+# reports the distribution of the lateness and the CPU usage.
+#
+# Modes:
+#   condvar      default build, waiting on a condition variable
+#   busy         USE_BUSY_WAITING=ON, spinning in the last 1 ms
+#   timerfd      USE_TIMERFD=ON (Linux only)
+#
+# Usage: timer-bench.sh [options]
+#   -n <runs>    number of runs per mode (default: 3)
+#   -m <list>    modes to compare (default: all)
+#   -S <dir>     SRT source directory (default: the script's parent)
+#   -B <dir>     directory for the builds, reused if it exists (default: temporary)
+
+RUNS=3
+MODES="condvar busy timerfd"
+SRCDIR=`dirname $0`/..
+BUILDROOT=
+
+while getopts "n:m:S:B:" opt; do
+	case $opt in
+		n) RUNS=$OPTARG ;;
+		m) MODES=$OPTARG ;;
+		S) SRCDIR=$OPTARG ;;
+		B) BUILDROOT=$OPTARG ;;
+		*) exit 1 ;;
+	esac
+done
+
+WORKDIR=`mktemp -d`
+cleanup()
+{
+	rm -rf $WORKDIR
+}
+trap cleanup EXIT
+
+if [[ -z $BUILDROOT ]]; then
+	BUILDROOT=$WORKDIR
+fi
+
+mode_options()
+{
+	case $1 in
+		condvar) echo "-DUSE_BUSY_WAITING=OFF -DUSE_TIMERFD=OFF" ;;
+		busy) echo "-DUSE_BUSY_WAITING=ON -DUSE_TIMERFD=OFF" ;;
+		timerfd) echo "-DUSE_BUSY_WAITING=OFF -DUSE_TIMERFD=ON" ;;
+		*) return 1 ;;
+	esac
+}
+
+# Builds the unit tests for the mode, prints the binary path
+build()
+{
+	local dir=$BUILDROOT/build-$1
+	local opts=`mode_options $1` || { echo >&2 "ERROR: unknown mode '$1'"; return 1; }
+	mkdir -p $dir
+	if ! cmake -S $SRCDIR -B $dir -DCMAKE_BUILD_TYPE=Release -DENABLE_UNITTESTS=ON -DENABLE_APPS=OFF $opts >$dir/build.log 2>&1 \
+		|| ! cmake --build $dir --target test-srt -j`nproc` >>$dir/build.log 2>&1; then
+		echo >&2 "ERROR: build of '$1' failed, see $dir/build.log"
+		return 1
+	fi
+	echo $dir/test-srt
+}
+
+printf "%-10s %10s %8s %8s %8s %8s %6s\n" mode interval p50-us p99-us p99.9-us max-us cpu-%
+
+for mode in $MODES; do
+	TEST=`build $mode` || continue
+
+	for run in `seq 1 $RUNS`; do
+		# CTimer pacing 20us: late p50=33us p99=55us p99.9=280us max=658us, CPU 8%
+		$TEST --gtest_filter=SyncTimer.PacingError 2>&1 | grep "^CTimer pacing" | \
+			sed -e 's/[a-z.0-9]*=//g' -e 's/us//g' -e 's/[:,%]//g' | \
+			awk -v mode=$mode '{ printf "%-10s %10s %8d %8d %8d %8d %6d\n", mode, $3 "us", $5, $6, $7, $8, $10 }'
+	done
+done
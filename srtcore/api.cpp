@@ -106,6 +106,48 @@ CUDTSocket::~CUDTSocket()
    releaseMutex(m_ControlLock);
 }
 
+void CUDTSocket::reset()
+{
+   // Create the new entity first, so that the socket stays intact
+   // if this fails.
+   CUDT* udt = new CUDT(this);
+
+   // The loss lists take the most time to build among the connection
+   // objects and their size rarely differs between connections.
+   std::swap(udt->m_pSndLossList, m_pUDT->m_pSndLossList);
+   std::swap(udt->m_pRcvLossList, m_pUDT->m_pRcvLossList);
+   if (udt->m_pSndLossList)
+      udt->m_pSndLossList->clear();
+   if (udt->m_pRcvLossList)
+      udt->m_pRcvLossList->clear();
+
+   delete m_pUDT;
+   m_pUDT = udt;
+
+   delete m_pQueuedSockets;
+   m_pQueuedSockets = NULL;
+   delete m_pAcceptSockets;
+   m_pAcceptSockets = NULL;
+
+   m_Status = SRTS_INIT;
+   m_tsClosureTimeStamp = steady_clock::time_point();
+   m_SelfAddr = sockaddr_any();
+   m_PeerAddr = sockaddr_any();
+   m_SocketID = 0;
+   m_ListenSocket = 0;
+   m_PeerID = 0;
+   m_IncludedGroup = NULL;
+   m_IncludedIter = CUDTGroup::gli_NULL();
+   m_iISN = 0;
+   m_uiBackLog = 0;
+   m_iMuxID = -1;
+}
+
+bool CUDTSocket::hasConnectionObjects() const
+{
+   return m_pUDT->m_pSndLossList || m_pUDT->m_pRcvLossList;
+}
+
 
 SRT_SOCKSTATUS CUDTSocket::getStatus()
 {
@@ -173,6 +215,9 @@ m_TLSError(),
 m_mMultiplexer(),
 m_MultiplexerLock(),
 m_pCache(NULL),
+m_SocketPool(),
+m_zSocketPoolSize(0),
+m_SocketPoolLock(),
 m_bClosing(false),
 m_GCStopCond(),
 m_InitLock(),
@@ -199,10 +244,11 @@ m_ClosedSockets()
    setupMutex(m_GlobControlLock, "GlobControl");
    setupMutex(m_IDLock, "ID");
    setupMutex(m_InitLock, "Init");
+   setupMutex(m_SocketPoolLock, "SocketPool");
 
    pthread_key_create(&m_TLSError, TLSDestroy);
 
-   m_pCache = new CCache<CInfoBlock>;
+   m_pCache = new CInfoCache;
 }
 
 CUDTUnited::~CUDTUnited()
@@ -215,9 +261,12 @@ CUDTUnited::~CUDTUnited()
         cleanup();
     }
 
+    clearSocketPool();
+
     releaseMutex(m_GlobControlLock);
     releaseMutex(m_IDLock);
     releaseMutex(m_InitLock);
+    releaseMutex(m_SocketPoolLock);
 
     delete (CUDTException*)pthread_getspecific(m_TLSError);
     pthread_key_delete(m_TLSError);
@@ -270,6 +319,8 @@ int CUDTUnited::startup()
 
    m_bGCStatus = true;
 
+   fillSocketPool();
+
    return 0;
 }
 
@@ -305,6 +356,9 @@ int CUDTUnited::cleanup()
 
    m_bGCStatus = false;
 
+   // The GC thread has returned the last closed sockets to the pool.
+   clearSocketPool();
+
    // Global destruction code
 #ifdef _WIN32
    WSACleanup();
@@ -420,12 +474,10 @@ SRTSOCKET CUDTUnited::newSocket(CUDTSocket** pps)
 
    try
    {
-      ns = new CUDTSocket;
-      ns->m_pUDT = new CUDT(ns);
+      ns = acquireSocket();
    }
    catch (...)
    {
-      delete ns;
       throw CUDTException(MJ_SYSTEMRES, MN_MEMORY, 0);
    }
 
@@ -534,10 +586,11 @@ int CUDTUnited::newConnection(const SRTSOCKET listen, const sockaddr_any& peer,
        return -1;
    }
 
+   ns = NULL;
    try
    {
-      ns = new CUDTSocket;
-      ns->m_pUDT = new CUDT(ns, *(ls->m_pUDT));
+      ns = acquireSocket();
+      ns->m_pUDT->inheritOptions(*(ls->m_pUDT));
       // No need to check the peer, this is the address from which the request has come.
       ns->m_PeerAddr = peer;
    }
@@ -692,25 +745,13 @@ int CUDTUnited::newConnection(const SRTSOCKET listen, const sockaddr_any& peer,
          // Newly created group from the listener, which hasn't yet
          // the listener set.
          g->m_listener = ls;
-
-         // Listen on both first connected socket and continued sockets.
-         // This might help with jump-over situations, and in regular continued
-         // sockets the IN event won't be reported anyway.
-         int listener_modes = SRT_EPOLL_ACCEPT | SRT_EPOLL_UPDATE;
-         srt_epoll_add_usock(g->m_RcvEID, ls->m_SocketID, &listener_modes);
-
-         // This listening should be done always when a first connected socket
-         // appears as accepted off the listener. This is for the sake of swait() calls
-         // inside the group receiving and sending functions so that they get
-         // interrupted when a new socket is connected.
       }
 
-      // Add also per-direction subscription for the about-to-be-accepted socket.
+      // Add also the sending subscription for the about-to-be-accepted socket.
       // Both first accepted socket that makes the group-accept and every next
-      // socket that adds a new link.
-      int read_modes = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+      // socket that adds a new link. The received packets are passed to the
+      // group by the socket itself.
       int write_modes = SRT_EPOLL_OUT | SRT_EPOLL_ERR;
-      srt_epoll_add_usock(g->m_RcvEID, ns->m_SocketID, &read_modes);
       srt_epoll_add_usock(g->m_SndEID, ns->m_SocketID, &write_modes);
 
       // With app reader, do not set groupPacketArrival (block the
@@ -1314,9 +1355,8 @@ int CUDTUnited::groupConnect(CUDTGroup* pg, SRT_SOCKGROUPDATA* targets, int arra
         // connection succeeded or failed and whether the new socket is
         // ready to use or needs to be closed.
         srt_epoll_add_usock(g.m_SndEID, sid, &connect_modes);
-        srt_epoll_add_usock(g.m_RcvEID, sid, &connect_modes);
 
-        // Adding a socket on which we need to block to BOTH these tracking EIDs
+        // Adding a socket on which we need to block to BOTH the tracking EID
         // and the blocker EID. We'll simply remove from them later all sockets that
         // got connected state or were broken.
 
@@ -1367,7 +1407,11 @@ int CUDTUnited::groupConnect(CUDTGroup* pg, SRT_SOCKGROUPDATA* targets, int arra
         {
             CGuard grd (g.m_GroupLock);
 
-            if (isn == 0)
+            // The ISN of the first link becomes the group sequence, and the
+            // links connected after it send it in the handshake too. This way
+            // all the members on the peer side start with the same sequence,
+            // whichever of them gets connected first.
+            if (isn == -1)
             {
                 g.syncWithSocket(ns->core());
             }
@@ -1398,7 +1442,6 @@ int CUDTUnited::groupConnect(CUDTGroup* pg, SRT_SOCKGROUPDATA* targets, int arra
                 f->sndstate = CUDTGroup::GST_BROKEN;
                 f->rcvstate = CUDTGroup::GST_BROKEN;
                 srt_epoll_remove_usock(g.m_SndEID, sid);
-                srt_epoll_remove_usock(g.m_RcvEID, sid);
             }
             else
             {
@@ -1473,7 +1516,6 @@ int CUDTUnited::groupConnect(CUDTGroup* pg, SRT_SOCKGROUPDATA* targets, int arra
                 broken.push_back(sid);
                 srt_epoll_remove_usock(eid, sid);
                 srt_epoll_remove_usock(g.m_SndEID, sid);
-                srt_epoll_remove_usock(g.m_RcvEID, sid);
 
                 continue;
             }
@@ -2108,6 +2150,83 @@ int CUDTUnited::epoll_release(const int eid)
    return m_EPoll.release(eid);
 }
 
+int CUDTUnited::bulkstats(int source, int id, int fields, SRT_SOCKSTATS* out, int size, bool clear)
+{
+   if (size < 0 || (size > 0 && !out) || (fields & ~SRT_STATSF_ALL) != 0)
+      throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
+
+   vector<SRTSOCKET> ids;
+   if (source == SRT_STATS_EPOLL)
+   {
+      m_EPoll.watched_usocks(id, (ids));
+   }
+   else if (source == SRT_STATS_GROUP)
+   {
+      CUDTGroup* g = locateGroup(id, ERH_THROW);
+      CGuard glock (g->m_GroupLock);
+      for (CUDTGroup::gli_t gi = g->m_Group.begin(); gi != g->m_Group.end(); ++gi)
+         ids.push_back(gi->id);
+   }
+   else if (source != SRT_STATS_MUXER)
+   {
+      throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
+   }
+
+   // Only the list of the sockets is made under m_GlobControlLock.
+   vector<SRTSOCKET> live;
+   {
+      CGuard cg (m_GlobControlLock);
+      if (source == SRT_STATS_MUXER)
+      {
+         sockets_t::iterator i = m_Sockets.find(id);
+         if (i == m_Sockets.end() || i->second->m_Status == SRTS_CLOSED)
+            throw CUDTException(MJ_NOTSUP, MN_SIDINVAL, 0);
+
+         // Sockets that aren't bound yet have no multiplexer
+         const int mid = i->second->m_iMuxID;
+         if (mid == -1)
+            live.push_back(id);
+         else
+         {
+            for (i = m_Sockets.begin(); i != m_Sockets.end(); ++i)
+            {
+               if (i->second->m_iMuxID == mid && i->second->m_Status != SRTS_CLOSED)
+                  live.push_back(i->first);
+            }
+         }
+      }
+      else
+      {
+         for (vector<SRTSOCKET>::iterator x = ids.begin(); x != ids.end(); ++x)
+         {
+            sockets_t::iterator i = m_Sockets.find(*x);
+            if (i != m_Sockets.end() && i->second->m_Status != SRTS_CLOSED)
+               live.push_back(*x);
+         }
+      }
+   }
+
+   // The statistics are collected without the lock, which is taken again
+   // only briefly to find every socket, as for srt_bstats(). A socket
+   // closed in the meantime is reported as not connected.
+   const int count = int(live.size());
+   for (int i = 0; i < count && i < size; ++i)
+   {
+      CUDTSocket* s = locateSocket(live[i], ERH_RETURN);
+      if (s)
+      {
+         s->m_pUDT->compactStats((out[i]), fields, clear);
+      }
+      else
+      {
+         memset(&out[i], 0, sizeof out[i]);
+         out[i].id = live[i];
+      }
+   }
+
+   return count;
+}
+
 CUDTSocket* CUDTUnited::locateSocket(const SRTSOCKET u, ErrorHandling erh)
 {
     CGuard cg (m_GlobControlLock);
@@ -2340,8 +2459,8 @@ void CUDTUnited::removeSocket(const SRTSOCKET u)
 
    HLOGC(mglog.Debug, log << "GC/removeSocket: closing associated UDT @" << u);
    s->makeClosed();
-   HLOGC(mglog.Debug, log << "GC/removeSocket: DELETING SOCKET @" << u);
-   delete s;
+   HLOGC(mglog.Debug, log << "GC/removeSocket: RELEASING SOCKET @" << u);
+   releaseSocket(s);
 
    if (mid == -1)
        return;
@@ -2380,6 +2499,151 @@ void CUDTUnited::removeSocket(const SRTSOCKET u)
    }
 }
 
+void CUDTUnited::setSocketPool(size_t size)
+{
+   vector<CUDTSocket*> extra;
+   {
+      CGuard pg(m_SocketPoolLock);
+      m_zSocketPoolSize = size;
+      while (m_SocketPool.size() > size)
+      {
+         extra.push_back(m_SocketPool.front());
+         m_SocketPool.pop_front();
+      }
+   }
+
+   for (size_t i = 0; i < extra.size(); ++i)
+      delete extra[i];
+
+   fillSocketPool();
+}
+
+// The sockets returned by the GC are at the back of the pool and the
+// newly built ones at the front, so that the sockets that can reuse
+// the connection objects of the previous connection are taken first.
+CUDTSocket* CUDTUnited::acquireSocket()
+{
+   {
+      CGuard pg(m_SocketPoolLock);
+      if (!m_SocketPool.empty())
+      {
+         CUDTSocket* s = m_SocketPool.back();
+         m_SocketPool.pop_back();
+         return s;
+      }
+   }
+
+   return constructSocket();
+}
+
+CUDTSocket* CUDTUnited::constructSocket()
+{
+   CUDTSocket* s = new CUDTSocket;
+   try
+   {
+      s->m_pUDT = new CUDT(s);
+   }
+   catch (...)
+   {
+      delete s;
+      throw;
+   }
+   return s;
+}
+
+void CUDTUnited::releaseSocket(CUDTSocket* s)
+{
+   bool keep;
+   {
+      CGuard pg(m_SocketPoolLock);
+      keep = m_zSocketPoolSize > 0;
+   }
+
+   if (keep)
+   {
+      try
+      {
+         s->reset();
+      }
+      catch (...)
+      {
+         keep = false;
+      }
+   }
+
+   if (keep)
+   {
+      CGuard pg(m_SocketPoolLock);
+      // A full pool gives up a socket without connection objects
+      // for the one that has them.
+      if (m_SocketPool.size() < m_zSocketPoolSize)
+      {
+         m_SocketPool.push_back(s);
+         return;
+      }
+
+      if (!m_SocketPool.empty() && s->hasConnectionObjects()
+            && !m_SocketPool.front()->hasConnectionObjects())
+      {
+         CUDTSocket* fresh = m_SocketPool.front();
+         m_SocketPool.pop_front();
+         m_SocketPool.push_back(s);
+         s = fresh;
+      }
+   }
+
+   delete s;
+}
+
+// Builds the missing sockets outside the lock, so that acquireSocket()
+// is not blocked by that. Called also from the GC thread, so that the
+// pool is refilled when the sockets are taken faster than they are closed.
+void CUDTUnited::fillSocketPool()
+{
+   for (;;)
+   {
+      {
+         CGuard pg(m_SocketPoolLock);
+         if (m_SocketPool.size() >= m_zSocketPoolSize)
+            return;
+      }
+
+      CUDTSocket* s = NULL;
+      try
+      {
+         s = constructSocket();
+      }
+      catch (...)
+      {
+         return;
+      }
+
+      {
+         CGuard pg(m_SocketPoolLock);
+         if (m_SocketPool.size() < m_zSocketPoolSize)
+         {
+            m_SocketPool.push_front(s);
+            continue;
+         }
+      }
+
+      delete s;
+      return;
+   }
+}
+
+void CUDTUnited::clearSocketPool()
+{
+   std::deque<CUDTSocket*> pool;
+   {
+      CGuard pg(m_SocketPoolLock);
+      pool.swap(m_SocketPool);
+   }
+
+   for (size_t i = 0; i < pool.size(); ++i)
+      delete pool[i];
+}
+
 void CUDTUnited::setError(CUDTException* e)
 {
     delete (CUDTException*)pthread_getspecific(m_TLSError);
@@ -2595,6 +2859,7 @@ void* CUDTUnited::garbageCollect(void* p)
    {
        INCREMENT_THREAD_ITERATIONS();
        self->checkBrokenSockets();
+       self->fillSocketPool();
 
        HLOGC(mglog.Debug, log << "GC: sleep 1 s");
        self->m_GCStopCond.wait_for(gcguard, seconds_from(1));
@@ -2800,6 +3065,7 @@ int CUDT::removeSocketFromGroup(SRTSOCKET socket)
 
 void CUDTSocket::removeFromGroup()
 {
+    m_IncludedGroup->rcvHandOver(m_pUDT);
     m_IncludedGroup->remove(m_SocketID);
     m_IncludedIter = CUDTGroup::gli_NULL();
     m_IncludedGroup = NULL;
@@ -3339,6 +3605,55 @@ int64_t CUDT::recvfile(
    }
 }
 
+#ifdef SRT_ENABLE_FILEMAP
+int64_t CUDT::sendfile(
+   SRTSOCKET u, int fd, int64_t& offset, int64_t size, int block)
+{
+   try
+   {
+      return s_UDTUnited.locateSocket(u, CUDTUnited::ERH_THROW)->core().sendfile(fd, offset, size, block);
+   }
+   catch (const CUDTException& e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (bad_alloc&)
+   {
+      s_UDTUnited.setError(new CUDTException(MJ_SYSTEMRES, MN_MEMORY, 0));
+      return ERROR;
+   }
+   catch (const std::exception& ee)
+   {
+      LOGC(mglog.Fatal, log << "sendfile: UNEXPECTED EXCEPTION: "
+         << typeid(ee).name() << ": " << ee.what());
+      s_UDTUnited.setError(new CUDTException(MJ_UNKNOWN, MN_NONE, 0));
+      return ERROR;
+   }
+}
+
+int64_t CUDT::recvfile(
+   SRTSOCKET u, int fd, int64_t& offset, int64_t size, int block)
+{
+   try
+   {
+       return s_UDTUnited.locateSocket(u, CUDTUnited::ERH_THROW)->core().recvfile(fd, offset, size, block);
+   }
+   catch (const CUDTException& e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (const std::exception& ee)
+   {
+      LOGC(mglog.Fatal, log << "recvfile: UNEXPECTED EXCEPTION: "
+         << typeid(ee).name() << ": " << ee.what());
+      s_UDTUnited.setError(new CUDTException(MJ_UNKNOWN, MN_NONE, 0));
+      return ERROR;
+   }
+}
+#endif
+
 int CUDT::select(
    int,
    ud_set* readfds,
@@ -3694,6 +4009,50 @@ int CUDT::bstats(SRTSOCKET u, CBytePerfMon* perf, bool clear, bool instantaneous
    }
 }
 
+int CUDT::bulkstats(int source, int id, int fields, SRT_SOCKSTATS* out, int size, bool clear)
+{
+   try
+   {
+      return s_UDTUnited.bulkstats(source, id, fields, out, size, clear);
+   }
+   catch (const CUDTException& e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (const std::exception& ee)
+   {
+      LOGC(mglog.Fatal, log << "bulkstats: UNEXPECTED EXCEPTION: "
+         << typeid(ee).name() << ": " << ee.what());
+      s_UDTUnited.setError(new CUDTException(MJ_UNKNOWN, MN_NONE, 0));
+      return ERROR;
+   }
+}
+
+int CUDT::histstats(SRTSOCKET u, SRT_HISTSTATS* hist, bool clear)
+{
+   try
+   {
+      if (!hist)
+         throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
+      CUDT* udt = s_UDTUnited.locateSocket(u, s_UDTUnited.ERH_THROW)->m_pUDT;
+      udt->histstats((*hist), clear);
+      return 0;
+   }
+   catch (const CUDTException& e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (const std::exception& ee)
+   {
+      LOGC(mglog.Fatal, log << "histstats: UNEXPECTED EXCEPTION: "
+         << typeid(ee).name() << ": " << ee.what());
+      s_UDTUnited.setError(new CUDTException(MJ_UNKNOWN, MN_NONE, 0));
+      return ERROR;
+   }
+}
+
 CUDT* CUDT::getUDTHandle(SRTSOCKET u)
 {
    try
@@ -3750,6 +4109,15 @@ SRT_SOCKSTATUS CUDT::getsockstate(SRTSOCKET u)
    }
 }
 
+int CUDT::setSocketPool(int size)
+{
+   if (size < 0)
+      return APIError(MJ_NOTSUP, MN_INVAL, 0);
+
+   s_UDTUnited.setSocketPool(size);
+   return 0;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -4163,8 +4531,12 @@ void setloghandler(void* opaque, SRT_LOG_HANDLER_FN* handler)
 
 void setlogflags(int flags)
 {
-    CGuard gg(srt_logger_config.mutex);
-    srt_logger_config.flags = flags;
+    srt_logger_config.setFlags(flags);
+}
+
+int64_t getlogdropped()
+{
+    return srt_logger_config.asyncDropped();
 }
 
 SRT_API bool setstreamid(SRTSOCKET u, const std::string& sid)
@@ -56,6 +56,7 @@ modified by
 
 #include <map>
 #include <vector>
+#include <deque>
 #include <string>
 #include "netinet_any.h"
 #include "udt.h"
@@ -94,6 +95,14 @@ public:
 
    void construct();
 
+   /// Brings the socket back to the state of a newly created one, with
+   /// a new CUDT entity of default options, so that it can be reused.
+   /// The synchronization objects and the loss lists are kept.
+   void reset();
+
+   /// Whether the loss lists of a previous connection are kept for reuse.
+   bool hasConnectionObjects() const;
+
    SRT_SOCKSTATUS m_Status;                  //< current socket state
 
    /// Time when the socket is closed.
@@ -237,6 +246,22 @@ public:
    int32_t epoll_set(const int eid, int32_t flags);
    int epoll_release(const int eid);
 
+      /// Set the number of sockets kept constructed for reuse and fill the pool.
+      /// @param [in] size maximum number of sockets in the pool, 0 disables it.
+
+   void setSocketPool(size_t size);
+
+      /// fill the compact statistics of all sockets selected by source.
+      /// @param [in] source SRT_STATS_EPOLL, SRT_STATS_GROUP or SRT_STATS_MUXER.
+      /// @param [in] id EPoll ID, group ID or any socket on the multiplexer.
+      /// @param [in] fields SRT_STATSF_* field sets to calculate.
+      /// @param [out] out array of records for the first `size` sockets.
+      /// @param [in] size size of the out array.
+      /// @param [in] clear whether to clear the interval counters.
+      /// @return number of selected sockets.
+
+   int bulkstats(int source, int id, int fields, SRT_SOCKSTATS* out, int size, bool clear);
+
       /// record the UDT exception.
       /// @param [in] e pointer to a UDT exception instance.
 
@@ -343,8 +368,6 @@ private:
    static void TLSDestroy(void* e) {if (NULL != e) delete (CUDTException*)e;}
 
 private:
-   friend struct FLookupSocketWithEvent;
-
    CUDTSocket* locateSocket(SRTSOCKET u, ErrorHandling erh = ERH_RETURN);
    CUDTSocket* locatePeer(const sockaddr_any& peer, const SRTSOCKET id, int32_t isn);
    CUDTGroup* locateGroup(SRTSOCKET u, ErrorHandling erh = ERH_RETURN);
@@ -356,7 +379,18 @@ private:
    srt::sync::Mutex            m_MultiplexerLock;
 
 private:
-   CCache<CInfoBlock>* m_pCache;			// UDT network information cache
+   CInfoCache* m_pCache;			// UDT network information cache
+
+private:
+   std::deque<CUDTSocket*> m_SocketPool;		// closed or preallocated sockets ready for reuse
+   size_t m_zSocketPoolSize;				// maximum number of sockets in m_SocketPool
+   srt::sync::Mutex m_SocketPoolLock;
+
+   CUDTSocket* acquireSocket();
+   CUDTSocket* constructSocket();
+   void releaseSocket(CUDTSocket* s);
+   void fillSocketPool();
+   void clearSocketPool();
 
 private:
    volatile bool m_bClosing;
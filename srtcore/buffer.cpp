@@ -50,10 +50,12 @@ modified by
    Haivision Systems Inc.
 *****************************************************************************/
 
+#define SRT_IMPORT_FILEMAP
 #include "platform_sys.h"
 
 #include <cstring>
 #include <cmath>
+#include <new>
 #include "buffer.h"
 #include "packet.h"
 #include "core.h" // provides some constants
@@ -63,6 +65,30 @@ using namespace std;
 using namespace srt_logging;
 using namespace srt::sync;
 
+CSharedPayload::CSharedPayload(char* data, int len)
+    : m_iRefCount(1)
+    , m_iLength(len)
+    , m_pcData(data)
+{
+}
+
+CSharedPayload* CSharedPayload::create(const char* data, int len)
+{
+   char* mem = new char[sizeof(CSharedPayload) + len];
+   char* payload = mem + sizeof(CSharedPayload);
+   memcpy(payload, data, len);
+   return new (mem) CSharedPayload(payload, len);
+}
+
+void CSharedPayload::release()
+{
+   if (m_iRefCount.fetch_add(-1) > 1)
+      return;
+
+   this->~CSharedPayload();
+   delete [] reinterpret_cast<char*>(this);
+}
+
 CSndBuffer::CSndBuffer(int size, int mss)
     : m_BufLock()
     , m_pBlock(NULL)
@@ -70,6 +96,9 @@ CSndBuffer::CSndBuffer(int size, int mss)
     , m_pCurrBlock(NULL)
     , m_pLastBlock(NULL)
     , m_pBuffer(NULL)
+#ifdef SRT_ENABLE_FILEMAP
+    , m_pFileMap(NULL)
+#endif
     , m_iNextMsgNo(1)
     , m_iSize(size)
     , m_iMSS(mss)
@@ -107,6 +136,11 @@ CSndBuffer::CSndBuffer(int size, int mss)
    for (int i = 0; i < m_iSize; ++ i)
    {
       pb->m_pcData = pc;
+      pb->m_pcStorage = pc;
+      pb->m_pShared = NULL;
+#ifdef SRT_ENABLE_FILEMAP
+      pb->m_pFileMap = NULL;
+#endif
       pb = pb->m_pNext;
       pc += m_iMSS;
    }
@@ -118,6 +152,14 @@ CSndBuffer::CSndBuffer(int size, int mss)
 
 CSndBuffer::~CSndBuffer()
 {
+   // Blocks that were never acknowledged may still keep
+   // the shared payloads and mappings alive.
+   for (Block* b = m_pFirstBlock; b != m_pLastBlock; b = b->m_pNext)
+      releaseBlockData(b);
+#ifdef SRT_ENABLE_FILEMAP
+   releaseFileMap();
+#endif
+
    Block* pb = m_pBlock->m_pNext;
    while (pb != m_pBlock)
    {
@@ -138,7 +180,7 @@ CSndBuffer::~CSndBuffer()
    releaseMutex(m_BufLock);
 }
 
-void CSndBuffer::addBuffer(const char* data, int len, SRT_MSGCTRL& w_mctrl)
+void CSndBuffer::addBuffer(const char* data, int len, SRT_MSGCTRL& w_mctrl, CSharedPayload* shared)
 {
     int32_t& w_msgno = w_mctrl.msgno;
     int32_t& w_seqno = w_mctrl.pktseq;
@@ -197,7 +239,15 @@ void CSndBuffer::addBuffer(const char* data, int len, SRT_MSGCTRL& w_mctrl)
         HLOGC(dlog.Debug, log << "addBuffer: %" << w_seqno << " #" << w_msgno
                 << " spreading from=" << (i*m_iMSS) << " size=" << pktlen
                 << " TO BUFFER:" << (void*)s->m_pcData);
-        memcpy((s->m_pcData), data + i * m_iMSS, pktlen);
+        if (shared)
+        {
+            s->m_pcData = const_cast<char*>(data) + i * m_iMSS;
+            s->m_pShared = shared;
+        }
+        else
+        {
+            memcpy((s->m_pcData), data + i * m_iMSS, pktlen);
+        }
         s->m_iLength = pktlen;
 
         s->m_iSeqNo = w_seqno;
@@ -226,6 +276,10 @@ void CSndBuffer::addBuffer(const char* data, int len, SRT_MSGCTRL& w_mctrl)
     }
     m_pLastBlock = s;
 
+    // The blocks may be released by ackData() in the receiver thread.
+    if (shared)
+        shared->addRef(size);
+
     enterCS(m_BufLock);
     m_iCount += size;
 
@@ -356,6 +410,191 @@ int CSndBuffer::addBufferFromFile(fstream& ifs, int len)
    return total;
 }
 
+#ifdef SRT_ENABLE_FILEMAP
+namespace
+{
+// Unmaps a window, unless it was handed over to its FileMap.
+struct MappedWindow
+{
+   void* base;
+   size_t size;
+
+   MappedWindow(void* b, size_t s): base(b), size(s) {}
+   ~MappedWindow()
+   {
+      if (base)
+         ::munmap(base, size);
+   }
+
+   void* release()
+   {
+      void* b = base;
+      base = NULL;
+      return b;
+   }
+};
+}
+
+int CSndBuffer::addBufferFromFileMap(int fd, int64_t offset, int len, int64_t filesize)
+{
+   // The file may have been truncated since the transfer started, and the
+   // pages beyond its end can't be touched (SIGBUS), so the size is checked
+   // again for every block. A truncation while the blocks already added
+   // wait for sending can't be detected this way; such a file must not be
+   // shortened during the transfer.
+   struct stat st;
+   if (::fstat(fd, &st) == -1)
+      return -1;
+   if (st.st_size < filesize)
+      filesize = st.st_size;
+
+   if (offset + len > filesize)
+      len = int(filesize - offset);
+   if (len <= 0)
+      return 0;
+
+   FileMap* map = m_pFileMap;
+   if (!map || offset < map->m_llOffset || offset + len > map->m_llOffset + int64_t(map->m_zSize))
+   {
+      // Map a new window starting at the page containing the offset. The window
+      // must cover at least the whole block and must not extend past the file end,
+      // as touching pages beyond it causes SIGBUS.
+      static const int64_t pagesize = sysconf(_SC_PAGESIZE);
+      const int64_t mapoffset = offset - (offset % pagesize);
+      int64_t mapsize = std::max<int64_t>(FILEMAP_WINDOW, offset + len - mapoffset);
+      if (mapoffset + mapsize > filesize)
+         mapsize = filesize - mapoffset;
+
+      // The mapping is private and writable only to allow in-place encryption
+      // of the payload. Pages touched this way are copied, the file is never
+      // modified.
+      void* base = ::mmap(NULL, size_t(mapsize), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)mapoffset);
+      if (base == MAP_FAILED)
+      {
+         LOGC(dlog.Error, log << "addBufferFromFileMap: mmap offset=" << mapoffset << " size=" << mapsize
+               << " failed: " << SysStrError(errno));
+         return -1;
+      }
+      MappedWindow window(base, size_t(mapsize));
+#ifdef MADV_SEQUENTIAL
+      ::madvise(base, size_t(mapsize), MADV_SEQUENTIAL);
+#endif
+
+      map = new FileMap;
+      map->m_pcBase = static_cast<char*>(window.release());
+      map->m_zSize = size_t(mapsize);
+      map->m_llOffset = mapoffset;
+      map->m_iRefCount = 1;
+
+      HLOGC(dlog.Debug, log << "addBufferFromFileMap: mapped " << mapsize << " bytes from offset " << mapoffset);
+
+      CGuard bufferguard(m_BufLock);
+      if (m_pFileMap)
+         releaseMapRef(m_pFileMap);
+      m_pFileMap = map;
+   }
+
+   int size = len / m_iMSS;
+   if ((len % m_iMSS) != 0)
+      size ++;
+
+   // dynamically increase sender buffer
+   while (size + m_iCount >= m_iSize)
+      increase();
+
+   HLOGC(dlog.Debug, log << CONID() << "addBufferFromFileMap: adding "
+       << size << " packets (" << len << " bytes) to send, msgno=" << m_iNextMsgNo);
+
+   char* data = map->m_pcBase + (offset - map->m_llOffset);
+   Block* s = m_pLastBlock;
+   for (int i = 0; i < size; ++ i)
+   {
+      int pktlen = len - i * m_iMSS;
+      if (pktlen > m_iMSS)
+         pktlen = m_iMSS;
+
+      s->m_pcData = data + i * m_iMSS;
+      s->m_pFileMap = map;
+
+      // currently file transfer is only available in streaming mode, message is always in order, ttl = infinite
+      s->m_iMsgNoBitset = m_iNextMsgNo | MSGNO_PACKET_INORDER::mask;
+      if (i == 0)
+         s->m_iMsgNoBitset |= PacketBoundaryBits(PB_FIRST);
+      if (i == size - 1)
+         s->m_iMsgNoBitset |= PacketBoundaryBits(PB_LAST);
+
+      s->m_iLength = pktlen;
+      s->m_iTTL = -1;
+      s = s->m_pNext;
+   }
+   m_pLastBlock = s;
+
+   enterCS(m_BufLock);
+   // The blocks are released by ackData() in the receiver thread,
+   // so the reference count is only modified under m_BufLock.
+   map->m_iRefCount += size;
+   m_iCount += size;
+   m_iBytesCount += len;
+
+   leaveCS(m_BufLock);
+
+   m_iNextMsgNo ++;
+   if (m_iNextMsgNo == int32_t(MSGNO_SEQ::mask))
+      m_iNextMsgNo = 1;
+
+   return len;
+}
+
+void CSndBuffer::releaseFileMap()
+{
+   CGuard bufferguard(m_BufLock);
+   if (m_pFileMap)
+   {
+      releaseMapRef(m_pFileMap);
+      m_pFileMap = NULL;
+   }
+}
+
+void CSndBuffer::releaseMapRef(FileMap* map)
+{
+   if (--map->m_iRefCount > 0)
+      return;
+
+   HLOGC(dlog.Debug, log << "CSndBuffer: unmapping " << map->m_zSize << " bytes from file offset " << map->m_llOffset);
+   ::munmap(map->m_pcBase, map->m_zSize);
+   delete map;
+}
+
+void CSndBuffer::releaseBlockMap(Block* b)
+{
+   if (!b->m_pFileMap)
+      return;
+
+   releaseMapRef(b->m_pFileMap);
+   b->m_pFileMap = NULL;
+   b->m_pcData = b->m_pcStorage;
+}
+#endif
+
+void CSndBuffer::releaseBlockData(Block* b)
+{
+   if (b->m_pShared)
+   {
+      b->m_pShared->release();
+      b->m_pShared = NULL;
+      b->m_pcData = b->m_pcStorage;
+   }
+   releaseBlockMap(b);
+}
+
+steady_clock::time_point CSndBuffer::getNextOriginTime() const
+{
+   if (m_pCurrBlock == m_pLastBlock)
+      return steady_clock::time_point();
+
+   return m_pCurrBlock->m_tsOriginTime;
+}
+
 int CSndBuffer::readData(CPacket& w_packet, steady_clock::time_point& w_srctime, int kflgs)
 {
    // No data to read
@@ -549,6 +788,7 @@ void CSndBuffer::ackData(int offset)
       m_iBytesCount -= m_pFirstBlock->m_iLength;
       if (m_pFirstBlock == m_pCurrBlock)
           move = true;
+      releaseBlockData(m_pFirstBlock);
       m_pFirstBlock = m_pFirstBlock->m_pNext;
    }
    if (move)
@@ -650,6 +890,7 @@ int CSndBuffer::dropLateData(int& w_bytes, int32_t& w_first_msgno, const steady_
 
       if (m_pFirstBlock == m_pCurrBlock)
           move = true;
+      releaseBlockData(m_pFirstBlock);
       m_pFirstBlock = m_pFirstBlock->m_pNext;
    }
 
@@ -727,6 +968,11 @@ void CSndBuffer::increase()
    for (int i = 0; i < unitsize; ++ i)
    {
       pb->m_pcData = pc;
+      pb->m_pcStorage = pc;
+      pb->m_pShared = NULL;
+#ifdef SRT_ENABLE_FILEMAP
+      pb->m_pFileMap = NULL;
+#endif
       pb = pb->m_pNext;
       pc += m_iMSS;
    }
@@ -967,6 +1213,109 @@ int CRcvBuffer::readBufferToFile(fstream& ofs, int len)
    return len - rs;
 }
 
+#ifdef SRT_ENABLE_FILEMAP
+int CRcvBuffer::readBufferToFd(int fd, int64_t offset, int len)
+{
+   // Number of packets written by a single pwritev call.
+#if defined(IOV_MAX) && IOV_MAX < 1024
+   static const int MAX_IOV = IOV_MAX;
+#else
+   static const int MAX_IOV = 1024;
+#endif
+   iovec iov[MAX_IOV];
+
+   int p = m_iStartPos;
+   const int lastack = m_iLastAckPos;
+   int rs = len;
+   bool failed = false;
+
+   while ((p != lastack) && (rs > 0) && !failed)
+   {
+      // Collect the batch of units to write. Units are only
+      // released after their data have been written to the file.
+      int niov = 0;
+      int batch = 0;
+      for (int q = p, notch = m_iNotch; (q != lastack) && (batch < rs) && (niov < MAX_IOV); q = shiftFwd(q), notch = 0)
+      {
+         int unitsize = (int) m_pUnit[q]->m_Packet.getLength() - notch;
+         if (unitsize > rs - batch)
+            unitsize = rs - batch;
+
+         iov[niov].iov_base = m_pUnit[q]->m_Packet.m_pcData + notch;
+         iov[niov].iov_len = unitsize;
+         ++niov;
+         batch += unitsize;
+      }
+
+      int written = 0;
+      iovec* piov = iov;
+      while (written < batch)
+      {
+         const ssize_t res = ::pwritev(fd, piov, niov, (off_t)(offset + written));
+         if (res < 0)
+         {
+            if (errno == EINTR)
+               continue;
+            LOGC(dlog.Error, log << "readBufferToFd: pwritev failed: " << SysStrError(errno));
+            failed = true;
+            break;
+         }
+         if (res == 0)
+         {
+            failed = true;
+            break;
+         }
+
+         written += int(res);
+
+         // Skip the vectors completed by a partial write.
+         size_t left = size_t(res);
+         while (niov > 0 && left >= piov->iov_len)
+         {
+            left -= piov->iov_len;
+            ++piov;
+            --niov;
+         }
+         if (niov > 0)
+         {
+            piov->iov_base = static_cast<char*>(piov->iov_base) + left;
+            piov->iov_len -= left;
+         }
+      }
+
+      offset += written;
+
+      // Consume what was actually written.
+      while (written > 0)
+      {
+         int unitsize = (int) m_pUnit[p]->m_Packet.getLength() - m_iNotch;
+         if (written >= unitsize)
+         {
+            freeUnitAt(p);
+            p = shiftFwd(p);
+            m_iNotch = 0;
+         }
+         else
+         {
+            m_iNotch += written;
+            unitsize = written;
+         }
+
+         written -= unitsize;
+         rs -= unitsize;
+      }
+   }
+
+   /* we removed acked bytes form receive buffer */
+   countBytes(-1, -(len - rs), true);
+   m_iStartPos = p;
+
+   if (failed && rs == len)
+      return -1;
+   return len - rs;
+}
+#endif
+
 int CRcvBuffer::ackData(int len)
 {
    SRT_ASSERT(len < m_iSize);
@@ -1955,13 +2304,14 @@ bool CRcvBuffer::addRcvTsbPdDriftSample(uint32_t timestamp_us, Mutex& mutex_to_l
 int CRcvBuffer::readMsg(char* data, int len)
 {
     SRT_MSGCTRL dummy = srt_msgctrl_default;
-    return readMsg(data, len, (dummy), -1);
+    time_point arrival;
+    return readMsg(data, len, (dummy), -1, (arrival));
 }
 
 // NOTE: The order of ref-arguments is odd because:
 // - data and len shall be close to one another
 // - upto is last because it's a kind of unusual argument that has a default value
-int CRcvBuffer::readMsg(char* data, int len, SRT_MSGCTRL& w_msgctl, int upto)
+int CRcvBuffer::readMsg(char* data, int len, SRT_MSGCTRL& w_msgctl, int upto, time_point& w_arrival)
 {
     int p = -1, q = -1;
     bool passack;
@@ -1978,11 +2328,34 @@ int CRcvBuffer::readMsg(char* data, int len, SRT_MSGCTRL& w_msgctl, int upto)
     // the API caller.
     w_msgctl.pktseq = pkt1.getSeqNo();
     w_msgctl.msgno = pkt1.getMsgSeq();
+    w_arrival = m_pUnit[p]->m_tsArrival;
 
     return extractData((data), len, p, q, passack);
 
 }
 
+int CRcvBuffer::getStoredSpan() const
+{
+    return getRcvDataSize() + m_iMaxPos;
+}
+
+int CRcvBuffer::peekMsg(int off, char* data, int len, SRT_MSGCTRL& w_msgctl, time_point& w_tsbpdtime)
+{
+    const CUnit* u = m_pUnit[shift(m_iStartPos, off)];
+    if (u == NULL || u->m_iFlag != CUnit::GOOD || u->m_Packet.getMsgCryptoFlags() != EK_NOENC)
+        return 0;
+
+    const CPacket& pkt = u->m_Packet;
+    const int size = std::min(len, (int)pkt.getLength());
+    memcpy((data), pkt.m_pcData, size);
+
+    w_tsbpdtime = getPktTsbPdTime(pkt.getMsgTimeStamp());
+    w_msgctl.srctime = count_microseconds(w_tsbpdtime.time_since_epoch());
+    w_msgctl.pktseq = pkt.getSeqNo();
+    w_msgctl.msgno = pkt.getMsgSeq();
+    return size;
+}
+
 #ifdef SRT_DEBUG_TSBPD_OUTJITTER
 void CRcvBuffer::debugTraceJitter(uint64_t rplaytime)
 {
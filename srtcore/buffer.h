@@ -73,6 +73,34 @@ modified by
 // a == b : equality is same as for just numbers
 
 
+/// Payload of a message shared by the sender buffers of several sockets
+/// (the members of a broadcast group), so that it's copied only once for
+/// all of them. Every block of a sender buffer that refers to it holds
+/// a reference, and the last released reference deletes it.
+class CSharedPayload
+{
+public:
+   /// Create a payload with a copy of the data, referred once.
+   static CSharedPayload* create(const char* data, int len);
+
+   void addRef(int count) { m_iRefCount.fetch_add(count); }
+   void release();
+
+   const char* data() const { return m_pcData; }
+   int size() const { return m_iLength; }
+
+private:
+   CSharedPayload(char* data, int len);
+
+   srt::sync::atomic<int> m_iRefCount;
+   int m_iLength;
+   char* m_pcData;                      // follows the object in the same allocation
+
+private:
+   CSharedPayload(const CSharedPayload&);
+   CSharedPayload& operator=(const CSharedPayload&);
+};
+
 class CSndBuffer
 {
 public:
@@ -102,7 +130,9 @@ public:
       /// @param [in] data pointer to the user data block.
       /// @param [in] len size of the block.
       /// @param [inout] r_mctrl Message control data
-   void addBuffer(const char* data, int len, SRT_MSGCTRL& w_mctrl);
+      /// @param [in] shared if not NULL, the payload that data point into; the
+      ///             blocks then refer to it instead of holding a copy.
+   void addBuffer(const char* data, int len, SRT_MSGCTRL& w_mctrl, CSharedPayload* shared = NULL);
 
       /// Read a block of data from file and insert it into the sending list.
       /// @param [in] ifs input file stream.
@@ -111,6 +141,25 @@ public:
 
    int addBufferFromFile(std::fstream& ifs, int len);
 
+#ifdef SRT_ENABLE_FILEMAP
+      /// Insert a block of data from file into the sending list without copying it.
+      /// The blocks refer to a private mapping of the file, which is shared between
+      /// them and unmapped when the last of them is acknowledged or dropped.
+      /// @param [in] fd descriptor of a regular file open for reading.
+      /// @param [in] offset position in the file where the block begins.
+      /// @param [in] len size of the block.
+      /// @param [in] filesize size of the file; no mapping ever extends past it.
+      /// @return actual size of data added, -1 if the file could not be mapped.
+
+   int addBufferFromFileMap(int fd, int64_t offset, int len, int64_t filesize);
+
+      /// Drop the reference to the file mapping used by the last call to
+      /// addBufferFromFileMap. The mapping stays alive as long as it's still
+      /// referred to by blocks that haven't yet been acknowledged.
+
+   void releaseFileMap();
+#endif
+
       /// Find data position to pack a DATA packet from the furthest reading point.
       /// @param [out] data the pointer to the data position.
       /// @param [out] msgno message number of the packet.
@@ -120,6 +169,12 @@ public:
 
    int readData(CPacket& w_packet, srt::sync::steady_clock::time_point& w_origintime, int kflgs);
 
+      /// Get the origin time of the oldest packet not yet extracted by readData().
+      /// Like readData(), this is called from the sending thread only.
+      /// @return origin time stamp of the next packet to read, or zero if there's none.
+
+   srt::sync::steady_clock::time_point getNextOriginTime() const;
+
       /// Find data position to pack a DATA packet for a retransmission.
       /// @param [out] data the pointer to the data position.
       /// @param [in] offset offset from the last ACK point (backward sequence number difference)
@@ -172,9 +227,22 @@ public:
 
 private:
 
+   struct Block;
+
    void increase();
    void setInputRateSmpPeriod(int period);
 
+#ifdef SRT_ENABLE_FILEMAP
+   struct FileMap;
+   static void releaseMapRef(FileMap* map);
+   static void releaseBlockMap(Block* b);
+#else
+   static void releaseBlockMap(Block*) {}
+#endif
+
+   /// Release the data the block refers to, if they aren't in its own slot.
+   static void releaseBlockData(Block* b);
+
 private:    // Constants
 
     static const uint64_t INPUTRATE_FAST_START_US   =      500000;    //  500 ms
@@ -189,6 +257,11 @@ private:
    {
       char* m_pcData;                   // pointer to the data block
       int m_iLength;                    // length of the block
+      char* m_pcStorage;                // own slot in the physical buffer (m_pcData differs if not used)
+      CSharedPayload* m_pShared;        // shared payload that m_pcData points into, or NULL
+#ifdef SRT_ENABLE_FILEMAP
+      FileMap* m_pFileMap;              // file mapping that m_pcData points into, or NULL
+#endif
 
       int32_t m_iMsgNoBitset;           // message number
       int32_t m_iSeqNo;                       // sequence number for scheduling
@@ -221,6 +294,21 @@ private:
       Buffer* m_pNext;                  // next buffer
    } *m_pBuffer;                        // physical buffer
 
+#ifdef SRT_ENABLE_FILEMAP
+   struct FileMap
+   {
+      char* m_pcBase;                   // start of the mapped region
+      size_t m_zSize;                   // size of the mapped region
+      int64_t m_llOffset;               // file offset mapped at m_pcBase
+      int m_iRefCount;                  // number of blocks referring to it, +1 while current
+   } *m_pFileMap;                       // mapping used by the last addBufferFromFileMap call
+
+   // Size of a single mapping window. Files are mapped in windows
+   // of this size so that the address space consumed by a transfer
+   // of a large file remains bounded.
+   static const size_t FILEMAP_WINDOW = 64 * 1024 * 1024;
+#endif
+
    int32_t m_iNextMsgNo;                // next message number
 
    int m_iSize;                         // buffer size (number of packets)
@@ -297,6 +385,16 @@ public:
 
    int readBufferToFile(std::fstream& ofs, int len);
 
+#ifdef SRT_ENABLE_FILEMAP
+      /// Read data directly into file using positioned vector writes.
+      /// @param [in] fd descriptor of a file open for writing.
+      /// @param [in] offset position in the file where the data should be written.
+      /// @param [in] len expected length of data to write into the file.
+      /// @return size of data read, -1 if nothing could be written because of an error.
+
+   int readBufferToFd(int fd, int64_t offset, int len);
+#endif
+
       /// Update the ACK point of the buffer.
       /// @param [in] len number of units to be acknowledged.
       /// @return 1 if a user buffer is fulfilled, otherwise 0.
@@ -366,9 +464,27 @@ public:
       /// @param [out] data buffer to write the message into.
       /// @param [in] len size of the buffer.
       /// @param [out] tsbpdtime localtime-based (uSec) packet time stamp including buffering delay
+      /// @param [out] w_arrival arrival time of the (first) packet of the message.
       /// @return actuall size of data read.
 
-   int readMsg(char* data, int len, SRT_MSGCTRL& w_mctrl, int upto);
+   int readMsg(char* data, int len, SRT_MSGCTRL& w_mctrl, int upto, time_point& w_arrival);
+
+      /// Query how many positions from the reading position the received
+      /// packets span, including the ones not yet acknowledged.
+      /// @return number of positions, some of them possibly empty.
+
+   int getStoredSpan() const;
+
+      /// Copy a packet stored in the buffer, acknowledged or not and ready
+      /// to play or not, leaving it in the buffer.
+      /// @param [in] off position counted from the reading position, less than getStoredSpan().
+      /// @param [out] data buffer to write the payload into.
+      /// @param [in] len size of the buffer.
+      /// @param [out] w_mctrl sequence number, message number and time to play of the packet.
+      /// @param [out] w_tsbpdtime time to play of the packet.
+      /// @return size of the payload, 0 if there's no decrypted packet at this position.
+
+   int peekMsg(int off, char* data, int len, SRT_MSGCTRL& w_mctrl, time_point& w_tsbpdtime);
       /// Query if data is ready to read (tsbpdtime <= now if TsbPD is active).
       /// @param [out] tsbpdtime localtime-based (uSec) packet time stamp including buffering delay
       ///                        of next packet in recv buffer, ready or not.
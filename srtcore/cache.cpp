@@ -46,73 +46,200 @@ written by
 #include "core.h"
 
 using namespace std;
+using namespace srt::sync;
 
-CInfoBlock& CInfoBlock::operator=(const CInfoBlock& obj)
+namespace
 {
-   std::copy(obj.m_piIP, obj.m_piIP + 4, m_piIP);
-   m_iIPversion = obj.m_iIPversion;
-   m_ullTimeStamp = obj.m_ullTimeStamp;
-   m_iRTT = obj.m_iRTT;
-   m_iBandwidth = obj.m_iBandwidth;
-   m_iLossRate = obj.m_iLossRate;
-   m_iReorderDistance = obj.m_iReorderDistance;
-   m_dInterval = obj.m_dInterval;
-   m_dCWnd = obj.m_dCWnd;
-
-   return *this;
+
+uint64_t bitsOf(double value)
+{
+   uint64_t bits;
+   memcpy(&bits, &value, sizeof bits);
+   return bits;
 }
 
-bool CInfoBlock::operator==(const CInfoBlock& obj)
+double valueOf(uint64_t bits)
 {
-   if (m_iIPversion != obj.m_iIPversion)
-      return false;
+   double value;
+   memcpy(&value, &bits, sizeof value);
+   return value;
+}
+
+// Zero means an unknown value: it replaces the cached one only
+// if the slot has just been taken for another host.
+template <class T, class V>
+void refresh(srt::sync::atomic<T>& w_field, V value, bool keep)
+{
+   if (value != 0 || !keep)
+      w_field.store(T(value));
+}
+
+}
+
+CInfoBlock::CInfoBlock()
+   : m_iIPversion(0)
+   , m_ullTimeStamp(0)
+   , m_iRTT(0)
+   , m_iBandwidth(0)
+   , m_iLossRate(0)
+   , m_iReorderDistance(0)
+   , m_dInterval(0)
+   , m_dCWnd(0)
+{
+   std::fill(m_piIP, m_piIP + 4, 0);
+}
+
+void CInfoBlock::convert(const sockaddr_any& addr, uint32_t aw_ip[4])
+{
+   if (addr.family() == AF_INET)
+   {
+      aw_ip[0] = addr.sin.sin_addr.s_addr;
+      aw_ip[1] = aw_ip[2] = aw_ip[3] = 0;
+   }
+   else
+   {
+      memcpy((aw_ip), addr.sin6.sin6_addr.s6_addr, sizeof addr.sin6.sin6_addr.s6_addr);
+   }
+}
+
+CInfoCache::CInfoCache(int size)
+{
+   size_t nsets = 1;
+   while (nsets * WAYS < size_t(size))
+      nsets *= 2;
 
-   else if (m_iIPversion == AF_INET)
-      return (m_piIP[0] == obj.m_piIP[0]);
+   m_pSets = new Set[nsets];
+   m_zSetMask = nsets - 1;
+}
+
+CInfoCache::~CInfoCache()
+{
+   delete [] m_pSets;
+}
+
+CInfoCache::Set& CInfoCache::setOf(const CInfoBlock& data)
+{
+   uint64_t hash = uint64_t(data.m_iIPversion);
+   for (int i = 0; i < 4; ++ i)
+      hash = (hash ^ data.m_piIP[i]) * 0x9E3779B97F4A7C15ULL;
+
+   return m_pSets[(hash >> 32) & m_zSetMask];
+}
+
+bool CInfoCache::matches(const Slot& slot, const CInfoBlock& data)
+{
+   if (slot.m_iIPversion.load() != data.m_iIPversion)
+      return false;
 
    for (int i = 0; i < 4; ++ i)
    {
-      if (m_piIP[i] != obj.m_piIP[i])
+      if (slot.m_piIP[i].load() != data.m_piIP[i])
          return false;
    }
 
    return true;
 }
 
-CInfoBlock* CInfoBlock::clone()
+int CInfoCache::lookup(CInfoBlock* data)
 {
-   CInfoBlock* obj = new CInfoBlock;
-
-   std::copy(m_piIP, m_piIP + 4, obj->m_piIP);
-   obj->m_iIPversion = m_iIPversion;
-   obj->m_ullTimeStamp = m_ullTimeStamp;
-   obj->m_iRTT = m_iRTT;
-   obj->m_iBandwidth = m_iBandwidth;
-   obj->m_iLossRate = m_iLossRate;
-   obj->m_iReorderDistance = m_iReorderDistance;
-   obj->m_dInterval = m_dInterval;
-   obj->m_dCWnd = m_dCWnd;
-
-   return obj;
-}
+   Set& set = setOf(*data);
 
-int CInfoBlock::getKey()
-{
-   if (m_iIPversion == AF_INET)
-      return m_piIP[0];
+   for (int i = 0; i < WAYS; ++ i)
+   {
+      Slot& slot = set.m_aSlots[i];
+
+      // Retry a few times if the slot is changed while being read. A slot
+      // found different only because it's being written is taken as a miss.
+      for (int attempt = 0; attempt < 4; ++ attempt)
+      {
+         const uint32_t seq = slot.m_iSequence.load_acquire();
+         if (seq & 1)
+            continue;
+
+         if (!matches(slot, *data))
+            break;
+
+         CInfoBlock ib;
+         ib.m_ullTimeStamp = slot.m_ullTimeStamp.load();
+         ib.m_iRTT = slot.m_iRTT.load();
+         ib.m_iBandwidth = slot.m_iBandwidth.load();
+         ib.m_iLossRate = slot.m_iLossRate.load();
+         ib.m_iReorderDistance = slot.m_iReorderDistance.load();
+         ib.m_dInterval = valueOf(slot.m_ullInterval.load());
+         ib.m_dCWnd = valueOf(slot.m_ullCWnd.load());
+
+         atomic_fence_acquire();
+         if (slot.m_iSequence.load() != seq)
+            continue;
+
+         data->m_ullTimeStamp = ib.m_ullTimeStamp;
+         data->m_iRTT = ib.m_iRTT;
+         data->m_iBandwidth = ib.m_iBandwidth;
+         data->m_iLossRate = ib.m_iLossRate;
+         data->m_iReorderDistance = ib.m_iReorderDistance;
+         data->m_dInterval = ib.m_dInterval;
+         data->m_dCWnd = ib.m_dCWnd;
+
+         // Not under the sequence: if the slot has been taken by another
+         // host meanwhile, that one is just considered used too.
+         slot.m_ullLastUse.store(set.m_ullClock.fetch_add(1) + 1);
+         return 0;
+      }
+   }
 
-   return m_piIP[0] + m_piIP[1] + m_piIP[2] + m_piIP[3];
+   return -1;
 }
 
-void CInfoBlock::convert(const sockaddr_any& addr, uint32_t aw_ip[4])
+int CInfoCache::update(const CInfoBlock* data)
 {
-   if (addr.family() == AF_INET)
+   Set& set = setOf(*data);
+
+   // Take the slot of this host, or else an empty or the least recently used one.
+   Slot* target = NULL;
+   uint64_t oldest = 0;
+   for (int i = 0; i < WAYS; ++ i)
    {
-      aw_ip[0] = addr.sin.sin_addr.s_addr;
-      aw_ip[1] = aw_ip[2] = aw_ip[3] = 0;
+      Slot& slot = set.m_aSlots[i];
+      if (matches(slot, *data))
+      {
+         target = &slot;
+         break;
+      }
+
+      const uint64_t used = slot.m_iIPversion.load() == 0 ? 0 : slot.m_ullLastUse.load();
+      if (!target || used < oldest)
+      {
+         target = &slot;
+         oldest = used;
+      }
    }
-   else
+
+   uint32_t seq = target->m_iSequence.load();
+   for (;;)
    {
-      memcpy((aw_ip), addr.sin6.sin6_addr.s6_addr, sizeof addr.sin6.sin6_addr.s6_addr);
+      if (seq & 1)
+         return -1;
+      if (target->m_iSequence.compare_exchange((seq), seq + 1))
+         break;
    }
+   atomic_fence_release();
+
+   // Check again, now that the slot can't change: it might have been
+   // given to another host since the search.
+   const bool keep = matches(*target, *data);
+
+   target->m_iIPversion.store(data->m_iIPversion);
+   for (int i = 0; i < 4; ++ i)
+      target->m_piIP[i].store(data->m_piIP[i]);
+   target->m_ullTimeStamp.store(count_microseconds(steady_clock::now()));
+   refresh(target->m_iRTT, data->m_iRTT, keep);
+   refresh(target->m_iBandwidth, data->m_iBandwidth, keep);
+   refresh(target->m_iLossRate, data->m_iLossRate, keep);
+   refresh(target->m_iReorderDistance, data->m_iReorderDistance, keep);
+   refresh(target->m_ullInterval, bitsOf(data->m_dInterval), keep);
+   refresh(target->m_ullCWnd, bitsOf(data->m_dCWnd), keep);
+   target->m_ullLastUse.store(set.m_ullClock.fetch_add(1) + 1);
+
+   target->m_iSequence.store_release(seq + 2);
+   return 0;
 }
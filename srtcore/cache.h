@@ -41,225 +41,98 @@ written by
 #ifndef __UDT_CACHE_H__
 #define __UDT_CACHE_H__
 
-#include <list>
-#include <vector>
-
 #include "sync.h"
 #include "netinet_any.h"
 #include "udt.h"
 
-class CCacheItem
+class CInfoBlock
 {
 public:
-   virtual ~CCacheItem() {}
+   uint32_t m_piIP[4];		// IP address, machine read only, not human readable format
+   int m_iIPversion;   		// Address family: AF_INET or AF_INET6
+   uint64_t m_ullTimeStamp;	// last update time, microseconds of the steady clock
+   int m_iRTT;			// RTT
+   int m_iBandwidth;		// estimated bandwidth
+   int m_iLossRate;		// average loss rate
+   int m_iReorderDistance;	// packet reordering distance
+   double m_dInterval;		// inter-packet time, congestion control
+   double m_dCWnd;		// congestion window size, congestion control
 
 public:
-   virtual CCacheItem& operator=(const CCacheItem&) = 0;
-
-   // The "==" operator SHOULD only compare key values.
-   virtual bool operator==(const CCacheItem&) = 0;
-
-      /// get a deep copy clone of the current item
-      /// @return Pointer to the new item, or NULL if failed.
-
-   virtual CCacheItem* clone() = 0;
+   CInfoBlock();
 
-      /// get a random key value between 0 and MAX_INT to be used for the hash in cache
-      /// @return A random hash key.
-
-   virtual int getKey() = 0;
+      /// convert sockaddr structure to an integer array
+      /// @param [in] addr network address
+      /// @param [out] ip the result machine readable IP address in integer array
 
-   // If there is any shared resources between the cache item and its clone,
-   // the shared resource should be released by this function.
-   virtual void release() {}
+   static void convert(const sockaddr_any& addr, uint32_t ip[4]);
 };
 
-template<typename T> class CCache
+// Cache of the connection parameters per peer host, so that a new
+// connection can start with what the previous one to the same host
+// has measured. The table has a fixed size and is set-associative: the
+// host address selects a set of WAYS slots, the sets being the shards,
+// and in a set the least recently used slot is replaced. Every slot is
+// a sequence lock over atomic fields, so neither lookup nor update takes
+// a lock or allocates memory. A reader retries when the slot has been
+// changed meanwhile; an update that finds the slot written by another
+// thread is dropped, as the cache is only a hint.
+class CInfoCache
 {
 public:
-   CCache(int size = 1024):
-   m_iMaxSize(size),
-   m_iHashSize(size * 3),
-   m_iCurrSize(0)
-   {
-      m_vHashPtr.resize(m_iHashSize);
-      srt::sync::setupMutex(m_Lock, "Cache");
-   }
+   static const int WAYS = 8;
 
-   ~CCache()
-   {
-      clear();
-   }
+      /// @param [in] size number of items, rounded up to whole sets of a power-of-two count.
+
+   CInfoCache(int size = 1024);
+   ~CInfoCache();
 
 public:
       /// find the matching item in the cache.
       /// @param [in,out] data storage for the retrieved item; initially it must carry the key information
       /// @return 0 if found a match, otherwise -1.
 
-   int lookup(T* data)
-   {
-      srt::sync::CGuard cacheguard(m_Lock);
+   int lookup(CInfoBlock* data);
 
-      int key = data->getKey();
-      if (key < 0)
-         return -1;
-      if (key >= m_iMaxSize)
-         key %= m_iHashSize;
-
-      const ItemPtrList& item_list = m_vHashPtr[key];
-      for (typename ItemPtrList::const_iterator i = item_list.begin(); i != item_list.end(); ++ i)
-      {
-         if (*data == ***i)
-         {
-            // copy the cached info
-            *data = ***i;
-            return 0;
-         }
-      }
-
-      return -1;
-   }
-
-      /// update an item in the cache, or insert one if it doesn't exist; oldest item may be removed
+      /// update an item in the cache, or insert one if it doesn't exist; the least
+      /// recently used item of the same set may be replaced. The fields of zero
+      /// value are unknown and the values cached for the same host are kept.
       /// @param [in] data the new item to updated/inserted to the cache
-      /// @return 0 if success, otherwise -1.
-
-   int update(T* data)
-   {
-      srt::sync::CGuard cacheguard(m_Lock);
-
-      int key = data->getKey();
-      if (key < 0)
-         return -1;
-      if (key >= m_iMaxSize)
-         key %= m_iHashSize;
-
-      T* curr = NULL;
-
-      ItemPtrList& item_list = m_vHashPtr[key];
-      for (typename ItemPtrList::iterator i = item_list.begin(); i != item_list.end(); ++ i)
-      {
-         if (*data == ***i)
-         {
-            // update the existing entry with the new value
-            ***i = *data;
-            curr = **i;
-
-            // remove the current entry
-            m_StorageList.erase(*i);
-            item_list.erase(i);
-
-            // re-insert to the front
-            m_StorageList.push_front(curr);
-            item_list.push_front(m_StorageList.begin());
-
-            return 0;
-         }
-      }
-
-      // create new entry and insert to front
-      curr = data->clone();
-      m_StorageList.push_front(curr);
-      item_list.push_front(m_StorageList.begin());
+      /// @return 0 if success, -1 if the slot was being updated by another thread.
 
-      ++ m_iCurrSize;
-      if (m_iCurrSize >= m_iMaxSize)
-      {
-         // Cache overflow, remove oldest entry.
-         T* last_data = m_StorageList.back();
-         int last_key = last_data->getKey() % m_iHashSize;
+   int update(const CInfoBlock* data);
 
-         ItemPtrList& last_item_list = m_vHashPtr[last_key];
-         for (typename ItemPtrList::iterator i = last_item_list.begin(); i != last_item_list.end(); ++ i)
-         {
-            if (*last_data == ***i)
-            {
-               last_item_list.erase(i);
-               break;
-            }
-         }
-
-         last_data->release();
-         delete last_data;
-         m_StorageList.pop_back();
-         -- m_iCurrSize;
-      }
-
-      return 0;
-   }
-
-      /// Specify the cache size (i.e., max number of items).
-      /// @param [in] size max cache size.
-
-   void setSizeLimit(int size)
+private:
+   struct Slot
    {
-      m_iMaxSize = size;
-      m_iHashSize = size * 3;
-      m_vHashPtr.resize(m_iHashSize);
-   }
-
-      /// Clear all entries in the cache, restore to initialization state.
-
-   void clear()
+      srt::sync::atomic<uint32_t> m_iSequence;	// odd while the slot is being written
+      srt::sync::atomic<int> m_iIPversion;		// 0 if the slot is empty
+      srt::sync::atomic<uint32_t> m_piIP[4];
+      srt::sync::atomic<uint64_t> m_ullLastUse;	// clock of the set at the last lookup or update
+      srt::sync::atomic<uint64_t> m_ullTimeStamp;
+      srt::sync::atomic<int> m_iRTT;
+      srt::sync::atomic<int> m_iBandwidth;
+      srt::sync::atomic<int> m_iLossRate;
+      srt::sync::atomic<int> m_iReorderDistance;
+      srt::sync::atomic<uint64_t> m_ullInterval;	// bits of CInfoBlock::m_dInterval
+      srt::sync::atomic<uint64_t> m_ullCWnd;	// bits of CInfoBlock::m_dCWnd
+   };
+
+   struct Set
    {
-      for (typename std::list<T*>::iterator i = m_StorageList.begin(); i != m_StorageList.end(); ++ i)
-      {
-         (*i)->release();
-         delete *i;
-      }
-      m_StorageList.clear();
-      for (typename std::vector<ItemPtrList>::iterator i = m_vHashPtr.begin(); i != m_vHashPtr.end(); ++ i)
-         i->clear();
-      m_iCurrSize = 0;
-   }
-
-private:
-   std::list<T*> m_StorageList;
-   typedef typename std::list<T*>::iterator ItemPtr;
-   typedef std::list<ItemPtr> ItemPtrList;
-   std::vector<ItemPtrList> m_vHashPtr;
+      srt::sync::atomic<uint64_t> m_ullClock;	// counts the uses of the slots, for the LRU order
+      Slot m_aSlots[WAYS];
+   };
 
-   int m_iMaxSize;
-   int m_iHashSize;
-   int m_iCurrSize;
+   Set& setOf(const CInfoBlock& data);
+   static bool matches(const Slot& slot, const CInfoBlock& data);
 
-   srt::sync::Mutex m_Lock;
+   Set* m_pSets;
+   size_t m_zSetMask;
 
 private:
-   CCache(const CCache&);
-   CCache& operator=(const CCache&);
-};
-
-
-class CInfoBlock
-{
-public:
-   uint32_t m_piIP[4];		// IP address, machine read only, not human readable format
-   int m_iIPversion;   		// Address family: AF_INET or AF_INET6
-   uint64_t m_ullTimeStamp;	// last update time
-   int m_iRTT;			// RTT
-   int m_iBandwidth;		// estimated bandwidth
-   int m_iLossRate;		// average loss rate
-   int m_iReorderDistance;	// packet reordering distance
-   double m_dInterval;		// inter-packet time, congestion control
-   double m_dCWnd;		// congestion window size, congestion control
-
-public:
-   virtual ~CInfoBlock() {}
-   virtual CInfoBlock& operator=(const CInfoBlock& obj);
-   virtual bool operator==(const CInfoBlock& obj);
-   virtual CInfoBlock* clone();
-   virtual int getKey();
-   virtual void release() {}
-
-public:
-
-      /// convert sockaddr structure to an integer array
-      /// @param [in] addr network address
-      /// @param [in] ver IP version
-      /// @param [out] ip the result machine readable IP address in integer array
-
-   static void convert(const sockaddr_any& addr, uint32_t ip[4]);
+   CInfoCache(const CInfoCache&);
+   CInfoCache& operator=(const CInfoCache&);
 };
 
 
@@ -451,6 +451,66 @@ void CMD5::compute(const char* input, unsigned char result[16])
    md5_finish(&state, result);
 }
 
+static inline uint64_t SipRotl(uint64_t x, int b)
+{
+   return (x << b) | (x >> (64 - b));
+}
+
+static inline uint64_t SipLoad64(const unsigned char* p)
+{
+   // Little endian, regardless of the platform
+   uint64_t v = 0;
+   for (int i = 7; i >= 0; --i)
+      v = (v << 8) | p[i];
+   return v;
+}
+
+static inline void SipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+{
+   v0 += v1; v1 = SipRotl(v1, 13); v1 ^= v0; v0 = SipRotl(v0, 32);
+   v2 += v3; v3 = SipRotl(v3, 16); v3 ^= v2;
+   v0 += v3; v3 = SipRotl(v3, 21); v3 ^= v0;
+   v2 += v1; v1 = SipRotl(v1, 17); v1 ^= v2; v2 = SipRotl(v2, 32);
+}
+
+uint64_t CSipHash::compute(const unsigned char key[KEY_SIZE], const unsigned char* input, size_t len)
+{
+   const uint64_t k0 = SipLoad64(key);
+   const uint64_t k1 = SipLoad64(key + 8);
+   uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+   uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+   uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+   uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+
+   const unsigned char* const end = input + (len & ~size_t(7));
+   for (; input != end; input += 8)
+   {
+      const uint64_t m = SipLoad64(input);
+      v3 ^= m;
+      SipRound(v0, v1, v2, v3);
+      SipRound(v0, v1, v2, v3);
+      v0 ^= m;
+   }
+
+   // The last block is the remaining bytes with the length in the top byte.
+   uint64_t b = uint64_t(len) << 56;
+   for (int i = int(len & 7) - 1; i >= 0; --i)
+      b |= uint64_t(input[i]) << (8 * i);
+
+   v3 ^= b;
+   SipRound(v0, v1, v2, v3);
+   SipRound(v0, v1, v2, v3);
+   v0 ^= b;
+
+   v2 ^= 0xff;
+   SipRound(v0, v1, v2, v3);
+   SipRound(v0, v1, v2, v3);
+   SipRound(v0, v1, v2, v3);
+   SipRound(v0, v1, v2, v3);
+
+   return v0 ^ v1 ^ v2 ^ v3;
+}
+
 std::string MessageTypeStr(UDTMessageType mt, uint32_t extt)
 {
     using std::string;
@@ -590,15 +650,34 @@ std::string SockStatusStr(SRT_SOCKSTATUS s)
     return names.names[int(s)-1];
 }
 
-LogDispatcher::Proxy::Proxy(LogDispatcher& guy) : that(guy), that_enabled(that.CheckEnabled())
+LogDispatcher::Proxy::Proxy(LogDispatcher& guy) : that(guy), os(), line(), that_enabled(that.CheckEnabled())
 {
     if (that_enabled)
     {
         i_file = "";
         i_line = 0;
+        area = "";
         flags = that.src_config->flags;
-        // Create logger prefix
-        that.CreateLogLinePrefix(os);
+        if ((flags & SRT_LOGF_ASYNC) && that.src_config->asyncEnter())
+        {
+            line = LogLine::acquire();
+            if (!line)
+                that.src_config->asyncLeave();
+        }
+
+        // Create logger prefix. In asynchronous mode only the time
+        // is recorded, it's formatted by the writer thread.
+        if (line)
+        {
+            if (!that.isset(SRT_LOGF_DISABLE_TIME))
+                gettimeofday(&line->time, 0);
+            that.CreateLogLinePrefix(line->os, false);
+        }
+        else
+        {
+            os = new std::ostringstream;
+            that.CreateLogLinePrefix(*os);
+        }
     }
 }
 
@@ -607,14 +686,13 @@ LogDispatcher::Proxy LogDispatcher::operator()()
     return Proxy(*this);
 }
 
-void LogDispatcher::CreateLogLinePrefix(std::ostringstream& serr)
+void LogDispatcher::CreateLogLinePrefix(std::ostream& serr, bool with_time)
 {
     using namespace std;
 
     char tmp_buf[512];
-    if ( !isset(SRT_LOGF_DISABLE_TIME) )
+    if ( with_time && !isset(SRT_LOGF_DISABLE_TIME) )
     {
-        // Not necessary if sending through the queue.
         timeval tv;
         gettimeofday(&tv, 0);
         struct tm tm = SysLocalTime((time_t) tv.tv_sec);
@@ -623,7 +701,7 @@ void LogDispatcher::CreateLogLinePrefix(std::ostringstream& serr)
         serr << tmp_buf << setw(6) << setfill('0') << tv.tv_usec;
     }
 
-    string out_prefix;
+    const char* out_prefix = "";
     if ( !isset(SRT_LOGF_DISABLE_SEVERITY) )
     {
         out_prefix = prefix;
@@ -840,6 +840,15 @@ struct CMD5
    static void compute(const char* input, unsigned char result[16]);
 };
 
+// SipHash-2-4, a keyed hash function fast for short input.
+// Used to bake the SYN cookies.
+struct CSipHash
+{
+   static const size_t KEY_SIZE = 16;
+
+   static uint64_t compute(const unsigned char key[KEY_SIZE], const unsigned char* input, size_t len);
+};
+
 // Debug stats
 template <size_t SIZE>
 class StatsLossRecords
@@ -959,6 +968,73 @@ public:
 };
 
 
+/// Histogram of durations in microseconds, with the log-scale buckets
+/// described at SRT_HISTOGRAM in srt.h. Samples are added with relaxed
+/// atomic operations only, so it can be updated by any thread on the data
+/// path without locking and without allocation.
+class CLogHistogram
+{
+public:
+    static int bucketOf(int64_t us)
+    {
+        if (us < 4)
+            return us < 0 ? 0 : int(us);
+
+#if defined(__GNUC__)
+        const int msb = 63 - __builtin_clzll((unsigned long long)us);
+#else
+        int msb = 2;
+        while (msb < 62 && (us >> (msb + 1)) != 0)
+            ++msb;
+#endif
+
+        const int bucket = (msb - 1) * 4 + int((us >> (msb - 2)) & 3);
+        return bucket < SRT_HISTOGRAM_BUCKETS ? bucket : SRT_HISTOGRAM_BUCKETS - 1;
+    }
+
+    void add(int64_t us)
+    {
+        if (us < 0)
+            us = 0;
+        m_Count.fetch_add(1);
+        m_Sum.fetch_add(us);
+        m_Max.fetch_max(us);
+        m_Buckets[bucketOf(us)].fetch_add(1);
+    }
+
+    /// Copy the histogram into w_out, optionally starting over. With `clear`
+    /// every value is exchanged atomically, so no sample is lost, although
+    /// a sample added meanwhile may be counted in a bucket and not in the sum.
+    void get(SRT_HISTOGRAM& w_out, bool clear)
+    {
+        w_out.count = take(m_Count, clear);
+        w_out.usSum = take(m_Sum, clear);
+        w_out.usMax = take(m_Max, clear);
+        for (int i = 0; i < SRT_HISTOGRAM_BUCKETS; ++i)
+            w_out.buckets[i] = take(m_Buckets[i], clear);
+    }
+
+    void reset()
+    {
+        m_Count.store(0);
+        m_Sum.store(0);
+        m_Max.store(0);
+        for (int i = 0; i < SRT_HISTOGRAM_BUCKETS; ++i)
+            m_Buckets[i].store(0);
+    }
+
+private:
+    static uint64_t take(srt::sync::atomic<int64_t>& value, bool clear)
+    {
+        return uint64_t(clear ? value.exchange(0) : value.load());
+    }
+
+    srt::sync::atomic<int64_t> m_Count;
+    srt::sync::atomic<int64_t> m_Sum;
+    srt::sync::atomic<int64_t> m_Max;
+    srt::sync::atomic<int64_t> m_Buckets[SRT_HISTOGRAM_BUCKETS];
+};
+
 // There are some better or worse things you can find outside,
 // there's also boost::circular_buffer, but it's too overspoken
 // to be included here. We also can't rely on boost. Maybe in future
@@ -24,6 +24,7 @@
 
 #include <string>
 #include <cmath>
+#include <algorithm>
 
 
 #include "common.h"
@@ -331,6 +332,25 @@ public:
         }
     }
 
+    void seedFromHost(double pktsndperiod_us, double cwnd) ATR_OVERRIDE
+    {
+        // The slow start continues from the window the previous connection
+        // has reached. The sending period stays 1us during the slow start,
+        // so a longer one means that the previous connection has ended it,
+        // and this one starts at its rate.
+        if (cwnd > m_dCWndSize)
+            m_dCWndSize = std::min(cwnd, m_dMaxCWndSize);
+
+        if (pktsndperiod_us > 1)
+        {
+            m_bSlowStart = false;
+            m_dPktSndPeriod = pktsndperiod_us;
+            m_dLastDecPeriod = pktsndperiod_us;
+        }
+        HLOGC(cclog.Debug, log << "FileCC: seeded wndsize=" << m_dCWndSize << " sndperiod=" << m_dPktSndPeriod
+            << "us slowstart:" << (m_bSlowStart ? "ON" : "OFF"));
+    }
+
 private:
 
     // SLOTS
@@ -609,6 +629,546 @@ private:
 };
 
 
+// Model-based congestion control, following the BBR approach: instead of
+// reacting to packet loss, the sender maintains an estimate of the
+// bottleneck bandwidth (windowed maximum of the delivery rate) and of the
+// round-trip propagation time (windowed minimum of RTT samples). The sending
+// period is derived from the bandwidth estimate multiplied by a pacing gain,
+// and the congestion window is limited to a multiple of the resulting
+// bandwidth-delay product. Random loss therefore does not slow down the
+// transmission, which makes it suitable for long fat pipes.
+class BbrCC : public SrtCongestionControlBase
+{
+    typedef BbrCC Me; // Required by SSLOT macro
+
+    enum Mode { BBR_STARTUP, BBR_DRAIN, BBR_PROBE_BW, BBR_PROBE_RTT };
+
+    static const int BW_FILTER_ROUNDS = 10;             // rounds in the bottleneck bandwidth window
+    static const int64_t MIN_RTT_WINDOW_US = 10000000;  // 10s: expiry of the min RTT estimate
+    static const int64_t PROBE_RTT_TIME_US = 200000;    // 200ms: minimum duration of PROBE_RTT
+    static const int PROBE_RTT_CWND = 4;                // packets kept in flight during PROBE_RTT
+    static const int MIN_CWND = 16;                     // lower bound for the congestion window
+    static const int FULL_BW_ROUNDS = 3;                // rounds without growth that end STARTUP
+    static const int GAIN_CYCLE_LEN = 8;
+
+    static const double HIGH_GAIN;                      // 2/ln(2), used in STARTUP
+    static const double FULL_BW_THRESHOLD;              // bandwidth growth considered still significant
+    static const double PACING_GAIN_CYCLE[GAIN_CYCLE_LEN];
+
+    Mode m_Mode;
+
+    // Bottleneck bandwidth filter: maximum delivery rate per round, in packets per second
+    double m_adBwRound[BW_FILTER_ROUNDS];
+    double m_dBtlBw;
+    int64_t m_llRoundCount;
+    int32_t m_iRoundEndSeq;     // a round ends when this sequence is acknowledged
+
+    // Round-trip propagation time filter
+    int m_iMinRTT;              // in microseconds, 0 if not yet measured
+    steady_clock::time_point m_tsMinRTTStamp;
+
+    // STARTUP exit detection
+    double m_dFullBw;
+    int m_iFullBwCount;
+    bool m_bFullBwReached;
+
+    // PROBE_BW gain cycling
+    int m_iCycleIndex;
+    steady_clock::time_point m_tsCycleStamp;
+
+    // PROBE_RTT state
+    steady_clock::time_point m_tsProbeRTTDone;
+    bool m_bProbeRTTRoundDone;
+    int64_t m_llProbeRTTRound;
+
+    double m_dPacingGain;
+    double m_dCWndGain;
+    int32_t m_iLastAck;
+    steady_clock::time_point m_tsLastAckTime;
+    int64_t m_maxSR;
+
+public:
+
+    BbrCC(CUDT* parent)
+        : SrtCongestionControlBase(parent)
+        , m_Mode(BBR_STARTUP)
+        , m_dBtlBw(0)
+        , m_llRoundCount(0)
+        , m_iRoundEndSeq(parent->sndSeqNo())
+        , m_iMinRTT(0)
+        , m_tsMinRTTStamp(steady_clock::now())
+        , m_dFullBw(0)
+        , m_iFullBwCount(0)
+        , m_bFullBwReached(false)
+        , m_iCycleIndex(0)
+        , m_tsCycleStamp(steady_clock::now())
+        , m_bProbeRTTRoundDone(false)
+        , m_llProbeRTTRound(0)
+        , m_dPacingGain(HIGH_GAIN)
+        , m_dCWndGain(HIGH_GAIN)
+        , m_iLastAck(parent->sndSeqNo())
+        , m_tsLastAckTime(steady_clock::now())
+        , m_maxSR(0)
+    {
+        std::fill(m_adBwRound, m_adBwRound + BW_FILTER_ROUNDS, 0.0);
+
+        // Until the first delivery rate sample arrives the sending is
+        // limited only by the initial window, as with FileCC.
+        m_dCWndSize = MIN_CWND;
+        m_dPktSndPeriod = 1;
+
+        parent->ConnectSignal(TEV_ACK,        SSLOT(onAck));
+        parent->ConnectSignal(TEV_LOSSREPORT, SSLOT(onLossReport));
+        parent->ConnectSignal(TEV_CHECKTIMER, SSLOT(onCheckTimer));
+
+        HLOGC(cclog.Debug, log << "Creating BbrCC");
+    }
+
+    bool checkTransArgs(SrtCongestion::TransAPI, SrtCongestion::TransDir, const char*, size_t, int, bool) ATR_OVERRIDE
+    {
+        return true;
+    }
+
+    bool needsQuickACK(const CPacket& pkt) ATR_OVERRIDE
+    {
+        // Same as FileCC: an irregular sized packet usually indicates
+        // the end of a message, so send an ACK immediately.
+        return pkt.getLength() < m_parent->maxPayloadSize();
+    }
+
+    void updateBandwidth(int64_t maxbw, int64_t) ATR_OVERRIDE
+    {
+        if (maxbw != 0)
+        {
+            m_maxSR = maxbw;
+            HLOGC(cclog.Debug, log << "BbrCC: updated BW: " << m_maxSR);
+        }
+    }
+
+    void seedFromHost(double pktsndperiod_us, double cwnd) ATR_OVERRIDE
+    {
+        // Until the model gets the first samples, send with the window
+        // and the rate of the previous connection instead of the initial
+        // window. The samples are limited by this rate, but the STARTUP
+        // gain makes the estimate grow from there.
+        if (cwnd > m_dCWndSize)
+            m_dCWndSize = std::min(cwnd, m_dMaxCWndSize);
+        if (pktsndperiod_us > 0)
+            m_dPktSndPeriod = pktsndperiod_us;
+        HLOGC(cclog.Debug, log << "BbrCC: seeded cwnd=" << m_dCWndSize << " sndperiod=" << m_dPktSndPeriod << "us");
+    }
+
+    SrtCongestion::RexmitMethod rexmitMethod() ATR_OVERRIDE
+    {
+        return SrtCongestion::SRM_LATEREXMIT;
+    }
+
+private:
+
+    // Bandwidth-delay product in packets, for the current estimates
+    double bdp() const
+    {
+        return m_dBtlBw * m_iMinRTT / 1000000.0;
+    }
+
+    void updateBtlBw(double sample, bool new_round)
+    {
+        if (new_round)
+        {
+            ++m_llRoundCount;
+            m_adBwRound[m_llRoundCount % BW_FILTER_ROUNDS] = 0;
+        }
+
+        double& slot = m_adBwRound[m_llRoundCount % BW_FILTER_ROUNDS];
+        if (sample > slot)
+            slot = sample;
+
+        m_dBtlBw = *std::max_element(m_adBwRound, m_adBwRound + BW_FILTER_ROUNDS);
+    }
+
+    void checkFullPipe(bool new_round)
+    {
+        if (m_bFullBwReached || !new_round)
+            return;
+
+        if (m_dBtlBw >= m_dFullBw * FULL_BW_THRESHOLD)
+        {
+            m_dFullBw = m_dBtlBw;
+            m_iFullBwCount = 0;
+            return;
+        }
+
+        if (++m_iFullBwCount >= FULL_BW_ROUNDS)
+        {
+            m_bFullBwReached = true;
+            HLOGC(cclog.Debug, log << "BbrCC: pipe full at bw=" << m_dBtlBw << " pkts/s");
+        }
+    }
+
+    void enterProbeBW(const steady_clock::time_point& now)
+    {
+        m_Mode = BBR_PROBE_BW;
+        m_dCWndGain = 2.0;
+
+        // Start from a random phase, except the draining one, so that
+        // multiple flows do not probe synchronously.
+        m_iCycleIndex = genRandomInt(0, GAIN_CYCLE_LEN - 1);
+        if (m_iCycleIndex == 1)
+            m_iCycleIndex = 2;
+        m_dPacingGain = PACING_GAIN_CYCLE[m_iCycleIndex];
+        m_tsCycleStamp = now;
+    }
+
+    void updateMode(const steady_clock::time_point& now, int inflight, bool new_round)
+    {
+        if (m_Mode == BBR_STARTUP && m_bFullBwReached)
+        {
+            m_Mode = BBR_DRAIN;
+            m_dPacingGain = 1.0 / HIGH_GAIN;
+            m_dCWndGain = HIGH_GAIN;
+            HLOGC(cclog.Debug, log << "BbrCC: STARTUP -> DRAIN");
+        }
+
+        if (m_Mode == BBR_DRAIN && inflight <= bdp())
+        {
+            enterProbeBW(now);
+            HLOGC(cclog.Debug, log << "BbrCC: DRAIN -> PROBE_BW");
+        }
+
+        if (m_Mode == BBR_PROBE_BW)
+        {
+            // Each phase lasts one min RTT. The probing phase is additionally
+            // held until the window had a chance to fill, the draining
+            // phase ends as soon as the queue is gone.
+            const bool elapsed = count_microseconds(now - m_tsCycleStamp) > m_iMinRTT;
+            bool advance = elapsed;
+            if (m_dPacingGain > 1.0)
+                advance = elapsed && inflight >= m_dPacingGain * bdp();
+            else if (m_dPacingGain < 1.0)
+                advance = elapsed || inflight <= bdp();
+
+            if (advance)
+            {
+                m_iCycleIndex = (m_iCycleIndex + 1) % GAIN_CYCLE_LEN;
+                m_dPacingGain = PACING_GAIN_CYCLE[m_iCycleIndex];
+                m_tsCycleStamp = now;
+            }
+        }
+
+        if (m_Mode != BBR_PROBE_RTT && m_iMinRTT > 0
+                && count_microseconds(now - m_tsMinRTTStamp) > MIN_RTT_WINDOW_US)
+        {
+            m_Mode = BBR_PROBE_RTT;
+            m_dPacingGain = 1.0;
+            m_tsProbeRTTDone = steady_clock::time_point();
+            m_bProbeRTTRoundDone = false;
+            HLOGC(cclog.Debug, log << "BbrCC: -> PROBE_RTT, minRTT=" << m_iMinRTT << "us expired");
+        }
+
+        if (m_Mode == BBR_PROBE_RTT)
+        {
+            if (is_zero(m_tsProbeRTTDone) && inflight <= PROBE_RTT_CWND)
+            {
+                const int64_t probe_time_us = m_iMinRTT > PROBE_RTT_TIME_US ? m_iMinRTT : PROBE_RTT_TIME_US;
+                m_tsProbeRTTDone = now + microseconds_from(probe_time_us);
+                m_llProbeRTTRound = m_llRoundCount;
+            }
+            else if (!is_zero(m_tsProbeRTTDone))
+            {
+                if (new_round && m_llRoundCount > m_llProbeRTTRound)
+                    m_bProbeRTTRoundDone = true;
+
+                if (m_bProbeRTTRoundDone && now > m_tsProbeRTTDone)
+                {
+                    m_tsMinRTTStamp = now;
+                    if (m_bFullBwReached)
+                    {
+                        enterProbeBW(now);
+                    }
+                    else
+                    {
+                        m_Mode = BBR_STARTUP;
+                        m_dPacingGain = HIGH_GAIN;
+                        m_dCWndGain = HIGH_GAIN;
+                    }
+                    HLOGC(cclog.Debug, log << "BbrCC: PROBE_RTT done, minRTT=" << m_iMinRTT << "us");
+                }
+            }
+        }
+    }
+
+    void updateControl()
+    {
+        if (m_dBtlBw <= 0 || m_iMinRTT <= 0)
+            return;
+
+        m_dPktSndPeriod = 1000000.0 / (m_dPacingGain * m_dBtlBw);
+
+        if (m_Mode == BBR_PROBE_RTT)
+            m_dCWndSize = PROBE_RTT_CWND;
+        else
+            m_dCWndSize = std::max<double>(m_dCWndGain * bdp(), MIN_CWND);
+
+        if (m_dCWndSize > m_dMaxCWndSize)
+            m_dCWndSize = m_dMaxCWndSize;
+
+        // set maximum transfer rate
+        if (m_maxSR)
+        {
+            const double minSP = 1000000.0 / (double(m_maxSR) / m_parent->MSS());
+            if (m_dPktSndPeriod < minSP)
+                m_dPktSndPeriod = minSP;
+        }
+    }
+
+    void updateMinRTT(const steady_clock::time_point& now)
+    {
+        // The sender measures the RTT samples itself when ACK packets come,
+        // see CUDT::processCtrlAck().
+        const int rtt = m_parent->lastRTTSample();
+        if (rtt <= 0)
+            return;
+
+        const bool expired = count_microseconds(now - m_tsMinRTTStamp) > MIN_RTT_WINDOW_US;
+        if (m_iMinRTT == 0 || rtt <= m_iMinRTT || (expired && m_Mode != BBR_PROBE_RTT))
+        {
+            m_iMinRTT = rtt;
+            m_tsMinRTTStamp = now;
+        }
+    }
+
+    // SLOTS
+    void onAck(ETransmissionEvent, EventVariant arg)
+    {
+        const int32_t ack = arg.get<EventVariant::ACK>();
+        const steady_clock::time_point now = steady_clock::now();
+
+        const bool new_round = CSeqNo::seqcmp(ack, m_iRoundEndSeq) > 0;
+        if (new_round)
+            m_iRoundEndSeq = m_parent->sndSeqNo();
+
+        // Delivery rate sample from the ACK progress. The packets could not
+        // have been delivered faster than they were sent, so the sample is
+        // limited by the sending rate; this prevents overestimation when the
+        // ACK jumps after a retransmitted packet fills a hole.
+        double sample = 0;
+        const int delivered = CSeqNo::seqoff(m_iLastAck, ack);
+        const int64_t interval_us = count_microseconds(now - m_tsLastAckTime);
+        if (delivered > 0 && interval_us > 0)
+            sample = std::min(delivered * 1000000.0 / interval_us, 1000000.0 / m_dPktSndPeriod);
+
+        // The delivery rate reported by the receiver is measured from the
+        // packet arrival intervals, so it is not affected by the holes in
+        // the sequence left by lost packets.
+        sample = std::max<double>(sample, m_parent->deliveryRate());
+        if (sample > 0)
+            updateBtlBw(sample, new_round);
+
+        updateMinRTT(now);
+
+        if (m_dBtlBw <= 0 || m_iMinRTT <= 0)
+        {
+            // No model yet: grow the window as in slow start.
+            m_dCWndSize += CSeqNo::seqlen(m_iLastAck, ack);
+            if (m_dCWndSize > m_dMaxCWndSize)
+                m_dCWndSize = m_dMaxCWndSize;
+        }
+        m_iLastAck = ack;
+        m_tsLastAckTime = now;
+
+        checkFullPipe(new_round);
+        updateMode(now, m_parent->getFlightSpan(), new_round);
+        updateControl();
+
+        HLOGC(cclog.Debug, log << "BbrCC: ACK " << ack << " mode=" << m_Mode
+            << " btlbw=" << m_dBtlBw << " pkts/s minRTT=" << m_iMinRTT
+            << "us gain=" << m_dPacingGain << " sndperiod=" << m_dPktSndPeriod
+            << "us cwnd=" << m_dCWndSize);
+    }
+
+    void onLossReport(ETransmissionEvent, EventVariant arg SRT_ATR_UNUSED)
+    {
+        // Loss is not a congestion signal for this controller; the model
+        // is updated from the delivery rate only. Lost packets are simply
+        // retransmitted at the current pacing rate.
+        HLOGC(cclog.Debug, log << "BbrCC: LOSS reported, " << arg.get_len() << " entries, mode=" << m_Mode);
+    }
+
+    void onCheckTimer(ETransmissionEvent, EventVariant arg)
+    {
+        const ECheckTimerStage stg = arg.get<EventVariant::STAGE>();
+        if (stg == TEV_CHT_INIT)
+            return;
+
+        // A retransmission timeout while still without a model means
+        // the initial window was too optimistic. Otherwise the pacing
+        // stays with the model.
+        if (m_dBtlBw <= 0)
+            m_dCWndSize = MIN_CWND;
+    }
+};
+
+const double BbrCC::HIGH_GAIN = 2.885;
+const double BbrCC::FULL_BW_THRESHOLD = 1.25;
+const double BbrCC::PACING_GAIN_CYCLE[BbrCC::GAIN_CYCLE_LEN] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+
+
+// Adapter for a controller registered through the C API. The callbacks
+// are connected to the signals only if they are set, so the per-packet
+// TEV_SEND is not emitted into it unless requested.
+class CallbackCC : public SrtCongestionControlBase
+{
+    typedef CallbackCC Me; // Required by SSLOT macro
+
+    const SRT_CONGCTL_CALLBACKS m_Callbacks;
+    void* m_pState;
+    bool m_bCreated;
+    SRT_CONGCTL_DATA m_Data;
+
+public:
+
+    CallbackCC(CUDT* parent, const SRT_CONGCTL_CALLBACKS& callbacks, void* opaque)
+        : SrtCongestionControlBase(parent)
+        , m_Callbacks(callbacks)
+        , m_pState(NULL)
+        , m_bCreated(true)
+    {
+        m_Data.pkt_snd_period_us = m_dPktSndPeriod;
+        m_Data.cwnd_size = m_dCWndSize;
+        refreshData();
+
+        if (m_Callbacks.create)
+        {
+            m_pState = m_Callbacks.create(opaque, parent->socketID(), &m_Data);
+            m_bCreated = m_pState != NULL;
+        }
+        applyData();
+
+        if (m_Callbacks.on_ack)
+            parent->ConnectSignal(TEV_ACK, SSLOT(onAck));
+        if (m_Callbacks.on_loss)
+            parent->ConnectSignal(TEV_LOSSREPORT, SSLOT(onLossReport));
+        if (m_Callbacks.on_timer)
+            parent->ConnectSignal(TEV_CHECKTIMER, SSLOT(onCheckTimer));
+        if (m_Callbacks.on_send)
+            parent->ConnectSignal(TEV_SEND, SSLOT(onSend));
+
+        HLOGC(cclog.Debug, log << "Creating CallbackCC" << (m_bCreated ? "" : " - REJECTED by user callback"));
+    }
+
+    ~CallbackCC()
+    {
+        if (m_bCreated && m_Callbacks.destroy)
+            m_Callbacks.destroy(m_pState);
+    }
+
+    bool created() const { return m_bCreated; }
+
+    bool needsQuickACK(const CPacket& pkt) ATR_OVERRIDE
+    {
+        return m_Callbacks.quickack_on_short && pkt.getLength() < m_parent->maxPayloadSize();
+    }
+
+    void updateBandwidth(int64_t maxbw, int64_t bw) ATR_OVERRIDE
+    {
+        if (!m_Callbacks.on_bandwidth)
+            return;
+
+        refreshData();
+        m_Callbacks.on_bandwidth(m_pState, &m_Data, maxbw, bw);
+        applyData();
+    }
+
+    SrtCongestion::RexmitMethod rexmitMethod() ATR_OVERRIDE
+    {
+        return m_Callbacks.fastrexmit ? SrtCongestion::SRM_FASTREXMIT : SrtCongestion::SRM_LATEREXMIT;
+    }
+
+private:
+
+    void refreshData()
+    {
+        m_Data.cwnd_max_size = m_dMaxCWndSize;
+        m_Data.rtt_us = m_parent->RTT();
+        m_Data.delivery_rate = m_parent->deliveryRate();
+        m_Data.bandwidth = m_parent->bandwidth();
+        m_Data.mss = m_parent->MSS();
+        m_Data.max_payload_size = int(m_parent->maxPayloadSize());
+        m_Data.snd_seqno = m_parent->sndSeqNo();
+        m_Data.flight_span = m_parent->getFlightSpan();
+        m_Data.snd_loss_length = m_parent->sndLossLength();
+        m_Data.max_bw = m_parent->maxBandwidth();
+    }
+
+    void applyData()
+    {
+        // Protect against values that would stall the transmission
+        m_dPktSndPeriod = m_Data.pkt_snd_period_us > 0 ? m_Data.pkt_snd_period_us : 1;
+        m_dCWndSize = m_Data.cwnd_size >= 1 ? m_Data.cwnd_size : 1;
+    }
+
+    // SLOTS
+    void onAck(ETransmissionEvent, EventVariant arg)
+    {
+        refreshData();
+        m_Callbacks.on_ack(m_pState, &m_Data, arg.get<EventVariant::ACK>());
+        applyData();
+    }
+
+    void onLossReport(ETransmissionEvent, EventVariant arg)
+    {
+        refreshData();
+        m_Callbacks.on_loss(m_pState, &m_Data, arg.get_ptr(), arg.get_len());
+        applyData();
+    }
+
+    void onCheckTimer(ETransmissionEvent, EventVariant arg)
+    {
+        const ECheckTimerStage stg = arg.get<EventVariant::STAGE>();
+        if (stg == TEV_CHT_INIT)
+            return;
+
+        refreshData();
+        m_Callbacks.on_timer(m_pState, &m_Data, stg == TEV_CHT_FASTREXMIT);
+        applyData();
+    }
+
+    void onSend(ETransmissionEvent, EventVariant arg)
+    {
+        // Values from this event are not taken over by CUDT, so only
+        // the inputs are refreshed.
+        const CPacket* pkt = arg.get<EventVariant::PACKET>();
+        refreshData();
+        m_Callbacks.on_send(m_pState, &m_Data, pkt->getSeqNo(), int(pkt->getLength()));
+    }
+};
+
+class CallbackFactory : public SrtCongestion::Factory
+{
+    const SRT_CONGCTL_CALLBACKS m_Callbacks;
+    void* m_pOpaque;
+
+public:
+
+    CallbackFactory(const SRT_CONGCTL_CALLBACKS& callbacks, void* opaque)
+        : m_Callbacks(callbacks)
+        , m_pOpaque(opaque)
+    {
+    }
+
+    SrtCongestionControlBase* Create(CUDT* parent) ATR_OVERRIDE
+    {
+        CallbackCC* cc = new CallbackCC(parent, m_Callbacks, m_pOpaque);
+        if (!cc->created())
+        {
+            delete cc;
+            return NULL;
+        }
+        return cc;
+    }
+};
+
+
 #undef SSLOT
 
 template <class Target>
@@ -620,12 +1180,66 @@ struct Creator
 SrtCongestion::NamePtr SrtCongestion::congctls[N_CONTROLLERS] =
 {
     {"live", Creator<LiveCC>::Create },
-    {"file", Creator<FileCC>::Create }
+    {"file", Creator<FileCC>::Create },
+    {"bbr",  Creator<BbrCC>::Create }
 };
 
 
+SrtCongestion::UserCongctls SrtCongestion::user_congctls;
+srt::sync::Mutex SrtCongestion::user_congctls_lock;
+
+SrtCongestion::UserCongctls::~UserCongctls()
+{
+    for (iterator i = begin(); i != end(); ++i)
+        delete i->second;
+}
+
+bool SrtCongestion::add(const std::string& name, Factory* factory)
+{
+    if (name.empty() || IsBuiltin(name))
+    {
+        delete factory;
+        return false;
+    }
+
+    ScopedLock lk (user_congctls_lock);
+    if (user_congctls.count(name))
+    {
+        delete factory;
+        return false;
+    }
+
+    user_congctls[name] = factory;
+    HLOGC(cclog.Debug, log << "SrtCongestion: registered user controller '" << name << "'");
+    return true;
+}
+
+bool SrtCongestion::add(const std::string& name, const SRT_CONGCTL_CALLBACKS& callbacks, void* opaque)
+{
+    return add(name, new CallbackFactory(callbacks, opaque));
+}
+
+bool SrtCongestion::selectUser(const std::string& name)
+{
+    ScopedLock lk (user_congctls_lock);
+    UserCongctls::iterator i = user_congctls.find(name);
+    if (i == user_congctls.end())
+        return false;
+
+    user_factory = i->second;
+    user_name = name;
+    selector = N_CONTROLLERS;
+    return true;
+}
+
 bool SrtCongestion::configure(CUDT* parent)
 {
+    if (user_factory)
+    {
+        congctl = user_factory->Create(parent);
+        return !!congctl;
+    }
+
     if (selector == N_CONTROLLERS)
         return false;
 
@@ -11,10 +11,14 @@
 #ifndef INC__CONGCTL_H
 #define INC__CONGCTL_H
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <utility>
 
+#include "srt.h"
+#include "sync.h"
+
 class CUDT;
 class SrtCongestionControlBase;
 
@@ -22,18 +26,41 @@ typedef SrtCongestionControlBase* srtcc_create_t(CUDT* parent);
 
 class SrtCongestion
 {
-    // Temporarily changed to linear searching, until this is exposed
-    // for a user-defined controller.
+public:
+
+    // Creates a user-defined controller. The builtin controllers are
+    // kept in a fixed table instead, see congctls.
+    class Factory
+    {
+    public:
+        virtual SrtCongestionControlBase* Create(CUDT* parent) = 0;
+        virtual ~Factory() {}
+    };
+
+private:
+
+    // Builtin controllers are searched linearly in this table.
     // Note that this is a pointer to function :)
 
-    static const size_t N_CONTROLLERS = 2;
+    static const size_t N_CONTROLLERS = 3;
     // The first/second is to mimic the map.
     typedef struct { const char* first; srtcc_create_t* second; } NamePtr;
     static NamePtr congctls[N_CONTROLLERS];
 
+    // User-registered controllers. Entries are never removed or replaced,
+    // so a Factory pointer obtained under the lock stays valid.
+    struct UserCongctls: std::map<std::string, Factory*>
+    {
+        ~UserCongctls();
+    };
+    static UserCongctls user_congctls;
+    static srt::sync::Mutex user_congctls_lock;
+
     // This is a congctl container.
     SrtCongestionControlBase* congctl;
     size_t selector;
+    Factory* user_factory; // set instead of selector for a user controller
+    std::string user_name;
 
     void Check();
 
@@ -46,7 +73,7 @@ public:
     SrtCongestionControlBase* operator->() { Check(); return congctl; }
 
     // In the beginning it's uninitialized
-    SrtCongestion(): congctl(), selector(N_CONTROLLERS) {}
+    SrtCongestion(): congctl(), selector(N_CONTROLLERS), user_factory() {}
 
     struct IsName
     {
@@ -55,6 +82,22 @@ public:
         bool operator()(NamePtr np) { return n == np.first; }
     };
 
+    static bool IsBuiltin(const std::string& name)
+    {
+        NamePtr* end = congctls+N_CONTROLLERS;
+        return std::find_if(congctls, end, IsName(name)) != end;
+    }
+
+    // Registers a user-defined controller under the given name, so that it
+    // can be selected by SRTO_CONGESTION. Takes ownership of the factory.
+    // Fails if the name is already taken, either by a builtin or by a
+    // previously registered controller. This header isn't installed, so
+    // applications register their controllers with srt_register_congctl().
+    static bool add(const std::string& name, Factory* factory);
+
+    // Registers a controller implemented by C API callbacks.
+    static bool add(const std::string& name, const SRT_CONGCTL_CALLBACKS& callbacks, void* opaque);
+
     // You can call select() multiple times, until finally
     // the 'configure' method is called.
     bool select(const std::string& name)
@@ -62,13 +105,16 @@ public:
         NamePtr* end = congctls+N_CONTROLLERS;
         NamePtr* try_selector = std::find_if(congctls, end, IsName(name));
         if (try_selector == end)
-            return false;
+            return selectUser(name);
         selector = try_selector - congctls;
+        user_factory = NULL;
         return true;
     }
 
     std::string selected_name()
     {
+        if (user_factory)
+            return user_name;
         if (selector == N_CONTROLLERS)
             return "";
         return congctls[selector].first;
@@ -78,8 +124,20 @@ public:
     // Things being done:
     // 1. The congctl is individual, so don't copy it. Set NULL.
     // 2. The selected name is copied so that it's configured correctly.
-    SrtCongestion(const SrtCongestion& source): congctl(), selector(source.selector) {}
-    void operator=(const SrtCongestion& source) { congctl = 0; selector = source.selector; }
+    SrtCongestion(const SrtCongestion& source)
+        : congctl()
+        , selector(source.selector)
+        , user_factory(source.user_factory)
+        , user_name(source.user_name)
+    {}
+
+    void operator=(const SrtCongestion& source)
+    {
+        congctl = 0;
+        selector = source.selector;
+        user_factory = source.user_factory;
+        user_name = source.user_name;
+    }
 
     // This function will be called by the parent CUDT
     // in appropriate time. It should select appropriate
@@ -97,6 +155,11 @@ public:
     // destruction.
     ~SrtCongestion();
 
+private:
+    bool selectUser(const std::string& name);
+
+public:
+
     enum RexmitMethod
     {
         SRM_LATEREXMIT,
@@ -179,6 +242,13 @@ public:
     // Arg 2: value calculated out of CUDT::m_llInputBW and CUDT::m_iOverheadBW.
     virtual void updateBandwidth(int64_t, int64_t) {}
 
+    // Called once after the controller is created, if the previous
+    // connection to the same peer host has left its state in the host
+    // info cache: the packet sending period in microseconds and the
+    // congestion window in packets. The controller may start from them
+    // instead of its initial values.
+    virtual void seedFromHost(double /*pktsndperiod_us*/, double /*cwnd*/) {}
+
     virtual bool needsQuickACK(const CPacket&)
     {
         return false;
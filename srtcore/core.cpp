@@ -50,6 +50,7 @@ modified by
    Haivision Systems Inc.
 *****************************************************************************/
 
+#define SRT_IMPORT_FILEMAP
 #include "platform_sys.h"
 
 #include <cmath>
@@ -63,6 +64,7 @@ modified by
 #include "logging.h"
 #include "crypto.h"
 #include "logging_api.h" // Required due to containing extern srt_logger_config
+#include "trace.h"
 
 // Again, just in case when some "smart guy" provided such a global macro
 #ifdef min
@@ -207,6 +209,8 @@ void CUDT::construct()
     m_uKmRefreshRatePkt = 0;
     m_uKmPreAnnouncePkt = 0;
 
+    m_iCookieEpoch = -1;
+
     // Initilize mutex and condition variables
     initSynch();
 
@@ -258,6 +262,11 @@ CUDT::CUDT(CUDTSocket* parent): m_parent(parent)
     m_bOPT_StrictEncryption = true;
     m_iOPT_PeerIdleTimeout  = COMM_RESPONSE_TIMEOUT_MS;
     m_uOPT_StabilityTimeout = 4*CUDT::COMM_SYN_INTERVAL_US;
+    m_iOPT_SndPacingDelay   = 0;
+    m_bOPT_GroupFastSwitch  = false;
+    m_bOPT_GroupSharedRcv   = false;
+    m_bOPT_AcceptThread     = false;
+    m_bOPT_CCSeed           = false;
     m_OPT_GroupConnect      = 0;
     m_bTLPktDrop            = true; // Too-late Packet Drop
     m_bMessageAPI           = true;
@@ -284,7 +293,13 @@ CUDT::CUDT(CUDTSocket* parent): m_parent(parent)
 CUDT::CUDT(CUDTSocket* parent, const CUDT& ancestor): m_parent(parent)
 {
     construct();
+    inheritOptions(ancestor);
+}
 
+// Copies the options of the listener to the accepted socket. This is
+// also applied to a socket with default options, taken from the pool.
+void CUDT::inheritOptions(const CUDT& ancestor)
+{
     // XXX Consider all below fields (except m_bReuseAddr) to be put
     // into a separate class for easier copying.
 
@@ -322,6 +337,11 @@ CUDT::CUDT(CUDTSocket* parent, const CUDT& ancestor): m_parent(parent)
     m_bOPT_StrictEncryption = ancestor.m_bOPT_StrictEncryption;
     m_iOPT_PeerIdleTimeout  = ancestor.m_iOPT_PeerIdleTimeout;
     m_uOPT_StabilityTimeout = ancestor.m_uOPT_StabilityTimeout;
+    m_iOPT_SndPacingDelay   = ancestor.m_iOPT_SndPacingDelay;
+    m_bOPT_GroupFastSwitch  = ancestor.m_bOPT_GroupFastSwitch;
+    m_bOPT_GroupSharedRcv   = ancestor.m_bOPT_GroupSharedRcv;
+    m_bOPT_AcceptThread     = ancestor.m_bOPT_AcceptThread;
+    m_bOPT_CCSeed           = ancestor.m_bOPT_CCSeed;
     m_OPT_GroupConnect      = ancestor.m_OPT_GroupConnect; // NOTE: on single accept set back to 0
     m_zOPT_ExpPayloadSize   = ancestor.m_zOPT_ExpPayloadSize;
     m_bTLPktDrop            = ancestor.m_bTLPktDrop;
@@ -930,6 +950,18 @@ void CUDT::setOpt(SRT_SOCKOPT optName, const void* optval, int optlen)
         m_iIpV6Only = *(int *)optval;
         break;
 
+    case SRTO_PACINGDELAY:
+        if (*(int *)optval < 0)
+            throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
+
+        m_iOPT_SndPacingDelay = *(int *)optval;
+
+        // Can be changed on the fly; the input rate sampling
+        // may need to be turned on or off.
+        if (m_bConnected)
+            updateCC(TEV_INIT, TEV_INIT_RESET);
+        break;
+
     case SRTO_PACKETFILTER:
         if (m_bConnected)
             throw CUDTException(MJ_NOTSUP, MN_ISCONNECTED, 0);
@@ -988,6 +1020,30 @@ void CUDT::setOpt(SRT_SOCKOPT optName, const void* optval, int optlen)
 
         break;
 
+    case SRTO_GROUPFASTSWITCH:
+        // Like SRTO_GROUPSTABTIMEO, used by the group only.
+        m_bOPT_GroupFastSwitch = bool_int_value(optval, optlen);
+        break;
+
+    case SRTO_GROUPSHAREDRCV:
+        if (m_bConnected)
+            throw CUDTException(MJ_NOTSUP, MN_ISCONNECTED, 0);
+        m_bOPT_GroupSharedRcv = bool_int_value(optval, optlen);
+        break;
+
+    case SRTO_ACCEPTTHREAD:
+        // Taken over by the receiver queue in srt_listen().
+        if (m_bListening)
+            throw CUDTException(MJ_NOTSUP, MN_ISBOUND, 0);
+        m_bOPT_AcceptThread = bool_int_value(optval, optlen);
+        break;
+
+    case SRTO_CCSEED:
+        if (m_bConnected)
+            throw CUDTException(MJ_NOTSUP, MN_ISCONNECTED, 0);
+        m_bOPT_CCSeed = bool_int_value(optval, optlen);
+        break;
+
     default:
         throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
     }
@@ -1282,6 +1338,31 @@ void CUDT::getOpt(SRT_SOCKOPT optName, void *optval, int &optlen)
         optlen         = sizeof(int);
         break;
 
+    case SRTO_PACINGDELAY:
+        *(int *)optval = m_iOPT_SndPacingDelay;
+        optlen         = sizeof(int);
+        break;
+
+    case SRTO_GROUPFASTSWITCH:
+        *(bool *)optval = m_bOPT_GroupFastSwitch;
+        optlen          = sizeof(bool);
+        break;
+
+    case SRTO_GROUPSHAREDRCV:
+        *(bool *)optval = m_bOPT_GroupSharedRcv;
+        optlen          = sizeof(bool);
+        break;
+
+    case SRTO_ACCEPTTHREAD:
+        *(bool *)optval = m_bOPT_AcceptThread;
+        optlen          = sizeof(bool);
+        break;
+
+    case SRTO_CCSEED:
+        *(bool *)optval = m_bOPT_CCSeed;
+        optlen          = sizeof(bool);
+        break;
+
     case SRTO_PACKETFILTER:
         if (size_t(optlen) < m_OPT_PktFilterConfigString.size() + 1)
             throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
@@ -1344,46 +1425,23 @@ void CUDT::clearData()
         CGuard stat_lock(m_StatsLock);
 
         m_stats.tsStartTime = steady_clock::now();
-        m_stats.sentTotal = m_stats.recvTotal = m_stats.sndLossTotal = m_stats.rcvLossTotal = m_stats.retransTotal =
-            m_stats.sentACKTotal = m_stats.recvACKTotal = m_stats.sentNAKTotal = m_stats.recvNAKTotal = 0;
-        m_stats.tsLastSampleTime = steady_clock::now();
-        m_stats.traceSent = m_stats.traceRecv = m_stats.traceSndLoss = m_stats.traceRcvLoss = m_stats.traceRetrans =
-            m_stats.sentACK = m_stats.recvACK = m_stats.sentNAK = m_stats.recvNAK = 0;
-        m_stats.traceRcvRetrans                                                   = 0;
-        m_stats.traceReorderDistance                                              = 0;
-        m_stats.traceBelatedTime                                                  = 0.0;
-        m_stats.traceRcvBelated                                                   = 0;
-
-        m_stats.sndDropTotal = 0;
-        m_stats.traceSndDrop = 0;
-        m_stats.rcvDropTotal = 0;
-        m_stats.traceRcvDrop = 0;
-
-        m_stats.m_rcvUndecryptTotal = 0;
-        m_stats.traceRcvUndecrypt   = 0;
-
-        m_stats.bytesSentTotal    = 0;
-        m_stats.bytesRecvTotal    = 0;
-        m_stats.bytesRetransTotal = 0;
-        m_stats.traceBytesSent    = 0;
-        m_stats.traceBytesRecv    = 0;
-        m_stats.sndFilterExtra    = 0;
-        m_stats.rcvFilterExtra    = 0;
-        m_stats.rcvFilterSupply   = 0;
-        m_stats.rcvFilterLoss     = 0;
-
-        m_stats.traceBytesRetrans = 0;
-#ifdef SRT_ENABLE_LOSTBYTESCOUNT
-        m_stats.traceRcvBytesLoss = 0;
-#endif
-        m_stats.sndBytesDropTotal        = 0;
-        m_stats.rcvBytesDropTotal        = 0;
-        m_stats.traceSndBytesDrop        = 0;
-        m_stats.traceRcvBytesDrop        = 0;
-        m_stats.m_rcvBytesUndecryptTotal = 0;
-        m_stats.traceRcvBytesUndecrypt   = 0;
+        m_stats.tsLastSampleTime = m_stats.tsStartTime;
 
-        m_stats.sndDuration = m_stats.m_sndDurationTotal = 0;
+        for (int i = 0; i < STAT__SIZE; ++i)
+        {
+            m_stats.counters[i].store(0);
+            m_stats.base[i] = 0;
+        }
+
+        m_stats.traceReorderDistance.store(0);
+        m_stats.traceBelatedTime.store(0);
+        m_stats.sndPacingDelayMax.store(0);
+        m_stats.sndBackupSwitchTime.store(0);
+        m_stats.sndDurationCounter.store(count_microseconds(m_stats.tsStartTime));
+
+        m_stats.histRcvTransit.reset();
+        m_stats.histRcvBuffer.reset();
+        m_stats.histSndLag.reset();
     }
 
     // Resetting these data because this happens when agent isn't connected.
@@ -1429,6 +1487,10 @@ void CUDT::open()
 
     m_iRTT    = 10 * COMM_SYN_INTERVAL_US;
     m_iRTTVar = m_iRTT >> 1;
+    m_iRTTSample = 0;
+    m_iRTTProbeSeq.store(-1);
+    m_iProbeRTT = 0;
+    m_iProbeSentTime.store(0);
 
 
     // set minimum NAK and EXP timeout to 300ms
@@ -1452,6 +1514,7 @@ void CUDT::open()
     m_iLightACKCount = 1;
 
     m_tsNextSendTime = steady_clock::time_point();
+    m_tsLastUnpacedSndTime = steady_clock::time_point();
     m_tdSendTimeDiff = m_tdSendTimeDiff.zero();
 
     // Now UDT is opened.
@@ -3633,6 +3696,15 @@ bool CUDTGroup::getBufferTimeBase(CUDT* forthesakeof, steady_clock::time_point&
 // [[using locked(this->m_GroupLock)]];
 bool CUDTGroup::applyGroupSequences(SRTSOCKET target, int32_t& w_snd_isn, int32_t& w_rcv_isn)
 {
+    // In the balancing group every link keeps its own sequence, as agreed
+    // in the handshake. Both parties may see a different member connected
+    // first, so a sequence derived from another member can't be trusted.
+    if (m_type == SRT_GTYPE_BALANCING)
+    {
+        HLOGC(dlog.Debug, log << "applyGroupSequences: @" << target << " balancing group, keeping own sequences");
+        return true;
+    }
+
     if (m_bConnected) // You are the first one, no need to change.
     {
         IF_HEAVY_LOGGING(string update_reason = "what?");
@@ -4928,15 +5000,6 @@ EConnectStatus CUDT::postConnect(const CPacket &response, bool rendezvous, CUDTE
        }
     }
 
-    CInfoBlock ib;
-    ib.m_iIPversion = m_PeerAddr.family();
-    CInfoBlock::convert(m_PeerAddr, ib.m_piIP);
-    if (m_pCache->lookup(&ib) >= 0)
-    {
-        m_iRTT       = ib.m_iRTT;
-        m_iBandwidth = ib.m_iBandwidth;
-    }
-
     SRT_REJECT_REASON rr = setupCC();
     if (rr != SRT_REJ_UNKNOWN)
     {
@@ -5545,24 +5608,36 @@ void *CUDT::tsbpd(void *param)
             HLOGC(tslog.Debug,
                   log << self->CONID() << "tsbpd: PLAYING PACKET seq=" << current_pkt_seq << " (belated "
                       << (count_milliseconds(steady_clock::now() - tsbpdtime)) << "ms)");
-            /*
-             * There are packets ready to be delivered
-             * signal a waiting "recv" call if there is any data available
-             */
-            if (self->m_bSynRecving)
+            if (srt::trace::g_iEnabled.load())
             {
-                recvdata_cc.signal_locked(recv_lock);
+                const int64_t belated_us = count_microseconds(steady_clock::now() - tsbpdtime);
+                srt::trace::record(SRT_TRACE_TSBPD_RELEASE, self->m_SocketID, current_pkt_seq, std::max<int64_t>(belated_us, 0));
             }
-            /*
-             * Set EPOLL_IN to wakeup any thread waiting on epoll
-             */
-            self->s_UDTUnited.m_EPoll.update_events(self->m_SocketID, self->m_sPollID, SRT_EPOLL_IN, true);
             if (self->m_parent->m_IncludedGroup)
             {
-                // The current "APP reader" needs to simply decide as to whether
-                // the next CUDTGroup::recv() call should return with no blocking or not.
-                // When the group is read-ready, it should update its pollers as it sees fit.
-                self->m_parent->m_IncludedGroup->updateReadState(self->m_SocketID, current_pkt_seq);
+                // The application reads from the group, so move the packets
+                // ready to play to the group receiver buffer right away and
+                // check the time of the next one without waiting for a reader.
+                if (self->m_parent->m_IncludedGroup->readyPackets(self) > 0)
+                {
+                    CGlobEvent::triggerEvent();
+                    continue;
+                }
+            }
+            else
+            {
+                /*
+                 * There are packets ready to be delivered
+                 * signal a waiting "recv" call if there is any data available
+                 */
+                if (self->m_bSynRecving)
+                {
+                    recvdata_cc.signal_locked(recv_lock);
+                }
+                /*
+                 * Set EPOLL_IN to wakeup any thread waiting on epoll
+                 */
+                self->s_UDTUnited.m_EPoll.update_events(self->m_SocketID, self->m_sPollID, SRT_EPOLL_IN, true);
             }
             CGlobEvent::triggerEvent();
             tsbpdtime = steady_clock::time_point();
@@ -5601,6 +5676,13 @@ void *CUDT::tsbpd(void *param)
 
         HLOGC(tslog.Debug, log << self->CONID() << "tsbpd: WAKE UP!!!");
     }
+
+    // The connection is closing, so the packets stored here will not be
+    // played. In the shared receiving mode they may not be stored by any
+    // other member of the group.
+    if (self->m_parent->m_IncludedGroup)
+        self->m_parent->m_IncludedGroup->rcvHandOver(self);
+
     THREAD_EXIT();
     HLOGC(tslog.Debug, log << self->CONID() << "tsbpd: EXITING");
     return NULL;
@@ -5609,14 +5691,11 @@ void *CUDT::tsbpd(void *param)
 void CUDT::updateForgotten(int seqlen, int32_t lastack, int32_t skiptoseqno)
 {
     /* Update drop/skip stats */
-    enterCS(m_StatsLock);
-    m_stats.rcvDropTotal += seqlen;
-    m_stats.traceRcvDrop += seqlen;
+    countStat(STAT_RCV_DROP, seqlen);
     /* Estimate dropped/skipped bytes from average payload */
     int avgpayloadsz = m_pRcvBuffer->getRcvAvgPayloadSize();
-    m_stats.rcvBytesDropTotal += seqlen * avgpayloadsz;
-    m_stats.traceRcvBytesDrop += seqlen * avgpayloadsz;
-    leaveCS(m_StatsLock);
+    countStat(STAT_RCV_DROP_BYTES, int64_t(seqlen) * avgpayloadsz);
+    srt::trace::event(SRT_TRACE_PKT_RCVDROP, m_SocketID, lastack, seqlen);
 
     dropFromLossLists(lastack, CSeqNo::decseq(skiptoseqno)); //remove(from,to-inclusive)
 }
@@ -5659,9 +5738,21 @@ bool CUDT::prepareConnectionObjects(const CHandShake &hs, HandshakeSide hsd, CUD
     {
         m_pSndBuffer = new CSndBuffer(32, m_iMaxSRTPayloadSize);
         m_pRcvBuffer = new CRcvBuffer(&(m_pRcvQueue->m_UnitQueue), m_iRcvBufSize);
+        // A socket taken from the pool may already have the cleared loss
+        // lists of its previous connection; they are reused if they fit.
         // after introducing lite ACK, the sndlosslist may not be cleared in time, so it requires twice space.
-        m_pSndLossList = new CSndLossList(m_iFlowWindowSize * 2);
-        m_pRcvLossList = new CRcvLossList(m_iFlightFlagSize);
+        if (!m_pSndLossList || m_pSndLossList->capacity() != m_iFlowWindowSize * 2)
+        {
+            delete m_pSndLossList;
+            m_pSndLossList = NULL;
+            m_pSndLossList = new CSndLossList(m_iFlowWindowSize * 2);
+        }
+        if (!m_pRcvLossList || m_pRcvLossList->capacity() != m_iFlightFlagSize)
+        {
+            delete m_pRcvLossList;
+            m_pRcvLossList = NULL;
+            m_pRcvLossList = new CRcvLossList(m_iFlightFlagSize);
+        }
     }
     catch (...)
     {
@@ -5748,14 +5839,8 @@ void CUDT::acceptAndRespond(const sockaddr_any& peer, const CPacket& hspkt, CHan
     }
     // Since now you can use m_pCryptoControl
 
-    CInfoBlock ib;
-    ib.m_iIPversion = peer.family();
-    CInfoBlock::convert(peer, ib.m_piIP);
-    if (m_pCache->lookup(&ib) >= 0)
-    {
-        m_iRTT       = ib.m_iRTT;
-        m_iBandwidth = ib.m_iBandwidth;
-    }
+    // Needed by setupCC to find the host in the cache.
+    m_PeerAddr = peer;
 
     // This should extract the HSREQ and KMREQ portion in the handshake packet.
     // This could still be a HSv4 packet and contain no such parts, which will leave
@@ -5806,8 +5891,6 @@ void CUDT::acceptAndRespond(const sockaddr_any& peer, const CPacket& hspkt, CHan
         throw CUDTException(MJ_SETUP, MN_REJECTED, 0);
     }
 
-    m_PeerAddr = peer;
-
     // And of course, it is connected.
     m_bConnected = true;
 
@@ -5907,6 +5990,18 @@ SRT_REJECT_REASON CUDT::setupCC()
     // if (bidirectional || m_bDataSender || m_bTwoWayData)
     //    m_bPeerTsbPd = m_bOPT_TsbPd;
 
+    // Start with the RTT and bandwidth measured by the previous
+    // connection to the same host, if any.
+    CInfoBlock ib;
+    ib.m_iIPversion = m_PeerAddr.family();
+    CInfoBlock::convert(m_PeerAddr, ib.m_piIP);
+    const bool cached = m_pCache->lookup(&ib) >= 0;
+    if (cached)
+    {
+        m_iRTT       = ib.m_iRTT;
+        m_iBandwidth = ib.m_iBandwidth;
+    }
+
     // SrtCongestion will retrieve whatever parameters it needs
     // from *this.
     if (!m_CongCtl.configure(this))
@@ -5914,6 +6009,18 @@ SRT_REJECT_REASON CUDT::setupCC()
         return SRT_REJ_CONGESTION;
     }
 
+    // The congestion state is only cached by a connection that has
+    // been sending, and is given to the controller while recent, if
+    // requested by SRTO_CCSEED. It gets into m_dCongestionWindow and
+    // m_tdSendInterval with TEV_INIT.
+    if (m_bOPT_CCSeed && cached && ib.m_dInterval > 0
+            && count_microseconds(steady_clock::now()) - int64_t(ib.m_ullTimeStamp) < HOSTINFO_CC_MAXAGE_US)
+    {
+        HLOGC(mglog.Debug, log << "setupCC: seeding congctl from the host cache: sndperiod="
+                << ib.m_dInterval << "us cwnd=" << ib.m_dCWnd);
+        m_CongCtl->seedFromHost(ib.m_dInterval, ib.m_dCWnd);
+    }
+
     // Configure filter module
     if (m_OPT_PktFilterConfigString != "")
     {
@@ -6161,12 +6268,19 @@ bool CUDT::close()
             sendCtrl(UMSG_SHUTDOWN);
         }
 
-        // Store current connection information.
+        // Store current connection information. The congestion state
+        // is left zero, that is, unknown, if nothing was acknowledged,
+        // so that the one cached by a sending connection is kept.
         CInfoBlock ib;
         ib.m_iIPversion = m_PeerAddr.family();
         CInfoBlock::convert(m_PeerAddr, ib.m_piIP);
         ib.m_iRTT       = m_iRTT;
         ib.m_iBandwidth = m_iBandwidth;
+        if (m_CongCtl.ready() && m_stats.counters[STAT_RECV_ACK].load() > 0)
+        {
+            ib.m_dInterval = m_CongCtl->pktSndPeriod_us();
+            ib.m_dCWnd     = m_CongCtl->cgWindowSize();
+        }
         m_pCache->update(&ib);
 
         m_bConnected = false;
@@ -6360,12 +6474,9 @@ void CUDT::checkNeedDrop(bool& w_bCongestion)
         int dpkts = m_pSndBuffer->dropLateData((dbytes), (first_msgno), steady_clock::now() - milliseconds_from(threshold_ms));
         if (dpkts > 0)
         {
-            enterCS(m_StatsLock);
-            m_stats.traceSndDrop += dpkts;
-            m_stats.sndDropTotal += dpkts;
-            m_stats.traceSndBytesDrop += dbytes;
-            m_stats.sndBytesDropTotal += dbytes;
-            leaveCS(m_StatsLock);
+            countStat(STAT_SND_DROP, dpkts);
+            countStat(STAT_SND_DROP_BYTES, dbytes);
+            srt::trace::event(SRT_TRACE_PKT_SNDDROP, m_SocketID, m_iSndLastDataAck, dpkts);
 
 #if ENABLE_HEAVY_LOGGING
             int32_t realack = m_iSndLastDataAck;
@@ -6414,7 +6525,7 @@ int CUDT::sendmsg(const char *data, int len, int msttl, bool inorder, uint64_t s
     return this->sendmsg2(data, len, (mctrl));
 }
 
-int CUDT::sendmsg2(const char *data, int len, SRT_MSGCTRL& w_mctrl)
+int CUDT::sendmsg2(const char *data, int len, SRT_MSGCTRL& w_mctrl, CSharedPayload* shared)
 {
     bool         bCongestion = false;
 
@@ -6582,10 +6693,7 @@ int CUDT::sendmsg2(const char *data, int len, SRT_MSGCTRL& w_mctrl)
     // If the sender's buffer is empty,
     // record total time used for sending
     if (m_pSndBuffer->getCurrBufSize() == 0)
-    {
-        CGuard lock(m_StatsLock);
-        m_stats.sndDurationCounter = steady_clock::now();
-    }
+        m_stats.sndDurationCounter.store(count_microseconds(steady_clock::now()));
 
     int size = len;
     if (!m_bMessageAPI)
@@ -6635,7 +6743,12 @@ int CUDT::sendmsg2(const char *data, int len, SRT_MSGCTRL& w_mctrl)
         // - OUTPUT: value of the sequence number to be put on the first packet at the next sendmsg2 call.
         // We need to supply to the output the value that was STAMPED ON THE PACKET,
         // which is seqno. In the output we'll get the next sequence number.
-        m_pSndBuffer->addBuffer(data, size, (w_mctrl));
+        // The payload is encrypted in place, so the blocks can refer
+        // to the payload shared with other sockets only if it's clear.
+        if (shared && m_pCryptoControl && m_pCryptoControl->getSndCryptoFlags() == EK_NOENC)
+            m_pSndBuffer->addBuffer(data, size, (w_mctrl), shared);
+        else
+            m_pSndBuffer->addBuffer(data, size, (w_mctrl));
         m_iSndNextSeqNo = w_mctrl.pktseq;
         w_mctrl.pktseq = seqno;
 
@@ -6784,8 +6897,11 @@ int CUDT::receiveMessage(char* data, int len, SRT_MSGCTRL& w_mctrl, int by_excep
     {
         HLOGC(dlog.Debug, log << CONID() << "receiveMessage: BEGIN ASYNC MODE. Going to extract payload size=" << len);
 
-        int res = m_pRcvBuffer->readMsg(data, len, (w_mctrl), seqdistance);
+        steady_clock::time_point arrival_time;
+        int res = m_pRcvBuffer->readMsg(data, len, (w_mctrl), seqdistance, (arrival_time));
         HLOGC(dlog.Debug, log << CONID() << "AFTER readMsg: (NON-BLOCKING) result=" << res);
+        if (res > 0 && m_bTsbPd)
+            m_stats.histRcvBuffer.add(count_microseconds(steady_clock::now() - arrival_time));
 
         if (res == 0)
         {
@@ -6900,8 +7016,11 @@ int CUDT::receiveMessage(char* data, int len, SRT_MSGCTRL& w_mctrl, int by_excep
                 << " NMSG " << m_pRcvBuffer->getRcvMsgNum());
                 */
 
-        res = m_pRcvBuffer->readMsg((data), len, (w_mctrl), seqdistance);
+        steady_clock::time_point arrival_time;
+        res = m_pRcvBuffer->readMsg((data), len, (w_mctrl), seqdistance, (arrival_time));
         HLOGC(dlog.Debug, log << CONID() << "AFTER readMsg: (BLOCKING) result=" << res);
+        if (res > 0 && m_bTsbPd)
+            m_stats.histRcvBuffer.add(count_microseconds(steady_clock::now() - arrival_time));
 
         if (m_bBroken || m_bClosing)
         {
@@ -7046,10 +7165,7 @@ int64_t CUDT::sendfile(fstream &ifs, int64_t &offset, int64_t size, int block)
 
         // record total time used for sending
         if (m_pSndBuffer->getCurrBufSize() == 0)
-        {
-            CGuard lock(m_StatsLock);
-            m_stats.sndDurationCounter = steady_clock::now();
-        }
+            m_stats.sndDurationCounter.store(count_microseconds(steady_clock::now()));
 
         {
             CGuard        recvAckLock(m_RecvAckLock);
@@ -7194,217 +7310,524 @@ int64_t CUDT::recvfile(fstream &ofs, int64_t &offset, int64_t size, int block)
     return size - torecv;
 }
 
-void CUDT::bstats(CBytePerfMon *perf, bool clear, bool instantaneous)
+#ifdef SRT_ENABLE_FILEMAP
+int64_t CUDT::sendfile(int fd, int64_t &offset, int64_t size, int block)
 {
-    if (!m_bConnected)
-        throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
     if (m_bBroken || m_bClosing)
         throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
+    else if (!m_bConnected || !m_CongCtl.ready())
+        throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
 
-    CGuard statsguard(m_StatsLock);
-
-    const steady_clock::time_point currtime = steady_clock::now();
+    if (size <= 0 && size != -1)
+        return 0;
 
-    perf->msTimeStamp          = count_milliseconds(currtime - m_stats.tsStartTime);
-    perf->pktSent              = m_stats.traceSent;
-    perf->pktRecv              = m_stats.traceRecv;
-    perf->pktSndLoss           = m_stats.traceSndLoss;
-    perf->pktRcvLoss           = m_stats.traceRcvLoss;
-    perf->pktRetrans           = m_stats.traceRetrans;
-    perf->pktRcvRetrans        = m_stats.traceRcvRetrans;
-    perf->pktSentACK           = m_stats.sentACK;
-    perf->pktRecvACK           = m_stats.recvACK;
-    perf->pktSentNAK           = m_stats.sentNAK;
-    perf->pktRecvNAK           = m_stats.recvNAK;
-    perf->usSndDuration        = m_stats.sndDuration;
-    perf->pktReorderDistance   = m_stats.traceReorderDistance;
-    perf->pktReorderTolerance  = m_iReorderTolerance;
-    perf->pktRcvAvgBelatedTime = m_stats.traceBelatedTime;
-    perf->pktRcvBelated        = m_stats.traceRcvBelated;
+    if (!m_CongCtl->checkTransArgs(SrtCongestion::STA_FILE, SrtCongestion::STAD_SEND, 0, size, -1, false))
+        throw CUDTException(MJ_NOTSUP, MN_INVALBUFFERAPI, 0);
 
-    perf->pktSndFilterExtra  = m_stats.sndFilterExtra;
-    perf->pktRcvFilterExtra  = m_stats.rcvFilterExtra;
-    perf->pktRcvFilterSupply = m_stats.rcvFilterSupply;
-    perf->pktRcvFilterLoss   = m_stats.rcvFilterLoss;
+    if (!m_pCryptoControl || !m_pCryptoControl->isSndEncryptionOK())
+    {
+        LOGC(dlog.Error,
+             log << "Encryption is required, but the peer did not supply correct credentials. Sending rejected.");
+        throw CUDTException(MJ_SETUP, MN_SECURITY, 0);
+    }
 
-    /* perf byte counters include all headers (SRT+UDP+IP) */
-    const int pktHdrSize = CPacket::HDR_SIZE + CPacket::UDP_HDR_SIZE;
-    perf->byteSent       = m_stats.traceBytesSent + (m_stats.traceSent * pktHdrSize);
-    perf->byteRecv       = m_stats.traceBytesRecv + (m_stats.traceRecv * pktHdrSize);
-    perf->byteRetrans    = m_stats.traceBytesRetrans + (m_stats.traceRetrans * pktHdrSize);
-#ifdef SRT_ENABLE_LOSTBYTESCOUNT
-    perf->byteRcvLoss = m_stats.traceRcvBytesLoss + (m_stats.traceRcvLoss * pktHdrSize);
-#endif
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+        throw CUDTException(MJ_FILESYSTEM, MN_READFAIL, errno);
 
-    perf->pktSndDrop  = m_stats.traceSndDrop;
-    perf->pktRcvDrop  = m_stats.traceRcvDrop + m_stats.traceRcvUndecrypt;
-    perf->byteSndDrop = m_stats.traceSndBytesDrop + (m_stats.traceSndDrop * pktHdrSize);
-    perf->byteRcvDrop =
-        m_stats.traceRcvBytesDrop + (m_stats.traceRcvDrop * pktHdrSize) + m_stats.traceRcvBytesUndecrypt;
-    perf->pktRcvUndecrypt  = m_stats.traceRcvUndecrypt;
-    perf->byteRcvUndecrypt = m_stats.traceRcvBytesUndecrypt;
-
-    perf->pktSentTotal       = m_stats.sentTotal;
-    perf->pktRecvTotal       = m_stats.recvTotal;
-    perf->pktSndLossTotal    = m_stats.sndLossTotal;
-    perf->pktRcvLossTotal    = m_stats.rcvLossTotal;
-    perf->pktRetransTotal    = m_stats.retransTotal;
-    perf->pktSentACKTotal    = m_stats.sentACKTotal;
-    perf->pktRecvACKTotal    = m_stats.recvACKTotal;
-    perf->pktSentNAKTotal    = m_stats.sentNAKTotal;
-    perf->pktRecvNAKTotal    = m_stats.recvNAKTotal;
-    perf->usSndDurationTotal = m_stats.m_sndDurationTotal;
-
-    perf->byteSentTotal           = m_stats.bytesSentTotal + (m_stats.sentTotal * pktHdrSize);
-    perf->byteRecvTotal           = m_stats.bytesRecvTotal + (m_stats.recvTotal * pktHdrSize);
-    perf->byteRetransTotal        = m_stats.bytesRetransTotal + (m_stats.retransTotal * pktHdrSize);
-    perf->pktSndFilterExtraTotal  = m_stats.sndFilterExtraTotal;
-    perf->pktRcvFilterExtraTotal  = m_stats.rcvFilterExtraTotal;
-    perf->pktRcvFilterSupplyTotal = m_stats.rcvFilterSupplyTotal;
-    perf->pktRcvFilterLossTotal   = m_stats.rcvFilterLossTotal;
+    const int64_t filesize = st.st_size;
+    if (offset < 0 || offset > filesize)
+        throw CUDTException(MJ_FILESYSTEM, MN_SEEKGFAIL);
 
-#ifdef SRT_ENABLE_LOSTBYTESCOUNT
-    perf->byteRcvLossTotal = m_stats.rcvBytesLossTotal + (m_stats.rcvLossTotal * pktHdrSize);
-#endif
-    perf->pktSndDropTotal  = m_stats.sndDropTotal;
-    perf->pktRcvDropTotal  = m_stats.rcvDropTotal + m_stats.m_rcvUndecryptTotal;
-    perf->byteSndDropTotal = m_stats.sndBytesDropTotal + (m_stats.sndDropTotal * pktHdrSize);
-    perf->byteRcvDropTotal =
-        m_stats.rcvBytesDropTotal + (m_stats.rcvDropTotal * pktHdrSize) + m_stats.m_rcvBytesUndecryptTotal;
-    perf->pktRcvUndecryptTotal  = m_stats.m_rcvUndecryptTotal;
-    perf->byteRcvUndecryptTotal = m_stats.m_rcvBytesUndecryptTotal;
-    //<
+    // Like with the stream version, sending ends at the end of file.
+    if (size == -1 || offset + size > filesize)
+        size = filesize - offset;
 
-    double interval = count_microseconds(currtime - m_stats.tsLastSampleTime);
+    CGuard sendguard (m_SendLock);
 
-    //>mod
-    perf->mbpsSendRate = double(perf->byteSent) * 8.0 / interval;
-    perf->mbpsRecvRate = double(perf->byteRecv) * 8.0 / interval;
-    //<
+    if (m_pSndBuffer->getCurrBufSize() == 0)
+    {
+        // delay the EXP timer to avoid mis-fired timeout
+        m_tsLastRspAckTime = steady_clock::now();
+        m_iReXmitCount   = 1;
+    }
 
-    perf->usPktSndPeriod      = count_microseconds(m_tdSendInterval);
-    perf->pktFlowWindow       = m_iFlowWindowSize;
-    perf->pktCongestionWindow = (int)m_dCongestionWindow;
-    perf->pktFlightSize       = getFlightSpan();
-    perf->msRTT               = (double)m_iRTT / 1000.0;
-    //>new
-    perf->msSndTsbPdDelay = m_bPeerTsbPd ? m_iPeerTsbPdDelay_ms : 0;
-    perf->msRcvTsbPdDelay = isOPT_TsbPd() ? m_iTsbPdDelay_ms : 0;
-    perf->byteMSS         = m_iMSS;
+    int64_t tosend = size;
+    int     unitsize;
 
-    perf->mbpsMaxBW = m_llMaxBW > 0 ? Bps2Mbps(m_llMaxBW) : m_CongCtl.ready() ? Bps2Mbps(m_CongCtl->sndBandwidth()) : 0;
+    // sending block by block
+    while (tosend > 0)
+    {
+        unitsize = int((tosend >= block) ? block : tosend);
 
-    //<
-    uint32_t availbw = (uint64_t)(m_iBandwidth == 1 ? m_RcvTimeWindow.getBandwidth() : m_iBandwidth);
+        {
+            CGuard lock(m_SendBlockLock);
 
-    perf->mbpsBandwidth = Bps2Mbps(availbw * (m_iMaxSRTPayloadSize + pktHdrSize));
+            while (stillConnected() && (sndBuffersLeft() <= 0) && m_bPeerHealth)
+                m_SendBlockCond.wait(lock);
+        }
 
-    if (tryEnterCS(m_ConnectionLock))
-    {
-        if (m_pSndBuffer)
+        if (m_bBroken || m_bClosing)
         {
-#ifdef SRT_ENABLE_SNDBUFSZ_MAVG
-            if (instantaneous)
-            {
-                /* Get instant SndBuf instead of moving average for application-based Algorithm
-                   (such as NAE) in need of fast reaction to network condition changes. */
-                perf->pktSndBuf = m_pSndBuffer->getCurrBufSize((perf->byteSndBuf), (perf->msSndBuf));
-            }
-            else
-            {
-                perf->pktSndBuf = m_pSndBuffer->getAvgBufSize((perf->byteSndBuf), (perf->msSndBuf));
-            }
-#else
-            perf->pktSndBuf = m_pSndBuffer->getCurrBufSize((perf->byteSndBuf), (perf->msSndBuf));
-#endif
-            perf->byteSndBuf += (perf->pktSndBuf * pktHdrSize);
-            //<
-            perf->byteAvailSndBuf = (m_iSndBufSize - perf->pktSndBuf) * m_iMSS;
+            m_pSndBuffer->releaseFileMap();
+            throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
         }
-        else
+        else if (!m_bConnected)
         {
-            perf->byteAvailSndBuf = 0;
-            // new>
-            perf->pktSndBuf  = 0;
-            perf->byteSndBuf = 0;
-            perf->msSndBuf   = 0;
-            //<
+            m_pSndBuffer->releaseFileMap();
+            throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
+        }
+        else if (!m_bPeerHealth)
+        {
+            m_pSndBuffer->releaseFileMap();
+            // reset peer health status, once this error returns, the app should handle the situation at the peer side
+            m_bPeerHealth = true;
+            throw CUDTException(MJ_PEERERROR);
         }
 
-        if (m_pRcvBuffer)
+        // record total time used for sending
+        if (m_pSndBuffer->getCurrBufSize() == 0)
+            m_stats.sndDurationCounter.store(count_microseconds(steady_clock::now()));
+
         {
-            perf->byteAvailRcvBuf = m_pRcvBuffer->getAvailBufSize() * m_iMSS;
-            // new>
-#ifdef SRT_ENABLE_RCVBUFSZ_MAVG
-            if (instantaneous) // no need for historical API for Rcv side
+            CGuard        recvAckLock(m_RecvAckLock);
+            const int64_t sentsize = m_pSndBuffer->addBufferFromFileMap(fd, offset, unitsize, filesize);
+
+            if (sentsize < 0)
             {
-                perf->pktRcvBuf = m_pRcvBuffer->getRcvDataSize(perf->byteRcvBuf, perf->msRcvBuf);
+                m_pSndBuffer->releaseFileMap();
+                throw CUDTException(MJ_FILESYSTEM, MN_READFAIL, errno);
             }
-            else
+
+            // The file got shorter meanwhile; end at its new end.
+            if (sentsize == 0)
+                break;
+
+            tosend -= sentsize;
+            offset += sentsize;
+
+            if (sndBuffersLeft() <= 0)
             {
-                perf->pktRcvBuf = m_pRcvBuffer->getRcvAvgDataSize(perf->byteRcvBuf, perf->msRcvBuf);
+                // write is not available any more
+                s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, SRT_EPOLL_OUT, false);
             }
-#else
-            perf->pktRcvBuf = m_pRcvBuffer->getRcvDataSize(perf->byteRcvBuf, perf->msRcvBuf);
-#endif
-            //<
-        }
-        else
-        {
-            perf->byteAvailRcvBuf = 0;
-            // new>
-            perf->pktRcvBuf  = 0;
-            perf->byteRcvBuf = 0;
-            perf->msRcvBuf   = 0;
-            //<
         }
 
-        leaveCS(m_ConnectionLock);
+        // insert this socket to snd list if it is not on the list yet
+        m_pSndQueue->m_pSndUList->update(this, CSndUList::DONT_RESCHEDULE);
     }
-    else
-    {
-        perf->byteAvailSndBuf = 0;
-        perf->byteAvailRcvBuf = 0;
-        // new>
-        perf->pktSndBuf  = 0;
-        perf->byteSndBuf = 0;
-        perf->msSndBuf   = 0;
 
-        perf->byteRcvBuf = 0;
-        perf->msRcvBuf   = 0;
-        //<
-    }
+    // The blocks still in the buffer keep the mapping alive until they are ACKed.
+    m_pSndBuffer->releaseFileMap();
 
-    if (clear)
-    {
-        m_stats.traceSndDrop           = 0;
-        m_stats.traceRcvDrop           = 0;
-        m_stats.traceSndBytesDrop      = 0;
-        m_stats.traceRcvBytesDrop      = 0;
-        m_stats.traceRcvUndecrypt      = 0;
-        m_stats.traceRcvBytesUndecrypt = 0;
-        // new>
-        m_stats.traceBytesSent = m_stats.traceBytesRecv = m_stats.traceBytesRetrans = 0;
-        //<
-        m_stats.traceSent = m_stats.traceRecv = m_stats.traceSndLoss = m_stats.traceRcvLoss = m_stats.traceRetrans =
-            m_stats.sentACK = m_stats.recvACK = m_stats.sentNAK = m_stats.recvNAK = 0;
-        m_stats.sndDuration                                                       = 0;
-        m_stats.traceRcvRetrans                                                   = 0;
-        m_stats.traceRcvBelated                                                   = 0;
+    return size - tosend;
+}
+
+int64_t CUDT::recvfile(int fd, int64_t &offset, int64_t size, int block)
+{
+    if (!m_bConnected || !m_CongCtl.ready())
+        throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
+    else if ((m_bBroken || m_bClosing) && !m_pRcvBuffer->isRcvDataReady())
+    {
+        if (!m_bMessageAPI && m_bShutdown)
+            return 0;
+        throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
+    }
+
+    if (size <= 0)
+        return 0;
+
+    if (!m_CongCtl->checkTransArgs(SrtCongestion::STA_FILE, SrtCongestion::STAD_RECV, 0, size, -1, false))
+        throw CUDTException(MJ_NOTSUP, MN_INVALBUFFERAPI, 0);
+
+    if (isOPT_TsbPd())
+    {
+        LOGC(dlog.Error, log << "Reading from file is incompatible with TSBPD mode and would cause a deadlock\n");
+        throw CUDTException(MJ_NOTSUP, MN_INVALBUFFERAPI, 0);
+    }
+
+    if (offset < 0)
+        throw CUDTException(MJ_FILESYSTEM, MN_SEEKPFAIL);
+
+    CGuard recvguard(m_RecvLock);
+
+    int64_t torecv   = size;
+    int     unitsize = block;
+    int     recvsize;
+
+    // receiving... "recvfile" is always blocking
+    while (torecv > 0)
+    {
+        {
+            CGuard gl   (m_RecvDataLock);
+            CSync rcond (m_RecvDataCond,  gl);
+
+            while (stillConnected() && !m_pRcvBuffer->isRcvDataReady())
+                rcond.wait();
+        }
+
+        if (!m_bConnected)
+            throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
+        else if ((m_bBroken || m_bClosing) && !m_pRcvBuffer->isRcvDataReady())
+        {
+
+            if (!m_bMessageAPI && m_bShutdown)
+                return 0;
+            throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
+        }
+
+        unitsize = int((torecv == -1 || torecv >= block) ? block : torecv);
+        recvsize = m_pRcvBuffer->readBufferToFd(fd, offset, unitsize);
+
+        if (recvsize < 0)
+        {
+            // send the sender a signal so it will not be blocked forever
+            int32_t err_code = CUDTException::EFILE;
+            sendCtrl(UMSG_PEERERROR, &err_code);
+
+            throw CUDTException(MJ_FILESYSTEM, MN_WRITEFAIL, errno);
+        }
+
+        torecv -= recvsize;
+        offset += recvsize;
+    }
+
+    if (!m_pRcvBuffer->isRcvDataReady())
+    {
+        // read is not available any more
+        s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, SRT_EPOLL_IN, false);
+    }
+
+    return size - torecv;
+}
+#endif
+
+void CUDT::snapshotStats(StatsSnapshot& w_snap, bool clear)
+{
+    // The writers never take m_StatsLock; it only serializes the readers,
+    // which share the baseline and the last sample time.
+    CGuard statsguard(m_StatsLock);
+
+    w_snap.currtime   = steady_clock::now();
+    w_snap.lastsample = m_stats.tsLastSampleTime;
+    for (int i = 0; i < STAT__SIZE; ++i)
+    {
+        w_snap.total[i] = m_stats.counters[i].load();
+        w_snap.trace[i] = w_snap.total[i] - m_stats.base[i];
+    }
+
+    if (clear)
+    {
+        std::copy(w_snap.total, w_snap.total + STAT__SIZE, m_stats.base);
+        w_snap.pacingDelayMax    = m_stats.sndPacingDelayMax.exchange(0);
+        m_stats.tsLastSampleTime = w_snap.currtime;
+    }
+    else
+    {
+        w_snap.pacingDelayMax = m_stats.sndPacingDelayMax.load();
+    }
+}
+
+void CUDT::bstats(CBytePerfMon *perf, bool clear, bool instantaneous)
+{
+    if (!m_bConnected)
+        throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
+    if (m_bBroken || m_bClosing)
+        throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
+
+    StatsSnapshot snap;
+    snapshotStats((snap), clear);
+    const int64_t* total = snap.total;
+    const int64_t* trace = snap.trace;
+    const int64_t pacing_delay_max = snap.pacingDelayMax;
+    const steady_clock::time_point currtime = snap.currtime, lastsample = snap.lastsample;
+
+    perf->msTimeStamp          = count_milliseconds(currtime - m_stats.tsStartTime);
+    perf->pktSent              = trace[STAT_SENT];
+    perf->pktRecv              = trace[STAT_RECV];
+    perf->pktSndLoss           = int(trace[STAT_SND_LOSS]);
+    perf->pktRcvLoss           = int(trace[STAT_RCV_LOSS]);
+    perf->pktRetrans           = int(trace[STAT_RETRANS]);
+    perf->pktRcvRetrans        = int(trace[STAT_RCV_RETRANS]);
+    perf->pktSentACK           = int(trace[STAT_SENT_ACK]);
+    perf->pktRecvACK           = int(trace[STAT_RECV_ACK]);
+    perf->pktSentNAK           = int(trace[STAT_SENT_NAK]);
+    perf->pktRecvNAK           = int(trace[STAT_RECV_NAK]);
+    perf->usSndDuration        = trace[STAT_SND_DURATION];
+    perf->pktReorderDistance   = m_stats.traceReorderDistance.load();
+    perf->pktReorderTolerance  = m_iReorderTolerance;
+    perf->pktRcvAvgBelatedTime = m_stats.traceBelatedTime.load() / 1000.0;
+    perf->pktRcvBelated        = trace[STAT_RCV_BELATED];
+
+    perf->pktSndFilterExtra  = int(trace[STAT_SND_FILTER_EXTRA]);
+    perf->pktRcvFilterExtra  = int(trace[STAT_RCV_FILTER_EXTRA]);
+    perf->pktRcvFilterSupply = int(trace[STAT_RCV_FILTER_SUPPLY]);
+    perf->pktRcvFilterLoss   = int(trace[STAT_RCV_FILTER_LOSS]);
+
+    perf->msSndPacingDelay    = trace[STAT_SND_PACED]
+                              ? trace[STAT_SND_PACING_DELAY] / 1000.0 / trace[STAT_SND_PACED] : 0.0;
+    perf->msSndPacingDelayMax = pacing_delay_max / 1000.0;
+
+    perf->backupSwitchTotal = int(total[STAT_SND_BACKUP_SWITCH]);
+    perf->msBackupSwitch    = m_stats.sndBackupSwitchTime.load() / 1000.0;
+
+    /* perf byte counters include all headers (SRT+UDP+IP) */
+    const int pktHdrSize = CPacket::HDR_SIZE + CPacket::UDP_HDR_SIZE;
+    perf->byteSent       = trace[STAT_SENT_BYTES] + (trace[STAT_SENT] * pktHdrSize);
+    perf->byteRecv       = trace[STAT_RECV_BYTES] + (trace[STAT_RECV] * pktHdrSize);
+    perf->byteRetrans    = trace[STAT_RETRANS_BYTES] + (trace[STAT_RETRANS] * pktHdrSize);
 #ifdef SRT_ENABLE_LOSTBYTESCOUNT
-        m_stats.traceRcvBytesLoss = 0;
+    perf->byteRcvLoss = trace[STAT_RCV_LOSS_BYTES] + (trace[STAT_RCV_LOSS] * pktHdrSize);
 #endif
 
-        m_stats.sndFilterExtra = 0;
-        m_stats.rcvFilterExtra = 0;
+    perf->pktSndDrop  = int(trace[STAT_SND_DROP]);
+    perf->pktRcvDrop  = int(trace[STAT_RCV_DROP] + trace[STAT_RCV_UNDECRYPT]);
+    perf->byteSndDrop = trace[STAT_SND_DROP_BYTES] + (trace[STAT_SND_DROP] * pktHdrSize);
+    perf->byteRcvDrop =
+        trace[STAT_RCV_DROP_BYTES] + (trace[STAT_RCV_DROP] * pktHdrSize) + trace[STAT_RCV_UNDECRYPT_BYTES];
+    perf->pktRcvUndecrypt  = int(trace[STAT_RCV_UNDECRYPT]);
+    perf->byteRcvUndecrypt = trace[STAT_RCV_UNDECRYPT_BYTES];
+
+    perf->pktSentTotal       = total[STAT_SENT];
+    perf->pktRecvTotal       = total[STAT_RECV];
+    perf->pktSndLossTotal    = int(total[STAT_SND_LOSS]);
+    perf->pktRcvLossTotal    = int(total[STAT_RCV_LOSS]);
+    perf->pktRetransTotal    = int(total[STAT_RETRANS]);
+    perf->pktSentACKTotal    = int(total[STAT_SENT_ACK]);
+    perf->pktRecvACKTotal    = int(total[STAT_RECV_ACK]);
+    perf->pktSentNAKTotal    = int(total[STAT_SENT_NAK]);
+    perf->pktRecvNAKTotal    = int(total[STAT_RECV_NAK]);
+    perf->usSndDurationTotal = total[STAT_SND_DURATION];
+
+    perf->byteSentTotal           = total[STAT_SENT_BYTES] + (total[STAT_SENT] * pktHdrSize);
+    perf->byteRecvTotal           = total[STAT_RECV_BYTES] + (total[STAT_RECV] * pktHdrSize);
+    perf->byteRetransTotal        = total[STAT_RETRANS_BYTES] + (total[STAT_RETRANS] * pktHdrSize);
+    perf->pktSndFilterExtraTotal  = int(total[STAT_SND_FILTER_EXTRA]);
+    perf->pktRcvFilterExtraTotal  = int(total[STAT_RCV_FILTER_EXTRA]);
+    perf->pktRcvFilterSupplyTotal = int(total[STAT_RCV_FILTER_SUPPLY]);
+    perf->pktRcvFilterLossTotal   = int(total[STAT_RCV_FILTER_LOSS]);
+
+#ifdef SRT_ENABLE_LOSTBYTESCOUNT
+    perf->byteRcvLossTotal = total[STAT_RCV_LOSS_BYTES] + (total[STAT_RCV_LOSS] * pktHdrSize);
+#endif
+    perf->pktSndDropTotal  = int(total[STAT_SND_DROP]);
+    perf->pktRcvDropTotal  = int(total[STAT_RCV_DROP] + total[STAT_RCV_UNDECRYPT]);
+    perf->byteSndDropTotal = total[STAT_SND_DROP_BYTES] + (total[STAT_SND_DROP] * pktHdrSize);
+    perf->byteRcvDropTotal =
+        total[STAT_RCV_DROP_BYTES] + (total[STAT_RCV_DROP] * pktHdrSize) + total[STAT_RCV_UNDECRYPT_BYTES];
+    perf->pktRcvUndecryptTotal  = int(total[STAT_RCV_UNDECRYPT]);
+    perf->byteRcvUndecryptTotal = total[STAT_RCV_UNDECRYPT_BYTES];
+    //<
 
-        m_stats.rcvFilterSupply = 0;
-        m_stats.rcvFilterLoss   = 0;
+    double interval = count_microseconds(currtime - lastsample);
+
+    //>mod
+    perf->mbpsSendRate = double(perf->byteSent) * 8.0 / interval;
+    perf->mbpsRecvRate = double(perf->byteRecv) * 8.0 / interval;
+    //<
+
+    perf->usPktSndPeriod      = count_microseconds(m_tdSendInterval);
+    perf->pktFlowWindow       = m_iFlowWindowSize;
+    perf->pktCongestionWindow = (int)m_dCongestionWindow;
+    perf->pktFlightSize       = getFlightSpan();
+    perf->msRTT               = (double)m_iRTT / 1000.0;
+    //>new
+    perf->msSndTsbPdDelay = m_bPeerTsbPd ? m_iPeerTsbPdDelay_ms : 0;
+    perf->msRcvTsbPdDelay = isOPT_TsbPd() ? m_iTsbPdDelay_ms : 0;
+    perf->byteMSS         = m_iMSS;
+
+    perf->mbpsMaxBW = m_llMaxBW > 0 ? Bps2Mbps(m_llMaxBW) : m_CongCtl.ready() ? Bps2Mbps(m_CongCtl->sndBandwidth()) : 0;
+
+    //<
+    uint32_t availbw = (uint64_t)(m_iBandwidth == 1 ? m_RcvTimeWindow.getBandwidth() : m_iBandwidth);
+
+    perf->mbpsBandwidth = Bps2Mbps(availbw * (m_iMaxSRTPayloadSize + pktHdrSize));
 
-        m_stats.tsLastSampleTime = currtime;
+    if (tryEnterCS(m_ConnectionLock))
+    {
+        if (m_pSndBuffer)
+        {
+#ifdef SRT_ENABLE_SNDBUFSZ_MAVG
+            if (instantaneous)
+            {
+                /* Get instant SndBuf instead of moving average for application-based Algorithm
+                   (such as NAE) in need of fast reaction to network condition changes. */
+                perf->pktSndBuf = m_pSndBuffer->getCurrBufSize((perf->byteSndBuf), (perf->msSndBuf));
+            }
+            else
+            {
+                perf->pktSndBuf = m_pSndBuffer->getAvgBufSize((perf->byteSndBuf), (perf->msSndBuf));
+            }
+#else
+            perf->pktSndBuf = m_pSndBuffer->getCurrBufSize((perf->byteSndBuf), (perf->msSndBuf));
+#endif
+            perf->byteSndBuf += (perf->pktSndBuf * pktHdrSize);
+            //<
+            perf->byteAvailSndBuf = (m_iSndBufSize - perf->pktSndBuf) * m_iMSS;
+        }
+        else
+        {
+            perf->byteAvailSndBuf = 0;
+            // new>
+            perf->pktSndBuf  = 0;
+            perf->byteSndBuf = 0;
+            perf->msSndBuf   = 0;
+            //<
+        }
+
+        if (m_pRcvBuffer)
+        {
+            perf->byteAvailRcvBuf = m_pRcvBuffer->getAvailBufSize() * m_iMSS;
+            // new>
+#ifdef SRT_ENABLE_RCVBUFSZ_MAVG
+            if (instantaneous) // no need for historical API for Rcv side
+            {
+                perf->pktRcvBuf = m_pRcvBuffer->getRcvDataSize(perf->byteRcvBuf, perf->msRcvBuf);
+            }
+            else
+            {
+                perf->pktRcvBuf = m_pRcvBuffer->getRcvAvgDataSize(perf->byteRcvBuf, perf->msRcvBuf);
+            }
+#else
+            perf->pktRcvBuf = m_pRcvBuffer->getRcvDataSize(perf->byteRcvBuf, perf->msRcvBuf);
+#endif
+            //<
+        }
+        else
+        {
+            perf->byteAvailRcvBuf = 0;
+            // new>
+            perf->pktRcvBuf  = 0;
+            perf->byteRcvBuf = 0;
+            perf->msRcvBuf   = 0;
+            //<
+        }
+
+        leaveCS(m_ConnectionLock);
+    }
+    else
+    {
+        perf->byteAvailSndBuf = 0;
+        perf->byteAvailRcvBuf = 0;
+        // new>
+        perf->pktSndBuf  = 0;
+        perf->byteSndBuf = 0;
+        perf->msSndBuf   = 0;
+
+        perf->byteRcvBuf = 0;
+        perf->msRcvBuf   = 0;
+        //<
     }
 }
 
+void CUDT::compactStats(SRT_SOCKSTATS& w_st, int fields, bool clear)
+{
+    memset(&w_st, 0, sizeof w_st);
+    w_st.id = m_SocketID;
+    if (!m_bConnected || m_bBroken || m_bClosing)
+        return;
+
+    StatsSnapshot snap;
+    snapshotStats((snap), clear);
+
+    const int pktHdrSize = CPacket::HDR_SIZE + CPacket::UDP_HDR_SIZE;
+    w_st.msTimeStamp = count_milliseconds(snap.currtime - m_stats.tsStartTime);
+
+    if (fields & (SRT_STATSF_INTERVAL | SRT_STATSF_RATE))
+    {
+        w_st.byteSent = snap.trace[STAT_SENT_BYTES] + (snap.trace[STAT_SENT] * pktHdrSize);
+        w_st.byteRecv = snap.trace[STAT_RECV_BYTES] + (snap.trace[STAT_RECV] * pktHdrSize);
+    }
+
+    if (fields & SRT_STATSF_INTERVAL)
+    {
+        w_st.pktSent    = snap.trace[STAT_SENT];
+        w_st.pktRecv    = snap.trace[STAT_RECV];
+        w_st.pktSndLoss = int(snap.trace[STAT_SND_LOSS]);
+        w_st.pktRcvLoss = int(snap.trace[STAT_RCV_LOSS]);
+        w_st.pktRetrans = int(snap.trace[STAT_RETRANS]);
+        w_st.pktSndDrop = int(snap.trace[STAT_SND_DROP]);
+        w_st.pktRcvDrop = int(snap.trace[STAT_RCV_DROP] + snap.trace[STAT_RCV_UNDECRYPT]);
+    }
+
+    if (fields & SRT_STATSF_TOTAL)
+    {
+        w_st.pktSentTotal    = snap.total[STAT_SENT];
+        w_st.pktRecvTotal    = snap.total[STAT_RECV];
+        w_st.pktSndLossTotal = int(snap.total[STAT_SND_LOSS]);
+        w_st.pktRcvLossTotal = int(snap.total[STAT_RCV_LOSS]);
+        w_st.pktRetransTotal = int(snap.total[STAT_RETRANS]);
+        w_st.pktSndDropTotal = int(snap.total[STAT_SND_DROP]);
+        w_st.pktRcvDropTotal = int(snap.total[STAT_RCV_DROP] + snap.total[STAT_RCV_UNDECRYPT]);
+        w_st.byteSentTotal   = snap.total[STAT_SENT_BYTES] + (snap.total[STAT_SENT] * pktHdrSize);
+        w_st.byteRecvTotal   = snap.total[STAT_RECV_BYTES] + (snap.total[STAT_RECV] * pktHdrSize);
+    }
+
+    if (fields & SRT_STATSF_RATE)
+    {
+        const double interval = count_microseconds(snap.currtime - snap.lastsample);
+        if (interval > 0)
+        {
+            w_st.mbpsSendRate = double(w_st.byteSent) * 8.0 / interval;
+            w_st.mbpsRecvRate = double(w_st.byteRecv) * 8.0 / interval;
+        }
+        // The byte counters were only needed for the rate
+        if (!(fields & SRT_STATSF_INTERVAL))
+        {
+            w_st.byteSent = 0;
+            w_st.byteRecv = 0;
+        }
+    }
+
+    if (fields & SRT_STATSF_LINK)
+    {
+        const uint32_t availbw = (uint64_t)(m_iBandwidth == 1 ? m_RcvTimeWindow.getBandwidth() : m_iBandwidth);
+
+        w_st.msRTT               = (double)m_iRTT / 1000.0;
+        w_st.mbpsBandwidth       = Bps2Mbps(availbw * (m_iMaxSRTPayloadSize + pktHdrSize));
+        w_st.mbpsMaxBW           = m_llMaxBW > 0 ? Bps2Mbps(m_llMaxBW)
+                                 : m_CongCtl.ready() ? Bps2Mbps(m_CongCtl->sndBandwidth()) : 0;
+        w_st.usPktSndPeriod      = count_microseconds(m_tdSendInterval);
+        w_st.pktFlowWindow       = m_iFlowWindowSize;
+        w_st.pktCongestionWindow = (int)m_dCongestionWindow;
+        w_st.pktFlightSize       = getFlightSpan();
+    }
+
+    // Buffer values are always instantaneous here. When the buffers are
+    // being replaced at the moment, they're reported as empty (like bstats).
+    if ((fields & SRT_STATSF_BUFFER) && tryEnterCS(m_ConnectionLock))
+    {
+        if (m_pSndBuffer)
+        {
+            w_st.pktSndBuf       = m_pSndBuffer->getCurrBufSize((w_st.byteSndBuf), (w_st.msSndBuf));
+            w_st.byteSndBuf     += w_st.pktSndBuf * pktHdrSize;
+            w_st.byteAvailSndBuf = (m_iSndBufSize - w_st.pktSndBuf) * m_iMSS;
+        }
+
+        if (m_pRcvBuffer)
+        {
+            w_st.pktRcvBuf       = m_pRcvBuffer->getRcvDataSize(w_st.byteRcvBuf, w_st.msRcvBuf);
+            w_st.byteAvailRcvBuf = m_pRcvBuffer->getAvailBufSize() * m_iMSS;
+        }
+
+        leaveCS(m_ConnectionLock);
+    }
+
+    w_st.fields = fields & SRT_STATSF_ALL;
+}
+
+void CUDT::histstats(SRT_HISTSTATS& w_hist, bool clear)
+{
+    if (!m_bConnected)
+        throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
+    if (m_bBroken || m_bClosing)
+        throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
+
+    m_stats.histRcvTransit.get((w_hist.rcvTransit), clear);
+    m_stats.histRcvBuffer.get((w_hist.rcvBuffer), clear);
+    m_stats.histSndLag.get((w_hist.sndLag), clear);
+}
+
 bool CUDT::updateCC(ETransmissionEvent evt, const EventVariant arg)
 {
     // Special things that must be done HERE, not in SrtCongestion,
@@ -7459,8 +7882,9 @@ bool CUDT::updateCC(ETransmissionEvent evt, const EventVariant arg)
             }
             else
             {
-                // No need to calculate input reate if the bandwidth is set
-                const bool disable_in_rate_calc = (bw != 0);
+                // No need to calculate input reate if the bandwidth is set,
+                // unless the adaptive pacing needs it.
+                const bool disable_in_rate_calc = (bw != 0) && (m_iOPT_SndPacingDelay == 0 || m_llInputBW != 0);
                 m_pSndBuffer->resetInputRateSmpPeriod(disable_in_rate_calc);
             }
 
@@ -7508,8 +7932,11 @@ bool CUDT::updateCC(ETransmissionEvent evt, const EventVariant arg)
         // NOTE: THESE things come from CCC class:
         // - m_dPktSndPeriod
         // - m_dCWndSize
+        const steady_clock::duration prev_interval = m_tdSendInterval;
         m_tdSendInterval    = microseconds_from((int64_t)m_CongCtl->pktSndPeriod_us());
         m_dCongestionWindow = m_CongCtl->cgWindowSize();
+        if (m_tdSendInterval != prev_interval)
+            srt::trace::event(SRT_TRACE_CC_RATE, m_SocketID, m_iSndCurrSeqNo, count_microseconds(m_tdSendInterval));
 #if ENABLE_HEAVY_LOGGING
         HLOGC(mglog.Debug,
               log << CONID() << "updateCC: updated values from congctl: interval=" << count_microseconds(m_tdSendInterval) << " us ("
@@ -7578,6 +8005,9 @@ void CUDT::releaseSynch()
 
     enterCS(m_RecvLock);
     leaveCS(m_RecvLock);
+
+    if (m_parent->m_IncludedGroup)
+        m_parent->m_IncludedGroup->wakeupReader();
 }
 
 int32_t CUDT::ackDataUpTo(int32_t ack)
@@ -7657,6 +8087,27 @@ static void DebugAck(string hdr, int prev, int ack)
 static inline void DebugAck(string, int, int) {}
 #endif
 
+void CUDT::traceLossReport(SRT_TRACE_EVENT type, const int32_t* losslist, size_t size)
+{
+    if (!srt::trace::g_iEnabled.load() || size == 0)
+        return;
+
+    uint32_t num = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (IsSet(losslist[i], LOSSDATA_SEQNO_RANGE_FIRST) && i + 1 < size)
+        {
+            num += CSeqNo::seqlen(SEQNO_VALUE::unwrap(losslist[i]), losslist[i + 1]);
+            ++i;
+        }
+        else
+        {
+            ++num;
+        }
+    }
+    srt::trace::record(type, m_SocketID, SEQNO_VALUE::unwrap(losslist[0]), num);
+}
+
 void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam, int size)
 {
     CPacket ctrlpkt;
@@ -7727,7 +8178,7 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
         // IF ack %> m_iRcvLastAck
         if (CSeqNo::seqcmp(ack, m_iRcvLastAck) > 0)
         {
-            const int32_t first_seq = ackDataUpTo(ack);
+            ackDataUpTo(ack);
             leaveCS(m_RcvBufferLock);
             IF_HEAVY_LOGGING(int32_t oldack = m_iRcvLastSkipAck);
 
@@ -7748,19 +8199,22 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
             }
             else
             {
-                if (m_bSynRecving)
+                if (m_parent->m_IncludedGroup)
                 {
-                    // signal a waiting "recv" call if there is any data available
-                    CSync::lock_signal(m_RecvDataCond, m_RecvDataLock);
+                    // The application reads from the group, so move the
+                    // acknowledged packets to the group receiver buffer.
+                    CGuard rcvlock (m_RecvLock);
+                    m_parent->m_IncludedGroup->readyPackets(this);
                 }
-                // acknowledge any waiting epolls to read
-                s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, SRT_EPOLL_IN, true);
-                if (m_parent->m_IncludedGroup)
+                else
                 {
-                    // The current "APP reader" needs to simply decide as to whether
-                    // the next CUDTGroup::recv() call should return with no blocking or not.
-                    // When the group is read-ready, it should update its pollers as it sees fit.
-                    m_parent->m_IncludedGroup->updateReadState(m_SocketID, first_seq);
+                    if (m_bSynRecving)
+                    {
+                        // signal a waiting "recv" call if there is any data available
+                        CSync::lock_signal(m_RecvDataCond, m_RecvDataLock);
+                    }
+                    // acknowledge any waiting epolls to read
+                    s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, SRT_EPOLL_IN, true);
                 }
                 CGlobEvent::triggerEvent();
             }
@@ -7847,10 +8301,8 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
 
             m_ACKWindow.store(m_iAckSeqNo, m_iRcvLastAck);
 
-            enterCS(m_StatsLock);
-            ++m_stats.sentACK;
-            ++m_stats.sentACKTotal;
-            leaveCS(m_StatsLock);
+            countStat(STAT_SENT_ACK);
+            srt::trace::event(SRT_TRACE_ACK_SENT, m_SocketID, ack, m_iAckSeqNo);
         }
         else
         {
@@ -7865,6 +8317,7 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
         ctrlpkt.pack(pkttype, lparam);
         ctrlpkt.m_iID = m_PeerID;
         nbsent        = m_pSndQueue->sendto(m_PeerAddr, ctrlpkt);
+        srt::trace::event(SRT_TRACE_ACKACK_SENT, m_SocketID, *lparam);
 
         break;
 
@@ -7881,10 +8334,8 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
             ctrlpkt.m_iID = m_PeerID;
             nbsent        = m_pSndQueue->sendto(m_PeerAddr, ctrlpkt);
 
-            enterCS(m_StatsLock);
-            ++m_stats.sentNAK;
-            ++m_stats.sentNAKTotal;
-            leaveCS(m_StatsLock);
+            countStat(STAT_SENT_NAK);
+            traceLossReport(SRT_TRACE_NAK_SENT, lossdata, size);
         }
         // Call with no arguments - get loss list from internal data.
         else if (m_pRcvLossList->getLossLength() > 0)
@@ -7902,10 +8353,8 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
                 ctrlpkt.m_iID = m_PeerID;
                 nbsent        = m_pSndQueue->sendto(m_PeerAddr, ctrlpkt);
 
-                enterCS(m_StatsLock);
-                ++m_stats.sentNAK;
-                ++m_stats.sentNAKTotal;
-                leaveCS(m_StatsLock);
+                countStat(STAT_SENT_NAK);
+                traceLossReport(SRT_TRACE_NAK_SENT, data, losslen);
             }
 
             delete[] data;
@@ -7938,7 +8387,7 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
         break;
 
     case UMSG_KEEPALIVE: // 001 - Keep-alive
-        ctrlpkt.pack(pkttype);
+        ctrlpkt.pack(pkttype, lparam);
         ctrlpkt.m_iID = m_PeerID;
         nbsent        = m_pSndQueue->sendto(m_PeerAddr, ctrlpkt);
 
@@ -7984,7 +8433,7 @@ void CUDT::sendCtrl(UDTMessageType pkttype, const int32_t* lparam, void* rparam,
         m_tsLastSndTime = steady_clock::now();
 }
 
-void CUDT::updateSndLossListOnACK(int32_t ackdata_seqno)
+void CUDT::updateSndLossListOnACK(int32_t ackdata_seqno, const steady_clock::time_point& currtime)
 {
     // Update sender's loss list and acknowledge packets in the sender's buffer
     {
@@ -8020,33 +8469,30 @@ void CUDT::updateSndLossListOnACK(int32_t ackdata_seqno)
     }
 
     // insert this socket to snd list if it is not on the list yet
-    m_pSndQueue->m_pSndUList->update(this, CSndUList::DONT_RESCHEDULE);
+    m_pSndQueue->m_pSndUList->update(this, CSndUList::DONT_RESCHEDULE, currtime);
 
     if (m_bSynSending)
     {
         CSync::lock_signal(m_SendBlockCond, m_SendBlockLock);
     }
 
-    const steady_clock::time_point currtime = steady_clock::now();
     // record total time used for sending
-    enterCS(m_StatsLock);
-    m_stats.sndDuration += count_microseconds(currtime - m_stats.sndDurationCounter);
-    m_stats.m_sndDurationTotal += count_microseconds(currtime - m_stats.sndDurationCounter);
-    m_stats.sndDurationCounter = currtime;
-    leaveCS(m_StatsLock);
+    const int64_t now_us = count_microseconds(currtime);
+    countStat(STAT_SND_DURATION, now_us - m_stats.sndDurationCounter.exchange(now_us));
 }
 
 void CUDT::processCtrlAck(const CPacket &ctrlpkt, const steady_clock::time_point& currtime)
 {
     const int32_t* ackdata       = (const int32_t*)ctrlpkt.m_pcData;
     const int32_t  ackdata_seqno = ackdata[ACKD_RCVLASTACK];
+    srt::trace::event(SRT_TRACE_ACK_RECV, m_SocketID, ackdata_seqno, ctrlpkt.getAckSeqNo());
 
     const bool isLiteAck = ctrlpkt.getLength() == (size_t)SEND_LITE_ACK;
     HLOGC(mglog.Debug,
           log << CONID() << "ACK covers: " << m_iSndLastDataAck << " - " << ackdata_seqno << " [ACK=" << m_iSndLastAck
               << "]" << (isLiteAck ? "[LITE]" : "[FULL]"));
 
-    updateSndLossListOnACK(ackdata_seqno);
+    updateSndLossListOnACK(ackdata_seqno, currtime);
 
     // Process a lite ACK
     if (isLiteAck)
@@ -8170,6 +8616,19 @@ void CUDT::processCtrlAck(const CPacket &ctrlpkt, const steady_clock::time_point
     m_iRTTVar = avg_iir<4>(m_iRTTVar, abs(rtt - m_iRTT));
     m_iRTT    = avg_iir<8>(m_iRTT, rtt);
 
+    // The RTT field is the receiver's smoothed value, so the sender takes its
+    // own sample from the packet timed in packData() once an ACK covers it.
+    // It includes the delay of the ACK at the receiver, at most one ACK period.
+    // The exchange fails if the packet was retransmitted meanwhile, as the
+    // sample would be ambiguous then (Karn's algorithm).
+    int32_t probe_seq = m_iRTTProbeSeq.load_acquire();
+    if (probe_seq != -1 && CSeqNo::seqcmp(ackdata_seqno, probe_seq) > 0)
+    {
+        const int64_t sent_us = m_iRTTProbeSentTime.load();
+        if (m_iRTTProbeSeq.compare_exchange((probe_seq), -1))
+            m_iRTTSample = int(count_microseconds(currtime) - sent_us);
+    }
+
     /* Version-dependent fields:
      * Original UDT (total size: ACKD_TOTAL_SIZE_SMALL):
      *   ACKD_RCVLASTACK
@@ -8216,13 +8675,10 @@ void CUDT::processCtrlAck(const CPacket &ctrlpkt, const steady_clock::time_point
     checkSndTimers(REGEN_KM);
     updateCC(TEV_ACK, ackdata_seqno);
 
-    enterCS(m_StatsLock);
-    ++m_stats.recvACK;
-    ++m_stats.recvACKTotal;
-    leaveCS(m_StatsLock);
+    countStat(STAT_RECV_ACK);
 }
 
-void CUDT::processCtrlLossReport(const CPacket& ctrlpkt)
+void CUDT::processCtrlLossReport(const CPacket& ctrlpkt, const steady_clock::time_point& currtime)
 {
     const int32_t* losslist = (int32_t*)(ctrlpkt.m_pcData);
     const size_t   losslist_len = ctrlpkt.getLength() / 4;
@@ -8315,10 +8771,7 @@ void CUDT::processCtrlLossReport(const CPacket& ctrlpkt)
                     sendCtrl(UMSG_DROPREQ, &no_msgno, seqpair, sizeof(seqpair));
                 }
 
-                enterCS(m_StatsLock);
-                m_stats.traceSndLoss += num;
-                m_stats.sndLossTotal += num;
-                leaveCS(m_StatsLock);
+                countStat(STAT_SND_LOSS, num);
             }
             else if (CSeqNo::seqcmp(losslist[i], m_iSndLastAck) >= 0)
             {
@@ -8336,10 +8789,7 @@ void CUDT::processCtrlLossReport(const CPacket& ctrlpkt)
                     << losslist[i] << " (1 packet)");
                 int num = m_pSndLossList->insert(losslist[i], losslist[i]);
 
-                enterCS(m_StatsLock);
-                m_stats.traceSndLoss += num;
-                m_stats.sndLossTotal += num;
-                leaveCS(m_StatsLock);
+                countStat(STAT_SND_LOSS, num);
             }
         }
     }
@@ -8358,19 +8808,16 @@ void CUDT::processCtrlLossReport(const CPacket& ctrlpkt)
     }
 
     // the lost packet (retransmission) should be sent out immediately
-    m_pSndQueue->m_pSndUList->update(this, CSndUList::DO_RESCHEDULE);
+    m_pSndQueue->m_pSndUList->update(this, CSndUList::DO_RESCHEDULE, currtime);
 
-    enterCS(m_StatsLock);
-    ++m_stats.recvNAK;
-    ++m_stats.recvNAKTotal;
-    leaveCS(m_StatsLock);
+    countStat(STAT_RECV_NAK);
+    traceLossReport(SRT_TRACE_NAK_RECV, losslist, losslist_len);
 }
 
-void CUDT::processCtrl(const CPacket &ctrlpkt)
+void CUDT::processCtrl(const CPacket &ctrlpkt, const steady_clock::time_point& currtime)
 {
     // Just heard from the peer, reset the expiration count.
     m_iEXPCount = 1;
-    const steady_clock::time_point currtime = steady_clock::now();
     m_tsLastRspTime = currtime;
     bool using_rexmit_flag = m_bPeerRexmitFlag;
 
@@ -8402,7 +8849,10 @@ void CUDT::processCtrl(const CPacket &ctrlpkt)
         // if increasing delay detected...
         //   sendCtrl(UMSG_CGWARNING);
 
+        srt::trace::event(SRT_TRACE_ACKACK_RECV, m_SocketID, ctrlpkt.getAckSeqNo(), rtt);
+
         // RTT EWMA
+        m_iRTTSample = rtt;
         m_iRTTVar = avg_iir<4>(m_iRTTVar, abs(rtt - m_iRTT));
         m_iRTT = avg_iir<8>(m_iRTT, rtt);
 
@@ -8431,7 +8881,7 @@ void CUDT::processCtrl(const CPacket &ctrlpkt)
     }
 
     case UMSG_LOSSREPORT: // 011 - Loss Report
-        processCtrlLossReport(ctrlpkt);
+        processCtrlLossReport(ctrlpkt, currtime);
         break;
 
     case UMSG_CGWARNING: // 100 - Delay Warning
@@ -8446,7 +8896,7 @@ void CUDT::processCtrl(const CPacket &ctrlpkt)
 
     case UMSG_KEEPALIVE: // 001 - Keep-alive
 
-        handleKeepalive(ctrlpkt.m_pcData, ctrlpkt.getLength());
+        handleKeepalive(ctrlpkt.m_iMsgNo, ctrlpkt.m_pcData, ctrlpkt.getLength());
 
         break;
 
@@ -8833,12 +9283,9 @@ int CUDT::packLostData(CPacket& w_packet, steady_clock::time_point& w_origintime
         // Therefore unlocking in order not to block other threads.
         ackguard.unlock();
 
-        enterCS(m_StatsLock);
-        ++m_stats.traceRetrans;
-        ++m_stats.retransTotal;
-        m_stats.traceBytesRetrans += payload;
-        m_stats.bytesRetransTotal += payload;
-        leaveCS(m_StatsLock);
+        countStat(STAT_RETRANS);
+        countStat(STAT_RETRANS_BYTES, payload);
+        srt::trace::event(SRT_TRACE_PKT_RETRANS, m_SocketID, w_packet.m_iSeqNo, payload);
 
         // Despite the contextual interpretation of packet.m_iMsgNo around
         // CSndBuffer::readData version 2 (version 1 doesn't return -1), in this particular
@@ -8855,7 +9302,7 @@ int CUDT::packLostData(CPacket& w_packet, steady_clock::time_point& w_origintime
     return 0;
 }
 
-std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
+std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet, const steady_clock::time_point& enter_time)
 {
     int payload = 0;
     bool probe = false;
@@ -8865,32 +9312,28 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
 
     int kflg = EK_NOENC;
 
-    const steady_clock::time_point enter_time = steady_clock::now();
+    // Keep the time the pacing scheduled this packet for, before it's moved.
+    const steady_clock::time_point scheduled_time = m_tsNextSendTime;
 
     if (!is_zero(m_tsNextSendTime) && enter_time > m_tsNextSendTime)
         m_tdSendTimeDiff += enter_time - m_tsNextSendTime;
 
-    string reason = "reXmit";
+    IF_HEAVY_LOGGING(const char* reason = "reXmit");
 
     payload = packLostData((w_packet), (origintime));
     if (payload > 0)
     {
-        reason = "reXmit";
+        IF_HEAVY_LOGGING(reason = "reXmit");
     }
     else if (m_PacketFilter &&
              m_PacketFilter.packControlPacket(m_iSndCurrSeqNo, m_pCryptoControl->getSndCryptoFlags(), (w_packet)))
     {
         HLOGC(mglog.Debug, log << "filter: filter/CTL packet ready - packing instead of data.");
         payload        = w_packet.getLength();
-        reason         = "filter";
+        IF_HEAVY_LOGGING(reason = "filter");
         filter_ctl_pkt = true; // Mark that this packet ALREADY HAS timestamp field and it should not be set
 
-        // Stats
-        {
-            CGuard lg(m_StatsLock);
-            ++m_stats.sndFilterExtra;
-            ++m_stats.sndFilterExtraTotal;
-        }
+        countStat(STAT_SND_FILTER_EXTRA);
     }
     else
     {
@@ -8988,7 +9431,7 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
             return std::make_pair(0, enter_time);
         }
 
-        reason = "normal";
+        IF_HEAVY_LOGGING(reason = "normal");
     }
 
     // Normally packet.m_iTimeStamp field is set exactly here,
@@ -9014,7 +9457,7 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
             }
             else
             {
-                setPacketTS(w_packet, steady_clock::now());
+                setPacketTS(w_packet, enter_time);
                 LOGC(dlog.Error, log << "packData: reference time=" << FormatTime(origintime)
                         << " is in the past towards start time=" << FormatTime(m_stats.tsStartTime)
                         << " - setting NOW as reference time for the data packet");
@@ -9022,7 +9465,7 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
         }
         else
         {
-            setPacketTS(w_packet, steady_clock::now());
+            setPacketTS(w_packet, enter_time);
         }
     }
 
@@ -9042,7 +9485,6 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
             return std::make_pair(-1, enter_time);
         }
         payload = w_packet.getLength(); /* Cipher may change length */
-        reason += " (encrypted)";
     }
 
     if (new_packet_packed && m_PacketFilter)
@@ -9053,7 +9495,7 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
 
 #if ENABLE_HEAVY_LOGGING // Required because of referring to MessageFlagStr()
     HLOGC(mglog.Debug,
-          log << CONID() << "packData: " << reason << " packet seq=" << w_packet.m_iSeqNo << " (ACK=" << m_iSndLastAck
+          log << CONID() << "packData: " << reason << (kflg ? " (encrypted)" : "") << " packet seq=" << w_packet.m_iSeqNo << " (ACK=" << m_iSndLastAck
               << " ACKDATA=" << m_iSndLastDataAck << " MSG/FLAGS: " << w_packet.MessageFlagStr() << ")");
 #endif
 
@@ -9074,12 +9516,40 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
     // different thread than the rest of the signals.
     // m_pSndTimeWindow->onPktSent(w_packet.m_iTimeStamp);
 
-    enterCS(m_StatsLock);
-    m_stats.traceBytesSent += payload;
-    m_stats.bytesSentTotal += payload;
-    ++m_stats.traceSent;
-    ++m_stats.sentTotal;
-    leaveCS(m_StatsLock);
+    countStat(STAT_SENT_BYTES, payload);
+    countStat(STAT_SENT);
+    if (new_packet_packed)
+        srt::trace::event(SRT_TRACE_PKT_SENT, m_SocketID, w_packet.m_iSeqNo, payload);
+
+    // Time one packet at a time for the RTT sample taken in processCtrlAck().
+    if (new_packet_packed)
+    {
+        if (m_iRTTProbeSeq.load() == -1)
+        {
+            m_iRTTProbeSentTime.store(count_microseconds(enter_time));
+            m_iRTTProbeSeq.store_release(w_packet.m_iSeqNo);
+        }
+    }
+    else if (!filter_ctl_pkt && m_iRTTProbeSeq.load() == w_packet.m_iSeqNo)
+    {
+        m_iRTTProbeSeq.store(-1);
+    }
+    if (new_packet_packed && m_bPeerTsbPd)
+    {
+        // Without pacing the packet would go out as soon as it's scheduled,
+        // unless the sending was stalled (congestion window, empty buffer),
+        // in which case it would go out when the stall ends. Count the time
+        // from then until the pacing slot; lateness past the slot is not
+        // caused by pacing either.
+        const steady_clock::time_point unpaced_time = std::max(origintime, m_tsLastUnpacedSndTime);
+        const steady_clock::time_point paced_time = is_zero(scheduled_time) ? unpaced_time : std::min(scheduled_time, enter_time);
+        const int64_t delay = paced_time > unpaced_time ? count_microseconds(paced_time - unpaced_time) : 0;
+        countStat(STAT_SND_PACED);
+        countStat(STAT_SND_PACING_DELAY, delay);
+        m_stats.sndPacingDelayMax.fetch_max(delay);
+    }
+    if (is_zero(scheduled_time))
+        m_tsLastUnpacedSndTime = enter_time;
 
     if (probe)
     {
@@ -9089,18 +9559,30 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
     }
     else
     {
+        const bool adaptive_pacing = m_bPeerTsbPd && m_iOPT_SndPacingDelay > 0;
+        const duration send_interval = adaptive_pacing ? livePacingInterval(enter_time) : m_tdSendInterval;
 #if USE_BUSY_WAITING
-        m_tsNextSendTime = enter_time + m_tdSendInterval;
+        m_tsNextSendTime = enter_time + send_interval;
 #else
-        if (m_tdSendTimeDiff >= m_tdSendInterval)
+        // In the adaptive mode the lateness credit works as a token bucket
+        // of a limited depth, so that after a stall the queued packets
+        // aren't sent in a burst at the line rate. The deadline of the
+        // queued packets is still respected by the interval itself.
+        // (Duration::operator* takes a reference, so the constant is copied,
+        // otherwise it would need a definition out of the class.)
+        const int burst_pkts = PACING_BURST_PKTS;
+        if (adaptive_pacing && m_tdSendTimeDiff > send_interval * burst_pkts)
+            m_tdSendTimeDiff = send_interval * burst_pkts;
+
+        if (m_tdSendTimeDiff >= send_interval)
         {
             // Send immidiately
             m_tsNextSendTime = enter_time;
-            m_tdSendTimeDiff -= m_tdSendInterval;
+            m_tdSendTimeDiff -= send_interval;
         }
         else
         {
-            m_tsNextSendTime = enter_time + (m_tdSendInterval - m_tdSendTimeDiff);
+            m_tsNextSendTime = enter_time + (send_interval - m_tdSendTimeDiff);
             m_tdSendTimeDiff = m_tdSendTimeDiff.zero();
         }
 #endif
@@ -9109,6 +9591,48 @@ std::pair<int, steady_clock::time_point> CUDT::packData(CPacket& w_packet)
     return std::make_pair(payload, m_tsNextSendTime);
 }
 
+steady_clock::duration CUDT::livePacingInterval(const steady_clock::time_point& now)
+{
+    // Base rate: the input rate (SRTO_INPUTBW or measured) with the overhead,
+    // unless SRTO_MAXBW (applied by the congestion controller) limits it even
+    // more. The input rate includes the packet headers.
+    steady_clock::duration interval = m_tdSendInterval;
+    const int64_t inputrate = withOverhead(m_llInputBW != 0 ? m_llInputBW : m_pSndBuffer->getInputRate());
+    if (inputrate > 0)
+    {
+        const int64_t pktsize = m_iMaxSRTPayloadSize + CPacket::SRT_DATA_HDR_SIZE;
+        interval = std::max(interval, microseconds_from(pktsize * 1000000 / inputrate));
+    }
+
+    const steady_clock::time_point oldest = m_pSndBuffer->getNextOriginTime();
+    if (is_zero(oldest))
+        return interval; // Nothing waiting
+
+    // Packets scheduled, but not yet extracted from the sender buffer.
+    const int unsent = std::max(CSeqNo::seqoff(m_iSndCurrSeqNo, m_iSndNextSeqNo) - 1, 1);
+
+    // The horizon is limited to half of the peer latency, so that
+    // there's always time left for the transmission and recovery.
+    const int horizon_ms = std::min(m_iOPT_SndPacingDelay, m_iPeerTsbPdDelay_ms / 2);
+    const steady_clock::time_point deadline = oldest + milliseconds_from(horizon_ms);
+    if (deadline <= now)
+    {
+        HLOGC(dlog.Debug, log << CONID() << "livePacingInterval: oldest of " << unsent
+                << " unsent packets past the pacing horizon, sending immediately");
+        return steady_clock::duration();
+    }
+
+    // All waiting packets must be sent before the deadline of the oldest one.
+    const steady_clock::duration required = microseconds_from(count_microseconds(deadline - now) / unsent);
+    if (required < interval)
+    {
+        HLOGC(dlog.Debug, log << CONID() << "livePacingInterval: " << unsent << " unsent, speeding up from "
+                << count_microseconds(interval) << "us to " << count_microseconds(required) << "us");
+        return required;
+    }
+    return interval;
+}
+
 // This is a close request, but called from the
 void CUDT::processClose()
 {
@@ -9218,7 +9742,7 @@ bool CUDT::overrideSndSeqNo(int32_t seq)
     return true;
 }
 
-int CUDT::processData(CUnit* in_unit)
+int CUDT::processData(CUnit* in_unit, const steady_clock::time_point& arrival_time)
 {
     if (m_bClosing)
         return -1;
@@ -9229,7 +9753,7 @@ int CUDT::processData(CUnit* in_unit)
     // m_pRcvBuffer->addLocalTsbPdDriftSample(packet.getMsgTimeStamp());
     // Just heard from the peer, reset the expiration count.
     m_iEXPCount = 1;
-    m_tsLastRspTime = steady_clock::now();
+    m_tsLastRspTime = arrival_time;
 
     const bool need_tsbpd = m_bTsbPd || m_bGroupTsbPd;
 
@@ -9270,22 +9794,24 @@ int CUDT::processData(CUnit* in_unit)
     if (pktrexmitflag == 1)
     {
         // This packet was retransmitted
-        enterCS(m_StatsLock);
-        m_stats.traceRcvRetrans++;
-        leaveCS(m_StatsLock);
+        countStat(STAT_RCV_RETRANS);
 
 #if ENABLE_HEAVY_LOGGING
         // Check if packet was retransmitted on request or on ack timeout
         // Search the sequence in the loss record.
-        rexmit_reason = " by ";
-        if (!m_pRcvLossList->find(packet.m_iSeqNo, packet.m_iSeqNo))
-            rexmit_reason += "BLIND";
-        else
-            rexmit_reason += "NAKREPORT";
+        if (LOG_ENABLED(mglog.Debug))
+        {
+            rexmit_reason = " by ";
+            if (!m_pRcvLossList->find(packet.m_iSeqNo, packet.m_iSeqNo))
+                rexmit_reason += "BLIND";
+            else
+                rexmit_reason += "NAKREPORT";
+        }
 #endif
     }
 
 #if ENABLE_HEAVY_LOGGING
+   if (LOG_ENABLED(dlog.Debug))
    {
        steady_clock::duration tsbpddelay = milliseconds_from(m_iTsbPdDelay_ms); // (value passed to CRcvBuffer::setRcvTsbPdMode)
 
@@ -9316,7 +9842,7 @@ int CUDT::processData(CUnit* in_unit)
     // make sure that this packet isn't going to be
     // effectively discarded, as repeated retransmission,
     // for example, burdens the link, but doesn't better the speed.
-    m_RcvTimeWindow.onPktArrival(pktsz);
+    m_RcvTimeWindow.onPktArrival(pktsz, arrival_time);
 
     // Probe the packet pair if needed.
     // Conditions and any extra data required for the packet
@@ -9328,14 +9854,11 @@ int CUDT::processData(CUnit* in_unit)
     // Retransmitted and unordered packets do not provide expected measurement.
     // We expect the 16th and 17th packet to be sent regularly,
     // otherwise measurement must be rejected.
-    m_RcvTimeWindow.probeArrival(packet, unordered || retransmitted);
+    m_RcvTimeWindow.probeArrival(packet, unordered || retransmitted, arrival_time);
 
-    enterCS(m_StatsLock);
-    m_stats.traceBytesRecv += pktsz;
-    m_stats.bytesRecvTotal += pktsz;
-    ++m_stats.traceRecv;
-    ++m_stats.recvTotal;
-    leaveCS(m_StatsLock);
+    countStat(STAT_RECV_BYTES, pktsz);
+    countStat(STAT_RECV);
+    srt::trace::event(SRT_TRACE_PKT_RECV, m_SocketID, packet.m_iSeqNo, pktsz);
 
     loss_seqs_t                             filter_loss_seqs;
     loss_seqs_t                             srt_loss_seqs;
@@ -9373,13 +9896,10 @@ int CUDT::processData(CUnit* in_unit)
        // >1 - jump over a packet loss (loss = seqdiff-1)
         if (diff > 1)
         {
-            CGuard lg(m_StatsLock);
             int    loss = diff - 1; // loss is all that is above diff == 1
-            m_stats.traceRcvLoss += loss;
-            m_stats.rcvLossTotal += loss;
+            countStat(STAT_RCV_LOSS, loss);
             uint64_t lossbytes = loss * m_pRcvBuffer->getRcvAvgPayloadSize();
-            m_stats.traceRcvBytesLoss += lossbytes;
-            m_stats.rcvBytesLossTotal += lossbytes;
+            countStat(STAT_RCV_LOSS_BYTES, lossbytes);
             HLOGC(mglog.Debug,
                   log << "LOSS STATS: n=" << loss << " SEQ: [" << CSeqNo::incseq(m_iRcvCurrPhySeqNo) << " "
                       << CSeqNo::decseq(packet.m_iSeqNo) << "]");
@@ -9392,6 +9912,9 @@ int CUDT::processData(CUnit* in_unit)
         }
     }
 
+    // Set when this member has stored a packet in the shared receiving mode.
+    bool shared_stored = false;
+
     {
         // Start of offset protected section
         // Prevent TsbPd thread from modifying Ack position while adding data
@@ -9420,6 +9943,14 @@ int CUDT::processData(CUnit* in_unit)
         // Needed for possibly check for needsQuickACK.
         bool incoming_belated = (CSeqNo::seqcmp(in_unit->m_Packet.m_iSeqNo, m_iRcvLastSkipAck) < 0);
 
+        // In the shared receiving mode every packet is stored by only one member
+        // of the group. The packets are extracted by the TSBPD thread at their
+        // time to play, so the group gets them in order from different members.
+        CUDTGroup* shared_rcv_group = NULL;
+        if (m_bOPT_GroupSharedRcv && m_bTsbPd && m_parent->m_IncludedGroup
+                && m_parent->m_IncludedGroup->type() != SRT_GTYPE_BALANCING)
+            shared_rcv_group = m_parent->m_IncludedGroup;
+
         // Loop over all incoming packets that were filtered out.
         // In case when there is no filter, there's just one packet in 'incoming',
         // the one that came in the input of this function.
@@ -9442,13 +9973,11 @@ int CUDT::processData(CUnit* in_unit)
                 IF_HEAVY_LOGGING(exc_type = "BELATED");
                 steady_clock::time_point tsbpdtime = m_pRcvBuffer->getPktTsbPdTime(rpkt.getMsgTimeStamp());
                 long bltime = CountIIR<uint64_t>(
-                        uint64_t(m_stats.traceBelatedTime) * 1000,
-                        count_microseconds(steady_clock::now() - tsbpdtime), 0.2);
+                        uint64_t(m_stats.traceBelatedTime.load()),
+                        count_microseconds(arrival_time - tsbpdtime), 0.2);
 
-                enterCS(m_StatsLock);
-                m_stats.traceBelatedTime = double(bltime) / 1000.0;
-                m_stats.traceRcvBelated++;
-                leaveCS(m_StatsLock);
+                m_stats.traceBelatedTime.store(bltime);
+                countStat(STAT_RCV_BELATED);
                 HLOGC(mglog.Debug,
                       log << CONID() << "RECEIVED: seq=" << packet.m_iSeqNo << " offset=" << offset << " (BELATED/"
                           << rexmitstat[pktrexmitflag] << rexmit_reason << ") FLAGS: " << packet.MessageFlagStr());
@@ -9499,7 +10028,16 @@ int CUDT::processData(CUnit* in_unit)
             }
 
             bool adding_successful = true;
-            if (m_pRcvBuffer->addData(*i, offset) < 0)
+            if (shared_rcv_group && !shared_rcv_group->rcvClaim(rpkt.m_iSeqNo))
+            {
+                // Another member has stored this packet. Leave the unit free,
+                // but treat the packet as received, so that it's acknowledged
+                // and not reported as lost. The empty position in the buffer
+                // is skipped when reading.
+                IF_HEAVY_LOGGING(exc_type = "SHARED");
+                excessive = false;
+            }
+            else if (m_pRcvBuffer->addData(*i, offset) < 0)
             {
                 // addData returns -1 if at the m_iLastAckPos+offset position there already is a packet.
                 // So this packet is "redundant".
@@ -9510,6 +10048,14 @@ int CUDT::processData(CUnit* in_unit)
             {
                 IF_HEAVY_LOGGING(exc_type = "ACCEPTED");
                 excessive = false;
+                shared_stored = shared_stored || shared_rcv_group;
+                u->m_tsArrival = arrival_time;
+                if (m_bTsbPd)
+                {
+                    const steady_clock::time_point origin_time =
+                        m_pRcvBuffer->getPktTsbPdTime(rpkt.getMsgTimeStamp()) - milliseconds_from(m_iTsbPdDelay_ms);
+                    m_stats.histRcvTransit.add(count_microseconds(arrival_time - origin_time));
+                }
                 if (u->m_Packet.getMsgCryptoFlags())
                 {
                     EncryptionStatus rc = m_pCryptoControl ? m_pCryptoControl->decrypt((u->m_Packet)) : ENCS_NOTSUP;
@@ -9519,49 +10065,49 @@ int CUDT::processData(CUnit* in_unit)
                         // Keep packet in received buffer
                         // Crypto flags are still set
                         // It will be acknowledged
-                        {
-                            CGuard lg(m_StatsLock);
-                            m_stats.traceRcvUndecrypt += 1;
-                            m_stats.traceRcvBytesUndecrypt += pktsz;
-                            m_stats.m_rcvUndecryptTotal += 1;
-                            m_stats.m_rcvBytesUndecryptTotal += pktsz;
-                        }
+                        countStat(STAT_RCV_UNDECRYPT);
+                        countStat(STAT_RCV_UNDECRYPT_BYTES, pktsz);
 
                         // Log message degraded to debug because it may happen very often
                         HLOGC(dlog.Debug, log << CONID() << "ERROR: packet not decrypted, dropping data.");
                         adding_successful = false;
+                        if (shared_rcv_group)
+                            shared_rcv_group->rcvUnclaim(rpkt.m_iSeqNo);
                         IF_HEAVY_LOGGING(exc_type = "UNDECRYPTED");
                     }
                 }
             }
 #if ENABLE_HEAVY_LOGGING
-            std::ostringstream timebufspec;
-            if (m_bTsbPd)
+            if (LOG_ENABLED(mglog.Debug))
             {
-                int dsize = m_pRcvBuffer->getRcvDataSize();
-                timebufspec << "(" << FormatTime(m_pRcvBuffer->debugGetDeliveryTime(0))
-                    << "-" << FormatTime(m_pRcvBuffer->debugGetDeliveryTime(dsize-1)) << ")";
-            }
+                std::ostringstream timebufspec;
+                if (m_bTsbPd)
+                {
+                    int dsize = m_pRcvBuffer->getRcvDataSize();
+                    timebufspec << "(" << FormatTime(m_pRcvBuffer->debugGetDeliveryTime(0))
+                        << "-" << FormatTime(m_pRcvBuffer->debugGetDeliveryTime(dsize-1)) << ")";
+                }
 
-            std::ostringstream expectspec;
-            if (excessive)
-                expectspec << "EXCESSIVE(" << exc_type << rexmit_reason << ")";
-            else
-                expectspec << "ACCEPTED";
-
-            LOGC(mglog.Debug, log << CONID() << "RECEIVED: seq=" << rpkt.m_iSeqNo
-                    << " offset=" << offset
-                    << " BUFr=" << avail_bufsize
-                    << " avail=" << m_pRcvBuffer->getAvailBufSize()
-                    << " buffer=(" << m_iRcvLastSkipAck
-                    << ":" << m_iRcvCurrSeqNo                   // -1 = size to last index
-                    << "+" << CSeqNo::incseq(m_iRcvLastSkipAck, m_pRcvBuffer->capacity()-1)
-                    << ") "
-                    << " RSL=" << expectspec.str()
-                    << " SN=" << rexmitstat[pktrexmitflag]
-                    << " DLVTM=" << timebufspec.str()
-                    << " FLAGS: "
-                    << rpkt.MessageFlagStr());
+                std::ostringstream expectspec;
+                if (excessive)
+                    expectspec << "EXCESSIVE(" << exc_type << rexmit_reason << ")";
+                else
+                    expectspec << "ACCEPTED";
+
+                LOGC(mglog.Debug, log << CONID() << "RECEIVED: seq=" << rpkt.m_iSeqNo
+                        << " offset=" << offset
+                        << " BUFr=" << avail_bufsize
+                        << " avail=" << m_pRcvBuffer->getAvailBufSize()
+                        << " buffer=(" << m_iRcvLastSkipAck
+                        << ":" << m_iRcvCurrSeqNo                   // -1 = size to last index
+                        << "+" << CSeqNo::incseq(m_iRcvLastSkipAck, m_pRcvBuffer->capacity()-1)
+                        << ") "
+                        << " RSL=" << expectspec.str()
+                        << " SN=" << rexmitstat[pktrexmitflag]
+                        << " DLVTM=" << timebufspec.str()
+                        << " FLAGS: "
+                        << rpkt.MessageFlagStr());
+            }
 #endif
 
             // Decryption should have made the crypto flags EK_NOENC.
@@ -9624,7 +10170,7 @@ int CUDT::processData(CUnit* in_unit)
             // a given period).
             if (m_CongCtl->needsQuickACK(packet))
             {
-                m_tsNextACKTime = steady_clock::now();
+                m_tsNextACKTime = arrival_time;
             }
         }
 
@@ -9653,6 +10199,16 @@ int CUDT::processData(CUnit* in_unit)
         return -1;
     }
 
+    // In the shared receiving mode a member may store no packet for a long
+    // time, so its TSBPD thread waits for the next ACK. Behind a loss that
+    // is never recovered the ACK doesn't come, so wake up the thread to drop
+    // the loss at the time to play of the packet just stored.
+    if (shared_stored && m_pRcvLossList->getLossLength() > 0)
+    {
+        HLOGC(mglog.Debug, log << "shared: stored beyond a loss, signaling TSBPD cond");
+        CSync::lock_signal(m_RcvTsbPdCond, m_RecvLock);
+    }
+
     if (!srt_loss_seqs.empty())
     {
         // A loss is detected
@@ -9793,9 +10349,7 @@ int CUDT::processData(CUnit* in_unit)
             if (m_iReorderTolerance > 0)
             {
                 m_iReorderTolerance--;
-                enterCS(m_StatsLock);
-                m_stats.traceReorderDistance--;
-                leaveCS(m_StatsLock);
+                m_stats.traceReorderDistance.fetch_add(-1);
                 HLOGF(mglog.Debug,
                       "ORDERED DELIVERY of 50 packets in a row - decreasing tolerance to %d",
                       m_iReorderTolerance);
@@ -9993,9 +10547,7 @@ void CUDT::unlose(const CPacket &packet)
             HLOGF(mglog.Debug, "received out-of-band packet seq %d", sequence);
 
             const int seqdiff = abs(CSeqNo::seqcmp(m_iRcvCurrSeqNo, packet.m_iSeqNo));
-            enterCS(m_StatsLock);
-            m_stats.traceReorderDistance = max(seqdiff, m_stats.traceReorderDistance);
-            leaveCS(m_StatsLock);
+            m_stats.traceReorderDistance.fetch_max(seqdiff);
             if (seqdiff > m_iReorderTolerance)
             {
                 const int new_tolerance = min(seqdiff, m_iMaxReorderTolerance);
@@ -10100,9 +10652,7 @@ breakbreak:;
                 if (m_iReorderTolerance > 0)
                 {
                     m_iReorderTolerance--;
-                    enterCS(m_StatsLock);
-                    m_stats.traceReorderDistance--;
-                    leaveCS(m_StatsLock);
+                    m_stats.traceReorderDistance.fetch_add(-1);
                     HLOGF(mglog.Debug,
                           "... reached %d times - decreasing tolerance to %d",
                           m_iConsecEarlyDelivery,
@@ -10156,44 +10706,73 @@ void CUDT::dropFromLossLists(int32_t from, int32_t to)
                       m_FreshLoss.begin() + delete_index); // with delete_index == 0 will do nothing
 }
 
+// Fills the secret with random bytes, from the system source if available.
+static void genCookieSecret(unsigned char* secret, size_t size)
+{
+    size_t have = 0;
+#ifndef _WIN32
+    FILE* rnd = fopen("/dev/urandom", "rb");
+    if (rnd)
+    {
+        have = fread(secret, 1, size, rnd);
+        fclose(rnd);
+    }
+#endif
+    if (have == size)
+        return;
+
+    uint64_t seed = count_microseconds(steady_clock::now().time_since_epoch()) ^ uint64_t(uintptr_t(secret));
+    for (size_t i = have; i < size; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + uint64_t(rand());
+        secret[i] = (unsigned char)(seed >> 56);
+    }
+}
+
 // This function, as the name states, should bake a new cookie.
-int32_t CUDT::bake(const sockaddr_any& addr, int32_t current_cookie, int correction)
+// The cookie is a keyed hash of the peer address and the current time
+// epoch, so that the listener needn't remember anything about the peer
+// until it comes back with the cookie in the conclusion request. The
+// secret key changes with every epoch, and the one of the previous epoch
+// is still used to accept the cookies baked shortly before the change
+// (correction = -1).
+//
+// Called only from one thread: the RcvQ worker for a listener, the
+// connecting thread for a rendezvous socket.
+int32_t CUDT::bake(const sockaddr_any& addr, int correction)
 {
-    static unsigned int distractor = 0;
-    unsigned int        rollover   = distractor + 10;
+    const int64_t epoch = count_microseconds(steady_clock::now() - m_stats.tsStartTime) / COOKIE_EPOCH_US;
+    if (epoch != m_iCookieEpoch)
+    {
+        // Generate the secret for the new epoch; keep the previous one
+        // only if it's for the directly preceding epoch.
+        genCookieSecret(m_CookieSecret[epoch & 1], CSipHash::KEY_SIZE);
+        if (m_iCookieEpoch == -1 || epoch != m_iCookieEpoch + 1)
+            genCookieSecret(m_CookieSecret[(epoch + 1) & 1], CSipHash::KEY_SIZE);
+        m_iCookieEpoch = epoch;
+    }
 
-    for (;;)
+    const int64_t cookie_epoch = epoch + correction;
+
+    // Port, address and epoch, all in a fixed byte order.
+    unsigned char input[2 + 16 + 8];
+    size_t len = 0;
+    if (addr.family() == AF_INET6)
+    {
+        memcpy(input, &addr.sin6.sin6_port, 2);
+        memcpy(input + 2, &addr.sin6.sin6_addr, 16);
+        len = 2 + 16;
+    }
+    else
     {
-        // SYN cookie
-        char clienthost[NI_MAXHOST];
-        char clientport[NI_MAXSERV];
-        getnameinfo(addr.get(),
-                    addr.size(),
-                    clienthost,
-                    sizeof(clienthost),
-                    clientport,
-                    sizeof(clientport),
-                    NI_NUMERICHOST | NI_NUMERICSERV);
-        int64_t timestamp = (count_microseconds(steady_clock::now() - m_stats.tsStartTime) / 60000000) + distractor -
-                            correction; // secret changes every one minute
-        stringstream cookiestr;
-        cookiestr << clienthost << ":" << clientport << ":" << timestamp;
-        union {
-            unsigned char cookie[16];
-            int32_t       cookie_val;
-        };
-        CMD5::compute(cookiestr.str().c_str(), cookie);
-
-        if (cookie_val != current_cookie)
-            return cookie_val;
-
-        ++distractor;
-
-        // This is just to make the loop formally breakable,
-        // but this is virtually impossible to happen.
-        if (distractor == rollover)
-            return cookie_val;
+        memcpy(input, &addr.sin.sin_port, 2);
+        memcpy(input + 2, &addr.sin.sin_addr, 4);
+        len = 2 + 4;
     }
+    for (int i = 0; i < 8; ++i)
+        input[len++] = (unsigned char)(uint64_t(cookie_epoch) >> (8 * i));
+
+    return int32_t(CSipHash::compute(m_CookieSecret[cookie_epoch & 1], input, len));
 }
 
 // XXX This is quite a mystery, why this function has a return value
@@ -10290,11 +10869,6 @@ SRT_REJECT_REASON CUDT::processConnectRequest(const sockaddr_any& addr, CPacket&
     {
         HLOGC(mglog.Debug, log << "processConnectRequest: received type=induction, sending back with cookie+socket");
 
-        // XXX That looks weird - the calculated md5 sum out of the given host/port/timestamp
-        // is 16 bytes long, but CHandShake::m_iCookie has 4 bytes. This then effectively copies
-        // only the first 4 bytes. Moreover, it's dangerous on some platforms because the char
-        // array need not be aligned to int32_t - changed to union in a hope that using int32_t
-        // inside a union will enforce whole union to be aligned to int32_t.
         hs.m_iCookie = cookie_val;
         packet.m_iID = hs.m_iID;
 
@@ -10340,7 +10914,7 @@ SRT_REJECT_REASON CUDT::processConnectRequest(const sockaddr_any& addr, CPacket&
           log << "processConnectRequest: received type=" << RequestTypeStr(hs.m_iReqType) << " - checking cookie...");
     if (hs.m_iCookie != cookie_val)
     {
-        cookie_val = bake(addr, cookie_val, -1); // SHOULD generate an earlier, distracted cookie
+        cookie_val = bake(addr, -1); // The cookie may have been baked in the previous epoch
 
         if (hs.m_iCookie != cookie_val)
         {
@@ -10633,7 +11207,7 @@ bool CUDT::checkExpTimer(const steady_clock::time_point& currtime, int check_rea
         m_iBrokenCounter = 30;
 
         // update snd U list to remove this socket
-        m_pSndQueue->m_pSndUList->update(this, CSndUList::DO_RESCHEDULE);
+        m_pSndQueue->m_pSndUList->update(this, CSndUList::DO_RESCHEDULE, currtime);
 
         releaseSynch();
 
@@ -10731,10 +11305,7 @@ void CUDT::checkRexmitTimer(const steady_clock::time_point& currtime)
         const int     num = m_pSndLossList->insert(m_iSndLastAck, csn);
         if (num > 0)
         {
-            enterCS(m_StatsLock);
-            m_stats.traceSndLoss += num;
-            m_stats.sndLossTotal += num;
-            leaveCS(m_StatsLock);
+            countStat(STAT_SND_LOSS, num);
 
             HLOGC(mglog.Debug,
                   log << CONID() << "ENFORCED " << (is_laterexmit ? "LATEREXMIT" : "FASTREXMIT")
@@ -10750,16 +11321,14 @@ void CUDT::checkRexmitTimer(const steady_clock::time_point& currtime)
     updateCC(TEV_CHECKTIMER, stage);
 
     // immediately restart transmission
-    m_pSndQueue->m_pSndUList->update(this, CSndUList::DO_RESCHEDULE);
+    m_pSndQueue->m_pSndUList->update(this, CSndUList::DO_RESCHEDULE, currtime);
 }
 
-void CUDT::checkTimers()
+void CUDT::checkTimers(const steady_clock::time_point& currtime)
 {
     // update CC parameters
     updateCC(TEV_CHECKTIMER, TEV_CHT_INIT);
 
-    const steady_clock::time_point currtime = steady_clock::now();
-
     // This is a very heavy log, unblock only for temporary debugging!
 #if 0
     HLOGC(mglog.Debug, log << CONID() << "checkTimers: nextacktime=" << FormatTime(m_tsNextACKTime)
@@ -10780,6 +11349,11 @@ void CUDT::checkTimers()
     // Check if FAST or LATE packet retransmission is required
     checkRexmitTimer(currtime);
 
+    // A packet in the group receiver buffer may wait for the preceding ones,
+    // and no new packet may come to report it readable when the wait ends.
+    if (m_parent->m_IncludedGroup)
+        m_parent->m_IncludedGroup->rcvCheckReadable();
+
     if (currtime > m_tsLastSndTime + microseconds_from(COMM_KEEPALIVE_PERIOD_US))
     {
         sendCtrl(UMSG_KEEPALIVE);
@@ -10835,6 +11409,12 @@ void CUDTGroup::addEPoll(int eid)
 
    bool any_read = false;
    bool any_write = false;
+
+   {
+       CGuard rl (m_RcvDataLock);
+       any_read = m_bRcvReadable;
+   }
+
    bool any_broken = false;
    bool any_pending = false;
 
@@ -10852,11 +11432,6 @@ void CUDTGroup::addEPoll(int eid)
                any_write |= i->ps->writeReady();
            }
 
-           if (i->rcvstate == GST_IDLE || i->rcvstate == GST_RUNNING)
-           {
-               any_read |= i->ps->readReady();
-           }
-
            if (i->ps->broken())
                any_broken |= true;
            else
@@ -11031,11 +11606,32 @@ bool CUDT::runAcceptHook(CUDT *acore, const sockaddr* peer, const CHandShake& hs
     return true;
 }
 
-void CUDT::handleKeepalive(const char* /*data*/, size_t /*size*/)
+void CUDT::handleKeepalive(int32_t info, const char* /*data*/, size_t /*size*/)
 {
     // Here can be handled some protocol definition
     // for extra data sent through keepalive.
 
+    if (info == KEEPALIVE_PROBE_RESPONSE)
+    {
+        // Responses to a probe sent after this one are ignored.
+        const int64_t sent_us = m_iProbeSentTime.exchange(0);
+        if (sent_us == 0)
+            return;
+
+        const int rtt = int(steady_clock::now().us_since_epoch() - sent_us);
+        m_iProbeRTT = m_iProbeRTT ? avg_iir<4>(m_iProbeRTT, rtt) : rtt;
+        HLOGC(mglog.Debug, log << CONID() << "KEEPALIVE probe response: RTT=" << rtt << "us avg=" << m_iProbeRTT << "us");
+
+        // The response doesn't say anything about the peer's sending.
+        return;
+    }
+
+    if (info == KEEPALIVE_PROBE)
+    {
+        int32_t response = KEEPALIVE_PROBE_RESPONSE;
+        sendCtrl(UMSG_KEEPALIVE, &response);
+    }
+
     if (m_parent->m_IncludedGroup)
     {
         // Whether anything is to be done with this socket
@@ -11045,6 +11641,14 @@ void CUDT::handleKeepalive(const char* /*data*/, size_t /*size*/)
     }
 }
 
+void CUDT::sendKeepaliveProbe()
+{
+    // A lost probe (or response) is simply replaced by the next probe.
+    m_iProbeSentTime.store(steady_clock::now().us_since_epoch());
+    int32_t probe = KEEPALIVE_PROBE;
+    sendCtrl(UMSG_KEEPALIVE, &probe);
+}
+
 // GROUP
 
 
@@ -11102,7 +11706,8 @@ CUDTGroup::SocketData CUDTGroup::prepareData(CUDTSocket* s)
         -1, -1,
         sockaddr_any(), sockaddr_any(),
         false, false, false,
-        0 // priority
+        0, // priority
+        0 // sndcredit
     };
     return sd;
 }
@@ -11117,6 +11722,10 @@ CUDTGroup::CUDTGroup(SRT_GROUP_TYPE gtype)
     , m_iSndOldestMsgNo(-1)
     , m_iSndAckedMsgNo(-1)
     , m_uOPT_StabilityTimeout(4*CUDT::COMM_SYN_INTERVAL_US)
+    , m_bOPT_FastSwitch(false)
+    , m_tsLastSend()
+    , m_tsSendResumed()
+    , m_iSendIntervalUs(0)
     // -1 = "undefined"; will become defined with first added socket
     , m_iMaxPayloadSize(-1)
     , m_bSynRecving(true)
@@ -11130,7 +11739,12 @@ CUDTGroup::CUDTGroup(SRT_GROUP_TYPE gtype)
     , m_iRcvTimeOut(-1)
     , m_tsStartTime()
     , m_tsRcvPeerStartTime()
+    , m_RcvSlots(GRP_RCV_SLOTS)
+    , m_iRcvPackets(0)
+    , m_bRcvReadable(false)
+    , m_RcvFirstClaim(-1)
     , m_RcvBaseSeqNo(-1)
+    , m_tsRcvFirstArrival()
     , m_bOpened(false)
     , m_bConnected(false)
     , m_bClosing(false)
@@ -11140,7 +11754,6 @@ CUDTGroup::CUDTGroup(SRT_GROUP_TYPE gtype)
     setupMutex(m_GroupLock, "Group");
     setupMutex(m_RcvDataLock, "RcvData");
     setupCond(m_RcvDataCond, "RcvData");
-    m_RcvEID = m_pGlobal->m_EPoll.create(&m_RcvEpolld);
     m_SndEID = m_pGlobal->m_EPoll.create(&m_SndEpolld);
 
     // Configure according to type
@@ -11169,8 +11782,12 @@ CUDTGroup::CUDTGroup(SRT_GROUP_TYPE gtype)
 
 CUDTGroup::~CUDTGroup()
 {
-    srt_epoll_release(m_RcvEID);
     srt_epoll_release(m_SndEID);
+
+    rcvClear();
+    for (vector<char*>::iterator i = m_RcvFreeBuffers.begin(); i != m_RcvFreeBuffers.end(); ++i)
+        delete [] *i;
+
     releaseMutex(m_GroupLock);
     releaseMutex(m_RcvDataLock);
     releaseCond(m_RcvDataCond);
@@ -11262,6 +11879,10 @@ void CUDTGroup::setOpt(SRT_SOCKOPT optName, const void* optval, int optlen)
 
         break;
 
+    case SRTO_GROUPFASTSWITCH:
+        m_bOPT_FastSwitch = bool_int_value(optval, optlen);
+        break;
+
         // XXX Currently no socket groups allow any other
         // congestion control mode other than live.
     case SRTO_CONGESTION:
@@ -11397,6 +12018,10 @@ void CUDTGroup::deriveSettings(CUDT* u)
     IM(SRTO_MESSAGEAPI, m_bMessageAPI);
     IM(SRTO_NAKREPORT, m_bRcvNakReport);
     IM(SRTO_GROUPSTABTIMEO, m_uOPT_StabilityTimeout);
+    IM(SRTO_PACINGDELAY, m_iOPT_SndPacingDelay);
+    IM(SRTO_GROUPFASTSWITCH, m_bOPT_GroupFastSwitch);
+    IM(SRTO_GROUPSHAREDRCV, m_bOPT_GroupSharedRcv);
+    IM(SRTO_CCSEED, m_bOPT_CCSeed);
 
     importOption(m_config, SRTO_PBKEYLEN, u->m_pCryptoControl->KeyLen());
 
@@ -11695,11 +12320,11 @@ int CUDTGroup::send(const char* buf, int len, SRT_MSGCTRL& w_mc)
     case SRT_GTYPE_BACKUP:
         return sendBackup(buf, len, (w_mc));
 
-        /* to be implemented
-
     case SRT_GTYPE_BALANCING:
         return sendBalancing(buf, len, (w_mc));
 
+        /* to be implemented
+
     case SRT_GTYPE_MULTICAST:
         return sendMulticast(buf, len, (w_mc));
         */
@@ -11792,6 +12417,19 @@ int CUDTGroup::sendBroadcast(const char* buf, int len, SRT_MSGCTRL& w_mc)
 
     vector<Sendstate> sendstates;
 
+    // When the payload goes to more than one link, it's copied once into
+    // a shared block referenced by the sender buffers of all members that
+    // send it unencrypted (the encrypted ones need their own copy as the
+    // payload is encrypted in place). The members don't block, so a slow
+    // link only keeps its reference longer, without holding the others.
+    CSharedPayload* shared = NULL;
+    const char* payload = buf;
+    if (sendable.size() + idlers.size() > 1)
+    {
+        shared = CSharedPayload::create(buf, len);
+        payload = shared->data();
+    }
+
     for (vector<gli_t>::iterator snd = sendable.begin(); snd != sendable.end(); ++snd)
     {
         gli_t d = *snd;
@@ -11808,7 +12446,7 @@ int CUDTGroup::sendBroadcast(const char* buf, int len, SRT_MSGCTRL& w_mc)
 
             // Lift the group lock for a while, to avoid possible deadlocks.
             InvertedLock ug(m_GroupLock);
-            stat = ps->core().sendmsg2(buf, len, (w_mc));
+            stat = ps->core().sendmsg2(payload, len, (w_mc), shared);
         }
         catch (CUDTException& e)
         {
@@ -11895,7 +12533,7 @@ int CUDTGroup::sendBroadcast(const char* buf, int len, SRT_MSGCTRL& w_mc)
         try
         {
             InvertedLock ug (m_GroupLock);
-            stat = d->ps->core().sendmsg2(buf, len, (w_mc));
+            stat = d->ps->core().sendmsg2(payload, len, (w_mc), shared);
         }
         catch (CUDTException& e)
         {
@@ -11922,6 +12560,10 @@ int CUDTGroup::sendBroadcast(const char* buf, int len, SRT_MSGCTRL& w_mc)
         sendstates.push_back(cstate);
     }
 
+    // The sender buffers keep their own references.
+    if (shared)
+        shared->release();
+
     if (curseq != -1)
     {
         HLOGC(dlog.Debug, log << "grp/sendBroadcast: updating current scheduling sequence %" << curseq);
@@ -12286,6 +12928,289 @@ int CUDTGroup::sendBroadcast(const char* buf, int len, SRT_MSGCTRL& w_mc)
     return rstat;
 }
 
+// The balancing group sends every payload over one link only, chosen
+// according to the capacity of the links. Every link keeps its own packet
+// sequence, as the packets have to be sent in order of the sequence numbers
+// on a link, and the group message number is used by the receiver to
+// restore the order.
+int CUDTGroup::sendBalancing(const char* buf, int len, SRT_MSGCTRL& w_mc)
+{
+    // Avoid stupid errors in the beginning.
+    if (len <= 0)
+    {
+        throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
+    }
+
+    // Live only - sorry.
+    if (len > SRT_LIVE_MAX_PLSIZE)
+    {
+        LOGC(dlog.Error, log << "grp/send(balancing): buffer size=" << len << " exceeds maximum allowed in live mode");
+        throw CUDTException(MJ_NOTSUP, MN_INVAL, 0);
+    }
+
+    vector<gli_t> wipeme;
+    vector<gli_t> pending;
+    vector<gli_t> candidates;
+    vector<gli_t> blocked;
+
+    CGuard guard (m_GroupLock);
+
+    for (gli_t d = m_Group.begin(); d != m_Group.end(); ++d)
+    {
+        if (d->sndstate == GST_BROKEN)
+        {
+            HLOGC(dlog.Debug, log << "grp/sendBalancing: socket in BROKEN state: @" << d->id << ", sockstatus=" << SockStatusStr(d->ps ? d->ps->getStatus() : SRTS_NONEXIST));
+            wipeme.push_back(d);
+            continue;
+        }
+
+        // Idle links are activated when selected for sending. They don't
+        // need any sequence synchronization with the others.
+        if (d->sndstate == GST_IDLE && !send_CheckIdle(d, (wipeme), (pending)))
+            continue;
+
+        if (d->sndstate == GST_IDLE || d->sndstate == GST_RUNNING)
+        {
+            d->sndresult = 0;
+            candidates.push_back(d);
+            continue;
+        }
+
+        HLOGC(dlog.Debug, log << "grp/sendBalancing: socket @" << d->id << " not ready, state: "
+                << StateStr(d->sndstate) << "(" << int(d->sndstate) << ") - NOT sending, SET AS PENDING");
+        pending.push_back(d);
+    }
+
+    // 1 is the first valid message number.
+    const int32_t msgno = m_iLastSchedMsgNo == -1 ? 1 : int32_t(++MsgNo(m_iLastSchedMsgNo));
+    int stat = -1;
+    int ercode = 0;
+    const steady_clock::time_point sndexptime = steady_clock::now() + milliseconds_from(m_iSndTimeOut);
+
+    for (;;)
+    {
+        // Try the links in order of selection until one takes the payload.
+        while (!candidates.empty())
+        {
+            const size_t sel = sendBalancing_SelectLink(candidates);
+            gli_t d = candidates[sel];
+            candidates.erase(candidates.begin() + sel);
+
+            int erc = 0;
+            w_mc.msgno = msgno;
+            w_mc.pktseq = -1; // use the sequence of the link
+            try
+            {
+                // Lift the group lock for a while, to avoid possible deadlocks.
+                InvertedLock ug (m_GroupLock);
+                stat = d->ps->core().sendmsg2(buf, len, (w_mc));
+            }
+            catch (CUDTException& e)
+            {
+                stat = -1;
+                erc = e.getErrorCode();
+            }
+
+            d->sndresult = stat;
+            d->laststatus = d->ps->getStatus();
+
+            if (stat != -1)
+            {
+                HLOGC(dlog.Debug, log << "grp/sendBalancing: @" << d->id << " sent #" << msgno << " %" << w_mc.pktseq
+                        << (d->sndstate == GST_IDLE ? " - MEMBER STATUS: RUNNING" : ""));
+                d->sndstate = GST_RUNNING;
+                break;
+            }
+
+            if (erc == SRT_EASYNCSND)
+            {
+                HLOGC(dlog.Debug, log << "grp/sendBalancing: @" << d->id << " blocked, trying another link");
+                blocked.push_back(d);
+                continue;
+            }
+
+            HLOGC(dlog.Debug, log << "grp/sendBalancing: @" << d->id << " FAILED (code " << erc << "), setting broken");
+            d->sndstate = GST_BROKEN;
+            ercode = erc;
+        }
+
+        if (stat != -1 || blocked.empty())
+            break;
+
+        // Every link that could take the payload is blocked.
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_OUT, false);
+        if (!m_bSynSending)
+        {
+            throw CUDTException(MJ_AGAIN, MN_WRAVAIL, 0);
+        }
+
+        int modes = SRT_EPOLL_OUT | SRT_EPOLL_ERR;
+        for (vector<gli_t>::iterator b = blocked.begin(); b != blocked.end(); ++b)
+            m_pGlobal->m_EPoll.update_usock(m_SndEID, (*b)->id, &modes);
+
+        // m_iSndTimeOut is -1 by default, which matches the meaning of waiting forever.
+        int64_t timeout_ms = -1;
+        if (m_iSndTimeOut >= 0)
+            timeout_ms = std::max<int64_t>(count_milliseconds(sndexptime - steady_clock::now()), 0);
+
+        CEPoll::fmap_t sready;
+        int nready;
+        {
+            // Lift the group lock for a while, to avoid possible deadlocks.
+            InvertedLock ug (m_GroupLock);
+            HLOGC(dlog.Debug, log << "grp/sendBalancing: blocking on any of blocked sockets to allow sending");
+            nready = m_pGlobal->m_EPoll.swait(*m_SndEpolld, sready, timeout_ms, false);
+        }
+
+        if (nready <= 0)
+        {
+            for (vector<gli_t>::iterator b = blocked.begin(); b != blocked.end(); ++b)
+                m_pGlobal->m_EPoll.remove_usock(m_SndEID, (*b)->id);
+            throw CUDTException(MJ_AGAIN, MN_XMTIMEOUT, 0);
+        }
+
+        // Retry all the links that didn't fail. The readiness might have
+        // been also reported for a pending socket subscribed there.
+        for (vector<gli_t>::iterator b = blocked.begin(); b != blocked.end(); ++b)
+        {
+            gli_t d = *b;
+            m_pGlobal->m_EPoll.remove_usock(m_SndEID, d->id);
+            if (CEPoll::ready(sready, d->id) & SRT_EPOLL_ERR)
+                d->sndstate = GST_BROKEN;
+            else
+                candidates.push_back(d);
+        }
+        blocked.clear();
+    }
+
+    send_CheckPendingSockets(pending, (wipeme));
+    send_CloseBrokenSockets((wipeme));
+
+    if (stat == -1)
+    {
+        HLOGC(dlog.Debug, log << "grp/sendBalancing: all links broken (none succeeded to send a payload)");
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_OUT, false);
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_ERR, true);
+        CodeMajor major = CodeMajor(ercode ? ercode/1000 : MJ_CONNECTION);
+        CodeMinor minor = CodeMinor(ercode ? ercode%1000 : MN_CONNLOST);
+        throw CUDTException(major, minor, 0);
+    }
+
+    m_iLastSchedMsgNo = msgno;
+
+    // Now fill in the socket table. Check if the size is enough, if not,
+    // then set the pointer to NULL and set the correct size.
+    size_t grpsize = m_Group.size();
+
+    if (w_mc.grpdata_size < grpsize)
+    {
+        w_mc.grpdata = NULL;
+    }
+
+    size_t i = 0;
+
+    bool ready_again = false;
+    for (gli_t d = m_Group.begin(); d != m_Group.end(); ++d, ++i)
+    {
+        if (w_mc.grpdata)
+        {
+            // Enough space to fill
+            w_mc.grpdata[i].id = d->id;
+            w_mc.grpdata[i].status = d->laststatus;
+
+            if (d->sndstate == GST_RUNNING)
+                w_mc.grpdata[i].result = d->sndresult; // 0, if the payload went over another link
+            else if (d->sndstate == GST_IDLE)
+                w_mc.grpdata[i].result = 0;
+            else
+                w_mc.grpdata[i].result = -1;
+
+            memcpy((&w_mc.grpdata[i].peeraddr), &d->peer, d->peer.size());
+        }
+
+        ready_again = ready_again | d->ps->writeReady();
+    }
+    w_mc.grpdata_size = i;
+
+    if (!ready_again)
+    {
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_OUT, false);
+    }
+
+    return stat;
+}
+
+// Returns the rate in packets per second at which the link can still deliver
+// the packets on time, and the expected delay of a packet sent over it now.
+double CUDTGroup::sendBalancing_LinkWeight(const CUDT& u, double& w_delay_us) const
+{
+    // The capacity of the link is the bandwidth estimated by the receiver
+    // (1 until measured), limited by the pacing of the congestion control.
+    double rate = 0;
+    const int64_t period_us = count_microseconds(u.m_tdSendInterval);
+    if (period_us > 0)
+        rate = 1000000.0 / period_us;
+    if (u.bandwidth() > 1 && (rate == 0 || u.bandwidth() < rate))
+        rate = u.bandwidth();
+    if (rate < 1)
+        rate = 1;
+
+    // The packet is sent after those scheduled and not yet sent
+    // over this link and then it needs half of the RTT to arrive.
+    const int unsent = std::max(CSeqNo::seqoff(u.m_iSndCurrSeqNo, u.m_iSndNextSeqNo) - 1, 0);
+    w_delay_us = u.RTT() / 2.0 + (unsent + 1) * 1000000.0 / rate;
+
+    // The packets that arrive after the latency are dropped, so the part
+    // of the latency used by the delay is no longer usable capacity.
+    const double budget_us = u.m_bPeerTsbPd ? u.m_iPeerTsbPdDelay_ms * 1000.0 : 1000000.0;
+    if (w_delay_us >= budget_us)
+        return 0;
+
+    return rate * (1 - w_delay_us / budget_us);
+}
+
+// Smooth weighted round-robin: every link earns its weight as a credit
+// and the one with the highest credit pays for the packet with the sum of
+// all weights, so the links get the packets in proportion of their weights,
+// evenly spread. If no link can deliver on time, the least delayed one is used.
+size_t CUDTGroup::sendBalancing_SelectLink(const vector<gli_t>& candidates)
+{
+    double total = 0;
+    int best = -1;
+    size_t fastest = 0;
+    double fastest_delay = 0;
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        gli_t d = candidates[i];
+        double delay_us;
+        const double weight = sendBalancing_LinkWeight(d->ps->core(), (delay_us));
+        if (i == 0 || delay_us < fastest_delay)
+        {
+            fastest = i;
+            fastest_delay = delay_us;
+        }
+
+        if (weight <= 0)
+            continue;
+
+        d->sndcredit += weight;
+        total += weight;
+        if (best == -1 || d->sndcredit > candidates[best]->sndcredit)
+            best = i;
+    }
+
+    if (best == -1)
+    {
+        HLOGC(dlog.Debug, log << "grp/sendBalancing: no link delivers in time, selecting @"
+                << candidates[fastest]->id << " with delay " << fastest_delay << "us");
+        return fastest;
+    }
+
+    candidates[best]->sndcredit -= total;
+    return best;
+}
+
 int CUDTGroup::getGroupData(SRT_SOCKGROUPDATA* pdata, size_t* psize)
 {
     CGuard gl (m_GroupLock);
@@ -12402,732 +13327,510 @@ void CUDTGroup::fillGroupData(
     w_out.grpdata = st == 0 ? out_grpdata : NULL;
 }
 
-struct FLookupSocketWithEvent
-{
-    CUDTUnited* glob;
-    int evtype;
-    FLookupSocketWithEvent(CUDTUnited* g, int event_type): glob(g), evtype(event_type) {}
-
-    typedef CUDTSocket* result_type;
-
-    pair<CUDTSocket*, bool> operator()(const pair<SRTSOCKET, int>& es)
-    {
-        CUDTSocket* so = NULL;
-        if ( (es.second & evtype) == 0)
-            return make_pair(so, false);
-
-        so = glob->locateSocket(es.first, glob->ERH_RETURN);
-        return make_pair(so, !!so);
-    }
-};
-
-void CUDTGroup::updateReadState(SRTSOCKET /* not sure if needed */, int32_t sequence)
-{
-    bool ready = false;
-    CGuard lg (m_GroupLock);
-    int seqdiff = 0;
-
-    if (m_RcvBaseSeqNo == -1)
-    {
-        // One socket reported readiness, while no reading operation
-        // has ever been done. Whatever the sequence number is, it will
-        // be taken as a good deal and reading will be accepted.
-        ready = true;
-    }
-    else if ((seqdiff = CSeqNo::seqcmp(sequence, m_RcvBaseSeqNo)) > 0)
-    {
-        // Case diff == 1: The very next. Surely read-ready.
-
-        // Case diff > 1:
-        // We have an ahead packet. There's one strict condition in which
-        // we may believe it needs to be delivered - when KANGAROO->HORSE
-        // transition is allowed. Stating that the time calculation is done
-        // exactly the same way on every link in the redundancy group, when
-        // it came to a situation that a packet from one link is ready for
-        // extraction while it has jumped over some packet, it has surely
-        // happened due to TLPKTDROP, and if it happened on at least one link,
-        // we surely don't have this packet ready on any other link.
-
-        // This might prove not exactly true, especially when at the moment
-        // when this happens another link may surprisinly receive this lacking
-        // packet, so the situation gets suddenly repaired after this function
-        // is called, the only result of it would be that it will really get
-        // the very next sequence, even though this function doesn't know it
-        // yet, but surely in both cases the situation is the same: the medium
-        // is ready for reading, no matter what packet will turn out to be
-        // returned when reading is done.
-
-        ready = true;
-    }
-
-    // When the sequence number is behind the current one,
-    // stating that the readines wasn't checked otherwise, the reading
-    // function will not retrieve anything ready to read just by this premise.
-    // Even though this packet would have to be eventually extracted (and discarded).
-
-    if (ready)
-    {
-         m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, true);
-    }
-}
-
 void CUDTGroup::updateWriteState()
 {
     CGuard lg (m_GroupLock);
     m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_OUT, true);
 }
 
-// The "app reader" version of the reading function.
-// This reads the packets from every socket treating them as independent
-// and prepared to work with the application. Then packets are sorted out
-// by getting the sequence number.
-int CUDTGroup::recv(char* buf, int len, SRT_MSGCTRL& w_mc)
+int CUDTGroup::readyPackets(CUDT* core)
 {
-    typedef map<SRTSOCKET, ReadPos>::iterator pit_t;
-    // Later iteration over it might be less efficient than
-    // by vector, but we'll also often try to check a single id
-    // if it was ever seen broken, so that it's skipped.
-    set<CUDTSocket*> broken;
-
-    // Remember them now because they will be overwritten.
-    SRT_SOCKGROUPDATA* out_grpdata = (w_mc.grpdata);
-    size_t out_grpdata_size = w_mc.grpdata_size;
-
-    size_t output_size = 0;
-
-RETRY_READING:
-
-    {
-        if (!m_bOpened || !m_bConnected)
-        {
-            LOGC(dlog.Error, log << boolalpha << "group/recv: ERROR opened=" << m_bOpened << " connected=" << m_bConnected);
-            throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
-        }
-    }
-
-    // Check first the ahead packets if you have any to deliver.
-    if (m_RcvBaseSeqNo != -1 && !m_Positions.empty())
-    {
-        // This function also updates the group sequence pointer.
-        ReadPos* pos = checkPacketAhead();
-        if (pos)
-        {
-            if (size_t(len) < pos->packet.size())
-                throw CUDTException(MJ_NOTSUP, MN_XSIZE, 0);
-
-            HLOGC(dlog.Debug, log << "group/recv: delivering AHEAD packet %" << pos->mctrl.pktseq << " #" << pos->mctrl.msgno
-                    << ": " << BufferStamp(&pos->packet[0], pos->packet.size()));
-            memcpy(buf, &pos->packet[0], pos->packet.size());
-            fillGroupData((w_mc), pos->mctrl, (out_grpdata), out_grpdata_size);
-            len = pos->packet.size();
-            pos->packet.clear();
-
-            // We predict to have only one packet ahead, others are pending to be reported by tsbpd.
-            // This will be "re-enabled" if the later check puts any new packet into ahead.
-            m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, false);
-
-            return len;
-        }
-    }
-
-    // LINK QUALIFICATION NAMES:
-    //
-    // HORSE: Correct link, which delivers the very next sequence.
-    // Not necessarily this link is currently active.
-    //
-    // KANGAROO: Got some packets dropped and the sequence number
-    // of the packet jumps over the very next sequence and delivers
-    // an ahead packet.
-    //
-    // ELEPHANT: Is not ready to read, while others are, or reading
-    // up to the current latest delivery sequence number does not
-    // reach this sequence and the link becomes non-readable earlier.
-
-    // The above condition has ruled out one kangaroo and turned it
-    // into a horse.
-
-    // Below there's a loop that will try to extract packets. Kangaroos
-    // will be among the polled ones because skipping them risks that
-    // the elephants will take over the reading. Links already known as
-    // elephants will be also polled in an attempt to revitalize the
-    // connection that experienced just a short living choking.
-    //
-    // After polling we attempt to read from every link that reported
-    // read-readiness and read at most up to the sequence equal to the
-    // current delivery sequence.
-
-    // Links that deliver a packet below that sequence will be retried
-    // until they deliver no more packets or deliver the packet of
-    // expected sequence. Links that don't have a record in m_Positions
-    // and report readiness will be always read, at least to know what
-    // sequence they currently stand on.
-    //
-    // Links that are already known as kangaroos will be polled, but
-    // no reading attempt will be done. If after the reading series
-    // it will turn out that we have no more horses, the slowest kangaroo
-    // will be "upgraded to a horse" (the ahead link with a sequence
-    // closest to the current delivery sequence will get its sequence
-    // set as current delivered and its recorded ahead packet returned
-    // as the read packet).
-
-    // If we find at least one horse, the packet read from that link
-    // will be delivered. All other link will be just ensured update
-    // up to this sequence number, or at worst all available packets
-    // will be read. In this case all kangaroos remain kangaroos,
-    // until the current delivery sequence m_RcvBaseSeqNo will be lifted
-    // to the sequence recorded for these links in m_Positions,
-    // during the next time ahead check, after which they will become
-    // horses.
-
-#if ENABLE_HEAVY_LOGGING
-    std::ostringstream ds;
-    ds << "E(" << m_RcvEID << ") ";
-#define HCLOG(expr) expr
-#else
-#define HCLOG(x) if (false) {}
-#endif
-
-    bool still_alive = false;
-    size_t size = 0;
+    // [[using locked(core->m_RecvLock)]];
 
-    // You can't lock the whole group for that
-    // action because this will result in a deadlock.
-    // Prepare first the list of sockets to be added as connect-pending
-    // and as read-ready, then unlock the group, and then add them to epoll.
-    vector<SRTSOCKET> read_ready, connect_pending;
+    int nread = 0;
+    CGuard lk (m_RcvDataLock);
 
+    for (;;)
     {
-        HLOGC(dlog.Debug, log << "group/recv: Reviewing member sockets to epoll-add (locking)");
-        CGuard glock (m_GroupLock);
-        for (gli_t gi = m_Group.begin(); gi != m_Group.end(); ++gi)
+        char* data = rcvAllocBuffer();
+        SRT_MSGCTRL mctrl = srt_msgctrl_default;
+        steady_clock::time_point arrival_time;
+        const int size = core->m_pRcvBuffer->readMsg(data, SRT_LIVE_MAX_PLSIZE, (mctrl), -1, (arrival_time));
+        if (size <= 0)
         {
-            ++size; // list::size loops over all elements anyway, so this hits two birds with one stone
-            if (gi->laststatus == SRTS_CONNECTING)
-            {
-                HCLOG(ds << "@" << gi->id << "<pending> ");
-                /*
-                connect_pending.push_back(gi->id);
-                */
-
-                continue; // don't read over a failed or pending socket
-            }
-
-            if (gi->laststatus >= SRTS_BROKEN)
-            {
-                broken.insert(gi->ps);
-            }
+            m_RcvFreeBuffers.push_back(data);
+            break;
+        }
 
-            if (broken.count(gi->ps))
-            {
-                HCLOG(ds << "@" << gi->id << "<broken> ");
-                continue;
-            }
+        ++nread;
+        if (core->m_bTsbPd)
+            core->m_stats.histRcvBuffer.add(count_microseconds(steady_clock::now() - arrival_time));
 
-            if (gi->laststatus != SRTS_CONNECTED)
-            {
-                HCLOG(ds << "@" << gi->id << "<unstable:" << SockStatusStr(gi->laststatus) << "> ");
-                // Sockets in this state are ignored. We are waiting until it
-                // achieves CONNECTING state, then it's added to write.
-                // Or gets broken and closed in the next step.
-                continue;
-            }
+        rcvStore(data, size, mctrl, core->m_SocketID);
+    }
 
-            still_alive = true;
+    if (nread > 0)
+        rcvUpdateReadable();
 
-            // Don't skip packets that are ahead because if we have a situation
-            // that all links are either "elephants" (do not report read readiness)
-            // and "kangaroos" (have already delivered an ahead packet) then
-            // omiting kangaroos will result in only elephants to be polled for
-            // reading. Due to the strict timing requirements and ensurance that
-            // TSBPD on every link will result in exactly the same delivery time
-            // for a packet of given sequence, having an elephant and kangaroo in
-            // one cage means that the elephant is simply a broken or half-broken
-            // link (the data are not delivered, but it will get repaired soon,
-            // enough for SRT to maintain the connection, but it will still drop
-            // packets that didn't arrive in time), in both cases it may
-            // potentially block the reading for an indefinite time, while
-            // simultaneously a kangaroo might be a link that got some packets
-            // dropped, but then it's still capable to deliver packets on time.
+    return nread;
+}
 
-            // Note that gi->id might be a socket that was previously being polled
-            // on write, when it's attempting to connect, but now it's connected.
-            // This will update the socket with the new event set.
+bool CUDTGroup::rcvPut(const char* data, int size, const SRT_MSGCTRL& mctrl)
+{
+    if (size > SRT_LIVE_MAX_PLSIZE)
+        return false;
 
-            read_ready.push_back(gi->id);
-            HCLOG(ds << "@" << gi->id << "[READ] ");
-        }
-    }
+    CGuard lk (m_RcvDataLock);
 
-    int read_modes = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+    char* copy = rcvAllocBuffer();
+    memcpy(copy, data, size);
 
-    /* Done at the connecting stage so that it won't be missed.
+    if (!rcvStore(copy, size, mctrl, SRT_INVALID_SOCK))
+        return false;
 
-    int connect_modes = SRT_EPOLL_OUT | SRT_EPOLL_ERR;
-    for (vector<SRTSOCKET>::iterator i = connect_pending.begin(); i != connect_pending.end(); ++i)
-    {
-        srt_epoll_add_usock(m_RcvEID, *i, &connect_modes);
-    }
+    rcvUpdateReadable();
+    return true;
+}
 
-    AND this below additionally for sockets that were so far pending connection,
-    will be now "upgraded" to readable sockets. The epoll adding function for a
-    socket that already is in the eid container will only change the poll flags,
-    but will not re-add it, that is, event reports that are both in old and new
-    flags will survive the operation.
+void CUDTGroup::rcvHandOver(CUDT* core)
+{
+    if (!core->m_bOPT_GroupSharedRcv || !core->m_bTsbPd || !core->m_pRcvBuffer)
+        return;
 
-    */
+    // The order of locks is the same as in processData() with rcvClaim().
+    CGuard bufferlock (core->m_RcvBufferLock);
+    CGuard lk (m_RcvDataLock);
 
-    for (vector<SRTSOCKET>::iterator i = read_ready.begin(); i != read_ready.end(); ++i)
+    int nstored = 0;
+    const int span = core->m_pRcvBuffer->getStoredSpan();
+    for (int off = 0; off < span; ++off)
     {
-        srt_epoll_add_usock(m_RcvEID, *i, &read_modes);
-    }
-
-    HLOGC(dlog.Debug, log << "group/recv: " << ds.str() << " --> EPOLL/SWAIT");
-#undef HCLOG
+        char* data = rcvAllocBuffer();
+        SRT_MSGCTRL mctrl = srt_msgctrl_default;
+        steady_clock::time_point play_time;
+        const int size = core->m_pRcvBuffer->peekMsg(off, data, SRT_LIVE_MAX_PLSIZE, (mctrl), (play_time));
+        if (size <= 0)
+        {
+            m_RcvFreeBuffers.push_back(data);
+            continue;
+        }
 
-    if (!still_alive)
-    {
-        LOGC(dlog.Error, log << "group/recv: all links broken");
-        throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
+        if (rcvStore(data, size, mctrl, core->m_SocketID, play_time))
+            ++nstored;
     }
 
-    // Here we need to make an additional check.
-    // There might be a possibility that all sockets that
-    // were added to the reader group, are ahead. At least
-    // surely we don't have a situation that any link contains
-    // an ahead-read subsequent packet, because GroupCheckPacketAhead
-    // already handled that case.
-    //
-    // What we can have is that every link has:
-    // - no known seq position yet (is not registered in the position map yet)
-    // - the position equal to the latest delivered sequence
-    // - the ahead position
-
-    // Now the situation is that we don't have any packets
-    // waiting for delivery so we need to wait for any to report one.
-
-    // XXX We support blocking mode only at the moment.
-    // The non-blocking mode would need to simply check the readiness
-    // with only immediate report, and read-readiness would have to
-    // be done in background.
+    HLOGC(dlog.Debug, log << "group/recv: @" << core->m_SocketID << " handed over " << nstored << " packets");
+    if (nstored > 0)
+        rcvUpdateReadable();
+}
 
-    // Poll on this descriptor until reading is available, indefinitely.
-    CEPoll::fmap_t sready;
+char* CUDTGroup::rcvAllocBuffer()
+{
+    // [[using locked(m_RcvDataLock)]];
+    if (m_RcvFreeBuffers.empty())
+        return new char[SRT_LIVE_MAX_PLSIZE];
 
-    // In blocking mode, use m_iRcvTimeOut, which's default value -1
-    // means to block indefinitely, also in swait().
-    // In non-blocking mode use 0, which means to always return immediately.
-    int timeout = m_bSynRecving ? m_iRcvTimeOut : 0;
-    int nready = m_pGlobal->m_EPoll.swait(*m_RcvEpolld, sready, timeout, false /*report by retval*/);
+    char* data = m_RcvFreeBuffers.back();
+    m_RcvFreeBuffers.pop_back();
+    return data;
+}
 
-    HLOGC(dlog.Debug, log << "group/recv: RDY: " << DisplayEpollResults(sready));
+void CUDTGroup::rcvCheckReadable()
+{
+    CGuard lk (m_RcvDataLock);
+    if (m_bRcvReadable || m_iRcvPackets == 0)
+        return;
 
-    if (nready == 0)
+    steady_clock::time_point ready_time;
+    if (rcvReady((ready_time)))
     {
-        // This can only happen when 0 is passed as timeout and none is ready.
-        // And 0 is passed only in non-blocking mode. So this is none ready in
-        // non-blocking mode.
-        throw CUDTException(MJ_AGAIN, MN_RDAVAIL, 0);
+        m_bRcvReadable = true;
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, true);
     }
+}
 
-    // Handle sockets of pending connection and with errors.
-
-    // Nice to have something like:
-
-    // broken = FilterIf(sready, [] (auto s)
-    //                   { return s.second == SRT_EPOLL_ERR && (auto cs = g->locateSocket(s.first, ERH_RETURN))
-    //                          ? {cs, true}
-    //                          : {nullptr, false}
-    //                   });
+int CUDTGroup::rcvTryExtract(char* buf, int len, SRT_MSGCTRL& w_mctrl)
+{
+    CGuard lk (m_RcvDataLock);
+    steady_clock::time_point ready_time;
+    if (!rcvReady((ready_time)))
+        return 0;
+    return rcvExtract(buf, len, (w_mctrl));
+}
 
-    FilterIf(
-            /*FROM*/ sready.begin(), sready.end(),
-            /*TO*/ std::inserter(broken, broken.begin()),
-            /*VIA*/ FLookupSocketWithEvent(m_pGlobal, SRT_EPOLL_ERR));
+// Puts the packet at the position of its key, taking over the data buffer.
+bool CUDTGroup::rcvStore(char* data, int size, const SRT_MSGCTRL& mctrl, SRTSOCKET member SRT_ATR_UNUSED,
+        const steady_clock::time_point& play_time)
+{
+    // [[using locked(m_RcvDataLock)]];
 
-    // Ok, now we need to have some extra qualifications:
-    // 1. If a socket has no registry yet, we read anyway, just
-    // to notify the current position. We read ONLY ONE PACKET this time,
-    // we'll worry later about adjusting it to the current group sequence
-    // position.
-    // 2. If a socket is already position ahead, DO NOT read from it, even
-    // if it is ready.
+    // The first packet ever received defines the delivery sequence.
+    const int32_t key = rcvKey(mctrl);
+    if (m_RcvBaseSeqNo == -1)
+    {
+        m_RcvBaseSeqNo = rcvShiftKey(key, -1);
+        m_tsRcvFirstArrival = steady_clock::now();
 
-    // The state of things whether we were able to extract the very next
-    // sequence will be simply defined by the fact that `output` is nonempty.
+        // In the shared receiving mode the preceding packets may have
+        // been stored by other members, which deliver them a bit later.
+        if (m_RcvFirstClaim != -1 && CSeqNo::seqcmp(m_RcvFirstClaim, key) < 0)
+            m_RcvBaseSeqNo = CSeqNo::decseq(m_RcvFirstClaim);
+    }
 
-    int32_t next_seq = m_RcvBaseSeqNo;
+    int seqdiff = rcvKeyDiff(key, m_RcvBaseSeqNo);
 
-    // If this set is empty, it won't roll even once, therefore output
-    // will be surely empty. This will be checked then same way as when
-    // reading from every socket resulted in error.
+    // In the balancing group the packets preceding the first one may come
+    // a bit later over the other links. Until the first delivery (see
+    // rcvReady()) the base is moved back for them.
+    if (seqdiff <= 0 && m_type == SRT_GTYPE_BALANCING && !is_zero(m_tsRcvFirstArrival)
+            && -seqdiff < GRP_RCV_SLOTS / 2)
+    {
+        m_RcvBaseSeqNo = rcvShiftKey(key, -1);
+        seqdiff = 1;
+    }
 
-    for (CEPoll::fmap_t::const_iterator i = sready.begin(); i != sready.end(); ++i)
+    if (seqdiff <= 0)
     {
-        if (i->second & SRT_EPOLL_ERR)
-            continue; // broken already
+        HLOGC(dlog.Debug, log << "group/recv: @" << member << " %" << mctrl.pktseq << " #" << mctrl.msgno
+                << " BEHIND, base=" << m_RcvBaseSeqNo << " - discarding");
+        m_RcvFreeBuffers.push_back(data);
+        return false;
+    }
 
-        if ((i->second & SRT_EPOLL_IN) == 0)
-            continue; // not ready for reading
+    if (seqdiff > CSeqNo::m_iSeqNoTH)
+    {
+        LOGC(dlog.Error, log << "group/recv: @" << member << ": SEQUENCE DISCREPANCY: base=%"
+                << m_RcvBaseSeqNo << " vs pkt=%" << mctrl.pktseq << " - discarding");
+        m_RcvFreeBuffers.push_back(data);
+        return false;
+    }
 
-        // Check if this socket is in aheads
-        // If so, don't read from it, wait until the ahead is flushed.
-        SRTSOCKET id = i->first;
-        CUDTSocket* ps = m_pGlobal->locateSocket(id); // exception would interrupt it (SANITY)
-        ReadPos* p = NULL;
-        pit_t pe = m_Positions.find(id);
-        if (pe != m_Positions.end())
+    // The message numbers skip 0 when wrapping, so the positions
+    // may collide at the distance of GRP_RCV_SLOTS.
+    if (seqdiff >= GRP_RCV_SLOTS)
+    {
+        // The application doesn't read fast enough. Drop the oldest
+        // packets, as the members would do with the late ones.
+        const int32_t newbase = rcvShiftKey(key, -(GRP_RCV_SLOTS - 1));
+        LOGC(dlog.Warn, log << "group/recv: buffer full, dropping packets up to " << newbase);
+        if (seqdiff >= 2 * GRP_RCV_SLOTS)
         {
-            p = &pe->second;
-
-            // Possible results of comparison:
-            // x < 0: the sequence is in the past, the socket should be adjusted FIRST
-            // x = 0: the socket should be ready to get the exactly next packet
-            // x = 1: the case is already handled by GroupCheckPacketAhead.
-            // x > 1: AHEAD. DO NOT READ.
-            int seqdiff = CSeqNo::seqcmp(p->mctrl.pktseq, m_RcvBaseSeqNo);
-            if (seqdiff > 1)
-            {
-                HLOGC(dlog.Debug, log << "group/recv: EPOLL: @" << id << " %" << p->mctrl.pktseq
-						<< " AHEAD %" << m_RcvBaseSeqNo << ", not reading.");
-                continue;
-            }
+            rcvClear();
         }
         else
         {
-            // The position is not known, so get the position on which
-            // the socket is currently standing.
-            pair<pit_t, bool> ee = m_Positions.insert(make_pair(id, ReadPos(ps->core().m_iRcvLastSkipAck)));
-            p = &(ee.first->second);
-            HLOGC(dlog.Debug, log << "group/recv: EPOLL: @" << id << " %" << p->mctrl.pktseq << " NEW SOCKET INSERTED");
+            const int32_t end = rcvShiftKey(newbase, 1);
+            for (int32_t k = rcvShiftKey(m_RcvBaseSeqNo, 1); k != end; k = rcvShiftKey(k, 1))
+            {
+                RcvSlot& old = rcvSlot(k);
+                if (old.data)
+                {
+                    m_RcvFreeBuffers.push_back(old.data);
+                    old.data = NULL;
+                    --m_iRcvPackets;
+                }
+            }
         }
+        m_RcvBaseSeqNo = newbase;
+    }
 
-        // Read from this socket stubbornly, until:
-        // - reading is no longer possible (AGAIN)
-        // - the sequence difference is >= 1
+    // Checked only now, as beyond the buffer size the slot may be still
+    // taken by an old packet, dropped above.
+    RcvSlot& slot = rcvSlot(key);
+    if (slot.data)
+    {
+        HLOGC(dlog.Debug, log << "group/recv: @" << member << " %" << mctrl.pktseq << " #" << mctrl.msgno
+                << " ALREADY RECEIVED - discarding");
+        m_RcvFreeBuffers.push_back(data);
+        return false;
+    }
 
-        for (;;)
-        {
-            SRT_MSGCTRL mctrl = srt_msgctrl_default;
+    slot.data = data;
+    slot.size = size;
+    slot.mctrl = mctrl;
+    slot.arrival = steady_clock::now();
+    slot.play_time = play_time;
+    ++m_iRcvPackets;
+    return true;
+}
 
-            // Read the data into the user's buffer. This is an optimistic
-            // prediction that we'll read the right data. This will be overwritten
-            // by "more correct data" if found more appropriate later. But we have to
-            // copy these data anyway anywhere, even if they need to fall on the floor later.
-            int stat;
-            if (output_size)
-            {
-                // We have already the data, so this must fall on the floor
-                char lostbuf[SRT_LIVE_MAX_PLSIZE];
-                stat = ps->core().receiveMessage((lostbuf), SRT_LIVE_MAX_PLSIZE, (mctrl), CUDTUnited::ERH_RETURN);
-                HLOGC(dlog.Debug, log << "group/recv: @" << id << " IGNORED data with %" << mctrl.pktseq << " #" << mctrl.msgno
-                        << ": " << (stat <= 0 ? "(NOTHING)" : BufferStamp(lostbuf, stat)));
-            }
-            else
-            {
-                stat = ps->core().receiveMessage((buf), len, (mctrl), CUDTUnited::ERH_RETURN);
-                HLOGC(dlog.Debug, log << "group/recv: @" << id << " EXTRACTED data with %" << mctrl.pktseq << " #" << mctrl.msgno
-                        << ": " << (stat <= 0 ? "(NOTHING)" : BufferStamp(buf, stat)));
-            }
-            if (stat == 0)
-            {
-                HLOGC(dlog.Debug, log << "group/recv: SPURIOUS epoll, ignoring");
-                // This is returned in case of "again". In case of errors, we have SRT_ERROR.
-                // Do not treat this as spurious, just stop reading.
-                break;
-            }
+// Called after new packets were stored.
+void CUDTGroup::rcvUpdateReadable()
+{
+    // [[using locked(m_RcvDataLock)]];
+    if (m_bRcvReadable)
+        return;
 
-            if (stat == SRT_ERROR)
-            {
-                HLOGC(dlog.Debug, log << "group/recv: @" << id << ": " << srt_getlasterror_str());
-                broken.insert(ps);
-                break;
-            }
+    // Wake up the reader also if the packets have to wait for
+    // the preceding ones, so that it knows how long to wait.
+    m_RcvDataCond.notify_one();
 
-            // NOTE: checks against m_RcvBaseSeqNo and decisions based on it
-            // must NOT be done if m_RcvBaseSeqNo is -1, which means that we
-            // are about to deliver the very first packet and we take its
-            // sequence number as a good deal.
-
-            // The order must be:
-            // - check discrepancy
-            // - record the sequence
-            // - check ordering.
-            // The second one must be done always, but failed discrepancy
-            // check should exclude the socket from any further checks.
-            // That's why the common check for m_RcvBaseSeqNo != -1 can't
-            // embrace everything below.
-
-            // We need to first qualify the sequence, just for a case
-            if (m_RcvBaseSeqNo != -1 && abs(m_RcvBaseSeqNo - mctrl.pktseq) > CSeqNo::m_iSeqNoTH)
-            {
-                // This error should be returned if the link turns out
-                // to be the only one, or set to the group data.
-                // err = SRT_ESECFAIL;
-                LOGC(dlog.Error, log << "group/recv: @" << id << ": SEQUENCE DISCREPANCY: base=%"
-						<< m_RcvBaseSeqNo << " vs pkt=%" << mctrl.pktseq << ", setting ESECFAIL");
-                broken.insert(ps);
-                break;
-            }
+    steady_clock::time_point ready_time;
+    if (rcvReady((ready_time)))
+    {
+        m_bRcvReadable = true;
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, true);
+    }
+}
 
-            // Rewrite it to the state for a case when next reading
-            // would not succeed. Do not insert the buffer here because
-            // this is only required when the sequence is ahead; for that
-            // it will be fixed later.
-            p->mctrl.pktseq = mctrl.pktseq;
+bool CUDTGroup::rcvClaim(int32_t seqno)
+{
+    CGuard lk (m_RcvDataLock);
 
-            if (m_RcvBaseSeqNo != -1)
-            {
-                // Now we can safely check it.
-                int seqdiff = CSeqNo::seqcmp(mctrl.pktseq, m_RcvBaseSeqNo);
+    // Delivered already, or dropped on every link.
+    if (m_RcvBaseSeqNo != -1 && CSeqNo::seqcmp(seqno, m_RcvBaseSeqNo) <= 0)
+        return false;
 
-                if (seqdiff <= 0)
-                {
-                    HLOGC(dlog.Debug, log << "group/recv: @" << id << " %" << mctrl.pktseq << " #" << mctrl.msgno
-							<< " BEHIND base=%" << m_RcvBaseSeqNo << " - discarding");
-                    // The sequence is recorded, the packet has to be discarded.
-                    // That's all.
-                    continue;
-                }
+    if (m_RcvClaims.empty())
+        m_RcvClaims.resize(GRP_RCV_CLAIMS, -1);
 
-                // Now we have only two possibilities:
-                // seqdiff == 1: The very next sequence, we want to read and return the packet.
-                // seqdiff > 1: The packet is ahead - record the ahead packet, but continue with the others.
+    int32_t& claim = m_RcvClaims[seqno & (GRP_RCV_CLAIMS - 1)];
+    if (claim == seqno)
+    {
+        HLOGC(dlog.Debug, log << "group/recv: %" << seqno << " already stored by a member - dropping");
+        return false;
+    }
 
-                if (seqdiff > 1)
-                {
-                    HLOGC(dlog.Debug, log << "@" << id << " %" << mctrl.pktseq << " #" << mctrl.msgno
-							<< " AHEAD base=%" << m_RcvBaseSeqNo);
-                    p->packet.assign(buf, buf+stat);
-                    p->mctrl = mctrl;
-                    break; // Don't read from that socket anymore.
-                }
-            }
+    // The position is still taken by a packet not yet delivered, which
+    // may happen only with a receiver buffer larger than GRP_RCV_CLAIMS.
+    // Store this one without a claim then; the group drops the duplicates
+    // when they are ready.
+    if (claim != -1 && m_RcvBaseSeqNo != -1 && CSeqNo::seqcmp(claim, m_RcvBaseSeqNo) > 0)
+        return true;
 
-            // We have seqdiff = 1, or we simply have the very first packet
-            // which's sequence is taken as a good deal. Update the sequence
-            // and record output.
+    claim = seqno;
+    if (m_RcvBaseSeqNo == -1 && (m_RcvFirstClaim == -1 || CSeqNo::seqcmp(seqno, m_RcvFirstClaim) < 0))
+        m_RcvFirstClaim = seqno;
+    return true;
+}
 
-            if (output_size)
-            {
-                HLOGC(dlog.Debug, log << "group/recv: @" << id << " %" << mctrl.pktseq << " #" << mctrl.msgno << " REDUNDANT");
-                break;
-            }
+void CUDTGroup::rcvUnclaim(int32_t seqno)
+{
+    CGuard lk (m_RcvDataLock);
+    if (!rcvClaimed(seqno))
+        return;
 
-            HLOGC(dlog.Debug, log << "group/recv: @" << id << " %" << mctrl.pktseq << " #" << mctrl.msgno << " DELIVERING");
-            output_size = stat;
-            fillGroupData((w_mc), mctrl, (out_grpdata), out_grpdata_size);
+    HLOGC(dlog.Debug, log << "group/recv: %" << seqno << " released by the member that stored it");
+    m_RcvClaims[seqno & (GRP_RCV_CLAIMS - 1)] = -1;
+}
 
-            // Record, but do not update yet, until all sockets are handled.
-            next_seq = mctrl.pktseq;
-            break;
-        }
+int32_t CUDTGroup::rcvShiftKey(int32_t key, int32_t off) const
+{
+    if (m_type == SRT_GTYPE_BALANCING)
+    {
+        MsgNo msgno (key);
+        msgno += off;
+        return msgno;
     }
 
-#if ENABLE_HEAVY_LOGGING
-    if (!broken.empty())
+    return off < 0 ? CSeqNo::decseq(key, -off) : CSeqNo::incseq(key, off);
+}
+
+int CUDTGroup::rcvKeyDiff(int32_t key1, int32_t key2) const
+{
+    if (m_type == SRT_GTYPE_BALANCING)
+        return MsgNo(key1) - MsgNo(key2);
+
+    // Not seqcmp, which gives only the right sign around the wrap.
+    return CSeqNo::seqoff(key2, key1);
+}
+
+void CUDTGroup::rcvClear()
+{
+    // [[using locked(m_RcvDataLock)]];
+    for (vector<RcvSlot>::iterator i = m_RcvSlots.begin(); i != m_RcvSlots.end() && m_iRcvPackets > 0; ++i)
     {
-        std::ostringstream brks;
-        for (set<CUDTSocket*>::iterator b = broken.begin(); b != broken.end(); ++b)
-            brks << "@" << (*b)->m_SocketID << " ";
-        LOGC(dlog.Debug, log << "group/recv: REMOVING BROKEN: " << brks.str());
+        if (i->data)
+        {
+            m_RcvFreeBuffers.push_back(i->data);
+            i->data = NULL;
+            --m_iRcvPackets;
+        }
     }
-#endif
 
-    // Now remove all broken sockets from aheads, if any.
-    // Even if they have already delivered a packet.
-    for (set<CUDTSocket*>::iterator di = broken.begin(); di != broken.end(); ++di)
+    if (m_bRcvReadable)
     {
-        CUDTSocket* ps = *di;
-        m_Positions.erase(ps->m_SocketID);
-        m_pGlobal->close(ps);
+        m_bRcvReadable = false;
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, false);
     }
+}
 
-    if (broken.size() >= size) // This > is for sanity check
-    {
-        // All broken
-        HLOGC(dlog.Debug, log << "group/recv: All sockets broken");
-        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_ERR, true);
+bool CUDTGroup::rcvReady(steady_clock::time_point& w_ready_time)
+{
+    // [[using locked(m_RcvDataLock)]];
+    w_ready_time = steady_clock::time_point();
+    if (m_iRcvPackets == 0)
+        return false;
 
-        throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
+    // The balancing group waits for the reorder tolerance also before the
+    // first delivery, as the preceding packets may still come.
+    if (m_type == SRT_GTYPE_BALANCING && !is_zero(m_tsRcvFirstArrival))
+    {
+        w_ready_time = m_tsRcvFirstArrival + milliseconds_from(GRP_RCV_REORDER_MS);
+        if (w_ready_time > steady_clock::now())
+            return false;
+        w_ready_time = steady_clock::time_point();
     }
 
+    // The packets handed over by a closing member (see rcvHandOver())
+    // still wait for their time to play; the others are ready when present.
+    int32_t key = rcvShiftKey(m_RcvBaseSeqNo, 1);
+    if (rcvSlot(key).data)
+    {
+        w_ready_time = rcvSlot(key).play_time;
+        return w_ready_time <= steady_clock::now();
+    }
 
-    // May be required to be re-read.
-    broken.clear();
-
-    if (output_size)
+    // In the balancing group the packets come at their time to play over
+    // different links, each one extracted by its own thread, so the packet
+    // preceding a present one may still come a bit later. Wait for it for
+    // the reorder tolerance since the first present packet has arrived.
+    //
+    // The members of the other groups carry the same packets, so a packet
+    // missing when the next one is played will not come anymore. Unless it
+    // has been stored by one member only (see rcvClaim()), then it comes
+    // from that member at the same time to play, and it's waited for the
+    // same way, or up to the next ACK of that member if a packet lost on its
+    // link has to be dropped first.
+    bool claimed = false;
+    do
     {
-        // We have extracted something, meaning that we have the sequence shift.
-        // Update it now and don't do anything else with the sockets.
+        claimed = claimed || rcvClaimed(key);
+        key = rcvShiftKey(key, 1);
+    }
+    while (!rcvSlot(key).data);
 
-        // Sanity check
-        if (next_seq == -1)
-        {
-            LOGP(dlog.Error, "IPE: next_seq not set after output extracted!");
+    const RcvSlot& next = rcvSlot(key);
+    if (m_type != SRT_GTYPE_BALANCING && !claimed)
+    {
+        w_ready_time = next.play_time;
+        return w_ready_time <= steady_clock::now();
+    }
 
-            // This should never happen, but the only way to keep the code
-            // safe an recoverable is to use the incremented sequence. By
-            // leaving the sequence as is there's a risk of hangup.
-            // Not doing it in case of -1 as it would make a valid %0.
-            if (m_RcvBaseSeqNo != -1)
-                m_RcvBaseSeqNo = CSeqNo::incseq(m_RcvBaseSeqNo);
-        }
-        else
-        {
-            m_RcvBaseSeqNo = next_seq;
-        }
+    // A packet handed over by a closing member comes at its time to play
+    // only then, as the missing ones from the other members do.
+    const steady_clock::time_point since = next.play_time > next.arrival ? next.play_time : next.arrival;
+    w_ready_time = since + milliseconds_from(claimed ? GRP_RCV_CLAIM_MS : GRP_RCV_REORDER_MS);
+    return w_ready_time <= steady_clock::now();
+}
 
-        ReadPos* pos = checkPacketAhead();
-        if (!pos)
-        {
-            // Don't clear the read-readinsess state if you have a packet ahead because
-            // if you have, the next read call will return it.
-            m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, false);
-        }
+int CUDTGroup::rcvExtract(char* buf, int len, SRT_MSGCTRL& w_mctrl)
+{
+    // [[using locked(m_RcvDataLock)]];
 
-        HLOGC(dlog.Debug, log << "group/recv: successfully extracted packet size=" << output_size << " - returning");
-        return output_size;
-    }
+    // The members put the packets here at their time to play, so a gap
+    // before the first available one means that the packets in it were
+    // dropped on every link that could deliver them.
+    int32_t key = rcvShiftKey(m_RcvBaseSeqNo, 1);
+    while (!rcvSlot(key).data)
+        key = rcvShiftKey(key, 1);
 
-    HLOGC(dlog.Debug, log << "group/recv: NOT extracted anything - checking for a need to kick kangaroos");
+    RcvSlot& slot = rcvSlot(key);
+    if (len < slot.size)
+        throw CUDTException(MJ_NOTSUP, MN_XSIZE, 0);
 
-    // Check if we have any sockets left :D
+    HLOGC(dlog.Debug, log << "group/recv: delivering %" << slot.mctrl.pktseq << " #" << slot.mctrl.msgno
+            << (key == rcvShiftKey(m_RcvBaseSeqNo, 1) ? "" : " AHEAD")
+            << ": " << BufferStamp(slot.data, slot.size));
 
-    // Here we surely don't have any more HORSES,
-    // only ELEPHANTS and KANGAROOS. Qualify them and
-    // attempt to at least take advantage of KANGAROOS.
+    const int size = slot.size;
+    memcpy(buf, slot.data, size);
+    w_mctrl = slot.mctrl;
 
-    // In this position all links are either:
-    // - updated to the current position
-    // - updated to the newest possible possition available
-    // - not yet ready for extraction (not present in the group)
+    m_RcvFreeBuffers.push_back(slot.data);
+    slot.data = NULL;
+    m_RcvBaseSeqNo = key;
+    m_tsRcvFirstArrival = steady_clock::time_point();
+    --m_iRcvPackets;
 
-    // If we haven't extracted the very next sequence position,
-    // it means that we might only have the ahead packets read,
-    // that is, the next sequence has been dropped by all links.
+    steady_clock::time_point ready_time;
+    m_bRcvReadable = rcvReady((ready_time));
+    if (!m_bRcvReadable)
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, false);
 
-    if (!m_Positions.empty())
-    {
-        // This might notify both lingering links, which didn't
-        // deliver the required sequence yet, and links that have
-        // the sequence ahead. Review them, and if you find at
-        // least one packet behind, just wait for it to be ready.
-        // Use again the waiting function because we don't want
-        // the general waiting procedure to skip others.
-        set<SRTSOCKET> elephants;
+    return size;
+}
 
-        // const because it's `typename decltype(m_Positions)::value_type`
-        pair<const SRTSOCKET, ReadPos>* slowest_kangaroo = 0;
+void CUDTGroup::recv_CheckBroken()
+{
+    vector<CUDTSocket*> broken;
+    bool still_alive = false;
 
-        for (pit_t rp = m_Positions.begin(); rp != m_Positions.end(); ++rp)
+    {
+        CGuard glock (m_GroupLock);
+        for (gli_t gi = m_Group.begin(); gi != m_Group.end(); ++gi)
         {
-            // NOTE that m_RcvBaseSeqNo in this place wasn't updated
-            // because we haven't successfully extracted anything.
-            int seqdiff = CSeqNo::seqcmp(rp->second.mctrl.pktseq, m_RcvBaseSeqNo);
-            if (seqdiff < 0)
-            {
-                elephants.insert(rp->first);
-            }
-            // If seqdiff == 0, we have a socket ON TRACK.
-            else if (seqdiff > 0)
-            {
-                // If there's already a slowest_kangaroo, seqdiff decides if this one is slower.
-                // Otherwise it is always slower by having no competition.
-                seqdiff = slowest_kangaroo ? CSeqNo::seqcmp(slowest_kangaroo->second.mctrl.pktseq, rp->second.mctrl.pktseq) : 1;
-                if (seqdiff > 0)
-                {
-                    slowest_kangaroo = &*rp;
-                }
-            }
+            const SRT_SOCKSTATUS st = gi->ps->getStatus();
+            if (st >= SRTS_BROKEN)
+                broken.push_back(gi->ps);
+            else if (st == SRTS_CONNECTED)
+                still_alive = true;
         }
+    }
 
-        // Note that if no "slowest_kangaroo" was found, it means
-        // that we don't have kangaroos.
-        if (slowest_kangaroo)
-        {
-            // We have a slowest kangaroo. Elephants must be ignored.
-            // Best case, they will get revived, worst case they will be
-            // soon broken.
-            //
-            // As we already have the packet delivered by the slowest
-            // kangaroo, we can simply return it.
-
-            m_RcvBaseSeqNo = slowest_kangaroo->second.mctrl.pktseq;
-            vector<char>& pkt = slowest_kangaroo->second.packet;
-            if (size_t(len) < pkt.size())
-                throw CUDTException(MJ_NOTSUP, MN_XSIZE, 0);
-
-            HLOGC(dlog.Debug, log << "@" << slowest_kangaroo->first << " KANGAROO->HORSE %"
-                    << slowest_kangaroo->second.mctrl.pktseq
-                    << " #" << slowest_kangaroo->second.mctrl.msgno
-                    << ": " << BufferStamp(&pkt[0], pkt.size()));
-
-            memcpy(buf, &pkt[0], pkt.size());
-            fillGroupData((w_mc), slowest_kangaroo->second.mctrl, (out_grpdata), out_grpdata_size);
-            len = pkt.size();
-            pkt.clear();
+    for (vector<CUDTSocket*>::iterator i = broken.begin(); i != broken.end(); ++i)
+    {
+        HLOGC(dlog.Debug, log << "group/recv: REMOVING BROKEN @" << (*i)->m_SocketID);
+        m_pGlobal->close(*i);
+    }
 
-            // It is unlikely to have a packet ahead because usually having one packet jumped-ahead
-            // clears the possibility of having aheads at all.
-            // XXX Research if this is possible at all; if it isn't, then don't waste time on
-            // looking for it.
-            ReadPos* pos = checkPacketAhead();
-            if (!pos)
-            {
-                // Don't clear the read-readinsess state if you have a packet ahead because
-                // if you have, the next read call will return it.
-                m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_IN, false);
-            }
-            return len;
-        }
+    if (still_alive)
+        return;
 
-        HLOGC(dlog.Debug, log << "group/recv: "
-                << (elephants.empty() ? "NO LINKS REPORTED ANY FRESHER PACKET." : "ALL LINKS ELEPHANTS.")
-                << " Re-polling.");
-    }
-    else
+    LOGC(dlog.Error, log << "group/recv: all links broken");
+    if (!broken.empty())
     {
-        HLOGC(dlog.Debug, log << "group/recv: POSITIONS EMPTY - Re-polling.");
+        m_pGlobal->m_EPoll.update_events(id(), m_sPollID, SRT_EPOLL_ERR, true);
+        throw CUDTException(MJ_CONNECTION, MN_CONNLOST, 0);
     }
-
-    goto RETRY_READING;
+    throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
 }
 
-CUDTGroup::ReadPos* CUDTGroup::checkPacketAhead()
+// The member sockets put the packets ready for extraction into the group
+// receiver buffer (see readyPackets()), so here they are just taken from
+// there in the order of sequence numbers.
+int CUDTGroup::recv(char* buf, int len, SRT_MSGCTRL& w_mc)
 {
-    typedef map<SRTSOCKET, ReadPos>::iterator pit_t;
-    ReadPos* out = 0;
+    SRT_SOCKGROUPDATA* out_grpdata = w_mc.grpdata;
+    size_t out_grpdata_size = w_mc.grpdata_size;
 
-    // This map no longer maps only ahead links.
-    // Here are all links, and whether ahead, it's defined by the sequence.
-    for (pit_t i = m_Positions.begin(); i != m_Positions.end(); ++i)
-    {
-        // i->first: socket ID
-        // i->second: ReadPos { sequence, packet }
-        // We are not interested with the socket ID because we
-        // aren't going to read from it - we have the packet already.
-        ReadPos& a = i->second;
+    // In blocking mode, m_iRcvTimeOut of -1 means to block indefinitely,
+    // although the links are checked every second.
+    const steady_clock::time_point exptime = steady_clock::now() + milliseconds_from(m_iRcvTimeOut);
+    SRT_MSGCTRL mctrl = srt_msgctrl_default;
+    int size = 0;
 
-        const int seqdiff = CSeqNo::seqcmp(a.mctrl.pktseq, m_RcvBaseSeqNo);
-        if (seqdiff == 1)
+    for (;;)
+    {
+        if (!m_bOpened || !m_bConnected)
         {
-            // The very next packet. Return it.
-            // XXX SETTING THIS ONE IS PROBABLY A BUG.
-            m_RcvBaseSeqNo = a.mctrl.pktseq;
-            HLOGC(dlog.Debug, log << "group/recv: Base %" << m_RcvBaseSeqNo << " ahead delivery POSSIBLE %"
-                    << a.mctrl.pktseq << "#" << a.mctrl.msgno << " from @" << i->first << ")");
-            out = &a;
+            LOGC(dlog.Error, log << boolalpha << "group/recv: ERROR opened=" << m_bOpened << " connected=" << m_bConnected);
+            throw CUDTException(MJ_CONNECTION, MN_NOCONN, 0);
         }
-        else if (seqdiff < 1 && !a.packet.empty())
+
         {
-            HLOGC(dlog.Debug, log << "group/recv: @" << i->first << " dropping collected ahead %"
-                    << a.mctrl.pktseq << "#" << a.mctrl.msgno << " with base %" << m_RcvBaseSeqNo);
-            a.packet.clear();
+            CGuard lk (m_RcvDataLock);
+            CSync rcvcond (m_RcvDataCond, lk);
+            steady_clock::time_point ready_time;
+            if (!rcvReady((ready_time)) && m_bSynRecving)
+            {
+                steady_clock::time_point until = steady_clock::now() + seconds_from(1);
+                if (m_iRcvTimeOut >= 0 && exptime < until)
+                    until = exptime;
+                // A packet is waiting for the preceding ones (balancing group)
+                if (!is_zero(ready_time) && ready_time < until)
+                    until = ready_time;
+                rcvcond.wait_until(until);
+            }
+
+            if (rcvReady((ready_time)))
+            {
+                size = rcvExtract(buf, len, (mctrl));
+                break;
+            }
         }
-        // In case when it's >1, keep it in ahead
+
+        recv_CheckBroken();
+
+        if (!m_bSynRecving)
+            throw CUDTException(MJ_AGAIN, MN_RDAVAIL, 0);
+
+        if (m_iRcvTimeOut >= 0 && steady_clock::now() >= exptime)
+            throw CUDTException(MJ_AGAIN, MN_XMTIMEOUT, 0);
     }
 
-    return out;
+    fillGroupData((w_mc), mctrl, (out_grpdata), out_grpdata_size);
+    return size;
 }
 
 const char* CUDTGroup::StateStr(CUDTGroup::GroupState st)
@@ -13232,7 +13935,7 @@ bool CUDTGroup::send_CheckIdle(const gli_t d, vector<gli_t>& w_wipeme, vector<gl
     return true;
 }
 
-void CUDTGroup::sendBackup_CheckIdleTime(gli_t w_d)
+void CUDTGroup::sendBackup_CheckIdleTime(gli_t w_d, const time_point& currtime)
 {
     // Check if it was fresh set as idle, we had to wait until its sender
     // buffer gets empty so that we can make sure that KEEPALIVE will be the
@@ -13251,16 +13954,50 @@ void CUDTGroup::sendBackup_CheckIdleTime(gli_t w_d)
             // getting KEEPALIVES since now. Send the first one now to increase
             // probability that the link will be recognized as IDLE on the
             // reception side ASAP.
-            int32_t arg = 1;
-            w_d->ps->m_pUDT->sendCtrl(UMSG_KEEPALIVE, &arg);
+            if (m_bOPT_FastSwitch)
+                u.sendKeepaliveProbe();
+            else
+                u.sendCtrl(UMSG_KEEPALIVE);
         }
     }
+    else if (m_bOPT_FastSwitch && count_microseconds(currtime - u.m_tsLastSndTime) > BACKUP_PROBE_INTERVAL_US)
+    {
+        // Keep the idle link warm: the probes keep its path alive and the
+        // responses confirm that it's ready to take over, and measure its
+        // RTT, for which otherwise an idle link has no fresh ACKs.
+        u.sendKeepaliveProbe();
+    }
+}
+
+uint64_t CUDTGroup::sendBackup_StabilityTimeout(const CUDT& u, bool fresh) const
+{
+    if (!m_bOPT_FastSwitch)
+        return m_uOPT_StabilityTimeout;
+
+    // The receiver sends an ACK every COMM_SYN_INTERVAL_US as long as it gets
+    // packets, so the silence on a healthy link shouldn't exceed this interval
+    // plus the interval between the packets sent, wobbled by the RTT variance.
+    // One ACK missing or delayed by a scheduling stall of either side is still
+    // tolerated, otherwise the links are switched back and forth for nothing.
+    // A link that has just started sending needs also the RTT for the first response.
+    uint64_t tmo = 2 * CUDT::COMM_SYN_INTERVAL_US + m_iSendIntervalUs + 4 * u.m_iRTTVar;
+    if (fresh)
+        tmo += u.m_iProbeRTT ? u.m_iProbeRTT : u.m_iRTT;
+
+    // Never slower than the regular detection.
+    return std::min<uint64_t>(tmo, m_uOPT_StabilityTimeout);
 }
 
-void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point currtime, size_t& w_nunstable)
+bool CUDTGroup::sendBackup_IsWarm(const CUDT& u, const time_point& currtime) const
 {
-    steady_clock::time_point ts_oldest_unstable;
+    // The responses to the probes sent every BACKUP_PROBE_INTERVAL_US are missing
+    // for a few intervals. The peer without the probe support responds never.
+    return count_microseconds(currtime - u.m_tsLastRspTime) < 3 * BACKUP_PROBE_INTERVAL_US + u.m_iProbeRTT;
+}
 
+void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point currtime, size_t& w_nunstable,
+        time_point& w_ts_failed)
+{
     CUDT& u = w_d->ps->core();
     // This link might be unstable, check its responsiveness status
     // NOTE: currtime - last_rsp_time: we believe this value will be always positive as
@@ -13275,6 +14012,7 @@ void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point cur
     // deadlock risk and performance degradation.
 
     bool is_unstable = false;
+    time_point ts_silent_since;
 
     if (currtime > u.m_tsLastRspTime)
     {
@@ -13282,6 +14020,7 @@ void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point cur
         steady_clock::duration td_responsive = currtime - u.m_tsLastRspTime;
 
         IF_HEAVY_LOGGING(string source = "heard");
+        bool fresh = false;
 
         if (u.m_tsTmpActiveTime != steady_clock::zero() && u.m_tsTmpActiveTime < currtime)
         {
@@ -13296,6 +14035,7 @@ void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point cur
             {
                 IF_HEAVY_LOGGING(source = "activated");
                 td_responsive = td_active;
+                fresh = true;
             }
             else
             {
@@ -13303,13 +14043,23 @@ void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point cur
             }
         }
 
-        if (count_microseconds(td_responsive) > m_uOPT_StabilityTimeout)
+        // In the fast mode also the sending resumed after a pause is like
+        // an activation: there was nothing to respond to during the pause.
+        if (m_bOPT_FastSwitch && m_tsSendResumed > u.m_tsLastRspTime && currtime - m_tsSendResumed < td_responsive)
+        {
+            IF_HEAVY_LOGGING(source = "resumed");
+            td_responsive = currtime - m_tsSendResumed;
+            fresh = true;
+        }
+
+        const uint64_t stability_tmo = sendBackup_StabilityTimeout(u, fresh);
+        if (uint64_t(count_microseconds(td_responsive)) > stability_tmo)
         {
             if (u.m_tsUnstableSince == steady_clock::zero())
             {
                 HLOGC(dlog.Debug, log << "grp/sendBackup: socket NEW UNSTABLE: @" << w_d->id
                         << " last " << source << " " << FormatDuration(td_responsive)
-                        << " > " << m_uOPT_StabilityTimeout << " (stability timeout)");
+                        << " > " << stability_tmo << " (stability timeout)");
                 // The link seems to have missed two ACKs already.
                 // Qualify this link as unstable
                 // Notify that it has been seen so since now
@@ -13317,6 +14067,7 @@ void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point cur
             }
 
             is_unstable = true;
+            ts_silent_since = currtime - td_responsive;
         }
     }
 
@@ -13334,9 +14085,10 @@ void CUDTGroup::sendBackup_CheckRunningStability(gli_t w_d, const time_point cur
     {
         HLOGC(dlog.Debug, log << "grp/sendBackup: link UNSTABLE for "
                 << FormatDuration(currtime - u.m_tsUnstableSince) << " : @" << w_d->id << " - will send a payload");
-        // The link is already unstable
-        if (ts_oldest_unstable != steady_clock::zero() || ts_oldest_unstable > u.m_tsUnstableSince)
-            ts_oldest_unstable = u.m_tsUnstableSince;
+        // The link is already unstable. The switchover is counted
+        // since the earliest failure of the unstable links.
+        if (w_ts_failed == steady_clock::zero() || w_ts_failed > ts_silent_since)
+            w_ts_failed = ts_silent_since;
         ++w_nunstable;
     }
     else
@@ -13457,7 +14209,7 @@ void CUDTGroup::sendBackup_CheckNeedActivate(const vector<gli_t>& idlers,
         bool& w_none_succeeded, SRT_MSGCTRL& w_mc, int32_t& w_curseq, int32_t& w_final_stat,
         CUDTException& w_cx, vector<Sendstate>& w_sendstates,
         vector<gli_t>& w_parallel, vector<gli_t>& w_wipeme,
-        const string& activate_reason ATR_UNUSED)
+        const time_point& ts_failed, const string& activate_reason ATR_UNUSED)
 {
     int stat = -1;
 
@@ -13523,9 +14275,17 @@ void CUDTGroup::sendBackup_CheckNeedActivate(const vector<gli_t>& idlers,
             if (d->sndstate != GST_RUNNING)
             {
                 steady_clock::time_point currtime = steady_clock::now();
-                d->ps->core().m_tsTmpActiveTime = currtime;
+                CUDT& u = d->ps->core();
+                u.m_tsTmpActiveTime = currtime;
                 HLOGC(dlog.Debug, log << "@" << d->id << ":... sending SUCCESSFUL #" << w_mc.msgno
                         << " LINK ACTIVATED (pri: " << d->priority << ").");
+
+                // Record the takeover from a failed link.
+                if (ts_failed != steady_clock::zero())
+                {
+                    u.countStat(CUDT::STAT_SND_BACKUP_SWITCH);
+                    u.m_stats.sndBackupSwitchTime.store(count_microseconds(currtime - ts_failed));
+                }
             }
             else
             {
@@ -13929,6 +14689,19 @@ int CUDTGroup::sendBackup(const char *buf, int len, SRT_MSGCTRL& w_mc)
 
     steady_clock::time_point currtime = steady_clock::now();
 
+    if (m_tsLastSend != steady_clock::zero())
+    {
+        const int64_t interval_us = count_microseconds(currtime - m_tsLastSend);
+        if (interval_us > int64_t(m_uOPT_StabilityTimeout))
+            m_tsSendResumed = currtime; // a pause, not a part of the stream
+        else
+            m_iSendIntervalUs = avg_iir<8>(m_iSendIntervalUs, interval_us);
+    }
+    m_tsLastSend = currtime;
+
+    // The time when the first of the unstable links has failed
+    time_point ts_failed;
+
     sendable.reserve(m_Group.size());
 
     // First, check status of every link - no matter if idle or active.
@@ -13955,13 +14728,13 @@ int CUDTGroup::sendBackup(const char *buf, int len, SRT_MSGCTRL& w_mc)
             // - if ALL SOCKETS ARE IDLE, then we simply activate the first from the list,
             //   and all others will be activated using the ISN from the first one.
             idlers.push_back(d);
-            sendBackup_CheckIdleTime(d);
+            sendBackup_CheckIdleTime(d, currtime);
             continue;
         }
 
         if (d->sndstate == GST_RUNNING)
         {
-            sendBackup_CheckRunningStability(d, (currtime), (nunstable));
+            sendBackup_CheckRunningStability(d, (currtime), (nunstable), (ts_failed));
             sendable.push_back(d);
             continue;
         }
@@ -13975,6 +14748,22 @@ int CUDTGroup::sendBackup(const char *buf, int len, SRT_MSGCTRL& w_mc)
     // Sort the idle sockets by priority so the highest priority idle links are checked first.
     sort(idlers.begin(), idlers.end(), FByPriotity());
 
+    if (m_bOPT_FastSwitch)
+    {
+        // Activating a link that doesn't respond to the probes would most
+        // likely only delay the switch, so try the verified links first.
+        vector<gli_t> cold;
+        vector<gli_t>::iterator last = idlers.begin();
+        for (vector<gli_t>::iterator i = idlers.begin(); i != idlers.end(); ++i)
+        {
+            if (sendBackup_IsWarm((*i)->ps->core(), currtime))
+                *last++ = *i;
+            else
+                cold.push_back(*i);
+        }
+        copy(cold.begin(), cold.end(), last);
+    }
+
     vector<Sendstate> sendstates;
 
     // Ok, we've separated the unstable from sendable just to know if:
@@ -14150,6 +14939,7 @@ int CUDTGroup::sendBackup(const char *buf, int len, SRT_MSGCTRL& w_mc)
             HLOGC(dlog.Debug, log << "grp/sendBackup: found link pri " << idlers[0]->priority << " < "
                     << (*sendable_pri.begin()) << " (highest from sendable) - will activate an idle link");
             need_activate = true;
+            ts_failed = time_point(); // not a takeover
             IF_HEAVY_LOGGING(activate_reason = "found higher pri link");
         }
         else
@@ -14165,7 +14955,7 @@ int CUDTGroup::sendBackup(const char *buf, int len, SRT_MSGCTRL& w_mc)
     {
         sendBackup_CheckNeedActivate(idlers, buf, len,
                 (none_succeeded), (w_mc), (curseq), (final_stat), (cx), (sendstates),
-                (parallel), (wipeme), activate_reason);
+                (parallel), (wipeme), ts_failed, activate_reason);
     }
     else
     {
@@ -14311,28 +15101,29 @@ int CUDTGroup::sendBackupRexmit(CUDT& core, SRT_MSGCTRL& w_mc)
     set<int> results;
     int stat = -1;
 
+    // In the fast switch mode replay only what can still make it on time.
+    const size_t first = m_bOPT_FastSwitch ? sendBackup_ReplayStart(core, steady_clock::now()) : 0;
+
     // Make sure that the link has correctly synchronized sequence numbers.
     // Note that sequence numbers should be recorded in mc.
-    int32_t curseq = m_SenderBuffer[0].mc.pktseq;
-    size_t skip_initial = 0;
+    int32_t curseq = m_SenderBuffer[first].mc.pktseq;
+    size_t skip_initial = first;
     if (curseq != core.schedSeqNo())
     {
         int distance = CSeqNo::seqoff(core.schedSeqNo(), curseq);
         if (distance < 0)
         {
             // This may happen in case when the link to be activated is already running.
-            skip_initial = -distance;
+            skip_initial += -distance;
             HLOGC(dlog.Debug, log << "sendBackupRexmit: OVERRIDE attempt to %" << core.schedSeqNo()
                     << " from BACKWARD %" << curseq << " - DENIED; skip " << skip_initial << " packets" );
         }
         else
         {
-#if ENABLE_HEAVY_LOGGING
-            int32_t old = core.schedSeqNo();
-            bool su = core.overrideSndSeqNo(curseq);
+            IF_HEAVY_LOGGING(int32_t old = core.schedSeqNo());
+            const bool su SRT_ATR_UNUSED = core.overrideSndSeqNo(curseq);
             HLOGC(dlog.Debug, log << "sendBackupRexmit: OVERRIDING seq %" << old << " with %" << curseq
                     << (su ? " - succeeded" : " - FAILED!"));
-#endif
         }
     }
 
@@ -14367,6 +15158,28 @@ int CUDTGroup::sendBackupRexmit(CUDT& core, SRT_MSGCTRL& w_mc)
     return stat;
 }
 
+size_t CUDTGroup::sendBackup_ReplayStart(const CUDT& u, const time_point& currtime) const
+{
+    if (!u.m_bPeerTsbPd)
+        return 0;
+
+    // A message can still be delivered if it reaches the receiver before its
+    // play time, that is, within the latency since its origin time minus the
+    // one-way delay of this link. The latest message is always sent.
+    const int rtt = u.m_iProbeRTT ? u.m_iProbeRTT : u.m_iRTT;
+    const int64_t window_us = int64_t(u.m_iPeerTsbPdDelay_ms) * 1000 - rtt / 2;
+    const uint64_t now_us = currtime.us_since_epoch();
+
+    size_t first = 0;
+    while (first + 1 < m_SenderBuffer.size() && m_SenderBuffer[first].mc.srctime != 0
+            && int64_t(now_us - m_SenderBuffer[first].mc.srctime) > window_us)
+        ++first;
+
+    HLOGC(dlog.Debug, log << "sendBackupRexmit: replay window " << (window_us / 1000) << "ms, skipping "
+            << first << "/" << m_SenderBuffer.size() << " outdated messages");
+    return first;
+}
+
 void CUDTGroup::ackMessage(int32_t msgno)
 {
     // The message id could not be identified, skip.
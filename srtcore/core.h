@@ -220,6 +220,9 @@ public:
 
         // Configuration
         int priority;
+
+        // Balancing: credit for sending, see sendBalancing_SelectLink()
+        double sndcredit;
     };
 
     struct ConfigItem
@@ -329,9 +332,6 @@ public:
             m_bConnected = false;
         }
 
-        // XXX BUGFIX
-        m_Positions.erase(id);
-
         return s;
     }
 
@@ -348,6 +348,7 @@ public:
     int send(const char* buf, int len, SRT_MSGCTRL& w_mc);
     int sendBroadcast(const char* buf, int len, SRT_MSGCTRL& w_mc);
     int sendBackup(const char* buf, int len, SRT_MSGCTRL& w_mc);
+    int sendBalancing(const char* buf, int len, SRT_MSGCTRL& w_mc);
 
 private:
     // For Backup, sending all previous packet
@@ -355,8 +356,12 @@ private:
 
     // Support functions for sendBackup and sendBroadcast
     bool send_CheckIdle(const gli_t d, std::vector<gli_t>& w_wipeme, std::vector<gli_t>& w_pending);
-    void sendBackup_CheckIdleTime(gli_t w_d);
-    void sendBackup_CheckRunningStability(const gli_t d, const time_point currtime, size_t& w_nunstable);
+    void sendBackup_CheckIdleTime(gli_t w_d, const time_point& currtime);
+    void sendBackup_CheckRunningStability(const gli_t d, const time_point currtime, size_t& w_nunstable,
+            time_point& w_ts_failed);
+    uint64_t sendBackup_StabilityTimeout(const CUDT& u, bool fresh) const;
+    bool sendBackup_IsWarm(const CUDT& u, const time_point& currtime) const;
+    size_t sendBackup_ReplayStart(const CUDT& u, const time_point& currtime) const;
     bool sendBackup_CheckSendStatus(const gli_t d, const time_point& currtime, const int stat, const int erc, const int32_t lastseq,
             const int32_t pktseq, CUDT& w_u, int32_t& w_curseq, std::vector<gli_t>& w_parallel,
             int& w_final_stat, std::set<int>& w_sendable_pri, size_t& w_nsuccessful, size_t& w_nunstable);
@@ -365,11 +370,18 @@ private:
             bool& w_none_succeeded, SRT_MSGCTRL& w_mc, int32_t& w_curseq, int32_t& w_final_stat,
             CUDTException& w_cx, std::vector<Sendstate>& w_sendstates,
             std::vector<gli_t>& w_parallel, std::vector<gli_t>& w_wipeme,
-            const std::string& activate_reason);
+            const time_point& ts_failed, const std::string& activate_reason);
     void send_CheckPendingSockets(const std::vector<gli_t>& pending, std::vector<gli_t>& w_wipeme);
     void send_CloseBrokenSockets(std::vector<gli_t>& w_wipeme);
     void sendBackup_CheckParallelLinks(const size_t nunstable, std::vector<gli_t>& w_parallel,
             int& w_final_stat, bool& w_none_succeeded, SRT_MSGCTRL& w_mc, CUDTException& w_cx);
+    double sendBalancing_LinkWeight(const CUDT& u, double& w_delay_us) const;
+    size_t sendBalancing_SelectLink(const std::vector<gli_t>& candidates);
+
+    // Support functions for recv
+    bool rcvReady(time_point& w_ready_time);
+    int rcvExtract(char* buf, int len, SRT_MSGCTRL& w_mctrl);
+    void recv_CheckBroken();
 
 public:
     int recv(char* buf, int len, SRT_MSGCTRL& w_mc);
@@ -394,7 +406,6 @@ public:
     srt::sync::Mutex* exp_groupLock() { return &m_GroupLock; }
     void addEPoll(int eid);
     void removeEPoll(int eid);
-    void updateReadState(SRTSOCKET sock, int32_t sequence);
     void updateWriteState();
 
     /// Update the in-group array of packet providers per sequence number.
@@ -410,12 +421,67 @@ public:
     /// @return The bitmap that marks by 'false' packets lost since next to exp_sequence
     std::vector<bool> providePacket(int32_t exp_sequence, int32_t sequence, CUDT *provider, uint64_t time);
 
-    /// This is called from the ACK action by particular socket, which
-    /// actually signs off the packet for extraction.
+    /// This is called by a member socket when it has packets ready for
+    /// extraction (by the TSBPD thread at their time to play, or at ACK
+    /// without TSBPD), with its m_RecvLock locked. The packets are moved
+    /// from the receiver buffer of the socket to the group receiver buffer,
+    /// where the duplicates delivered already by other members are dropped.
+    ///
+    /// @param core The socket core that has the packets ready
+    /// @return The number of packets extracted from the socket
+    int readyPackets(CUDT* core);
+
+    /// This is called by a member socket with SRTO_GROUPSHAREDRCV set when
+    /// a packet arrives, before it's stored in the receiver buffer. The
+    /// packet is stored only by the first member that receives it, the
+    /// others drop it and treat it as received.
+    ///
+    /// @param seqno The sequence number of the arrived packet
+    /// @return true if the caller should store the packet, false if
+    ///         it's stored by another member or delivered already
+    bool rcvClaim(int32_t seqno);
+
+    /// This is called by a member socket with SRTO_GROUPSHAREDRCV set when
+    /// it couldn't decrypt a packet it has claimed, so that the copy coming
+    /// over another link is stored instead.
+    ///
+    /// @param seqno The sequence number of the packet
+    void rcvUnclaim(int32_t seqno);
+
+    /// This is called when a member socket with SRTO_GROUPSHAREDRCV set is
+    /// closing or removed from the group. The packets it has stored are not
+    /// stored by any other member, so they are moved to the group receiver
+    /// buffer, where they wait for their time to play.
     ///
-    /// @param core The socket core for which the ACK was sent
-    /// @param ack The past-the-last-received ACK sequence number
-    void readyPackets(CUDT* core, int32_t ack);
+    /// @param core The socket core of the member
+    void rcvHandOver(CUDT* core);
+
+    /// Puts a copy of a packet into the group receiver buffer, the same
+    /// way as readyPackets() does with the packets of a member.
+    ///
+    /// @param data The payload
+    /// @param size The payload size, at most SRT_LIVE_MAX_PLSIZE
+    /// @param mctrl The message control of the packet, with pktseq and msgno
+    /// @return false if the packet was discarded as delivered or present already
+    bool rcvPut(const char* data, int size, const SRT_MSGCTRL& mctrl);
+
+    /// Reports the group readable if a packet waiting in the group receiver
+    /// buffer for the preceding ones doesn't need to wait anymore. Called
+    /// periodically by the members, see CUDT::checkTimers().
+    void rcvCheckReadable();
+
+    /// Extracts the next packet from the group receiver buffer if it's
+    /// ready, without waiting.
+    ///
+    /// @return The payload size, or 0 if there's no packet ready
+    int rcvTryExtract(char* buf, int len, SRT_MSGCTRL& w_mctrl);
+
+    /// Wake up the reader waiting for packets, so that
+    /// it checks the state of the member links.
+    void wakeupReader()
+    {
+        srt::sync::CSync::lock_signal(m_RcvDataCond, m_RcvDataLock);
+    }
 
     void syncWithSocket(const CUDT& core);
     int getGroupData(SRT_SOCKGROUPDATA *pdata, size_t *psize);
@@ -592,6 +658,13 @@ private:
     int32_t m_iSndOldestMsgNo; // oldest position in the sender buffer
     volatile int32_t m_iSndAckedMsgNo;
     uint32_t m_uOPT_StabilityTimeout;
+    bool m_bOPT_FastSwitch;
+
+    // Fast switch mode (SRTO_GROUPFASTSWITCH) of the backup group
+    static const int64_t BACKUP_PROBE_INTERVAL_US = 20*1000; // how often an idle link is probed
+    time_point m_tsLastSend;     // time of the previous sendBackup() call
+    time_point m_tsSendResumed;  // time when sending was resumed after a pause longer than the stability timeout
+    int64_t m_iSendIntervalUs;   // average interval between the sendBackup() calls, in microseconds
 
     // THIS function must be called only in a function for a group type
     // that does use sender buffer.
@@ -604,8 +677,6 @@ private:
     bool m_bTsbPd;
     bool m_bTLPktDrop;
     int64_t m_iTsbPdDelay_us;
-    int m_RcvEID;
-    struct CEPollDesc* m_RcvEpolld;
     int m_SndEID;
     struct CEPollDesc* m_SndEpolld;
 
@@ -619,23 +690,56 @@ private:
     time_point m_tsStartTime;
     time_point m_tsRcvPeerStartTime;
 
-    struct ReadPos
+    // Group receiver buffer. The members put there the packets ready for
+    // extraction (see readyPackets()), at the position of their sequence
+    // number, and the application reads them in order. Guarded by m_RcvDataLock.
+    //
+    // In the balancing group every link has its own sequence, so the packets
+    // are ordered by the message number instead (see rcvKey()).
+    struct RcvSlot
     {
-        std::vector<char> packet;
+        char* data;                              // NULL if there's no packet at this position
+        int size;
         SRT_MSGCTRL mctrl;
-        ReadPos(int32_t s): mctrl(srt_msgctrl_default)
-        {
-            mctrl.pktseq = s;
-        }
+        time_point arrival;                      // when the packet was put here
+        time_point play_time;                    // time to play of a packet handed over early (see rcvHandOver()), or 0
     };
-    std::map<SRTSOCKET, ReadPos> m_Positions;
-
-    ReadPos* checkPacketAhead();
-
-    // This is the sequence number of a packet that has been previously
-    // delivered. Initially it should be set to -1 so that the sequence read
-    // from the first delivering socket will be taken as a good deal.
-    volatile int32_t m_RcvBaseSeqNo;
+    static const int GRP_RCV_SLOTS = 8192;       // power of two, so that the position wraps with the sequence
+    static const int GRP_RCV_REORDER_MS = 10;    // how long the balancing group waits for a missing packet
+    std::vector<RcvSlot> m_RcvSlots;
+    std::vector<char*> m_RcvFreeBuffers;         // payload buffers of the delivered packets, for reuse
+    int m_iRcvPackets;                           // number of packets in m_RcvSlots
+    bool m_bRcvReadable;                         // a packet can be extracted, as reported to epoll
+
+    RcvSlot& rcvSlot(int32_t key) { return m_RcvSlots[key & (GRP_RCV_SLOTS - 1)]; }
+
+    // Sequence numbers of the packets stored by the members in the shared
+    // receiving mode (see rcvClaim()), at the position of the sequence number.
+    // Allocated at the first claim. Guarded by m_RcvDataLock.
+    static const int GRP_RCV_CLAIMS = 65536;     // power of two, covers the receiver buffer of a member
+    static const int GRP_RCV_CLAIM_MS = 30;      // how long a packet stored by another member is waited for
+    std::vector<int32_t> m_RcvClaims;
+    int32_t m_RcvFirstClaim;                     // the lowest sequence claimed before the first delivery, or -1
+
+    bool rcvClaimed(int32_t seqno) const
+    {
+        return !m_RcvClaims.empty() && m_RcvClaims[seqno & (GRP_RCV_CLAIMS - 1)] == seqno;
+    }
+    int32_t rcvKey(const SRT_MSGCTRL& mctrl) const { return m_type == SRT_GTYPE_BALANCING ? mctrl.msgno : mctrl.pktseq; }
+    int32_t rcvShiftKey(int32_t key, int32_t off) const;
+    int rcvKeyDiff(int32_t key1, int32_t key2) const;
+    bool rcvStore(char* data, int size, const SRT_MSGCTRL& mctrl, SRTSOCKET member,
+            const time_point& play_time = time_point());
+    void rcvUpdateReadable();
+    char* rcvAllocBuffer();
+    void rcvClear();
+
+    // This is the sequence number (message number in the balancing group)
+    // of a packet that has been previously delivered. Initially it should be
+    // set to -1 so that the sequence read from the first delivering socket
+    // will be taken as a good deal.
+    int32_t m_RcvBaseSeqNo;
+    time_point m_tsRcvFirstArrival; // when the first packet came, zero after the first delivery
 
     bool m_bOpened;    // Set to true when at least one link is at least pending
     bool m_bConnected; // Set to true on first link confirmed connected
@@ -677,7 +781,12 @@ public:
         // The first provided one will be taken as a good deal; even if
         // this is going to be past the ISN, at worst it will be caused
         // by TLPKTDROP.
+        srt::sync::CGuard lk (m_RcvDataLock);
+        rcvClear();
+        m_RcvClaims.clear();
+        m_RcvFirstClaim = -1;
         m_RcvBaseSeqNo = -1;
+        m_tsRcvFirstArrival = time_point();
     }
 
     bool applyGroupTime(time_point& w_start_time, time_point& w_peer_start_time)
@@ -736,7 +845,6 @@ class CUDT
     friend class CUDTUnited;
     friend class CCC;
     friend struct CUDTComp;
-    friend class CCache<CInfoBlock>;
     friend class CRendezvousQueue;
     friend class CSndQueue;
     friend class CRcvQueue;
@@ -751,6 +859,7 @@ class CUDT
 private: // constructor and desctructor
     void construct();
     void clearData();
+    void inheritOptions(const CUDT& ancestor);
     CUDT(CUDTSocket* parent);
     CUDT(CUDTSocket* parent, const CUDT& ancestor);
     const CUDT& operator=(const CUDT&) {return *this;} // = delete ?
@@ -788,6 +897,10 @@ public: //API
     static int recvmsg2(SRTSOCKET u, char* buf, int len, SRT_MSGCTRL& w_mctrl);
     static int64_t sendfile(SRTSOCKET u, std::fstream& ifs, int64_t& offset, int64_t size, int block = SRT_DEFAULT_SENDFILE_BLOCK);
     static int64_t recvfile(SRTSOCKET u, std::fstream& ofs, int64_t& offset, int64_t size, int block = SRT_DEFAULT_RECVFILE_BLOCK);
+#ifdef SRT_ENABLE_FILEMAP
+    static int64_t sendfile(SRTSOCKET u, int fd, int64_t& offset, int64_t size, int block = SRT_DEFAULT_SENDFILE_BLOCK);
+    static int64_t recvfile(SRTSOCKET u, int fd, int64_t& offset, int64_t size, int block = SRT_DEFAULT_RECVFILE_BLOCK);
+#endif
     static int select(int nfds, ud_set* readfds, ud_set* writefds, ud_set* exceptfds, const timeval* timeout);
     static int selectEx(const std::vector<SRTSOCKET>& fds, std::vector<SRTSOCKET>* readfds, std::vector<SRTSOCKET>* writefds, std::vector<SRTSOCKET>* exceptfds, int64_t msTimeOut);
     static int epoll_create();
@@ -805,7 +918,10 @@ public: //API
     static int epoll_release(const int eid);
     static CUDTException& getlasterror();
     static int bstats(SRTSOCKET u, CBytePerfMon* perf, bool clear = true, bool instantaneous = false);
+    static int bulkstats(int source, int id, int fields, SRT_SOCKSTATS* out, int size, bool clear);
+    static int histstats(SRTSOCKET u, SRT_HISTSTATS* hist, bool clear);
     static SRT_SOCKSTATUS getsockstate(SRTSOCKET u);
+    static int setSocketPool(int size);
     static bool setstreamid(SRTSOCKET u, const std::string& sid);
     static std::string getstreamid(SRTSOCKET u);
     static int getsndbuffer(SRTSOCKET u, size_t* blocks, size_t* bytes);
@@ -877,6 +993,7 @@ public: // internal API
 
     bool isOPT_TsbPd() const { return m_bOPT_TsbPd; }
     int RTT() const { return m_iRTT; }
+    int lastRTTSample() const { return m_iRTTSample; }
     int32_t sndSeqNo() const { return m_iSndCurrSeqNo; }
     int32_t schedSeqNo() const { return m_iSndNextSeqNo; }
     bool overrideSndSeqNo(int32_t seq);
@@ -1098,7 +1215,7 @@ private:
     /// @param len [in] size of the buffer.
     /// @return Actual size of data received.
 
-    SRT_ATR_NODISCARD int sendmsg2(const char* data, int len, SRT_MSGCTRL& w_m);
+    SRT_ATR_NODISCARD int sendmsg2(const char* data, int len, SRT_MSGCTRL& w_m, CSharedPayload* shared = NULL);
 
     SRT_ATR_NODISCARD int recvmsg(char* data, int len, uint64_t& srctime);
     SRT_ATR_NODISCARD int recvmsg2(char* data, int len, SRT_MSGCTRL& w_m);
@@ -1125,6 +1242,30 @@ private:
 
     SRT_ATR_NODISCARD int64_t recvfile(std::fstream& ofs, int64_t& offset, int64_t size, int block = 7320000);
 
+#ifdef SRT_ENABLE_FILEMAP
+    /// Request UDT to send out a file described as "fd" without copying its contents
+    /// into the sender buffer. The file is mapped into memory and the sender buffer
+    /// refers to the mapped pages until they are acknowledged.
+    /// @param fd [in] Descriptor of a regular file open for reading.
+    /// @param offset [in, out] From where to read and send data; output is the new offset when the call returns.
+    /// @param size [in] How many data to be sent (-1 for up to the end of file).
+    /// @param block [in] size of block per single insertion into the sender buffer
+    /// @return Actual size of data sent.
+
+    SRT_ATR_NODISCARD int64_t sendfile(int fd, int64_t& offset, int64_t size, int block = 366000);
+
+    /// Request UDT to receive data into a file described as "fd", starting from "offset",
+    /// with expected size of "size". Data are written with positioned vector writes
+    /// directly from the receiver buffer, without using the file position.
+    /// @param fd [in] Descriptor of a file open for writing.
+    /// @param offset [in, out] From where to write data; output is the new offset when the call returns.
+    /// @param size [in] How many data to be received.
+    /// @param block [in] size of block per write to disk
+    /// @return Actual size of data received.
+
+    SRT_ATR_NODISCARD int64_t recvfile(int fd, int64_t& offset, int64_t size, int block = 7320000);
+#endif
+
     /// Configure UDT options.
     /// @param optName [in] The enum name of a UDT option.
     /// @param optval [in] The value to be set.
@@ -1147,6 +1288,16 @@ private:
     /// instead of moving averages.
     void bstats(CBytePerfMon* perf, bool clear = true, bool instantaneous = false);
 
+    /// Fill the compact statistics record, calculating only the
+    /// field sets requested in `fields` (SRT_STATSF_*). Unlike bstats()
+    /// it doesn't throw: a socket that isn't connected gets fields = 0.
+    void compactStats(SRT_SOCKSTATS& w_st, int fields, bool clear);
+
+    /// Read the delay histograms.
+    /// @param hist [out] the histograms of this socket
+    /// @param clear [in] whether the histograms should start over
+    void histstats(SRT_HISTSTATS& w_hist, bool clear);
+
     /// Mark sequence contained in the given packet as not lost. This
     /// removes the loss record from both current receiver loss list and
     /// the receiver fresh loss list.
@@ -1261,6 +1412,11 @@ private: // Identification
     std::string m_sStreamName;
     int m_iOPT_PeerIdleTimeout;      // Timeout for hearing anything from the peer.
     uint32_t m_uOPT_StabilityTimeout;
+    int m_iOPT_SndPacingDelay;       // Max time [ms] a live packet may be held back by adaptive pacing, 0 to off
+    bool m_bOPT_GroupFastSwitch;     // Fast link failure detection in backup groups
+    bool m_bOPT_GroupSharedRcv;      // Don't store the packets already stored by another group member
+    bool m_bOPT_AcceptThread;        // Listener: process connection requests outside the RcvQ worker
+    bool m_bOPT_CCSeed;              // Seed the congestion control from the host cache
 
     int m_iTsbPdDelay_ms;                           // Rx delay to absorb burst in milliseconds
     int m_iPeerTsbPdDelay_ms;                       // Tx delay that the peer uses to absorb burst in milliseconds
@@ -1272,7 +1428,7 @@ private: // Identification
 
 private:
     UniquePtr<CCryptoControl> m_pCryptoControl;                            // congestion control SRT class (small data extension)
-    CCache<CInfoBlock>* m_pCache;                // network information cache
+    CInfoCache* m_pCache;                        // network information cache
 
     // Congestion control
     std::vector<EventSlot> m_Slots[TEV__SIZE];
@@ -1303,6 +1459,11 @@ private:
     int m_iBandwidth;                            // Estimated bandwidth, number of packets per second
     int m_iRTT;                                  // RTT, in microseconds
     int m_iRTTVar;                               // RTT variance
+    int m_iRTTSample;                            // Last RTT sample, in microseconds: measured on ACKACK, or by the sender on ACK (see m_iRTTProbeSeq)
+    srt::sync::atomic<int32_t> m_iRTTProbeSeq;   // sequence of the data packet timed for the sender's RTT sample, -1 if none
+    srt::sync::atomic<int64_t> m_iRTTProbeSentTime; // time (us since epoch) when m_iRTTProbeSeq was sent
+    int m_iProbeRTT;                             // RTT measured with keepalive probes, in microseconds, 0 if unknown
+    srt::sync::atomic<int64_t> m_iProbeSentTime; // time (us since epoch) of the last unanswered probe, 0 if none
     int m_iDeliveryRate;                         // Packet arrival rate at the receiver side
     int m_iByteDeliveryRate;                     // Byte arrival rate at the receiver side
 
@@ -1345,6 +1506,7 @@ private: // Timers
     int m_iLightACKCount;                     // light ACK counter
 
     time_point m_tsNextSendTime;     // scheduled time of next packet sending
+    time_point m_tsLastUnpacedSndTime; // time the last packet was sent without a pacing schedule (for the pacing delay stats)
 
     volatile int32_t m_iSndLastFullAck;          // Last full ACK received
     volatile int32_t m_iSndLastAck;              // Last ACK received
@@ -1467,7 +1629,7 @@ private: // synchronization: mutexes and conditions
     srt::sync::Mutex m_SendLock;                 // used to synchronize "send" call
     srt::sync::Mutex m_RecvLock;                 // used to synchronize "recv" call
     srt::sync::Mutex m_RcvLossLock;              // Protects the receiver loss list (access: CRcvQueue::worker, CUDT::tsbpd)
-    srt::sync::Mutex m_StatsLock;                // used to synchronize access to trace statistics
+    srt::sync::Mutex m_StatsLock;                // used to synchronize the readers of trace statistics
 
     void initSynch();
     void destroySynch();
@@ -1491,15 +1653,17 @@ private: // Common connection Congestion Control setup
 
 private: // Generation and processing of packets
     void sendCtrl(UDTMessageType pkttype, const int32_t* lparam = NULL, void* rparam = NULL, int size = 0);
+    void traceLossReport(SRT_TRACE_EVENT type, const int32_t* losslist, size_t size);
 
-    void processCtrl(const CPacket& ctrlpkt);
+    void processCtrl(const CPacket& ctrlpkt, const time_point& currtime);
     void sendLossReport(const std::vector< std::pair<int32_t, int32_t> >& losslist);
     void processCtrlAck(const CPacket& ctrlpkt, const time_point &currtime);
-    void processCtrlLossReport(const CPacket& ctrlpkt);
+    void processCtrlLossReport(const CPacket& ctrlpkt, const time_point& currtime);
 
     ///
     /// @param ackdata_seqno    sequence number of a data packet being acknowledged
-    void updateSndLossListOnACK(int32_t ackdata_seqno);
+    /// @param currtime         time of the ACK's arrival
+    void updateSndLossListOnACK(int32_t ackdata_seqno, const time_point& currtime);
 
     /// Pack a packet from a list of lost packets.
     ///
@@ -1512,90 +1676,127 @@ private: // Generation and processing of packets
     /// Pack in CPacket the next data to be send.
     ///
     /// @param packet [in, out] a CPacket structure to fill
+    /// @param enter_time [in] the current time of the sending worker
     ///
     /// @return A pair of values is returned (payload, timestamp).
     ///         The payload tells the size of the payload, packed in CPacket.
     ///         The timestamp is the full source/origin timestamp of the data.
     ///         If payload is <= 0, consider the timestamp value invalid.
-    std::pair<int, time_point> packData(CPacket& packet);
+    std::pair<int, time_point> packData(CPacket& packet, const time_point& enter_time);
+
+    /// Calculate the interval to the next new packet in the adaptive live pacing
+    /// mode (SRTO_PACINGDELAY). The base rate follows the measured input rate with
+    /// the configured overhead, but it's sped up so that all packets waiting in
+    /// the sender buffer leave before the oldest of them exceeds the pacing horizon.
+    ///
+    /// @param now the current time
+    ///
+    /// @return the interval to wait before sending the next new packet.
+    duration livePacingInterval(const time_point& now);
 
-    int processData(CUnit* unit);
+    int processData(CUnit* unit, const time_point& arrival_time);
     void processClose();
     SRT_REJECT_REASON processConnectRequest(const sockaddr_any& addr, CPacket& packet);
     static void addLossRecord(std::vector<int32_t>& lossrecord, int32_t lo, int32_t hi);
-    int32_t bake(const sockaddr_any& addr, int32_t previous_cookie = 0, int correction = 0);
+    int32_t bake(const sockaddr_any& addr, int correction = 0);
     int32_t ackDataUpTo(int32_t seq);
-    void handleKeepalive(const char* data, size_t lenghth);
+    void handleKeepalive(int32_t info, const char* data, size_t lenghth);
+
+    /// Sends a keepalive probe, which the peer answers with a keepalive
+    /// response. This keeps an idle link in the backup group verified
+    /// and measures its RTT (see m_iProbeRTT).
+    void sendKeepaliveProbe();
 
 private: // Trace
+    // Statistics counters. Every counter is cumulative since the connection
+    // start and it's updated with a relaxed atomic addition, so the data path
+    // never waits for a statistics reader. The interval ("trace") values are
+    // calculated by bstats() as a difference to the baseline recorded at the
+    // last clear. Note that the counters aren't synchronized with one another,
+    // so a snapshot may catch one counter updated and a related one not yet.
+    enum EStatCounter
+    {
+        STAT_SENT,                  // data packets sent, including retransmissions
+        STAT_SENT_BYTES,            // payload bytes sent, including retransmissions
+        STAT_RETRANS,               // retransmitted packets
+        STAT_RETRANS_BYTES,         // retransmitted payload bytes
+        STAT_SND_LOSS,              // packets reported lost by the peer
+        STAT_SND_DROP,              // packets dropped by the sender as too late to send
+        STAT_SND_DROP_BYTES,        // payload bytes dropped by the sender
+        STAT_SENT_ACK,              // ACK packets sent
+        STAT_RECV_ACK,              // ACK packets received
+        STAT_SENT_NAK,              // NAK packets sent
+        STAT_RECV_NAK,              // NAK packets received
+        STAT_SND_FILTER_EXTRA,      // control packets supplied by the packet filter
+        STAT_SND_DURATION,          // time (us) the sender had data to send
+        STAT_SND_PACED,             // new packets sent in live mode
+        STAT_SND_PACING_DELAY,      // total time (us) these packets were held back by pacing
+        STAT_SND_BACKUP_SWITCH,     // takeovers of the transmission in a backup group
+        STAT_RECV,                  // data packets received
+        STAT_RECV_BYTES,            // payload bytes received
+        STAT_RCV_LOSS,              // packets detected lost by the receiver
+        STAT_RCV_LOSS_BYTES,        // payload bytes lost (estimate)
+        STAT_RCV_DROP,              // packets dropped by the receiver as too late to play
+        STAT_RCV_DROP_BYTES,        // payload bytes dropped by the receiver (estimate)
+        STAT_RCV_UNDECRYPT,         // packets that failed to decrypt
+        STAT_RCV_UNDECRYPT_BYTES,   // payload bytes that failed to decrypt
+        STAT_RCV_RETRANS,           // retransmitted packets received
+        STAT_RCV_BELATED,           // packets received too late and ignored
+        STAT_RCV_FILTER_EXTRA,      // control packets received and not supplied back
+        STAT_RCV_FILTER_SUPPLY,     // packets the packet filter supplied extra (rebuilt)
+        STAT_RCV_FILTER_LOSS,       // packet loss not coverable by the packet filter
+
+        STAT__SIZE
+    };
+
+    void countStat(EStatCounter counter, int64_t value = 1) { m_stats.counters[counter].fetch_add(value); }
+
     struct CoreStats
     {
         time_point tsStartTime;                 // timestamp when the UDT entity is started
-        int64_t sentTotal;                  // total number of sent data packets, including retransmissions
-        int64_t recvTotal;                  // total number of received packets
-        int sndLossTotal;                   // total number of lost packets (sender side)
-        int rcvLossTotal;                   // total number of lost packets (receiver side)
-        int retransTotal;                   // total number of retransmitted packets
-        int sentACKTotal;                   // total number of sent ACK packets
-        int recvACKTotal;                   // total number of received ACK packets
-        int sentNAKTotal;                   // total number of sent NAK packets
-        int recvNAKTotal;                   // total number of received NAK packets
-        int sndDropTotal;
-        int rcvDropTotal;
-        uint64_t bytesSentTotal;            // total number of bytes sent,  including retransmissions
-        uint64_t bytesRecvTotal;            // total number of received bytes
-        uint64_t rcvBytesLossTotal;         // total number of loss bytes (estimate)
-        uint64_t bytesRetransTotal;         // total number of retransmitted bytes
-        uint64_t sndBytesDropTotal;
-        uint64_t rcvBytesDropTotal;
-        int m_rcvUndecryptTotal;
-        uint64_t m_rcvBytesUndecryptTotal;
-
-        int sndFilterExtraTotal;
-        int rcvFilterExtraTotal;
-        int rcvFilterSupplyTotal;
-        int rcvFilterLossTotal;
-
-        int64_t m_sndDurationTotal;         // total real time for sending
-
-        time_point tsLastSampleTime;            // last performance sample time
-        int64_t traceSent;                  // number of packets sent in the last trace interval
-        int64_t traceRecv;                  // number of packets received in the last trace interval
-        int traceSndLoss;                   // number of lost packets in the last trace interval (sender side)
-        int traceRcvLoss;                   // number of lost packets in the last trace interval (receiver side)
-        int traceRetrans;                   // number of retransmitted packets in the last trace interval
-        int sentACK;                        // number of ACKs sent in the last trace interval
-        int recvACK;                        // number of ACKs received in the last trace interval
-        int sentNAK;                        // number of NAKs sent in the last trace interval
-        int recvNAK;                        // number of NAKs received in the last trace interval
-        int traceSndDrop;
-        int traceRcvDrop;
-        int traceRcvRetrans;
-        int traceReorderDistance;
-        double traceBelatedTime;
-        int64_t traceRcvBelated;
-        uint64_t traceBytesSent;            // number of bytes sent in the last trace interval
-        uint64_t traceBytesRecv;            // number of bytes sent in the last trace interval
-        uint64_t traceRcvBytesLoss;         // number of bytes bytes lost in the last trace interval (estimate)
-        uint64_t traceBytesRetrans;         // number of bytes retransmitted in the last trace interval
-        uint64_t traceSndBytesDrop;
-        uint64_t traceRcvBytesDrop;
-        int traceRcvUndecrypt;
-        uint64_t traceRcvBytesUndecrypt;
-
-        int sndFilterExtra;
-        int rcvFilterExtra;
-        int rcvFilterSupply;
-        int rcvFilterLoss;
-
-        int64_t sndDuration;                // real time for sending
-        time_point sndDurationCounter;         // timers to record the sending Duration
+        time_point tsLastSampleTime;            // last performance sample time (guarded by m_StatsLock)
+
+        srt::sync::atomic<int64_t> counters[STAT__SIZE];
+        int64_t base[STAT__SIZE];               // values of the counters at the last clear (guarded by m_StatsLock)
+
+        // Single-writer values (CRcvQueue::worker), not cleared by bstats
+        srt::sync::atomic<int> traceReorderDistance;
+        srt::sync::atomic<int64_t> traceBelatedTime;    // average belated time, in microseconds
+
+        srt::sync::atomic<int64_t> sndPacingDelayMax;   // max time (us) a new packet was held back by pacing
+        srt::sync::atomic<int64_t> sndBackupSwitchTime; // time (us) of the last takeover in a backup group (group sender)
+        srt::sync::atomic<int64_t> sndDurationCounter;  // time (us since epoch) when sending started or was last counted
+
+        // Delay distributions, cleared by histstats only
+        CLogHistogram histRcvTransit;   // arrival time versus the origin time on the TSBPD time base (CRcvQueue::worker)
+        CLogHistogram histRcvBuffer;    // time from arrival to delivery to the application (TSBPD readMsg only)
+        CLogHistogram histSndLag;       // delay of sending versus the CSndUList schedule (CSndQueue::worker)
     } m_stats;
 
+    // Consistent view of the counters taken by a statistics reader.
+    struct StatsSnapshot
+    {
+        int64_t total[STAT__SIZE];
+        int64_t trace[STAT__SIZE];
+        int64_t pacingDelayMax;
+        time_point currtime;
+        time_point lastsample;
+    };
+
+    /// Reads all counters under m_StatsLock and, if requested,
+    /// moves the baseline of the interval values to the current state.
+    void snapshotStats(StatsSnapshot& w_snap, bool clear);
+
 public:
     static const int SELF_CLOCK_INTERVAL = 64;  // ACK interval for self-clocking
     static const int SEND_LITE_ACK = sizeof(int32_t); // special size for ack containing only ack seq
     static const int PACKETPAIR_MASK = 0xF;
+    static const int PACING_BURST_PKTS = 4;     // depth of the adaptive live pacing token bucket, in packets
+    static const int64_t HOSTINFO_CC_MAXAGE_US = 60*1000*1000; // age of the cached congestion state still used to seed a new connection
+
+    // Additional info of UMSG_KEEPALIVE
+    static const int32_t KEEPALIVE_PROBE = 1;          // the peer is requested to respond
+    static const int32_t KEEPALIVE_PROBE_RESPONSE = 2; // response to KEEPALIVE_PROBE
 
     static const size_t MAX_SID_LENGTH = 512;
 
@@ -1609,7 +1810,7 @@ private: // Timers functions
                      BECAUSE_NAKREPORT = 1 << 2,
                      LAST_BECAUSE_BIT  =      3;
 
-    void checkTimers();
+    void checkTimers(const time_point& currtime);
     void considerLegacySrtHandshake(const time_point &timebase);
     int checkACKTimer (const time_point& currtime);
     int checkNAKTimer(const time_point& currtime);
@@ -1622,6 +1823,11 @@ public: // For the use of CCryptoControl
     unsigned int m_uKmPreAnnouncePkt;
 
 
+private: // SYN cookies, see bake()
+    static const int64_t COOKIE_EPOCH_US = 60*1000*1000; // the secret changes every minute
+    unsigned char m_CookieSecret[2][CSipHash::KEY_SIZE]; // for even and odd epochs
+    int64_t m_iCookieEpoch;         // the epoch of the latest secret, -1 if none
+
 private: // for UDP multiplexer
     CSndQueue* m_pSndQueue;         // packet sending queue
     CRcvQueue* m_pRcvQueue;         // packet receiving queue
@@ -150,6 +150,23 @@ int CEPoll::clear_usocks(int eid)
 }
 
 
+int CEPoll::watched_usocks(const int eid, vector<SRTSOCKET>& w_socks)
+{
+   CGuard pg (m_EPollLock);
+
+   map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+   if (p == m_mPolls.end())
+      throw CUDTException(MJ_NOTSUP, MN_EIDINVAL);
+
+   const CEPollDesc& d = p->second;
+   int count = 0;
+   for (CEPollDesc::ewatch_t::const_iterator i = d.watch_begin(); i != d.watch_end(); ++i, ++count)
+      w_socks.push_back(i->first);
+
+   return count;
+}
+
+
 void CEPoll::clear_ready_usocks(CEPollDesc& d, int direction)
 {
     if ((direction & ~SRT_EPOLL_EVENTTYPES) != 0)
@@ -57,6 +57,7 @@ modified by
 #include <map>
 #include <set>
 #include <list>
+#include <vector>
 #include "udt.h"
 
 
@@ -178,6 +179,8 @@ public:
 
    // Container accessors for ewatch_t.
    bool watch_empty() const { return m_USockWatchState.empty(); }
+   ewatch_t::const_iterator watch_begin() const { return m_USockWatchState.begin(); }
+   ewatch_t::const_iterator watch_end() const { return m_USockWatchState.end(); }
    Wait* watch_find(SRTSOCKET sock)
    {
        ewatch_t::iterator i = m_USockWatchState.find(sock);
@@ -414,6 +417,13 @@ public: // for CUDTUnited API
 
    int update_ssock(const int eid, const SYSSOCKET& s, const int* events = NULL);
 
+   /// retrieve the UDT sockets subscribed in an EPoll.
+   /// @param [in] eid EPoll ID.
+   /// @param [out] w_socks the subscribed sockets, appended.
+   /// @return number of subscribed sockets.
+
+   int watched_usocks(const int eid, std::vector<SRTSOCKET>& w_socks);
+
    /// wait for EPoll events or timeout.
    /// @param [in] eid EPoll ID.
    /// @param [out] readfds UDT sockets available for reading.
@@ -303,6 +303,20 @@ int CSndLossList::getLossLength() const
     return m_iLength;
 }
 
+void CSndLossList::clear()
+{
+    CGuard listguard(m_ListLock);
+
+    for (int i = 0; i < m_iSize; ++i)
+    {
+        m_caSeq[i].seqstart = -1;
+        m_caSeq[i].seqend   = -1;
+    }
+    m_iHead          = -1;
+    m_iLength        = 0;
+    m_iLastInsertPos = -1;
+}
+
 int32_t CSndLossList::popLostSeq()
 {
     CGuard listguard(m_ListLock);
@@ -690,6 +704,18 @@ int CRcvLossList::getLossLength() const
     return m_iLength;
 }
 
+void CRcvLossList::clear()
+{
+    for (int i = 0; i < m_iSize; ++i)
+    {
+        m_caSeq[i].seqstart = -1;
+        m_caSeq[i].seqend   = -1;
+    }
+    m_iHead   = -1;
+    m_iTail   = -1;
+    m_iLength = 0;
+}
+
 int CRcvLossList::getFirstLostSeq() const
 {
     if (0 == m_iLength)
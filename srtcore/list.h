@@ -81,6 +81,15 @@ public:
 
    int getLossLength() const;
 
+      /// Remove all losses from the list.
+
+   void clear();
+
+      /// Read the number of nodes of the static array.
+      /// @return The size given at construction.
+
+   int capacity() const { return m_iSize; }
+
       /// Read the first (smallest) loss seq. no. in the list and remove it.
       /// @return The seq. no. or -1 if the list is empty.
 
@@ -166,6 +175,15 @@ public:
 
    int getLossLength() const;
 
+      /// Remove all losses from the list.
+
+   void clear();
+
+      /// Read the number of nodes of the static array.
+      /// @return The size given at construction.
+
+   int capacity() const { return m_iSize; }
+
       /// Read the first (smallest) seq. no. in the list.
       /// @return the sequence number or -1 if the list is empty.
 
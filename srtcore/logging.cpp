@@ -0,0 +1,379 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#define SRT_IMPORT_TIME 1
+#include "platform_sys.h"
+
+#include <cstring>
+#include "logging.h"
+
+using namespace std;
+using namespace srt::sync;
+
+namespace srt_logging
+{
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Per-thread log line
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static pthread_key_t s_LogLineKey;
+static pthread_once_t s_LogLineKeyOnce = PTHREAD_ONCE_INIT;
+
+static void LogLineDestroy(void* line)
+{
+    delete static_cast<LogLine*>(line);
+}
+
+static void LogLineKeyCreate()
+{
+    pthread_key_create(&s_LogLineKey, LogLineDestroy);
+}
+
+LogLine* LogLine::acquire()
+{
+    pthread_once(&s_LogLineKeyOnce, LogLineKeyCreate);
+    LogLine* ln = static_cast<LogLine*>(pthread_getspecific(s_LogLineKey));
+    if (!ln)
+    {
+        ln = new LogLine;
+        pthread_setspecific(s_LogLineKey, ln);
+    }
+    else if (ln->m_busy)
+    {
+        return NULL;
+    }
+
+    // Restore the state of a fresh stream, as formatting of the
+    // previous line might have changed it or truncated the line.
+    ln->m_busy = true;
+    ln->buf.clear();
+    ln->os.clear();
+    ln->os.flags(ln->m_flags);
+    ln->os.fill(' ');
+    ln->os.precision(6);
+    ln->os.width(0);
+    return ln;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Asynchronous log queue
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Bounded lock-free queue of log lines with multiple producers and a single
+// consumer (the writer thread). Every slot has a sequence number telling
+// whether it's free for the producer at given position or filled for the
+// consumer, so producers only compete for the position.
+class LogAsyncQueue
+{
+public:
+    static const size_t SIZE = 1024; // power of two
+
+    LogAsyncQueue(LogConfig& config);
+    ~LogAsyncQueue();
+
+    bool start();
+    void stop();
+
+    // See LogConfig::asyncEnter().
+    bool enter();
+    void leave() { m_iProducers.fetch_add(-1); }
+
+    // Returns false and counts the line as dropped, if the queue is full.
+    bool push(int level, const char* file, int line, const char* area, const LogLine& text);
+
+    srt::sync::atomic<int64_t> m_iDropped;
+
+private:
+    struct Slot
+    {
+        srt::sync::atomic<uint64_t> seq;
+        timeval time;
+        int level;
+        const char* file;
+        int line;
+        const char* area;
+        size_t len;
+        char text[LogLineBuf::SIZE];
+    };
+
+    static void* worker(void* param);
+    size_t write();
+
+    LogConfig& m_Config;
+    Slot* m_Slots;
+    srt::sync::atomic<uint64_t> m_uEnqueuePos;
+    uint64_t m_uDequeuePos; // used by the writer only
+
+    Mutex m_Lock;
+    Condition m_Cond;
+    bool m_bRunning;
+    bool m_bStarted; // the writer thread is joinable
+    srt::sync::atomic<int> m_iWaiting;
+    srt::sync::atomic<int> m_iAccepting; // lines may be pushed
+    srt::sync::atomic<int> m_iProducers; // threads between enter() and leave()
+    pthread_t m_Thread;
+};
+
+LogAsyncQueue::LogAsyncQueue(LogConfig& config)
+    : m_iDropped(0)
+    , m_Config(config)
+    , m_Slots(new Slot[SIZE])
+    , m_uEnqueuePos(0)
+    , m_uDequeuePos(0)
+    , m_bRunning(false)
+    , m_bStarted(false)
+    , m_iWaiting(0)
+    , m_iAccepting(0)
+    , m_iProducers(0)
+{
+    for (size_t i = 0; i < SIZE; ++i)
+        m_Slots[i].seq.store(i);
+    m_Cond.init();
+}
+
+LogAsyncQueue::~LogAsyncQueue()
+{
+    stop();
+    m_Cond.destroy();
+    delete[] m_Slots;
+}
+
+bool LogAsyncQueue::start()
+{
+    ScopedLock lk(m_Lock);
+    if (m_bStarted)
+        return true;
+
+    m_bRunning = true;
+    if (pthread_create(&m_Thread, NULL, worker, this) != 0)
+    {
+        m_bRunning = false;
+        return false;
+    }
+    m_bStarted = true;
+    m_iAccepting.store(1);
+    return true;
+}
+
+void LogAsyncQueue::stop()
+{
+    {
+        ScopedLock lk(m_Lock);
+        if (!m_bStarted)
+            return;
+        m_iAccepting.store(0);
+    }
+
+    // Let the threads that have already decided to push a line finish, so
+    // that their lines are written out below and not left in the queue.
+    // The new ones see m_iAccepting cleared and log synchronously.
+    atomic_fence_seq_cst();
+    while (m_iProducers.load() != 0)
+        SleepFor(microseconds_from(100));
+
+    {
+        ScopedLock lk(m_Lock);
+        m_bRunning = false;
+        m_Cond.notify_one();
+    }
+
+    pthread_join(m_Thread, NULL);
+    {
+        ScopedLock lk(m_Lock);
+        m_bStarted = false;
+    }
+
+    // Lines pushed while the writer was exiting.
+    write();
+}
+
+bool LogAsyncQueue::enter()
+{
+    m_iProducers.fetch_add(1);
+    atomic_fence_seq_cst();
+    if (m_iAccepting.load())
+        return true;
+    leave();
+    return false;
+}
+
+bool LogAsyncQueue::push(int level, const char* file, int line, const char* area, const LogLine& text)
+{
+    uint64_t pos = m_uEnqueuePos.load();
+    Slot* slot;
+    for (;;)
+    {
+        slot = &m_Slots[pos & (SIZE - 1)];
+        const int64_t diff = int64_t(slot->seq.load_acquire() - pos);
+        if (diff == 0)
+        {
+            // On failure pos is updated to the current position.
+            if (m_uEnqueuePos.compare_exchange((pos), pos + 1))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // The slot wasn't yet written out by the writer.
+            m_iDropped.fetch_add(1);
+            return false;
+        }
+        else
+        {
+            pos = m_uEnqueuePos.load();
+        }
+    }
+
+    slot->time = text.time;
+    slot->level = level;
+    slot->file = file;
+    slot->line = line;
+    slot->area = area;
+    slot->len = text.buf.size();
+    memcpy(slot->text, text.buf.data(), slot->len);
+    slot->seq.store_release(pos + 1);
+
+    if (m_iWaiting.load())
+        m_Cond.notify_one();
+    return true;
+}
+
+size_t LogAsyncQueue::write()
+{
+    size_t count = 0;
+    // Time prefix, the message and EOL
+    char msg[64 + LogLineBuf::SIZE + 2];
+    for (;;)
+    {
+        Slot& slot = m_Slots[m_uDequeuePos & (SIZE - 1)];
+        if (slot.seq.load_acquire() != m_uDequeuePos + 1)
+            break;
+
+        const int flags = m_Config.flags;
+        size_t len = 0;
+        if (!(flags & SRT_LOGF_DISABLE_TIME))
+        {
+            struct tm tm = SysLocalTime((time_t) slot.time.tv_sec);
+            len = strftime(msg, 32, "%X.", &tm);
+            len += sprintf(msg + len, "%06d", int(slot.time.tv_usec));
+        }
+        memcpy(msg + len, slot.text, slot.len);
+        len += slot.len;
+        if (!(flags & SRT_LOGF_DISABLE_EOL))
+            msg[len++] = '\n';
+        msg[len] = '\0';
+
+        // The handler is called without the lock, so that it may use the
+        // logging API, and the threads logging synchronously don't wait
+        // for it. Only the stream, shared with them, is written under it.
+        m_Config.lock();
+        SRT_LOG_HANDLER_FN* handler = m_Config.loghandler_fn;
+        void* opaque = m_Config.loghandler_opaque;
+        if (!handler && m_Config.log_stream)
+        {
+            m_Config.log_stream->write(msg, len);
+            m_Config.log_stream->flush();
+        }
+        m_Config.unlock();
+        if (handler)
+            (*handler)(opaque, slot.level, slot.file, slot.line, slot.area, msg);
+
+        slot.seq.store_release(m_uDequeuePos + SIZE);
+        ++m_uDequeuePos;
+        ++count;
+    }
+    return count;
+}
+
+void* LogAsyncQueue::worker(void* param)
+{
+    LogAsyncQueue* self = static_cast<LogAsyncQueue*>(param);
+    ThreadName::set("SRT:Log");
+
+    for (;;)
+    {
+        const size_t written = self->write();
+
+        UniqueLock lk(self->m_Lock);
+        if (!self->m_bRunning)
+            break;
+
+        if (written == 0)
+        {
+            // Producers signal only when the writer waits, and they don't
+            // lock, so the signal may be missed; the timeout covers that.
+            self->m_iWaiting.store(1);
+            self->m_Cond.wait_for(lk, milliseconds_from(10));
+            self->m_iWaiting.store(0);
+        }
+    }
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// LogConfig and LogDispatcher
+//
+////////////////////////////////////////////////////////////////////////////////
+
+LogConfig::~LogConfig()
+{
+    // Write out the remaining lines, if the asynchronous mode was left on.
+    if (async_queue)
+        async_queue->stop();
+}
+
+void LogConfig::setFlags(int flg)
+{
+    int old_flags;
+    {
+        ScopedLock lk(mutex);
+        old_flags = flags;
+        if ((flg & SRT_LOGF_ASYNC) && !(old_flags & SRT_LOGF_ASYNC))
+        {
+            if (!async_queue)
+                async_queue = new LogAsyncQueue(*this);
+            if (!async_queue->start())
+                flg &= ~SRT_LOGF_ASYNC;
+        }
+        flags = flg;
+    }
+
+    // The writer takes the lock to write a line.
+    if ((old_flags & SRT_LOGF_ASYNC) && !(flg & SRT_LOGF_ASYNC))
+        async_queue->stop();
+}
+
+int64_t LogConfig::asyncDropped() const
+{
+    return async_queue ? async_queue->m_iDropped.load() : 0;
+}
+
+bool LogConfig::asyncEnter()
+{
+    return async_queue && async_queue->enter();
+}
+
+void LogConfig::asyncLeave()
+{
+    async_queue->leave();
+}
+
+void LogDispatcher::SendLogLine(const char*  file, int line, const char* area, const LogLine& ln)
+{
+    src_config->async_queue->push(int(level), file, line, area, ln);
+    src_config->asyncLeave();
+}
+
+} // namespace srt_logging
@@ -42,8 +42,27 @@ written by
 #define PRINTF_LIKE 
 #endif
 
+// The least severe level of the log sites compiled into the library, see the
+// LOGGING_MIN_LEVEL build option. Log sites of less severe levels compile to
+// nothing, regardless of the runtime settings.
+#ifndef SRT_LOGGING_MIN_LEVEL
+#define SRT_LOGGING_MIN_LEVEL LOG_DEBUG
+#endif
+
+#if ENABLE_HEAVY_LOGGING && SRT_LOGGING_MIN_LEVEL < LOG_DEBUG
+#error "ENABLE_HEAVY_LOGGING requires SRT_LOGGING_MIN_LEVEL=LOG_DEBUG"
+#endif
+
 #if ENABLE_LOGGING
 
+// LOG_ENABLED is true if the log site is compiled in and the dispatcher is
+// enabled at runtime. The first part is a constant expression, so with a site
+// below SRT_LOGGING_MIN_LEVEL the whole instruction is removed by the compiler.
+// Use it to guard calculations done only for the sake of logging.
+// Usage: if (LOG_ENABLED(mglog.Debug)) { ... }
+#define LOG_ENABLED(logdes) \
+    (sizeof(srt_logging::LogSiteCompiled(logdes)) == sizeof(srt_logging::LogSiteOn) && logdes.CheckEnabled())
+
 // GENERAL NOTE: All logger functions ADD THEIR OWN \n (EOL). Don't add any your own EOL character.
 // The logging system may not add the EOL character, if appropriate flag was set in log settings.
 // Anyway, treat the whole contents of eventually formatted message as exactly one line.
@@ -51,7 +70,7 @@ written by
 // LOGC uses an iostream-like syntax, using the special 'log' symbol.
 // This symbol isn't visible outside the log macro parameters.
 // Usage: LOGC(mglog.Debug, log << param1 << param2 << param3);
-#define LOGC(logdes, args) if (logdes.CheckEnabled()) \
+#define LOGC(logdes, args) if (LOG_ENABLED(logdes)) \
 { \
     srt_logging::LogDispatcher::Proxy log(logdes); \
     log.setloc(__FILE__, __LINE__, __FUNCTION__); \
@@ -60,11 +79,11 @@ written by
 
 // LOGF uses printf-like style formatting.
 // Usage: LOGF(mglog.Debug, "%s: %d", param1.c_str(), int(param2));
-#define LOGF(logdes, ...) if (logdes.CheckEnabled()) logdes().setloc(__FILE__, __LINE__, __FUNCTION__).form(__VA_ARGS__)
+#define LOGF(logdes, ...) if (LOG_ENABLED(logdes)) logdes().setloc(__FILE__, __LINE__, __FUNCTION__).form(__VA_ARGS__)
 
 // LOGP is C++11 only OR with only one string argument.
 // Usage: LOGP(mglog.Debug, param1, param2, param3);
-#define LOGP(logdes, ...) if (logdes.CheckEnabled()) logdes.printloc(__FILE__, __LINE__, __FUNCTION__,##__VA_ARGS__)
+#define LOGP(logdes, ...) if (LOG_ENABLED(logdes)) logdes.printloc(__FILE__, __LINE__, __FUNCTION__,##__VA_ARGS__)
 
 #if ENABLE_HEAVY_LOGGING
 
@@ -86,6 +105,8 @@ written by
 
 #else
 
+#define LOG_ENABLED(logdes) false
+
 #define LOGC(...)
 #define LOGF(...)
 #define LOGP(...)
@@ -101,7 +122,9 @@ written by
 namespace srt_logging
 {
 
-struct LogConfig
+class LogAsyncQueue;
+
+struct SRT_API LogConfig
 {
     typedef std::bitset<SRT_LOGFA_LASTNONE+1> fa_bitset_t;
     fa_bitset_t enabled_fa;   // NOTE: assumed atomic reading
@@ -111,6 +134,7 @@ struct LogConfig
     void* loghandler_opaque;
     srt::sync::Mutex mutex;
     int flags;
+    LogAsyncQueue* async_queue; // created with the first SRT_LOGF_ASYNC, never deleted
 
     LogConfig(const fa_bitset_t& efa,
             LogLevel::type l = LogLevel::warning,
@@ -121,15 +145,62 @@ struct LogConfig
         , loghandler_fn()
         , loghandler_opaque()
         , flags()
+        , async_queue()
     {
     }
 
-    ~LogConfig()
-    {
-    }
+    ~LogConfig();
 
     void lock() { mutex.lock(); }
     void unlock() { mutex.unlock(); }
+
+    // Sets the flags and starts or stops the thread writing the log lines
+    // when SRT_LOGF_ASYNC is changed. Must be called without the lock.
+    void setFlags(int flg);
+
+    // Number of log lines dropped in SRT_LOGF_ASYNC mode because the queue was full.
+    int64_t asyncDropped() const;
+
+    // Registers a thread about to push a line to the asynchronous queue.
+    // Returns false if the queue is stopped or being stopped; the line must
+    // be written synchronously then. Otherwise asyncLeave() must follow.
+    bool asyncEnter();
+    void asyncLeave();
+};
+
+// A log line formatted into a preallocated buffer, so that it doesn't need
+// any allocation. There's one per thread, used in SRT_LOGF_ASYNC mode.
+// Lines longer than the buffer are truncated.
+class LogLineBuf: public std::streambuf
+{
+public:
+    static const size_t SIZE = 512;
+
+    LogLineBuf() { setp(m_buf, m_buf + SIZE); }
+    void clear() { setp(m_buf, m_buf + SIZE); }
+    const char* data() const { return m_buf; }
+    size_t size() const { return pptr() - pbase(); }
+
+private:
+    char m_buf[SIZE];
+};
+
+struct LogLine
+{
+    LogLineBuf buf;
+    std::ostream os;
+    timeval time;
+
+    LogLine(): os(&buf), time(), m_busy(false), m_flags(os.flags()) {}
+
+    // Returns this thread's line, ready to be written, or NULL if it's
+    // already in use (a log line formatted while formatting another one).
+    static LogLine* acquire();
+    void release() { m_busy = false; }
+
+private:
+    bool m_busy;
+    std::ios_base::fmtflags m_flags;
 };
 
 // The LogDispatcher class represents the object that is responsible for
@@ -176,8 +247,9 @@ public:
 
     bool CheckEnabled();
 
-    void CreateLogLinePrefix(std::ostringstream&);
-    void SendLogLine(const char* file, int line, const std::string& area, const std::string& sl);
+    void CreateLogLinePrefix(std::ostream&, bool with_time = true);
+    void SendLogLine(const char* file, int line, const char* area, const std::string& sl);
+    void SendLogLine(const char* file, int line, const char* area, const LogLine& ln);
 
     // log.Debug("This is the ", nth, " time");  <--- C++11 only.
     // log.Debug() << "This is the " << nth << " time";  <--- C++03 available.
@@ -185,7 +257,7 @@ public:
 #if HAVE_CXX11
 
     template <class... Args>
-    void PrintLogLine(const char* file, int line, const std::string& area, Args&&... args);
+    void PrintLogLine(const char* file, int line, const char* area, Args&&... args);
 
     template<class Arg1, class... Args>
     void operator()(Arg1&& arg1, Args&&... args)
@@ -194,13 +266,13 @@ public:
     }
 
     template<class Arg1, class... Args>
-    void printloc(const char* file, int line, const std::string& area, Arg1&& arg1, Args&&... args)
+    void printloc(const char* file, int line, const char* area, Arg1&& arg1, Args&&... args)
     {
         PrintLogLine(file, line, area, arg1, args...);
     }
 #else
     template <class Arg>
-    void PrintLogLine(const char* file, int line, const std::string& area, const Arg& arg);
+    void PrintLogLine(const char* file, int line, const char* area, const Arg& arg);
 
     // For C++03 (older) standard provide only with one argument.
     template <class Arg>
@@ -209,7 +281,7 @@ public:
         PrintLogLine("UNKNOWN.c++", 0, "UNKNOWN", arg);
     }
 
-    void printloc(const char* file, int line, const std::string& area, const std::string& arg1)
+    void printloc(const char* file, int line, const char* area, const std::string& arg1)
     {
         PrintLogLine(file, line, area, arg1);
     }
@@ -241,7 +313,7 @@ public:
             return *this;
         }
 
-        DummyProxy& setloc(const char* , int , std::string)
+        DummyProxy& setloc(const char* , int , const char*)
         {
             return *this;
         }
@@ -262,7 +334,12 @@ struct LogDispatcher::Proxy
 {
     LogDispatcher& that;
 
-    std::ostringstream os;
+    // The stream for the synchronous mode. It's created only when needed,
+    // as its construction is expensive.
+    std::ostringstream* os;
+
+    // This thread's preallocated line in SRT_LOGF_ASYNC mode, used instead of os.
+    LogLine* line;
 
     // Cache the 'enabled' state in the beginning. If the logging
     // becomes enabled or disabled in the middle of the log, we don't
@@ -273,9 +350,11 @@ struct LogDispatcher::Proxy
     // CACHE!!!
     const char* i_file;
     int i_line;
-    std::string area;
+    const char* area;
 
-    Proxy& setloc(const char* f, int l, std::string a)
+    std::ostream& out() { return line ? line->os : *os; }
+
+    Proxy& setloc(const char* f, int l, const char* a)
     {
         i_file = f;
         i_line = l;
@@ -294,7 +373,7 @@ struct LogDispatcher::Proxy
     // Copy constructor is needed due to noncopyable ostringstream.
     // This is used only in creation of the default object, so just
     // use the default values, just copy the location cache.
-    Proxy(const Proxy& p): that(p.that), area(p.area)
+    Proxy(const Proxy& p): that(p.that), os(), line(), area(p.area)
     {
         i_file = p.i_file;
         i_line = p.i_line;
@@ -308,18 +387,25 @@ struct LogDispatcher::Proxy
     {
         if ( that_enabled )
         {
-            os << arg;
+            out() << arg;
         }
         return *this;
     }
 
     ~Proxy()
     {
-        if ( that_enabled )
+        if ( line )
+        {
+            // EOL is added by the writer thread
+            that.SendLogLine(i_file, i_line, area, *line);
+            line->release();
+        }
+        else if ( os )
         {
             if ( (flags & SRT_LOGF_DISABLE_EOL) == 0 )
-                os << std::endl;
-            that.SendLogLine(i_file, i_line, area, os.str());
+                *os << std::endl;
+            that.SendLogLine(i_file, i_line, area, os->str());
+            delete os;
         }
         // Needed in destructor?
         //os.clear();
@@ -354,7 +440,7 @@ struct LogDispatcher::Proxy
             buf[len-1] = '\0';
         }
 
-        os << buf;
+        out() << buf;
         return *this;
     }
 };
@@ -362,6 +448,31 @@ struct LogDispatcher::Proxy
 
 #endif
 
+// The dispatcher with the level known at compile time,
+// so that LOG_ENABLED can tell if its sites are compiled in.
+template <LogLevel::type LEVEL>
+struct LevelDispatcher: public LogDispatcher
+{
+    LevelDispatcher(int functional_area, const char* your_pfx,
+            const char* logger_pfx /*[[nullable]]*/, LogConfig& config):
+        LogDispatcher(functional_area, LEVEL, your_pfx, logger_pfx, config)
+    {
+    }
+};
+
+// Used by LOG_ENABLED in sizeof only, never defined.
+typedef char LogSiteOn[2];
+typedef char LogSiteOff[1];
+
+template <bool COMPILED> struct LogSiteTag { typedef LogSiteOff& type; };
+template <> struct LogSiteTag<true> { typedef LogSiteOn& type; };
+
+template <LogLevel::type LEVEL>
+typename LogSiteTag<(int(LEVEL) <= SRT_LOGGING_MIN_LEVEL)>::type LogSiteCompiled(const LevelDispatcher<LEVEL>&);
+
+// The level of other dispatchers is known only at runtime.
+LogSiteOn& LogSiteCompiled(const LogDispatcher&);
+
 class Logger
 {
     int m_fa;
@@ -369,20 +480,20 @@ class Logger
 
 public:
 
-    LogDispatcher Debug;
-    LogDispatcher Note;
-    LogDispatcher Warn;
-    LogDispatcher Error;
-    LogDispatcher Fatal;
+    LevelDispatcher<LogLevel::debug> Debug;
+    LevelDispatcher<LogLevel::note> Note;
+    LevelDispatcher<LogLevel::warning> Warn;
+    LevelDispatcher<LogLevel::error> Error;
+    LevelDispatcher<LogLevel::fatal> Fatal;
 
     Logger(int functional_area, LogConfig& config, const char* logger_pfx = NULL):
         m_fa(functional_area),
         m_config(config),
-        Debug ( m_fa, LogLevel::debug, " D", logger_pfx, m_config ),
-        Note  ( m_fa, LogLevel::note,  ".N", logger_pfx, m_config ),
-        Warn  ( m_fa, LogLevel::warning, "!W", logger_pfx, m_config ),
-        Error ( m_fa, LogLevel::error, "*E", logger_pfx, m_config ),
-        Fatal ( m_fa, LogLevel::fatal, "!!FATAL!!", logger_pfx, m_config )
+        Debug ( m_fa, " D", logger_pfx, m_config ),
+        Note  ( m_fa, ".N", logger_pfx, m_config ),
+        Warn  ( m_fa, "!W", logger_pfx, m_config ),
+        Error ( m_fa, "*E", logger_pfx, m_config ),
+        Fatal ( m_fa, "!!FATAL!!", logger_pfx, m_config )
     {
     }
 
@@ -419,36 +530,25 @@ inline void PrintArgs(std::ostream& serr, Arg1&& arg1, Args&&... args)
 }
 
 template <class... Args>
-inline void LogDispatcher::PrintLogLine(const char* file ATR_UNUSED, int line ATR_UNUSED, const std::string& area ATR_UNUSED, Args&&... args ATR_UNUSED)
+inline void LogDispatcher::PrintLogLine(const char* file ATR_UNUSED, int line ATR_UNUSED, const char* area ATR_UNUSED, Args&&... args ATR_UNUSED)
 {
-#ifdef ENABLE_LOGGING
-    std::ostringstream serr;
-    CreateLogLinePrefix(serr);
-    PrintArgs(serr, args...);
-
-    if ( !isset(SRT_LOGF_DISABLE_EOL) )
-        serr << std::endl;
-
-    // Not sure, but it wasn't ever used.
-    SendLogLine(file, line, area, serr.str());
+#if ENABLE_LOGGING
+    Proxy log(*this);
+    log.setloc(file, line, area);
+    if (log.that_enabled)
+        PrintArgs(log.out(), args...);
 #endif
 }
 
 #else
 
 template <class Arg>
-inline void LogDispatcher::PrintLogLine(const char* file ATR_UNUSED, int line ATR_UNUSED, const std::string& area ATR_UNUSED, const Arg& arg ATR_UNUSED)
+inline void LogDispatcher::PrintLogLine(const char* file ATR_UNUSED, int line ATR_UNUSED, const char* area ATR_UNUSED, const Arg& arg ATR_UNUSED)
 {
-#ifdef ENABLE_LOGGING
-    std::ostringstream serr;
-    CreateLogLinePrefix(serr);
-    serr << arg;
-
-    if ( !isset(SRT_LOGF_DISABLE_EOL) )
-        serr << std::endl;
-
-    // Not sure, but it wasn't ever used.
-    SendLogLine(file, line, area, serr.str());
+#if ENABLE_LOGGING
+    Proxy log(*this);
+    log.setloc(file, line, area);
+    log << arg;
 #endif
 }
 
@@ -457,12 +557,12 @@ inline void LogDispatcher::PrintLogLine(const char* file ATR_UNUSED, int line AT
 // SendLogLine can be compiled normally. It's intermediately used by:
 // - Proxy object, which is replaced by DummyProxy when !ENABLE_LOGGING
 // - PrintLogLine, which has empty body when !ENABLE_LOGGING
-inline void LogDispatcher::SendLogLine(const char* file, int line, const std::string& area, const std::string& msg)
+inline void LogDispatcher::SendLogLine(const char* file, int line, const char* area, const std::string& msg)
 {
     src_config->lock();
     if ( src_config->loghandler_fn )
     {
-        (*src_config->loghandler_fn)(src_config->loghandler_opaque, int(level), file, line, area.c_str(), msg.c_str());
+        (*src_config->loghandler_fn)(src_config->loghandler_opaque, int(level), file, line, area, msg.c_str());
     }
     else if ( src_config->log_stream )
     {
@@ -44,6 +44,9 @@ written by
 #define SRT_LOGF_DISABLE_THREADNAME 2
 #define SRT_LOGF_DISABLE_SEVERITY 4
 #define SRT_LOGF_DISABLE_EOL 8
+// Format log lines into preallocated buffers and write them from a separate
+// thread. Lines are dropped, if the queue is full, instead of blocking.
+#define SRT_LOGF_ASYNC 16
 
 // Handler type.
 typedef void SRT_LOG_HANDLER_FN(void* opaque, int level, const char* file, int line, const char* area, const char* message);
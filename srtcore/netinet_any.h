@@ -266,11 +266,25 @@ struct sockaddr_any
         return EqualAddress()(*this, rhs);
     }
 
+    // Orders the addresses by the same fields as Equal compares,
+    // so that it can be used as a key comparator in std::map.
     struct Less
     {
-        bool operator()(const sockaddr_any& c1, const sockaddr_any& c2)
+        bool operator()(const sockaddr_any& c1, const sockaddr_any& c2) const
         {
-            return memcmp(&c1, &c2, sizeof(c1)) < 0;
+            if (c1.sa.sa_family != c2.sa.sa_family)
+                return c1.sa.sa_family < c2.sa.sa_family;
+
+            if (c1.sin.sin_port != c2.sin.sin_port)
+                return c1.sin.sin_port < c2.sin.sin_port;
+
+            if (c1.sa.sa_family == AF_INET)
+                return c1.sin.sin_addr.s_addr < c2.sin.sin_addr.s_addr;
+
+            if (c1.sa.sa_family == AF_INET6)
+                return memcmp(&c1.sin6.sin6_addr, &c2.sin6.sin6_addr, sizeof (in6_addr)) < 0;
+
+            return false;
         }
     };
 
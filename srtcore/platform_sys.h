@@ -21,6 +21,7 @@
 //
 // SRT_IMPORT_TIME   (mach time on Mac, portability gettimeofday on WIN32)
 // SRT_IMPORT_EVENT  (includes kevent on Mac)
+// SRT_IMPORT_FILEMAP (mmap and positioned vector I/O, POSIX only)
 
 
 #ifdef _WIN32
@@ -93,6 +94,13 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifdef SRT_IMPORT_FILEMAP
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <sys/uio.h>
+   #include <limits.h>
+#endif
+
 #ifdef __cplusplus
 // Headers for errno, string and stdlib are
 // included indirectly correct C++ way.
@@ -271,6 +271,11 @@ CSndUList::~CSndUList()
 }
 
 void CSndUList::update(const CUDT* u, EReschedule reschedule)
+{
+    update(u, reschedule, steady_clock::now());
+}
+
+void CSndUList::update(const CUDT* u, EReschedule reschedule, const steady_clock::time_point& currtime)
 {
     CGuard listguard(m_ListLock);
 
@@ -283,20 +288,20 @@ void CSndUList::update(const CUDT* u, EReschedule reschedule)
 
         if (n->m_iHeapLoc == 0)
         {
-            n->m_tsTimeStamp = steady_clock::now();
+            n->m_tsTimeStamp = currtime;
             m_pTimer->interrupt();
             return;
         }
 
         remove_(u);
-        insert_norealloc_(steady_clock::now(), u);
+        insert_norealloc_(currtime, u);
         return;
     }
 
-    insert_(steady_clock::now(), u);
+    insert_(currtime, u);
 }
 
-int CSndUList::pop(sockaddr_any& w_addr, CPacket& w_pkt)
+int CSndUList::pop(sockaddr_any& w_addr, CPacket& w_pkt, const steady_clock::time_point& currtime)
 {
     CGuard listguard(m_ListLock);
 
@@ -304,7 +309,8 @@ int CSndUList::pop(sockaddr_any& w_addr, CPacket& w_pkt)
         return -1;
 
     // no pop until the next schedulled time
-    if (m_pHeap[0]->m_tsTimeStamp > steady_clock::now())
+    const steady_clock::time_point schedule_time = m_pHeap[0]->m_tsTimeStamp;
+    if (schedule_time > currtime)
         return -1;
 
     CUDT *u = m_pHeap[0]->m_pUDT;
@@ -322,11 +328,12 @@ int CSndUList::pop(sockaddr_any& w_addr, CPacket& w_pkt)
         return -1;
 
     // pack a packet from the socket
-    const std::pair<int, steady_clock::time_point> res_time = u->packData((w_pkt));
+    const std::pair<int, steady_clock::time_point> res_time = u->packData((w_pkt), currtime);
 
     if (res_time.first <= 0)
         return -1;
 
+    u->m_stats.histSndLag.add(count_microseconds(currtime - schedule_time));
     w_addr = u->m_PeerAddr;
 
     // insert a new entry, ts is the next processing time
@@ -568,7 +575,7 @@ void *CSndQueue::worker(void *param)
         }
 
         // wait until next processing time of the first socket on the list
-        const steady_clock::time_point currtime = steady_clock::now();
+        steady_clock::time_point currtime = steady_clock::now();
 
 #if defined(SRT_DEBUG_SNDQ_HIGHRATE)
         if (self->m_ullDbgTime <= currtime)
@@ -590,6 +597,7 @@ void *CSndQueue::worker(void *param)
         if (currtime < next_time)
         {
             self->m_pTimer->sleep_until(next_time);
+            currtime = steady_clock::now();
 
 #if defined(HAI_DEBUG_SNDQ_HIGHRATE)
             self->m_WorkerStats.lSleepTo++;
@@ -600,7 +608,7 @@ void *CSndQueue::worker(void *param)
         // it is time to send the next pkt
         sockaddr_any addr;
         CPacket      pkt;
-        if (self->m_pSndUList->pop((addr), (pkt)) < 0)
+        if (self->m_pSndUList->pop((addr), (pkt), currtime) < 0)
         {
             continue;
 
@@ -689,14 +697,14 @@ void CRcvUList::remove(const CUDT *u)
     n->m_pNext = n->m_pPrev = NULL;
 }
 
-void CRcvUList::update(const CUDT *u)
+void CRcvUList::update(const CUDT *u, const steady_clock::time_point& currtime)
 {
     CRNode *n = u->m_pRNode;
 
     if (!n->m_bOnList)
         return;
 
-    n->m_tsTimeStamp = steady_clock::now();
+    n->m_tsTimeStamp = currtime;
 
     // if n is the last node, do not need to change
     if (NULL == n->m_pNext)
@@ -805,14 +813,18 @@ void CHash::remove(int32_t id)
 
 //
 CRendezvousQueue::CRendezvousQueue()
-    : m_lRendezvousID()
+    : m_Connectors()
+    , m_Peers()
+    , m_Timers()
     , m_RIDVectorLock()
 {
 }
 
 CRendezvousQueue::~CRendezvousQueue()
 {
-    m_lRendezvousID.clear();
+    m_Connectors.clear();
+    m_Peers.clear();
+    m_Timers.clear();
 }
 
 void CRendezvousQueue::insert(
@@ -820,16 +832,21 @@ void CRendezvousQueue::insert(
 {
     CGuard vg(m_RIDVectorLock);
 
-    CRL r;
+    connectors_t::iterator i = m_Connectors.find(id);
+    if (i != m_Connectors.end())
+        erase(i);
+
+    CRL& r = m_Connectors[id];
     r.m_iID        = id;
     r.m_pUDT       = u;
     r.m_PeerAddr = addr;
     r.m_tsTTL = ttl;
+    r.m_PeerPos = m_Peers.insert(std::make_pair(addr, id));
+    r.m_TimerPos = m_Timers.insert(std::make_pair(nextCheckTime(r), id));
 
-    m_lRendezvousID.push_back(r);
     HLOGC(mglog.Debug, log << "RID: adding socket @" << id << " for address: " << SockaddrToString(addr)
             << " expires: " << FormatTime(ttl)
-            << " (total connectors: " << m_lRendezvousID.size() << ")");
+            << " (total connectors: " << m_Connectors.size() << ")");
 }
 
 void CRendezvousQueue::remove(const SRTSOCKET &id, bool should_lock)
@@ -837,34 +854,69 @@ void CRendezvousQueue::remove(const SRTSOCKET &id, bool should_lock)
     if (should_lock)
         enterCS(m_RIDVectorLock);
 
-    for (list<CRL>::iterator i = m_lRendezvousID.begin(); i != m_lRendezvousID.end(); ++i)
-    {
-        if (i->m_iID == id)
-        {
-            m_lRendezvousID.erase(i);
-            break;
-        }
-    }
+    connectors_t::iterator i = m_Connectors.find(id);
+    if (i != m_Connectors.end())
+        erase(i);
 
     if (should_lock)
         leaveCS(m_RIDVectorLock);
 }
 
+void CRendezvousQueue::erase(connectors_t::iterator i)
+{
+    m_Peers.erase(i->second.m_PeerPos);
+    m_Timers.erase(i->second.m_TimerPos);
+    m_Connectors.erase(i);
+}
+
+void CRendezvousQueue::schedule(CRL& r, const steady_clock::time_point& when)
+{
+    m_Timers.erase(r.m_TimerPos);
+    r.m_TimerPos = m_Timers.insert(std::make_pair(when, r.m_iID));
+}
+
+// The connector sends the next request 250ms after the last one, unless
+// its m_tsLastReqTime was reset to make it respond immediately, and is
+// removed when its TTL has passed. updateConnector() checks the exact
+// condition, so this time must only not be later than these events.
+steady_clock::time_point CRendezvousQueue::nextCheckTime(const CRL& r)
+{
+    const steady_clock::time_point next_req = r.m_pUDT->m_tsLastReqTime + milliseconds_from(250);
+    return std::min(next_req, r.m_tsTTL);
+}
+
 CUDT* CRendezvousQueue::retrieve(const sockaddr_any& addr, SRTSOCKET& w_id)
 {
     CGuard     vg(m_RIDVectorLock);
 
-    // TODO: optimize search
-    for (list<CRL>::iterator i = m_lRendezvousID.begin(); i != m_lRendezvousID.end(); ++i)
+    CRL* r = NULL;
+    if (w_id != 0)
     {
-        if (i->m_PeerAddr == addr && ((w_id == 0) || (w_id == i->m_iID)))
-        {
-            HLOGC(mglog.Debug, log << "RID: found id @" << i->m_iID << " while looking for "
-                    << (w_id ? "THIS ID FROM " : "A NEW CONNECTION FROM ")
-                    << SockaddrToString(i->m_PeerAddr));
-            w_id = i->m_iID;
-            return i->m_pUDT;
-        }
+        connectors_t::iterator i = m_Connectors.find(w_id);
+        if (i != m_Connectors.end() && i->second.m_PeerAddr == addr)
+            r = &i->second;
+    }
+    else
+    {
+        // Of several connectors to the same peer, the one registered first
+        // is found; equal keys keep the order of insertion in std::multimap.
+        peers_t::iterator p = m_Peers.find(addr);
+        if (p != m_Peers.end())
+            r = &m_Connectors[p->second];
+    }
+
+    if (r)
+    {
+        HLOGC(mglog.Debug, log << "RID: found id @" << r->m_iID << " while looking for "
+                << (w_id ? "THIS ID FROM " : "A NEW CONNECTION FROM ")
+                << SockaddrToString(r->m_PeerAddr));
+        w_id = r->m_iID;
+
+        // The packet is going to be processed by this connector, which may
+        // reset its m_tsLastReqTime to respond immediately. Have it checked
+        // in the next call to updateConnStatus.
+        schedule(*r, steady_clock::time_point());
+        return r->m_pUDT;
     }
 
 #if ENABLE_HEAVY_LOGGING
@@ -874,7 +926,7 @@ CUDT* CRendezvousQueue::retrieve(const sockaddr_any& addr, SRTSOCKET& w_id)
    else
        spec << " AGENT @" << w_id;
    HLOGC(mglog.Debug, log << "RID: NO CONNECTOR FOR ADR:" << SockaddrToString(addr)
-           << " while looking for " << spec.str() << " (" << m_lRendezvousID.size() << " connectors total)");
+           << " while looking for " << spec.str() << " (" << m_Connectors.size() << " connectors total)");
 #endif
 
     return NULL;
@@ -884,152 +936,144 @@ void CRendezvousQueue::updateConnStatus(EReadStatus rst, EConnectStatus cst, con
 {
     CGuard vg(m_RIDVectorLock);
 
-    if (m_lRendezvousID.empty())
+    if (m_Connectors.empty())
         return;
 
     HLOGC(mglog.Debug,
           log << "updateConnStatus: updating after getting pkt id=" << response.m_iID
               << " status: " << ConnectStatusStr(cst));
 
-#if ENABLE_HEAVY_LOGGING
-    int debug_nupd  = 0;
-    int debug_nrun  = 0;
-    int debug_nfail = 0;
-#endif
-
-    for (list<CRL>::iterator i = m_lRendezvousID.begin(), i_next = i; i != m_lRendezvousID.end(); i = i_next)
-    {
-        ++i_next;
-        // NOTE: This is a SAFE LOOP.
-        // Incrementation will be done at the end, after the processing did not
-        // REMOVE the currently processed element. When the element was removed,
-        // the iterator value for the next iteration will be taken from erase()'s result.
-
-        // RST_AGAIN happens in case when the last attempt to read a packet from the UDP
-        // socket has read nothing. In this case it would be a repeated update, while
-        // still waiting for a response from the peer. When we have any other state here
-        // (most expectably CONN_CONTINUE or CONN_RENDEZVOUS, which means that a packet has
-        // just arrived in this iteration), do the update immetiately (in SRT this also
-        // involves additional incoming data interpretation, which wasn't the case in UDT).
-
-        // Use "slow" cyclic responding in case when
-        // - RST_AGAIN (no packet was received for whichever socket)
-        // - a packet was received, but not for THIS socket
-        if (rst == RST_AGAIN || i->m_iID != response.m_iID)
+    // RST_AGAIN happens in case when the last attempt to read a packet from the UDP
+    // socket has read nothing. In this case it would be a repeated update, while
+    // still waiting for a response from the peer. When we have any other state here
+    // (most expectably CONN_CONTINUE or CONN_RENDEZVOUS, which means that a packet has
+    // just arrived in this iteration), do the update immetiately (in SRT this also
+    // involves additional incoming data interpretation, which wasn't the case in UDT).
+    SRTSOCKET addressed = 0;
+    if (rst != RST_AGAIN)
+    {
+        connectors_t::iterator i = m_Connectors.find(response.m_iID);
+        if (i != m_Connectors.end())
         {
-            // If no packet has been received from the peer,
-            // avoid sending too many requests, at most 1 request per 250ms
-            const steady_clock::time_point then = i->m_pUDT->m_tsLastReqTime;
-            const steady_clock::time_point now = steady_clock::now();
-            const steady_clock::duration timeout_250ms = milliseconds_from(250);
-            const bool now_is_time = (now - then) > timeout_250ms;
-            HLOGC(mglog.Debug,
-                  log << "RID:@" << i->m_iID << " then=" << FormatTime(then)
-                      << " now=" << FormatTime(now) << " passed=" << count_microseconds(now - then)
-                      << "<=> 250000 -- now's " << (now_is_time ? "" : "NOT ") << "the time");
-
-            if (!now_is_time)
-                continue;
+            addressed = response.m_iID;
+            updateConnector(i, rst, cst, response);
         }
+    }
 
-        HLOGC(mglog.Debug, log << "RID:@" << i->m_iID << " cst=" << ConnectStatusStr(cst) << " -- sending update NOW.");
+    // Use "slow" cyclic responding for all other connectors, in order of
+    // the time they were scheduled to be checked. The due ones are collected
+    // first, as the check schedules them again.
+    const steady_clock::time_point now = steady_clock::now();
+    if (m_Timers.empty() || m_Timers.begin()->first > now)
+        return;
 
-#if ENABLE_HEAVY_LOGGING
-        ++debug_nrun;
-#endif
+    std::vector<SRTSOCKET> due;
+    for (timers_t::iterator t = m_Timers.begin(); t != m_Timers.end() && t->first <= now; ++t)
+    {
+        if (t->second != addressed)
+            due.push_back(t->second);
+    }
 
-        // XXX This looks like a loop that rolls in infinity without any sleeps
-        // inside and makes it once per about 50 calls send a hs conclusion
-        // for a randomly sampled rendezvous ID of a socket out of the list.
-        // Ok, probably the rendezvous ID should be just one so not much to
-        // sample from, but if so, why the container?
-        //
-        // This must be somehow fixed!
-        //
-        // Maybe the time should be simply checked once and the whole loop not
-        // done when "it's not the time"?
-        const steady_clock::time_point now = steady_clock::now();
-        if (now >= i->m_tsTTL)
-        {
-            HLOGC(mglog.Debug, log << "RID: socket @" << i->m_iID
-                << " removed - EXPIRED ("
-                // The "enforced on FAILURE" is below when processAsyncConnectRequest failed.
-                << (is_zero(i->m_tsTTL) ? "enforced on FAILURE" : "passed TTL")
-                << "). removing from queue");
-            // connection timer expired, acknowledge app via epoll
-            i->m_pUDT->m_bConnecting = false;
-            CUDT::s_UDTUnited.m_EPoll.update_events(i->m_iID, i->m_pUDT->m_sPollID, SRT_EPOLL_ERR, true);
-            /*
-             * Setting m_bConnecting to false but keeping socket in rendezvous queue is not a good idea.
-             * Next CUDT::close will not remove it from rendezvous queue (because !m_bConnecting)
-             * and may crash here on next pass.
-             */
-            // i_next was preincremented, but this is guaranteed to point to
-            // the element next to erased one.
-            i_next = m_lRendezvousID.erase(i);
+    for (size_t n = 0; n < due.size(); ++n)
+    {
+        // May have been removed while processing another connector.
+        connectors_t::iterator i = m_Connectors.find(due[n]);
+        if (i == m_Connectors.end())
             continue;
-        }
-        else
+
+        // If no packet has been received from the peer,
+        // avoid sending too many requests, at most 1 request per 250ms
+        const steady_clock::time_point then = i->second.m_pUDT->m_tsLastReqTime;
+        const steady_clock::duration timeout_250ms = milliseconds_from(250);
+        const bool now_is_time = (now - then) > timeout_250ms;
+        HLOGC(mglog.Debug,
+              log << "RID:@" << i->first << " then=" << FormatTime(then)
+                  << " now=" << FormatTime(now) << " passed=" << count_microseconds(now - then)
+                  << "<=> 250000 -- now's " << (now_is_time ? "" : "NOT ") << "the time");
+
+        if (!now_is_time)
         {
-            HLOGC(mglog.Debug, log << "RID: socket @" << i->m_iID << " still active (remaining "
-                    << std::fixed << (count_microseconds(i->m_tsTTL - now)/1000000.0) << "s of TTL)...");
+            schedule(i->second, then + timeout_250ms + microseconds_from(1));
+            continue;
         }
 
-        // This queue is used only in case of Async mode (rendezvous or caller-listener).
-        // Synchronous connection requests are handled in startConnect() completely.
-        if (!i->m_pUDT->m_bSynRecving)
-        {
-#if ENABLE_HEAVY_LOGGING
-            ++debug_nupd;
-#endif
-            // IMPORTANT INFORMATION concerning changes towards UDT legacy.
-            // In the UDT code there was no attempt to interpret any incoming data.
-            // All data from the incoming packet were considered to be already deployed into
-            // m_ConnRes field, and m_ConnReq field was considered at this time accordingly updated.
-            // Therefore this procedure did only one thing: craft a new handshake packet and send it.
-            // In SRT this may also interpret extra data (extensions in case when Agent is Responder)
-            // and the `response` packet may sometimes contain no data. Therefore the passed `rst`
-            // must be checked to distinguish the call by periodic update (RST_AGAIN) from a call
-            // due to have received the packet (RST_OK).
-            //
-            // In the below call, only the underlying `processRendezvous` function will be attempting
-            // to interpret these data (for caller-listener this was already done by `processConnectRequest`
-            // before calling this function), and it checks for the data presence.
-
-            EReadStatus    read_st = rst;
-            EConnectStatus conn_st = cst;
-
-            if (i->m_iID != response.m_iID)
-            {
-                read_st = RST_AGAIN;
-                conn_st = CONN_AGAIN;
-            }
+        updateConnector(i, RST_AGAIN, CONN_AGAIN, response);
+    }
+}
 
-            if (!i->m_pUDT->processAsyncConnectRequest(read_st, conn_st, response, i->m_PeerAddr))
-            {
-                // cst == CONN_REJECT can only be result of worker_ProcessAddressedPacket and
-                // its already set in this case.
-                LOGC(mglog.Error, log << "RendezvousQueue: processAsyncConnectRequest FAILED. Setting TTL as EXPIRED.");
-                i->m_pUDT->sendCtrl(UMSG_SHUTDOWN);
-                i->m_tsTTL = steady_clock::time_point(); // Make it expire right now, will be picked up at the next iteration
-#if ENABLE_HEAVY_LOGGING
-                ++debug_nfail;
-#endif
-            }
+void CRendezvousQueue::updateConnector(connectors_t::iterator i, EReadStatus rst, EConnectStatus cst, const CPacket& response)
+{
+    const SRTSOCKET id = i->first;
+    CUDT* const u = i->second.m_pUDT;
 
-            // NOTE: safe loop, the incrementation was done before the loop body,
-            // so the `i' node can be safely deleted. Just the body must end here.
-            continue;
-        }
-        else
+    HLOGC(mglog.Debug, log << "RID:@" << id << " cst=" << ConnectStatusStr(cst) << " -- sending update NOW.");
+
+    const steady_clock::time_point now = steady_clock::now();
+    if (now >= i->second.m_tsTTL)
+    {
+        HLOGC(mglog.Debug, log << "RID: socket @" << id
+            << " removed - EXPIRED ("
+            // The "enforced on FAILURE" is below when processAsyncConnectRequest failed.
+            << (is_zero(i->second.m_tsTTL) ? "enforced on FAILURE" : "passed TTL")
+            << "). removing from queue");
+        // connection timer expired, acknowledge app via epoll
+        u->m_bConnecting = false;
+        CUDT::s_UDTUnited.m_EPoll.update_events(id, u->m_sPollID, SRT_EPOLL_ERR, true);
+        /*
+         * Setting m_bConnecting to false but keeping socket in rendezvous queue is not a good idea.
+         * Next CUDT::close will not remove it from rendezvous queue (because !m_bConnecting)
+         * and may crash here on next pass.
+         */
+        erase(i);
+        return;
+    }
+
+    HLOGC(mglog.Debug, log << "RID: socket @" << id << " still active (remaining "
+            << std::fixed << (count_microseconds(i->second.m_tsTTL - now)/1000000.0) << "s of TTL)...");
+
+    // This queue is used only in case of Async mode (rendezvous or caller-listener).
+    // Synchronous connection requests are handled in startConnect() completely.
+    if (!u->m_bSynRecving)
+    {
+        // IMPORTANT INFORMATION concerning changes towards UDT legacy.
+        // In the UDT code there was no attempt to interpret any incoming data.
+        // All data from the incoming packet were considered to be already deployed into
+        // m_ConnRes field, and m_ConnReq field was considered at this time accordingly updated.
+        // Therefore this procedure did only one thing: craft a new handshake packet and send it.
+        // In SRT this may also interpret extra data (extensions in case when Agent is Responder)
+        // and the `response` packet may sometimes contain no data. Therefore the passed `rst`
+        // must be checked to distinguish the call by periodic update (RST_AGAIN) from a call
+        // due to have received the packet (RST_OK).
+        //
+        // In the below call, only the underlying `processRendezvous` function will be attempting
+        // to interpret these data (for caller-listener this was already done by `processConnectRequest`
+        // before calling this function), and it checks for the data presence.
+
+        // The connector is removed from the queue when the connection is
+        // established during this call, so the address must be a copy.
+        const sockaddr_any peer = i->second.m_PeerAddr;
+        const bool ok = u->processAsyncConnectRequest(rst, cst, response, peer);
+
+        i = m_Connectors.find(id);
+        if (!ok)
         {
-            HLOGC(mglog.Debug, log << "RID: socket @" << i->m_iID << " deemed SYNCHRONOUS, NOT UPDATING");
+            // cst == CONN_REJECT can only be result of worker_ProcessAddressedPacket and
+            // its already set in this case.
+            LOGC(mglog.Error, log << "RendezvousQueue: processAsyncConnectRequest FAILED. Setting TTL as EXPIRED.");
+            u->sendCtrl(UMSG_SHUTDOWN);
+            if (i != m_Connectors.end())
+                i->second.m_tsTTL = steady_clock::time_point(); // Make it expire right now, will be picked up at the next iteration
         }
+
+        if (i == m_Connectors.end())
+            return;
+    }
+    else
+    {
+        HLOGC(mglog.Debug, log << "RID: socket @" << id << " deemed SYNCHRONOUS, NOT UPDATING");
     }
 
-    HLOGC(mglog.Debug,
-          log << "updateConnStatus: " << debug_nupd << "/" << debug_nrun << " sockets updated ("
-              << (debug_nrun - debug_nupd) << " useless). REMOVED " << debug_nfail << " sockets.");
+    schedule(i->second, nextCheckTime(i->second));
 }
 
 //
@@ -1049,8 +1093,14 @@ CRcvQueue::CRcvQueue()
     , m_IDLock()
     , m_mBuffer()
     , m_BufferCond()
+    , m_AcceptThread()
+    , m_bAcceptOffload(false)
+    , m_AcceptRequests()
+    , m_AcceptLock()
+    , m_AcceptCond()
 {
     setupCond(m_BufferCond, "QueueBuffer");
+    setupCond(m_AcceptCond, "QueueAccept");
 }
 
 CRcvQueue::~CRcvQueue()
@@ -1061,7 +1111,15 @@ CRcvQueue::~CRcvQueue()
         HLOGC(mglog.Debug, log << "RcvQueue: EXIT");
         pthread_join(m_WorkerThread, NULL);
     }
+    if (!pthread_equal(m_AcceptThread, pthread_t()))
+    {
+        CSync::lock_signal(m_AcceptCond, m_AcceptLock);
+        pthread_join(m_AcceptThread, NULL);
+    }
     releaseCond(m_BufferCond);
+    releaseCond(m_AcceptCond);
+
+    clearAcceptRequests();
 
     delete m_pRcvUList;
     delete m_pHash;
@@ -1121,12 +1179,13 @@ void *CRcvQueue::worker(void *param)
 
     THREAD_STATE_INIT("SRT:RcvQ:worker");
 
-    CUnit *        unit = 0;
-    EConnectStatus cst  = CONN_AGAIN;
+    CUnit *                  unit = 0;
+    EConnectStatus           cst  = CONN_AGAIN;
+    steady_clock::time_point currtime;
     while (!self->m_bClosing)
     {
         bool        have_received = false;
-        EReadStatus rst           = self->worker_RetrieveUnit((id), (unit), (sa));
+        EReadStatus rst           = self->worker_RetrieveUnit((id), (unit), (sa), (currtime));
         if (rst == RST_OK)
         {
             if (id < 0)
@@ -1149,14 +1208,14 @@ void *CRcvQueue::worker(void *param)
             if (id == 0)
             {
                 // ID 0 is for connection request, which should be passed to the listening socket or rendezvous sockets
-                cst = self->worker_ProcessConnectionRequest(unit, sa);
+                cst = self->worker_ProcessConnectionRequest(unit, sa, currtime);
             }
             else
             {
                 // Otherwise ID is expected to be associated with:
                 // - an enqueued rendezvous socket
                 // - a socket connected to a peer
-                cst = self->worker_ProcessAddressedPacket(id, unit, sa);
+                cst = self->worker_ProcessAddressedPacket(id, unit, sa, currtime);
                 // CAN RETURN CONN_REJECT, but m_RejectReason is already set
             }
             HLOGC(mglog.Debug, log << self->CONID() << "worker: result for the unit: " << ConnectStatusStr(cst));
@@ -1191,7 +1250,7 @@ void *CRcvQueue::worker(void *param)
         // OTHERWISE: this is an "AGAIN" situation. No data was read, but the process should continue.
 
         // take care of the timing event for all UDT sockets
-        const steady_clock::time_point curtime_minus_syn = steady_clock::now() - microseconds_from(CUDT::COMM_SYN_INTERVAL_US);
+        const steady_clock::time_point curtime_minus_syn = currtime - microseconds_from(CUDT::COMM_SYN_INTERVAL_US);
 
         CRNode *ul = self->m_pRcvUList->m_pUList;
         while ((NULL != ul) && (ul->m_tsTimeStamp < curtime_minus_syn))
@@ -1200,8 +1259,8 @@ void *CRcvQueue::worker(void *param)
 
             if (u->m_bConnected && !u->m_bBroken && !u->m_bClosing)
             {
-                u->checkTimers();
-                self->m_pRcvUList->update(u);
+                u->checkTimers(currtime);
+                self->m_pRcvUList->update(u, currtime);
             }
             else
             {
@@ -1239,7 +1298,7 @@ void *CRcvQueue::worker(void *param)
     return NULL;
 }
 
-EReadStatus CRcvQueue::worker_RetrieveUnit(int32_t& w_id, CUnit*& w_unit, sockaddr_any& w_addr)
+EReadStatus CRcvQueue::worker_RetrieveUnit(int32_t& w_id, CUnit*& w_unit, sockaddr_any& w_addr, steady_clock::time_point& w_currtime)
 {
 #if !USE_BUSY_WAITING
     // This might be not really necessary, and probably
@@ -1247,19 +1306,8 @@ EReadStatus CRcvQueue::worker_RetrieveUnit(int32_t& w_id, CUnit*& w_unit, sockad
     m_pTimer->tick();
 #endif
 
-    // check waiting list, if new socket, insert it to the list
-    while (ifNewEntry())
-    {
-        CUDT *ne = getNewEntry();
-        if (ne)
-        {
-            HLOGC(mglog.Debug,
-                  log << CUDTUnited::CONID(ne->m_SocketID)
-                      << " SOCKET pending for connection - ADDING TO RCV QUEUE/MAP");
-            m_pRcvUList->insert(ne);
-            m_pHash->insert(ne->m_SocketID, ne);
-        }
-    }
+    worker_InsertNewEntries();
+
     // find next available slot for incoming packet
     w_unit = m_UnitQueue.getNextAvailUnit();
     if (!w_unit)
@@ -1271,6 +1319,7 @@ EReadStatus CRcvQueue::worker_RetrieveUnit(int32_t& w_id, CUnit*& w_unit, sockad
         THREAD_PAUSED();
         EReadStatus rst = m_pChannel->recvfrom((w_addr), (temp));
         THREAD_RESUMED();
+        w_currtime = steady_clock::now();
         // Note: this will print nothing about the packet details unless heavy logging is on.
         LOGC(mglog.Error, log << CONID() << "LOCAL STORAGE DEPLETED. Dropping 1 packet: " << temp.Info());
         delete[] temp.m_pcData;
@@ -1286,6 +1335,7 @@ EReadStatus CRcvQueue::worker_RetrieveUnit(int32_t& w_id, CUnit*& w_unit, sockad
     THREAD_PAUSED();
     EReadStatus rst = m_pChannel->recvfrom((w_addr), (w_unit->m_Packet));
     THREAD_RESUMED();
+    w_currtime = steady_clock::now();
 
     if (rst == RST_OK)
     {
@@ -1297,7 +1347,24 @@ EReadStatus CRcvQueue::worker_RetrieveUnit(int32_t& w_id, CUnit*& w_unit, sockad
     return rst;
 }
 
-EConnectStatus CRcvQueue::worker_ProcessConnectionRequest(CUnit* unit, const sockaddr_any& addr)
+void CRcvQueue::worker_InsertNewEntries()
+{
+    // check waiting list, if new socket, insert it to the list
+    while (ifNewEntry())
+    {
+        CUDT *ne = getNewEntry();
+        if (ne)
+        {
+            HLOGC(mglog.Debug,
+                  log << CUDTUnited::CONID(ne->m_SocketID)
+                      << " SOCKET pending for connection - ADDING TO RCV QUEUE/MAP");
+            m_pRcvUList->insert(ne);
+            m_pHash->insert(ne->m_SocketID, ne);
+        }
+    }
+}
+
+EConnectStatus CRcvQueue::worker_ProcessConnectionRequest(CUnit* unit, const sockaddr_any& addr, const steady_clock::time_point& currtime)
 {
     HLOGC(mglog.Debug,
           log << "Got sockID=0 from " << SockaddrToString(addr)
@@ -1306,6 +1373,12 @@ EConnectStatus CRcvQueue::worker_ProcessConnectionRequest(CUnit* unit, const soc
     // that another thread could have closed the socket at
     // the same time and inject a bug between checking the
     // pointer for NULL and using it.
+    if (m_bAcceptOffload && worker_OffloadConnectionRequest(unit, addr))
+    {
+        // The listener will answer it in the acceptor thread.
+        return CONN_CONTINUE;
+    }
+
     SRT_REJECT_REASON listener_ret  = SRT_REJ_UNKNOWN;
     bool              have_listener = false;
     {
@@ -1339,18 +1412,139 @@ EConnectStatus CRcvQueue::worker_ProcessConnectionRequest(CUnit* unit, const soc
     }
 
     // If there's no listener waiting for the packet, just store it into the queue.
-    return worker_TryAsyncRend_OrStore(0, unit, addr); // 0 id because the packet came in with that very ID.
+    return worker_TryAsyncRend_OrStore(0, unit, addr, currtime); // 0 id because the packet came in with that very ID.
+}
+
+bool CRcvQueue::worker_OffloadConnectionRequest(CUnit* unit, const sockaddr_any& addr)
+{
+    CGuard acceptlock (m_AcceptLock);
+    CSync  acceptcond (m_AcceptCond, acceptlock);
+
+    // Check again under the lock, the listener might have been just removed.
+    if (!m_bAcceptOffload)
+        return false;
+
+    AcceptRequest req;
+    req.addr      = addr;
+    req.packet    = NULL;
+    req.caller_id = 0;
+    req.req_type  = 0;
+    CHandShake hs;
+    if (hs.load_from(unit->m_Packet.m_pcData, unit->m_Packet.getLength()) == 0)
+    {
+        req.caller_id = hs.m_iID;
+        req.req_type  = hs.m_iReqType;
+    }
+
+    // The induction is answered with a cookie only, so it's cheap enough
+    // for the worker, and it's not delayed by the conclusions waiting here.
+    if (req.req_type == URQ_INDUCTION)
+        return false;
+
+    // The caller repeats the request until it gets the response. When the
+    // acceptor is late, the repeated ones would only make it answer the same
+    // request again, while the requests of the other callers are waiting,
+    // and make the queue overflow. The queued one will be answered anyway.
+    if (m_AcceptQueued.count(req))
+    {
+        HLOGC(mglog.Debug, log << CONID() << "Acceptor: request from @" << req.caller_id
+                << " already queued, dropping the repeated one from " << SockaddrToString(addr));
+        return true;
+    }
+
+    if (m_AcceptRequests.size() >= MAX_ACCEPT_REQUESTS)
+    {
+        HLOGC(mglog.Debug, log << CONID() << "Acceptor: too many pending connection requests, dropping one from "
+                << SockaddrToString(addr));
+        return true;
+    }
+
+    req.packet = unit->m_Packet.clone();
+    m_AcceptRequests.push(req);
+    m_AcceptQueued.insert(req);
+    acceptcond.signal_locked(acceptlock);
+    return true;
 }
 
-EConnectStatus CRcvQueue::worker_ProcessAddressedPacket(int32_t id, CUnit* unit, const sockaddr_any& addr)
+void CRcvQueue::clearAcceptRequests()
+{
+    while (!m_AcceptRequests.empty())
+    {
+        CPacket *pkt = m_AcceptRequests.front().packet;
+        delete[] pkt->m_pcData;
+        delete pkt;
+        m_AcceptRequests.pop();
+    }
+    m_AcceptQueued.clear();
+}
+
+void *CRcvQueue::acceptor(void *param)
+{
+    CRcvQueue *self = (CRcvQueue *)param;
+
+    THREAD_STATE_INIT("SRT:RcvQ:acceptor");
+
+    CGuard acceptlock (self->m_AcceptLock);
+    CSync  acceptcond (self->m_AcceptCond, acceptlock);
+    while (!self->m_bClosing)
+    {
+        if (self->m_AcceptRequests.empty())
+        {
+            THREAD_PAUSED();
+            acceptcond.wait_for(seconds_from(1));
+            THREAD_RESUMED();
+            continue;
+        }
+
+        AcceptRequest req = self->m_AcceptRequests.front();
+        self->m_AcceptRequests.pop();
+        self->m_AcceptQueued.erase(req);
+
+        {
+            InvertedLock unlocked (self->m_AcceptLock);
+
+            // The same protection against closing the listener
+            // as in worker_ProcessConnectionRequest. The listener might
+            // have been also replaced by one without SRTO_ACCEPTTHREAD,
+            // whose requests are processed by the worker.
+            CGuard cg(self->m_LSLock);
+            if (self->m_pListener && self->m_bAcceptOffload)
+            {
+                LOGC(mglog.Note,
+                     log << "Acceptor: PASSING request from: " << SockaddrToString(req.addr)
+                         << " to agent:" << self->m_pListener->socketID());
+                const SRT_REJECT_REASON listener_ret = self->m_pListener->processConnectRequest(req.addr, *req.packet);
+                LOGC(mglog.Note,
+                     log << "Acceptor: listener managed the connection request from: " << SockaddrToString(req.addr)
+                         << " result:" << RequestTypeStr(UDTRequestType(listener_ret)));
+            }
+
+            delete[] req.packet->m_pcData;
+            delete req.packet;
+        }
+    }
+
+    THREAD_EXIT();
+    return NULL;
+}
+
+EConnectStatus CRcvQueue::worker_ProcessAddressedPacket(int32_t id, CUnit* unit, const sockaddr_any& addr, const steady_clock::time_point& currtime)
 {
     CUDT *u = m_pHash->lookup(id);
+    if (!u && ifNewEntry())
+    {
+        // The acceptor thread might have created this socket while
+        // this thread was waiting for the packet.
+        worker_InsertNewEntries();
+        u = m_pHash->lookup(id);
+    }
+
     if (!u)
     {
         // Pass this to either async rendezvous connection,
         // or store the packet in the queue.
         HLOGC(mglog.Debug, log << "worker_ProcessAddressedPacket: resending to QUEUED socket @" << id);
-        return worker_TryAsyncRend_OrStore(id, unit, addr);
+        return worker_TryAsyncRend_OrStore(id, unit, addr, currtime);
     }
 
     // Found associated CUDT - process this as control or data packet
@@ -1376,12 +1570,12 @@ EConnectStatus CRcvQueue::worker_ProcessAddressedPacket(int32_t id, CUnit* unit,
     }
 
     if (unit->m_Packet.isControl())
-        u->processCtrl(unit->m_Packet);
+        u->processCtrl(unit->m_Packet, currtime);
     else
-        u->processData(unit);
+        u->processData(unit, currtime);
 
-    u->checkTimers();
-    m_pRcvUList->update(u);
+    u->checkTimers(currtime);
+    m_pRcvUList->update(u, currtime);
 
     return CONN_RUNNING;
 }
@@ -1394,7 +1588,7 @@ EConnectStatus CRcvQueue::worker_ProcessAddressedPacket(int32_t id, CUnit* unit,
 // This function then tries to manage the packet as a rendezvous connection
 // request in ASYNC mode; when this is not applicable, it stores the packet
 // in the "receiving queue" so that it will be picked up in the "main" thread.
-EConnectStatus CRcvQueue::worker_TryAsyncRend_OrStore(int32_t id, CUnit* unit, const sockaddr_any& addr)
+EConnectStatus CRcvQueue::worker_TryAsyncRend_OrStore(int32_t id, CUnit* unit, const sockaddr_any& addr, const steady_clock::time_point& currtime)
 {
     // This 'retrieve' requires that 'id' be either one of those
     // stored in the rendezvous queue (see CRcvQueue::registerConnector)
@@ -1500,7 +1694,7 @@ EConnectStatus CRcvQueue::worker_TryAsyncRend_OrStore(int32_t id, CUnit* unit, c
 
                 // Theoretically we should check if m_pHash->lookup(ne->m_SocketID) returns 'ne', but this
                 // has been just added to m_pHash, so the check would be extremely paranoid here.
-                cst = worker_ProcessAddressedPacket(id, unit, addr);
+                cst = worker_ProcessAddressedPacket(id, unit, addr, currtime);
                 if (cst == CONN_REJECT)
                     return cst;
                 return CONN_ACCEPT; // this function usually will return CONN_CONTINUE, which doesn't represent current
@@ -1601,6 +1795,24 @@ int CRcvQueue::setListener(CUDT *u)
         return -1;
 
     m_pListener = u;
+
+    if (u->m_bOPT_AcceptThread)
+    {
+        CGuard acceptlock(m_AcceptLock);
+        if (pthread_equal(m_AcceptThread, pthread_t()))
+        {
+#if ENABLE_LOGGING
+            std::string thrname = "SRT:RcvQ:a" + Sprint(m_counter);
+            ThreadName tn(thrname.c_str());
+#endif
+            if (0 != pthread_create(&m_AcceptThread, NULL, CRcvQueue::acceptor, this))
+            {
+                m_AcceptThread = pthread_t();
+                LOGC(mglog.Error, log << "Acceptor: failed to start the thread, processing requests in the worker");
+            }
+        }
+        m_bAcceptOffload = !pthread_equal(m_AcceptThread, pthread_t());
+    }
     return 0;
 }
 
@@ -1609,7 +1821,16 @@ void CRcvQueue::removeListener(const CUDT *u)
     CGuard lslock(m_LSLock);
 
     if (u == m_pListener)
+    {
         m_pListener = NULL;
+
+        // The requests still queued were for this listener. Another one
+        // set later could be processing requests in the worker, and it
+        // must not get them in the acceptor at the same time.
+        CGuard acceptlock(m_AcceptLock);
+        m_bAcceptOffload = false;
+        clearAcceptRequests();
+    }
 }
 
 void CRcvQueue::registerConnector(const SRTSOCKET& id, CUDT* u, const sockaddr_any& addr, const steady_clock::time_point& ttl)
@@ -62,6 +62,7 @@ modified by
 #include <list>
 #include <map>
 #include <queue>
+#include <set>
 #include <vector>
 
 class CUDT;
@@ -71,6 +72,7 @@ struct CUnit
    CPacket m_Packet;		// packet
    enum Flag { FREE = 0, GOOD = 1, PASSACK = 2, DROPPED = 3 };
    Flag m_iFlag;			// 0: free, 1: occupied, 2: msg read but not freed (out-of-order), 3: msg dropped
+   srt::sync::steady_clock::time_point m_tsArrival; // time when added to the receiver buffer
 };
 
 class CUnitQueue
@@ -169,15 +171,18 @@ public:
       /// Update the timestamp of the UDT instance on the list.
       /// @param [in] u pointer to the UDT instance
       /// @param [in] reschedule if the timestamp should be rescheduled
+      /// @param [in] currtime the current time, if already known to the caller
 
    void update(const CUDT* u, EReschedule reschedule);
+   void update(const CUDT* u, EReschedule reschedule, const srt::sync::steady_clock::time_point& currtime);
 
       /// Retrieve the next packet and peer address from the first entry, and reschedule it in the queue.
       /// @param [out] addr destination address of the next packet
       /// @param [out] pkt the next packet to be sent
+      /// @param [in] currtime the current time of the sending worker
       /// @return 1 if successfully retrieved, -1 if no packet found.
 
-   int pop(sockaddr_any& addr, CPacket& pkt);
+   int pop(sockaddr_any& addr, CPacket& pkt, const srt::sync::steady_clock::time_point& currtime);
 
       /// Remove UDT instance from the list.
       /// @param [in] u pointer to the UDT instance
@@ -258,8 +263,9 @@ public:
 
       /// Move the UDT instance to the end of the list, if it already exists; otherwise, do nothing.
       /// @param [in] u pointer to the UDT instance
+      /// @param [in] currtime the current time of the receiving worker
 
-   void update(const CUDT* u);
+   void update(const CUDT* u, const srt::sync::steady_clock::time_point& currtime);
 
 public:
    CRNode* m_pUList;		// the head node
@@ -338,16 +344,33 @@ public:
    void updateConnStatus(EReadStatus rst, EConnectStatus, const CPacket& response);
 
 private:
+   typedef std::multimap<sockaddr_any, SRTSOCKET, sockaddr_any::Less> peers_t;
+   typedef std::multimap<srt::sync::steady_clock::time_point, SRTSOCKET> timers_t;
+
    struct CRL
    {
       SRTSOCKET m_iID;        // UDT socket ID (self)
       CUDT* m_pUDT;           // UDT instance
       sockaddr_any m_PeerAddr;// UDT sonnection peer address
       srt::sync::steady_clock::time_point m_tsTTL;    // the time that this request expires
+      peers_t::iterator m_PeerPos;   // position in m_Peers
+      timers_t::iterator m_TimerPos; // position in m_Timers
    };
-   std::list<CRL> m_lRendezvousID;    // The sockets currently in rendezvous mode
+   typedef std::map<SRTSOCKET, CRL> connectors_t;
+
+   // The sockets currently in rendezvous mode, indexed by the socket ID
+   // and by the peer address. m_Timers orders them by the time when they
+   // should be checked next, so that an update doesn't walk through all.
+   connectors_t m_Connectors;
+   peers_t m_Peers;
+   timers_t m_Timers;
 
    srt::sync::Mutex m_RIDVectorLock;
+
+   void erase(connectors_t::iterator i);
+   void schedule(CRL& r, const srt::sync::steady_clock::time_point& when);
+   static srt::sync::steady_clock::time_point nextCheckTime(const CRL& r);
+   void updateConnector(connectors_t::iterator i, EReadStatus rst, EConnectStatus cst, const CPacket& response);
 };
 
 class CSndQueue
@@ -487,11 +510,22 @@ public:
 private:
    static void* worker(void* param);
    pthread_t m_WorkerThread;
-   // Subroutines of worker
-   EReadStatus worker_RetrieveUnit(int32_t& id, CUnit*& unit, sockaddr_any& sa);
-   EConnectStatus worker_ProcessConnectionRequest(CUnit* unit, const sockaddr_any& sa);
-   EConnectStatus worker_TryAsyncRend_OrStore(int32_t id, CUnit* unit, const sockaddr_any& sa);
-   EConnectStatus worker_ProcessAddressedPacket(int32_t id, CUnit* unit, const sockaddr_any& sa);
+   // Subroutines of worker. The time of the worker's iteration is read
+   // once in worker_RetrieveUnit, when the packet has been received, and
+   // passed down to the processing functions.
+   EReadStatus worker_RetrieveUnit(int32_t& id, CUnit*& unit, sockaddr_any& sa, srt::sync::steady_clock::time_point& currtime);
+   void worker_InsertNewEntries();
+   EConnectStatus worker_ProcessConnectionRequest(CUnit* unit, const sockaddr_any& sa, const srt::sync::steady_clock::time_point& currtime);
+   EConnectStatus worker_TryAsyncRend_OrStore(int32_t id, CUnit* unit, const sockaddr_any& sa, const srt::sync::steady_clock::time_point& currtime);
+   EConnectStatus worker_ProcessAddressedPacket(int32_t id, CUnit* unit, const sockaddr_any& sa, const srt::sync::steady_clock::time_point& currtime);
+
+   // The acceptor thread, running for a listener with SRTO_ACCEPTTHREAD.
+   // The worker only copies the conclusion requests into m_AcceptRequests
+   // and the acceptor passes them to the listener, so that creating the
+   // accepted sockets doesn't delay the packets of the connected ones.
+   static void* acceptor(void* param);
+   bool worker_OffloadConnectionRequest(CUnit* unit, const sockaddr_any& sa);
+   void clearAcceptRequests();
 
 private:
    CUnitQueue m_UnitQueue;      // The received packet queue
@@ -532,6 +566,33 @@ private:
    srt::sync::Mutex m_BufferLock;
    srt::sync::Condition m_BufferCond;
 
+   struct AcceptRequest
+   {
+       sockaddr_any addr;
+       CPacket* packet;
+       int32_t caller_id;       // socket ID of the caller, from the handshake
+       int32_t req_type;        // handshake stage, from the handshake
+
+       // Orders the requests by the caller and the handshake stage.
+       bool operator<(const AcceptRequest& r) const
+       {
+           if (caller_id != r.caller_id)
+               return caller_id < r.caller_id;
+           if (req_type != r.req_type)
+               return req_type < r.req_type;
+           return sockaddr_any::Less()(addr, r.addr);
+       }
+   };
+   // Above this the requests are dropped, the callers will repeat them.
+   static const size_t MAX_ACCEPT_REQUESTS = 1024;
+
+   pthread_t m_AcceptThread;
+   volatile bool m_bAcceptOffload;                      // the listener has SRTO_ACCEPTTHREAD set, changed under both locks
+   std::queue<AcceptRequest> m_AcceptRequests;          // connection requests waiting for the acceptor
+   std::set<AcceptRequest> m_AcceptQueued;              // the same requests, to drop the repeated ones
+   srt::sync::Mutex m_AcceptLock;
+   srt::sync::Condition m_AcceptCond;
+
 private:
    CRcvQueue(const CRcvQueue&);
    CRcvQueue& operator=(const CRcvQueue&);
@@ -219,8 +219,12 @@ typedef enum SRT_SOCKOPT {
    SRTO_PEERIDLETIMEO,       // Peer-idle timeout (max time of silence heard from peer) in [ms]
    SRTO_GROUPCONNECT,        // Set on a listener to allow group connection
    SRTO_GROUPSTABTIMEO,      // Stability timeout (backup groups) in [us]
-   // (some space left)
-   SRTO_PACKETFILTER = 60          // Add and configure a packet filter
+   SRTO_PACINGDELAY,         // Max time [ms] a live packet may be held back by adaptive pacing (0: fixed pacing)
+   SRTO_GROUPFASTSWITCH,     // Fast link failure detection and switchover (backup groups)
+   SRTO_PACKETFILTER = 60,         // Add and configure a packet filter
+   SRTO_GROUPSHAREDRCV,            // Group members store every received packet once, dropping duplicates on arrival
+   SRTO_ACCEPTTHREAD,              // Process the connection requests to a listener in a dedicated thread
+   SRTO_CCSEED                     // Start the congestion control from the state cached for the peer host
 } SRT_SOCKOPT;
 
 
@@ -413,6 +417,10 @@ struct CBytePerfMon
    int      pktRcvFilterSupply;         // number of packets that the filter supplied extra (e.g. FEC rebuilt)
    int      pktRcvFilterLoss;           // number of packet loss not coverable by filter
    int      pktReorderTolerance;        // packet reorder tolerance value
+   double   msSndPacingDelay;           // average time (msec) new packets were held back by pacing
+   double   msSndPacingDelayMax;        // maximum time (msec) a new packet was held back by pacing
+   int      backupSwitchTotal;          // number of times this link took over the transmission in a backup group
+   double   msBackupSwitch;             // time (msec) from the last response over the failed link to the last takeover
    //<
 };
 
@@ -716,6 +724,9 @@ typedef enum SRT_GROUP_TYPE
 // library initialization
 SRT_API       int srt_startup(void);
 SRT_API       int srt_cleanup(void);
+// Keeps up to 'size' socket objects constructed for reuse by new and
+// accepted sockets, or disables the pool with 0 (default).
+SRT_API       int srt_setsocketpool(int size);
 
 //
 // Socket operations
@@ -846,6 +857,164 @@ SRT_API int srt_bstats(SRTSOCKET u, SRT_TRACEBSTATS * perf, int clear);
 // permon with Byte counters and instantaneous stats instead of moving averages for Snd/Rcvbuffer sizes.
 SRT_API int srt_bistats(SRTSOCKET u, SRT_TRACEBSTATS * perf, int clear, int instantaneous);
 
+// Bulk statistics: compact records for a whole set of sockets in one call.
+enum SRT_STATS_SOURCE
+{
+    SRT_STATS_EPOLL = 1, // SRT sockets subscribed in the given epoll container
+    SRT_STATS_GROUP = 2, // member sockets of the given group
+    SRT_STATS_MUXER = 3  // sockets sharing the multiplexer (UDP socket) with the given socket
+};
+
+// Field sets of SRT_SOCKSTATS to be filled. Fields outside the
+// requested sets are not calculated and are left zero.
+#define SRT_STATSF_INTERVAL 0x01 // counters since the last clear
+#define SRT_STATSF_TOTAL    0x02 // counters since the connection start
+#define SRT_STATSF_RATE     0x04 // sending and receiving rate in the interval
+#define SRT_STATSF_LINK     0x08 // RTT, bandwidth, windows and sending period
+#define SRT_STATSF_BUFFER   0x10 // buffer occupancy (requires locking the buffers)
+#define SRT_STATSF_ALL      0x1F
+
+typedef struct SRT_SocketStats_
+{
+    SRTSOCKET id;
+    int       fields;              // SRT_STATSF_* sets actually filled, 0 if the socket isn't connected
+    int64_t   msTimeStamp;         // time since the socket was started
+
+    // SRT_STATSF_INTERVAL
+    int64_t   pktSent;
+    int64_t   pktRecv;
+    int       pktSndLoss;
+    int       pktRcvLoss;
+    int       pktRetrans;
+    int       pktSndDrop;
+    int       pktRcvDrop;
+    uint64_t  byteSent;            // including all headers (SRT+UDP+IP)
+    uint64_t  byteRecv;
+
+    // SRT_STATSF_TOTAL
+    int64_t   pktSentTotal;
+    int64_t   pktRecvTotal;
+    int       pktSndLossTotal;
+    int       pktRcvLossTotal;
+    int       pktRetransTotal;
+    int       pktSndDropTotal;
+    int       pktRcvDropTotal;
+    uint64_t  byteSentTotal;
+    uint64_t  byteRecvTotal;
+
+    // SRT_STATSF_RATE
+    double    mbpsSendRate;
+    double    mbpsRecvRate;
+
+    // SRT_STATSF_LINK
+    double    msRTT;
+    double    mbpsBandwidth;
+    double    mbpsMaxBW;
+    double    usPktSndPeriod;
+    int       pktFlowWindow;
+    int       pktCongestionWindow;
+    int       pktFlightSize;
+
+    // SRT_STATSF_BUFFER
+    int       pktSndBuf;
+    int       byteSndBuf;
+    int       msSndBuf;
+    int       pktRcvBuf;
+    int       byteRcvBuf;
+    int       msRcvBuf;
+    int       byteAvailSndBuf;
+    int       byteAvailRcvBuf;
+} SRT_SOCKSTATS;
+
+// Fills up to `size` records in `out` for the sockets selected by `source` and `id`
+// and returns the number of selected sockets, which may be greater than `size`.
+SRT_API int srt_bulkstats(int source, int id, int fields, SRT_SOCKSTATS* out, int size, int clear);
+
+// Delay histograms. Values are in microseconds, in log-scale buckets with 4 buckets
+// per power of two: bucket i < 4 holds the value i, bucket i >= 4 holds the values
+// from srt_histogram_floor(i) up to srt_histogram_floor(i+1)-1. The last bucket
+// holds also all greater values.
+#define SRT_HISTOGRAM_BUCKETS 100
+
+typedef struct SRT_Histogram_
+{
+    uint64_t count;                           // number of samples
+    uint64_t usSum;                           // sum of all samples
+    uint64_t usMax;                           // greatest sample
+    uint64_t buckets[SRT_HISTOGRAM_BUCKETS];  // number of samples per bucket
+} SRT_HISTOGRAM;
+
+typedef struct SRT_HistStats_
+{
+    SRT_HISTOGRAM rcvTransit;  // packet arrival time versus its origin time on the TSBPD time base (jitter, not one-way delay)
+    SRT_HISTOGRAM rcvBuffer;   // time from packet arrival to delivery to the application (TSBPD message reading only)
+    SRT_HISTOGRAM sndLag;      // time the sender sent a packet later than scheduled
+} SRT_HISTSTATS;
+
+static inline int64_t srt_histogram_floor(int bucket)
+{
+    if (bucket < 4)
+        return bucket;
+    return (int64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+SRT_API int srt_histstats(SRTSOCKET u, SRT_HISTSTATS* hist, int clear);
+
+// Event tracing. When enabled, every thread that handles SRT sockets records
+// compact binary events into its own ring buffer of the given size, overwriting
+// the oldest ones. srt_trace_dump writes the events of all rings to a file,
+// ordered by time, which can be decoded with the srt-trace-decode application.
+typedef enum SRT_TRACE_EVENT
+{
+    SRT_TRACE_NONE = 0,
+    SRT_TRACE_PKT_SENT,      // seqno: sent packet, arg: payload size
+    SRT_TRACE_PKT_RECV,      // seqno: received packet, arg: payload size
+    SRT_TRACE_PKT_RETRANS,   // seqno: retransmitted packet, arg: payload size
+    SRT_TRACE_PKT_SNDDROP,   // seqno: first packet dropped by the sender, arg: number of packets
+    SRT_TRACE_PKT_RCVDROP,   // seqno: first packet dropped by the receiver, arg: number of packets
+    SRT_TRACE_ACK_SENT,      // seqno: acknowledged sequence, arg: ACK number
+    SRT_TRACE_ACK_RECV,      // seqno: acknowledged sequence, arg: ACK number
+    SRT_TRACE_NAK_SENT,      // seqno: first lost packet, arg: number of lost packets
+    SRT_TRACE_NAK_RECV,      // seqno: first lost packet, arg: number of lost packets
+    SRT_TRACE_ACKACK_SENT,   // seqno: ACK number
+    SRT_TRACE_ACKACK_RECV,   // seqno: ACK number, arg: RTT sample in microseconds
+    SRT_TRACE_TSBPD_RELEASE, // seqno: packet ready to play, arg: delay past its play time in microseconds
+    SRT_TRACE_CC_RATE,       // seqno: next packet to send, arg: packet sending period in microseconds
+    SRT_TRACE_E_SIZE
+} SRT_TRACE_EVENT;
+
+typedef struct SRT_TraceEvent_
+{
+    int64_t  ts;      // steady clock ticks (CPU timestamp counter where available)
+    int32_t  socket;  // socket ID
+    int32_t  seqno;   // sequence number, see SRT_TRACE_EVENT
+    uint32_t arg;     // event specific value, see SRT_TRACE_EVENT
+    uint16_t type;    // SRT_TRACE_EVENT
+    uint16_t thread;  // index of the recording thread's ring
+} SRT_TRACEEVENT;
+
+// Header of the file written by srt_trace_dump, followed by `count` events.
+// Event time in microseconds since the epoch is:
+// ref_unix_us + (ts - ref_ticks) * 1000000 / ticks_per_sec
+typedef struct SRT_TraceHeader_
+{
+    char    magic[8];       // "SRTTRACE"
+    int32_t version;        // 1
+    int32_t event_size;     // sizeof(SRT_TRACEEVENT)
+    int64_t ticks_per_sec;  // steady clock ticks per second
+    int64_t ref_ticks;      // steady clock ticks at the time of ref_unix_us
+    int64_t ref_unix_us;    // system time in microseconds since the epoch
+    int64_t count;          // number of events
+} SRT_TRACEHEADER;
+
+#define SRT_TRACE_DEFAULT_EVENTS 8192
+
+// Enables tracing with the given number of events per thread (rounded up to
+// a power of two), or disables it with 0. Tracing is disabled by default.
+SRT_API int srt_trace_setup(int events_per_thread);
+// Writes all currently recorded events to the file and returns their number.
+SRT_API int srt_trace_dump(const char* path);
+
 // Socket Status (for problem tracking)
 SRT_API SRT_SOCKSTATUS srt_getsockstate(SRTSOCKET u);
 
@@ -885,16 +1054,85 @@ SRT_API void srt_resetlogfa(const int* fara, size_t fara_size);
 // SRT_API void srt_setlogstream(std::ostream& stream);
 SRT_API void srt_setloghandler(void* opaque, SRT_LOG_HANDLER_FN* handler);
 SRT_API void srt_setlogflags(int flags);
+SRT_API int64_t srt_getlogdropped(void);
 
 
 SRT_API int srt_getsndbuffer(SRTSOCKET sock, size_t* blocks, size_t* bytes);
 
+// User-defined congestion control
+
+// State shared between the library and a user-defined congestion controller.
+// The input fields are refreshed before every callback. The output fields are
+// read back after every callback except on_send.
+typedef struct SRT_CONGCTL_DATA
+{
+    // Output: set by the controller
+    double pkt_snd_period_us; // interval between sending two packets, in microseconds
+    double cwnd_size;         // congestion window, in packets
+
+    // Input: set by the library
+    double cwnd_max_size;     // maximum congestion window (receiver's flow window), in packets
+    int rtt_us;               // smoothed round-trip time, in microseconds
+    int delivery_rate;        // packet arrival rate reported by the receiver, packets/s
+    int bandwidth;            // estimated link capacity, packets/s
+    int mss;                  // maximum segment size, in bytes
+    int max_payload_size;     // maximum payload in a single packet, in bytes
+    int32_t snd_seqno;        // sequence number of the last sent packet
+    int flight_span;          // number of sent and not yet acknowledged packets
+    int snd_loss_length;      // number of packets in the sender's loss list
+    int64_t max_bw;           // SRTO_MAXBW, in bytes/s
+} SRT_CONGCTL_DATA;
+
+typedef struct SRT_CONGCTL_CALLBACKS
+{
+    // Creates the state for a new connection, which is then passed to the
+    // other callbacks. Returning NULL rejects the connection. Optional.
+    void* (*create)(void* opaque, SRTSOCKET sock, SRT_CONGCTL_DATA* data);
+    // Releases the state when the connection is closed. Optional.
+    void (*destroy)(void* state);
+
+    // Called when a full ACK is received with the acknowledged sequence number.
+    void (*on_ack)(void* state, SRT_CONGCTL_DATA* data, int32_t ackseq);
+    // Called when a loss report is received. The loss list uses the same
+    // encoding as in the UMSG_LOSSREPORT packet (ranges have the highest
+    // bit set in the first element).
+    void (*on_loss)(void* state, SRT_CONGCTL_DATA* data, const int32_t* losslist, size_t size);
+    // Called when retransmission is triggered by a timer: fastrexmit is nonzero
+    // for the periodic retransmission (live mode), 0 for the expiration timer.
+    void (*on_timer)(void* state, SRT_CONGCTL_DATA* data, int fastrexmit);
+    // Called when SRTO_MAXBW (maxbw) or the input rate (bw) was updated, in bytes/s.
+    void (*on_bandwidth)(void* state, SRT_CONGCTL_DATA* data, int64_t maxbw, int64_t bw);
+    // Called for every packet scheduled for sending. This is on the fast path,
+    // leave it NULL unless needed; no per-packet call is made then.
+    void (*on_send)(void* state, SRT_CONGCTL_DATA* data, int32_t seqno, int size);
+
+    // Nonzero: retransmit lost packets periodically, as in live mode.
+    // 0: retransmit unacknowledged packets on timeout, as in file mode.
+    int fastrexmit;
+    // Nonzero: request an ACK for every packet shorter than the maximum payload.
+    int quickack_on_short;
+} SRT_CONGCTL_CALLBACKS;
+
+// Registers a congestion controller under the given name, which can be then
+// selected by SRTO_CONGESTION on both parties. The callbacks are copied. Fails
+// if the name is already taken, either by a builtin or a registered controller.
+SRT_API int srt_register_congctl(const char* name, const SRT_CONGCTL_CALLBACKS* callbacks, void* opaque);
+
 SRT_API enum SRT_REJECT_REASON srt_getrejectreason(SRTSOCKET sock);
 SRT_API extern const char* const srt_rejectreason_msg [];
 const char* srt_rejectreason_str(enum SRT_REJECT_REASON id);
 
 SRT_API uint32_t srt_getversion();
 
+// Sources of the time used by the library, as returned by srt_clock_type().
+#define SRT_SYNC_CLOCK_GETTIME_MONOTONIC  1
+#define SRT_SYNC_CLOCK_WINQPC             2
+#define SRT_SYNC_CLOCK_MACH_ABSTIME       3
+#define SRT_SYNC_CLOCK_POSIX_GETTIMEOFDAY 4
+#define SRT_SYNC_CLOCK_TSC                5
+
+SRT_API int srt_clock_type(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,7 @@ written by
 #include "packet.h"
 #include "core.h"
 #include "utilities.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -30,6 +31,7 @@ extern "C" {
 
 int srt_startup() { return CUDT::startup(); }
 int srt_cleanup() { return CUDT::cleanup(); }
+int srt_setsocketpool(int size) { return CUDT::setSocketPool(size); }
 
 // Socket creation.
 SRTSOCKET srt_socket(int , int , int ) { return CUDT::socket(); }
@@ -150,6 +152,16 @@ int64_t srt_sendfile(SRTSOCKET u, const char* path, int64_t* offset, int64_t siz
     {
         return CUDT::APIError(MJ_NOTSUP, MN_INVAL, 0);
     }
+#ifdef SRT_ENABLE_FILEMAP
+    const int fd = ::open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return CUDT::APIError(MJ_FILESYSTEM, MN_READFAIL, 0);
+    }
+    int64_t ret = CUDT::sendfile(u, fd, *offset, size, block);
+    ::close(fd);
+    return ret;
+#else
     fstream ifs(path, ios::binary | ios::in);
     if (!ifs)
     {
@@ -158,6 +170,7 @@ int64_t srt_sendfile(SRTSOCKET u, const char* path, int64_t* offset, int64_t siz
     int64_t ret = CUDT::sendfile(u, ifs, *offset, size, block);
     ifs.close();
     return ret;
+#endif
 }
 
 int64_t srt_recvfile(SRTSOCKET u, const char* path, int64_t* offset, int64_t size, int block)
@@ -166,7 +179,24 @@ int64_t srt_recvfile(SRTSOCKET u, const char* path, int64_t* offset, int64_t siz
     {
         return CUDT::APIError(MJ_NOTSUP, MN_INVAL, 0);
     }
-    fstream ofs(path, ios::binary | ios::out);
+    // The file is truncated only when receiving from its beginning. At
+    // a later offset the data are written into the existing file, so that
+    // parts of one file can be received over several connections.
+#ifdef SRT_ENABLE_FILEMAP
+    const int fd = ::open(path, O_WRONLY | O_CREAT | (*offset == 0 ? O_TRUNC : 0), 0666);
+    if (fd == -1)
+    {
+        return CUDT::APIError(MJ_FILESYSTEM, MN_WRAVAIL, 0);
+    }
+    int64_t ret = CUDT::recvfile(u, fd, *offset, size, block);
+    ::close(fd);
+    return ret;
+#else
+    fstream ofs;
+    if (*offset != 0)
+        ofs.open(path, ios::binary | ios::in | ios::out);
+    if (!ofs.is_open())
+        ofs.open(path, ios::binary | ios::out);
     if (!ofs)
     {
         return CUDT::APIError(MJ_FILESYSTEM, MN_WRAVAIL, 0);
@@ -174,6 +204,7 @@ int64_t srt_recvfile(SRTSOCKET u, const char* path, int64_t* offset, int64_t siz
     int64_t ret = CUDT::recvfile(u, ofs, *offset, size, block);
     ofs.close();
     return ret;
+#endif
 }
 
 extern const SRT_MSGCTRL srt_msgctrl_default = {
@@ -234,6 +265,26 @@ void srt_clearlasterror()
 
 int srt_bstats(SRTSOCKET u, SRT_TRACEBSTATS * perf, int clear) { return CUDT::bstats(u, perf, 0!=  clear); }
 int srt_bistats(SRTSOCKET u, SRT_TRACEBSTATS * perf, int clear, int instantaneous) { return CUDT::bstats(u, perf, 0!=  clear, 0!= instantaneous); }
+int srt_bulkstats(int source, int id, int fields, SRT_SOCKSTATS* out, int size, int clear) { return CUDT::bulkstats(source, id, fields, out, size, 0!= clear); }
+int srt_histstats(SRTSOCKET u, SRT_HISTSTATS* hist, int clear) { return CUDT::histstats(u, hist, 0!= clear); }
+
+int srt_trace_setup(int events_per_thread)
+{
+    if (!srt::trace::setup(events_per_thread))
+        return CUDT::APIError(MJ_NOTSUP, MN_INVAL, 0);
+    return 0;
+}
+
+int srt_trace_dump(const char* path)
+{
+    if (!path)
+        return CUDT::APIError(MJ_NOTSUP, MN_INVAL, 0);
+
+    const int count = srt::trace::dump(path);
+    if (count == -1)
+        return CUDT::APIError(MJ_FILESYSTEM, MN_WRITEFAIL, 0);
+    return count;
+}
 
 SRT_SOCKSTATUS srt_getsockstate(SRTSOCKET u) { return SRT_SOCKSTATUS((int)CUDT::getsockstate(u)); }
 
@@ -341,11 +392,27 @@ void srt_setlogflags(int flags)
     UDT::setlogflags(flags);
 }
 
+int64_t srt_getlogdropped()
+{
+    return UDT::getlogdropped();
+}
+
 int srt_getsndbuffer(SRTSOCKET sock, size_t* blocks, size_t* bytes)
 {
     return CUDT::getsndbuffer(sock, blocks, bytes);
 }
 
+int srt_register_congctl(const char* name, const SRT_CONGCTL_CALLBACKS* callbacks, void* opaque)
+{
+    if (!name || !callbacks)
+        return CUDT::APIError(MJ_NOTSUP, MN_INVAL, 0);
+
+    if (!SrtCongestion::add(name, *callbacks, opaque))
+        return CUDT::APIError(MJ_NOTSUP, MN_INVAL, 0);
+
+    return 0;
+}
+
 enum SRT_REJECT_REASON srt_getrejectreason(SRTSOCKET sock)
 {
     return CUDT::rejectReason(sock);
@@ -364,4 +431,9 @@ uint32_t srt_getversion()
     return SrtVersion(SRT_VERSION_MAJOR, SRT_VERSION_MINOR, SRT_VERSION_PATCH);
 }
 
+int srt_clock_type()
+{
+    return srt::sync::clock_type();
+}
+
 }
@@ -26,29 +26,44 @@
 #define TIMING_USE_CLOCK_GETTIME
 #endif
 
+#if USE_TIMERFD
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include "logging.h"
+
+namespace srt_logging
+{
+extern Logger mglog;
+}
+
+using srt_logging::mglog;
+#endif
+
+// The TSC is used instead of the platform clock above, if it's
+// found usable at startup. Otherwise the platform clock is a fallback.
+#if ENABLE_TSC_CLOCK && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+#define TIMING_USE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
 namespace srt
 {
 namespace sync
 {
 
-void rdtsc(uint64_t& x)
+// Reads the platform clock.
+static void read_sysclock(uint64_t& x)
 {
-#ifdef IA32
-    uint32_t lval, hval;
-    // asm volatile ("push %eax; push %ebx; push %ecx; push %edx");
-    // asm volatile ("xor %eax, %eax; cpuid");
-    asm volatile("rdtsc" : "=a"(lval), "=d"(hval));
-    // asm volatile ("pop %edx; pop %ecx; pop %ebx; pop %eax");
-    x = hval;
-    x = (x << 32) | lval;
-#elif defined(IA64)
-    asm("mov %0=ar.itc" : "=r"(x)::"memory");
-#elif defined(AMD64)
-    uint32_t lval, hval;
-    asm("rdtsc" : "=a"(lval), "=d"(hval));
-    x = hval;
-    x = (x << 32) | lval;
-#elif defined(TIMING_USE_QPC)
+#if defined(TIMING_USE_QPC)
     // This function should not fail, because we checked the QPC
     // when calling to QueryPerformanceFrequency. If it failed,
     // the m_bUseMicroSecond was set to true.
@@ -56,7 +71,7 @@ void rdtsc(uint64_t& x)
 #elif defined(TIMING_USE_MACH_ABS_TIME)
     x = mach_absolute_time();
 #elif defined(TIMING_USE_CLOCK_GETTIME)
-    // get_cpu_frequency() returns 1 us accuracy in this case
+    // get_sysclock_frequency() returns 1 us accuracy in this case
     timespec tm;
     clock_gettime(CLOCK_MONOTONIC, &tm);
     x = tm.tv_sec * uint64_t(1000000) + (tm.tv_nsec / 1000);
@@ -68,7 +83,8 @@ void rdtsc(uint64_t& x)
 #endif
 }
 
-int64_t get_cpu_frequency()
+// Platform clock ticks per microsecond
+static int64_t get_sysclock_frequency()
 {
     int64_t frequency = 1; // 1 tick per microsecond.
 
@@ -77,34 +93,188 @@ int64_t get_cpu_frequency()
     if (QueryPerformanceFrequency(&ccf))
         frequency = ccf.QuadPart / 1000000; // counts per microsecond
 
-#elif defined(TIMING_USE_CLOCK_GETTIME)
-    frequency = 1;
-
 #elif defined(TIMING_USE_MACH_ABS_TIME)
 
     mach_timebase_info_data_t info;
     mach_timebase_info(&info);
     frequency = info.denom * int64_t(1000) / info.numer;
+#endif
+
+    return frequency;
+}
+
+static int get_sysclock_type()
+{
+#if defined(TIMING_USE_QPC)
+    return SRT_SYNC_CLOCK_WINQPC;
+#elif defined(TIMING_USE_MACH_ABS_TIME)
+    return SRT_SYNC_CLOCK_MACH_ABSTIME;
+#elif defined(TIMING_USE_CLOCK_GETTIME)
+    return SRT_SYNC_CLOCK_GETTIME_MONOTONIC;
+#else
+    return SRT_SYNC_CLOCK_POSIX_GETTIMEOFDAY;
+#endif
+}
+
+#ifdef TIMING_USE_TSC
+
+static inline uint64_t read_tsc()
+{
+    return __rdtsc();
+}
+
+// The TSC can measure time only if it ticks at a constant rate
+// regardless of the power state of the core (CPUID.80000007H:EDX[8]).
+static bool has_invariant_tsc()
+{
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if (unsigned(regs[0]) < 0x80000007)
+        return false;
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#else
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000007, &a, &b, &c, &d))
+        return false;
+    return (d & (1 << 8)) != 0;
+#endif
+}
 
-#elif defined(IA32) || defined(IA64) || defined(AMD64)
-    uint64_t t1, t2;
+// Measures the TSC frequency against the platform clock in a few short
+// rounds. Returns TSC ticks per microsecond, or 0 if the TSC isn't usable:
+// not invariant, not advancing, or the rounds disagree, which happens when
+// the TSCs of the cores aren't synchronized or the hypervisor doesn't keep
+// the TSC rate stable.
+static double calibrate_tsc(int64_t sysclock_frequency)
+{
+    if (!has_invariant_tsc())
+        return 0;
 
-    rdtsc(t1);
-    timespec ts;
-    ts.tv_sec  = 0;
-    ts.tv_nsec = 100000000;
-    nanosleep(&ts, NULL);
-    rdtsc(t2);
+    const int    ROUNDS    = 3;
+    const int    ROUND_MS  = 10;
+    const double TOLERANCE = 0.001; // 1000 ppm between rounds
 
-    // CPU clocks per microsecond
-    frequency = int64_t(t2 - t1) / 100000;
+    double   round_freq[ROUNDS];
+    uint64_t total_ticks = 0;
+    uint64_t total_sys   = 0;
+    for (int i = 0; i < ROUNDS; ++i)
+    {
+        uint64_t sys0, sys1;
+        read_sysclock(sys0);
+        const uint64_t tsc0 = read_tsc();
+#ifdef _WIN32
+        Sleep(ROUND_MS);
+#else
+        timespec ts;
+        ts.tv_sec  = 0;
+        ts.tv_nsec = ROUND_MS * 1000000;
+        nanosleep(&ts, NULL);
 #endif
+        read_sysclock(sys1);
+        const uint64_t tsc1 = read_tsc();
 
-    return frequency;
+        if (tsc1 <= tsc0 || sys1 <= sys0)
+            return 0;
+
+        round_freq[i] = double(tsc1 - tsc0) * sysclock_frequency / double(sys1 - sys0);
+        total_ticks += tsc1 - tsc0;
+        total_sys += sys1 - sys0;
+    }
+
+    for (int i = 1; i < ROUNDS; ++i)
+    {
+        if (fabs(round_freq[i] - round_freq[0]) > round_freq[0] * TOLERANCE)
+            return 0;
+    }
+
+    const double frequency = double(total_ticks) * sysclock_frequency / double(total_sys);
+
+    // Below 100 MHz it's not a real TSC.
+    return frequency >= 100 ? frequency : 0;
+}
+
+// The TSC is converted to nanoseconds when read, as tsc * mult >> shift,
+// so that the conversions of the steady clock use an integer frequency.
+struct TscScale
+{
+    bool     usable;
+    uint32_t mult;
+    int      shift; // up to 32
+};
+
+static TscScale get_tsc_scale()
+{
+    TscScale scale = {false, 0, 0};
+    const double frequency = calibrate_tsc(get_sysclock_frequency());
+    if (frequency <= 0)
+        return scale;
+
+    // The highest precision that keeps mult in 32 bits.
+    const double ns_per_tick = 1000 / frequency;
+    int shift = 32;
+    while (shift > 0 && ns_per_tick * (uint64_t(1) << shift) >= 4294967295.0)
+        --shift;
+
+    scale.usable = true;
+    scale.mult   = uint32_t(ns_per_tick * (uint64_t(1) << shift) + 0.5);
+    scale.shift  = shift;
+    return scale;
+}
+
+static TscScale s_tsc = {false, 0, 0};
+
+#endif
+
+// The clock is set up at its first use rather than at the library load,
+// as the calibration takes a while and the clock may be used by other
+// static initializers. Only constant-initialized data are used for that.
+static int64_t        s_cpu_frequency = 1; // Steady clock ticks per microsecond
+static pthread_once_t s_clock_once    = PTHREAD_ONCE_INIT;
+
+static void init_clock()
+{
+#ifdef TIMING_USE_TSC
+    s_tsc = get_tsc_scale();
+    if (s_tsc.usable)
+    {
+        s_cpu_frequency = 1000;
+        return;
+    }
+#endif
+    s_cpu_frequency = get_sysclock_frequency();
+}
+
+static inline int64_t cpu_frequency()
+{
+    pthread_once(&s_clock_once, init_clock);
+    return s_cpu_frequency;
+}
+
+static inline bool use_tsc()
+{
+#ifdef TIMING_USE_TSC
+    pthread_once(&s_clock_once, init_clock);
+    return s_tsc.usable;
+#else
+    return false;
+#endif
 }
 
-const int64_t s_cpu_frequency = get_cpu_frequency();
+#ifdef TIMING_USE_TSC
+static inline uint64_t read_tsc_ns()
+{
+    // Split, so that the multiplication doesn't overflow.
+    const uint64_t tsc = read_tsc();
+    return (((tsc >> 32) * s_tsc.mult) << (32 - s_tsc.shift)) + (((tsc & 0xFFFFFFFF) * s_tsc.mult) >> s_tsc.shift);
+}
+#endif
 
+int clock_type()
+{
+    return use_tsc() ? SRT_SYNC_CLOCK_TSC : get_sysclock_type();
+}
 
 } // namespace sync
 } // namespace srt
@@ -132,7 +302,7 @@ static timespec us_to_timespec(const uint64_t time_us)
 template <>
 uint64_t srt::sync::TimePoint<srt::sync::steady_clock>::us_since_epoch() const
 {
-    return m_timestamp / s_cpu_frequency;
+    return m_timestamp / cpu_frequency();
 }
 
 template <>
@@ -143,39 +313,43 @@ srt::sync::Duration<srt::sync::steady_clock> srt::sync::TimePoint<srt::sync::ste
 
 srt::sync::TimePoint<srt::sync::steady_clock> srt::sync::steady_clock::now()
 {
+#ifdef TIMING_USE_TSC
+    if (use_tsc())
+        return TimePoint<steady_clock>(read_tsc_ns());
+#endif
     uint64_t x = 0;
-    rdtsc(x);
+    read_sysclock(x);
     return TimePoint<steady_clock>(x);
 }
 
 int64_t srt::sync::count_microseconds(const steady_clock::duration& t)
 {
-    return t.count() / s_cpu_frequency;
+    return t.count() / cpu_frequency();
 }
 
 int64_t srt::sync::count_milliseconds(const steady_clock::duration& t)
 {
-    return t.count() / s_cpu_frequency / 1000;
+    return t.count() / cpu_frequency() / 1000;
 }
 
 int64_t srt::sync::count_seconds(const steady_clock::duration& t)
 {
-    return t.count() / s_cpu_frequency / 1000000;
+    return t.count() / cpu_frequency() / 1000000;
 }
 
 srt::sync::steady_clock::duration srt::sync::microseconds_from(int64_t t_us)
 {
-    return steady_clock::duration(t_us * s_cpu_frequency);
+    return steady_clock::duration(t_us * cpu_frequency());
 }
 
 srt::sync::steady_clock::duration srt::sync::milliseconds_from(int64_t t_ms)
 {
-    return steady_clock::duration((1000 * t_ms) * s_cpu_frequency);
+    return steady_clock::duration((1000 * t_ms) * cpu_frequency());
 }
 
 srt::sync::steady_clock::duration srt::sync::seconds_from(int64_t t_s)
 {
-    return steady_clock::duration((1000000 * t_s) * s_cpu_frequency);
+    return steady_clock::duration((1000000 * t_s) * cpu_frequency());
 }
 
 std::string srt::sync::FormatTime(const steady_clock::time_point& timestamp)
@@ -223,6 +397,27 @@ std::string srt::sync::FormatTimeSys(const steady_clock::time_point& timestamp)
     return out.str();
 }
 
+// State of the generator below, 0 until the first use.
+static srt::sync::atomic<uint64_t> s_RandomState;
+
+int srt::sync::genRandomInt(int minVal, int maxVal)
+{
+    // A lock-free LCG (with Knuth's MMIX constants) seeded from the clock.
+    // The quality is good enough for jitter and phase selection, which is
+    // all it's used for; it must not be used for keys or cookies.
+    uint64_t state = s_RandomState.load();
+    uint64_t next;
+    do
+    {
+        const uint64_t seed = state ? state : (uint64_t(count_microseconds(steady_clock::now())) | 1);
+        next = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    } while (!s_RandomState.compare_exchange((state), next));
+
+    // The high bits of an LCG are the most random ones.
+    const uint64_t range = uint64_t(int64_t(maxVal) - minVal) + 1;
+    return int(minVal + int64_t((next >> 32) % range));
+}
+
 srt::sync::Mutex::Mutex()
 {
     pthread_mutex_init(&m_mutex, NULL);
@@ -442,12 +637,34 @@ srt::sync::CEvent g_Sync;
 ////////////////////////////////////////////////////////////////////////////////
 
 srt::sync::CTimer::CTimer()
+#if USE_TIMERFD
+    : m_iTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+    , m_iWakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_bWaiting(false)
+#endif
 {
+#if USE_TIMERFD
+    if (m_iTimerFd == -1 || m_iWakeFd == -1)
+    {
+        if (m_iTimerFd != -1)
+            ::close(m_iTimerFd);
+        if (m_iWakeFd != -1)
+            ::close(m_iWakeFd);
+        m_iTimerFd = m_iWakeFd = -1;
+    }
+#endif
 }
 
 
 srt::sync::CTimer::~CTimer()
 {
+#if USE_TIMERFD
+    if (m_iTimerFd != -1)
+    {
+        ::close(m_iTimerFd);
+        ::close(m_iWakeFd);
+    }
+#endif
 }
 
 
@@ -481,9 +698,9 @@ bool srt::sync::CTimer::sleep_until(TimePoint<steady_clock> tp)
             break;
 
         td_wait -= td_threshold;
-        m_event.lock_wait_for(td_wait);
+        wait_until(cur_tp + td_wait);
 #else
-        m_event.lock_wait_until(m_tsSchedTime);
+        wait_until(m_tsSchedTime);
 #endif // USE_BUSY_WAITING
 
         cur_tp = steady_clock::now();
@@ -514,16 +731,116 @@ bool srt::sync::CTimer::sleep_until(TimePoint<steady_clock> tp)
 }
 
 
+#if USE_TIMERFD
+// Reads the counter of the timerfd or eventfd, which resets it.
+// EAGAIN means there was nothing to reset.
+static bool reset_fd_counter(int fd)
+{
+    uint64_t count;
+    for (;;)
+    {
+        const ssize_t res = ::read(fd, &count, sizeof count);
+        if (res == (ssize_t)sizeof count)
+            return true;
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res == -1 && errno == EAGAIN)
+            return true;
+        LOGC(mglog.Error, log << "CTimer: can't reset fd " << fd << ": " << SysStrError(errno));
+        return false;
+    }
+}
+
+// Adds one to the counter of the eventfd. EAGAIN means the counter
+// is at its maximum, so the waiting thread is woken up anyway.
+static void signal_fd(int fd)
+{
+    const uint64_t one = 1;
+    for (;;)
+    {
+        const ssize_t res = ::write(fd, &one, sizeof one);
+        if (res == (ssize_t)sizeof one)
+            return;
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res != -1 || errno != EAGAIN)
+            LOGC(mglog.Error, log << "CTimer: can't signal fd " << fd << ": " << SysStrError(errno));
+        return;
+    }
+}
+#endif
+
+
+void srt::sync::CTimer::wait_until(const steady_clock::time_point& tp)
+{
+#if USE_TIMERFD
+    if (m_iTimerFd != -1)
+    {
+        // The timer expires exactly at the given time, unlike
+        // the timeout of poll(), which is subject to the timer slack.
+        const int64_t rel_us = count_microseconds(tp - steady_clock::now());
+        if (rel_us <= 0)
+            return;
+
+        itimerspec its;
+        memset(&its, 0, sizeof its);
+        its.it_value.tv_sec  = rel_us / 1000000;
+        its.it_value.tv_nsec = (rel_us % 1000000) * 1000;
+        if (timerfd_settime(m_iTimerFd, 0, &its, NULL) == -1)
+        {
+            m_event.lock_wait_until(tp);
+            return;
+        }
+
+        pollfd fds[2];
+        fds[0].fd     = m_iTimerFd;
+        fds[0].events = POLLIN;
+        fds[1].fd     = m_iWakeFd;
+        fds[1].events = POLLIN;
+
+        m_bWaiting.store(true);
+        const int nready = ::poll(fds, 2, -1);
+        m_bWaiting.store(false);
+
+        // Reset both for the next wait. An interruption (EINTR)
+        // leaves it to the caller to check the time and wait again;
+        // the revents are not valid then. If a reset fails, the next poll() would return at once,
+        // so the rest of this wait is done the other way.
+        if (nready <= 0)
+            return;
+        bool reset = true;
+        if (fds[0].revents & POLLIN)
+            reset = reset_fd_counter(m_iTimerFd) && reset;
+        if (fds[1].revents & POLLIN)
+            reset = reset_fd_counter(m_iWakeFd) && reset;
+        if (!reset)
+            m_event.lock_wait_until(tp);
+        return;
+    }
+#endif
+    m_event.lock_wait_until(tp);
+}
+
+
 void srt::sync::CTimer::interrupt()
 {
     UniqueLock lck(m_event.mutex());
     m_tsSchedTime = steady_clock::now();
     m_event.notify_all();
+#if USE_TIMERFD
+    // Always, as the thread may be just about to wait.
+    if (m_iWakeFd != -1)
+        signal_fd(m_iWakeFd);
+#endif
 }
 
 
 void srt::sync::CTimer::tick()
 {
     m_event.notify_one();
+#if USE_TIMERFD
+    if (m_iWakeFd != -1 && m_bWaiting.load())
+        signal_fd(m_iWakeFd);
+#endif
 }
 
@@ -15,9 +15,14 @@
 //#define ENABLE_CXX17
 
 #include <cstdlib>
+#include <limits>
 #include <pthread.h>
 #include "utilities.h"
 
+#if HAVE_CXX11
+#include <atomic>
+#endif
+
 namespace srt
 {
 namespace sync
@@ -181,6 +186,9 @@ Duration<steady_clock> seconds_from(int64_t t_s);
 
 inline bool is_zero(const TimePoint<steady_clock>& t) { return t.is_zero(); }
 
+// The source of the steady_clock ticks, one of SRT_SYNC_CLOCK_* from srt.h.
+int clock_type();
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -283,6 +291,127 @@ class InvertedLock
 inline void setupMutex(Mutex&, const char*) {}
 inline void releaseMutex(Mutex&) {}
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Atomic section
+//
+////////////////////////////////////////////////////////////////////////////////
+
+/// A subset of std::atomic for integer types, with relaxed memory ordering,
+/// except load_acquire and store_release. It's intended for values like statistics
+/// counters, which are updated without a lock and read occasionally by another
+/// thread, and which don't synchronize access to any other data, or only
+/// to data with a single writer (see load_acquire/store_release). Without C++11 the GCC builtins are used, and for
+/// other compilers the operations fall back to a mutex.
+template <class T>
+class atomic
+{
+public:
+    explicit atomic(T value = T())
+        : m_value(value)
+    {
+    }
+
+#if HAVE_CXX11
+    T load() const { return m_value.load(std::memory_order_relaxed); }
+    void store(T value) { m_value.store(value, std::memory_order_relaxed); }
+    T load_acquire() const { return m_value.load(std::memory_order_acquire); }
+    void store_release(T value) { m_value.store(value, std::memory_order_release); }
+    T exchange(T value) { return m_value.exchange(value, std::memory_order_relaxed); }
+    T fetch_add(T value) { return m_value.fetch_add(value, std::memory_order_relaxed); }
+    bool compare_exchange(T& w_expected, T desired)
+    {
+        return m_value.compare_exchange_weak(w_expected, desired, std::memory_order_relaxed);
+    }
+#elif defined(__GNUC__)
+    T load() const { return __atomic_load_n(&m_value, __ATOMIC_RELAXED); }
+    void store(T value) { __atomic_store_n(&m_value, value, __ATOMIC_RELAXED); }
+    T load_acquire() const { return __atomic_load_n(&m_value, __ATOMIC_ACQUIRE); }
+    void store_release(T value) { __atomic_store_n(&m_value, value, __ATOMIC_RELEASE); }
+    T exchange(T value) { return __atomic_exchange_n(&m_value, value, __ATOMIC_RELAXED); }
+    T fetch_add(T value) { return __atomic_fetch_add(&m_value, value, __ATOMIC_RELAXED); }
+    bool compare_exchange(T& w_expected, T desired)
+    {
+        return __atomic_compare_exchange_n(&m_value, &w_expected, desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+#else
+    T load() const { ScopedLock lk(m_lock); return m_value; }
+    void store(T value) { ScopedLock lk(m_lock); m_value = value; }
+    T load_acquire() const { return load(); }
+    void store_release(T value) { store(value); }
+    T exchange(T value) { ScopedLock lk(m_lock); T old = m_value; m_value = value; return old; }
+    T fetch_add(T value) { ScopedLock lk(m_lock); T old = m_value; m_value += value; return old; }
+    bool compare_exchange(T& w_expected, T desired)
+    {
+        ScopedLock lk(m_lock);
+        if (m_value != w_expected)
+        {
+            w_expected = m_value;
+            return false;
+        }
+        m_value = desired;
+        return true;
+    }
+#endif
+
+    /// Set the value to the given one, if it's greater than the current one.
+    void fetch_max(T value)
+    {
+        T current = load();
+        while (value > current && !compare_exchange((current), value))
+        {
+        }
+    }
+
+private:
+    atomic(const atomic&);
+    atomic& operator=(const atomic&);
+
+#if HAVE_CXX11
+    std::atomic<T> m_value;
+#elif defined(__GNUC__)
+    T m_value;
+#else
+    mutable Mutex m_lock;
+    T m_value;
+#endif
+};
+
+/// Fences ordering the relaxed operations of the atomic above, as needed by
+/// a sequence lock: the reader reads the data, then atomic_fence_acquire(),
+/// then the sequence number again; the writer changes the sequence number,
+/// then atomic_fence_release(), then the data. In the mutex fallback every
+/// operation is already ordered by the lock.
+inline void atomic_fence_acquire()
+{
+#if HAVE_CXX11
+    std::atomic_thread_fence(std::memory_order_acquire);
+#elif defined(__GNUC__)
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void atomic_fence_release()
+{
+#if HAVE_CXX11
+    std::atomic_thread_fence(std::memory_order_release);
+#elif defined(__GNUC__)
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/// Full fence, for when a store must become visible to other threads before
+/// a following load, as when two threads each announce themselves and then
+/// check for the other one.
+inline void atomic_fence_seq_cst()
+{
+#if HAVE_CXX11
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#elif defined(__GNUC__)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Condition section
@@ -547,8 +676,21 @@ public:
     void tick();
 
 private:
+    /// Waits until the given time, unless woken up
+    /// by interrupt() or tick().
+    void wait_until(const steady_clock::time_point& tp);
+
     CEvent m_event;
     steady_clock::time_point m_tsSchedTime;
+
+#if USE_TIMERFD
+    // The waiting is done on a timerfd, and interrupt() and tick()
+    // wake it up through an eventfd. If any of them couldn't be
+    // created, m_event is used for waiting instead.
+    int m_iTimerFd;
+    int m_iWakeFd;
+    atomic<bool> m_bWaiting; // tick() wakes up only a waiting thread
+#endif
 };
 
 
@@ -566,6 +708,13 @@ std::string FormatTime(const steady_clock::time_point& time);
 /// @returns a string with a formatted time representation
 std::string FormatTimeSys(const steady_clock::time_point& time);
 
+/// Generate a uniformly distributed random number, thread-safe and
+/// without disturbing the sequence of rand() that the application may use.
+/// @param [in] minVal  the lowest value to generate
+/// @param [in] maxVal  the highest value to generate
+/// @returns a random number in the range [minVal, maxVal]
+int genRandomInt(int minVal, int maxVal);
+
 enum eDurationUnit {DUNIT_S, DUNIT_MS, DUNIT_US};
 
 template <eDurationUnit u>
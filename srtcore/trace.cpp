@@ -0,0 +1,224 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#define SRT_IMPORT_TIME 1
+#include "platform_sys.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "trace.h"
+
+using namespace std;
+using namespace srt::sync;
+
+namespace srt
+{
+namespace trace
+{
+
+sync::atomic<int> g_iEnabled(0);
+
+namespace
+{
+
+struct Ring
+{
+    SRT_TRACEEVENT*        events;
+    uint64_t               size;  // power of two
+    sync::atomic<uint64_t> head;  // number of events recorded so far; written only by the owner
+    uint16_t               id;
+    bool                   owned; // guarded by Registry::lock
+};
+
+class Registry
+{
+public:
+    Mutex         lock;
+    vector<Ring*> rings;
+    uint64_t      ring_size;
+    pthread_key_t key;
+
+    Registry()
+        : ring_size(SRT_TRACE_DEFAULT_EVENTS)
+    {
+        pthread_key_create(&key, release);
+    }
+
+    Ring* acquire()
+    {
+        ScopedLock lk(lock);
+        Ring* r = NULL;
+        for (size_t i = 0; i < rings.size(); ++i)
+        {
+            if (!rings[i]->owned && rings[i]->size == ring_size)
+            {
+                r = rings[i];
+                break;
+            }
+        }
+
+        if (!r)
+        {
+            if (rings.size() > 0xFFFF)
+                return NULL;
+            r = new Ring;
+            r->events = new SRT_TRACEEVENT[ring_size];
+            memset(r->events, 0, sizeof(SRT_TRACEEVENT) * ring_size);
+            r->size = ring_size;
+            r->id = uint16_t(rings.size());
+            rings.push_back(r);
+        }
+
+        r->owned = true;
+        pthread_setspecific(key, r);
+        return r;
+    }
+
+    static void release(void* ring);
+};
+
+Registry& registry()
+{
+    // Never deleted, as exiting threads may release their rings
+    // after the static objects have been destroyed. Rings are never
+    // deleted either, just reused by other threads.
+    static Registry* reg = new Registry;
+    return *reg;
+}
+
+// Make sure the registry and its key are created before any
+// SRT thread is started.
+const Registry& s_Registry = registry();
+
+void Registry::release(void* ring)
+{
+    ScopedLock lk(registry().lock);
+    static_cast<Ring*>(ring)->owned = false;
+}
+
+bool earlier(const SRT_TRACEEVENT& a, const SRT_TRACEEVENT& b)
+{
+    return a.ts < b.ts;
+}
+
+} // namespace
+
+void record(SRT_TRACE_EVENT type, int32_t socket, int32_t seqno, uint32_t arg)
+{
+    Registry& reg = registry();
+    Ring* r = static_cast<Ring*>(pthread_getspecific(reg.key));
+    if (!r)
+    {
+        r = reg.acquire();
+        if (!r)
+            return;
+    }
+
+    const uint64_t h = r->head.load();
+    // Pairs with the fence in dump(): whoever sees a part of this event
+    // sees also the head of at least h.
+    atomic_fence_release();
+    SRT_TRACEEVENT& e = r->events[h & (r->size - 1)];
+    e.ts = steady_clock::now().time_since_epoch().count();
+    e.socket = socket;
+    e.seqno = seqno;
+    e.arg = arg;
+    e.type = uint16_t(type);
+    e.thread = r->id;
+    r->head.store_release(h + 1);
+}
+
+bool setup(int events_per_thread)
+{
+    if (events_per_thread < 0)
+        return false;
+
+    if (events_per_thread == 0)
+    {
+        g_iEnabled.store(0);
+        return true;
+    }
+
+    uint64_t size = 1;
+    while (size < uint64_t(events_per_thread))
+        size <<= 1;
+
+    Registry& reg = registry();
+    {
+        ScopedLock lk(reg.lock);
+        reg.ring_size = size;
+    }
+    g_iEnabled.store(1);
+    return true;
+}
+
+int dump(const char* path)
+{
+    Registry& reg = registry();
+    vector<SRT_TRACEEVENT> events;
+
+    {
+        ScopedLock lk(reg.lock);
+        for (size_t i = 0; i < reg.rings.size(); ++i)
+        {
+            const Ring& r = *reg.rings[i];
+
+            // The owner keeps recording while the ring is copied, so events
+            // that might have been overwritten in the meantime are discarded:
+            // the slot of the event being recorded overlaps the oldest one.
+            const uint64_t head = r.head.load_acquire();
+            const uint64_t begin = head > r.size ? head - r.size : 0;
+            const size_t pos = events.size();
+            for (uint64_t x = begin; x < head; ++x)
+                events.push_back(r.events[x & (r.size - 1)]);
+
+            // The copied events must be read before the head is checked again.
+            atomic_fence_acquire();
+            const uint64_t head_after = r.head.load();
+            const uint64_t valid = head_after >= r.size ? head_after - r.size + 1 : 0;
+            if (valid > begin)
+            {
+                const size_t stale = size_t(min(valid, head) - begin);
+                events.erase(events.begin() + pos, events.begin() + pos + stale);
+            }
+        }
+    }
+
+    stable_sort(events.begin(), events.end(), earlier);
+
+    SRT_TRACEHEADER hdr;
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, "SRTTRACE", sizeof hdr.magic);
+    hdr.version = 1;
+    hdr.event_size = sizeof(SRT_TRACEEVENT);
+    hdr.ticks_per_sec = microseconds_from(1000000).count();
+    hdr.ref_ticks = steady_clock::now().time_since_epoch().count();
+    timeval tv;
+    gettimeofday(&tv, 0);
+    hdr.ref_unix_us = int64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+    hdr.count = events.size();
+
+    FILE* f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    bool ok = fwrite(&hdr, sizeof hdr, 1, f) == 1;
+    if (ok && !events.empty())
+        ok = fwrite(&events[0], sizeof(SRT_TRACEEVENT), events.size(), f) == events.size();
+    if (fclose(f) != 0)
+        ok = false;
+
+    return ok ? int(events.size()) : -1;
+}
+
+} // namespace trace
+} // namespace srt
@@ -0,0 +1,53 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef INC_SRT_TRACE_H
+#define INC_SRT_TRACE_H
+
+#include "srt.h"
+#include "sync.h"
+
+namespace srt
+{
+namespace trace
+{
+
+// Binary event tracing, cheap enough to be left enabled in production.
+//
+// Every thread records into its own ring buffer, so recording takes no lock:
+// the ring is found through a thread-specific key, the event is written into
+// the next slot and the ring's head is advanced. A ring is allocated when the
+// thread records the first event and it's returned to a free list when the
+// thread exits, so that another thread can reuse it. When tracing is disabled,
+// recording costs only one relaxed load.
+
+extern sync::atomic<int> g_iEnabled;
+
+void record(SRT_TRACE_EVENT type, int32_t socket, int32_t seqno, uint32_t arg);
+
+inline void event(SRT_TRACE_EVENT type, int32_t socket, int32_t seqno, uint32_t arg = 0)
+{
+    if (g_iEnabled.load())
+        record(type, socket, seqno, arg);
+}
+
+// Enables tracing with rings of the given size (rounded up to a power of two),
+// or disables it, if 0. Rings already in use keep their size. Returns false if
+// the size is invalid.
+bool setup(int events_per_thread);
+
+// Writes the header and all events of all rings, ordered by time, to the file.
+// Returns the number of events, or -1 if the file couldn't be written.
+int dump(const char* path);
+
+} // namespace trace
+} // namespace srt
+
+#endif // INC_SRT_TRACE_H
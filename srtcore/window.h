@@ -207,12 +207,14 @@ public:
    }
 
    /// Record time information of an arrived packet.
+   /// @param pktsz  size of the packet's payload.
+   /// @param now    arrival time of the packet.
 
-   void onPktArrival(int pktsz = 0)
+   void onPktArrival(int pktsz, const srt::sync::steady_clock::time_point& now)
    {
        srt::sync::CGuard cg(m_lockPktWindow);
 
-       m_tsCurrArrTime = srt::sync::steady_clock::now();
+       m_tsCurrArrTime = now;
 
        // record the packet interval between the current and the last one
        m_aPktWindow[m_iPktWindowPtr] = count_microseconds(m_tsCurrArrTime - m_tsLastArrTime);
@@ -228,14 +230,14 @@ public:
    }
 
    /// Shortcut to test a packet for possible probe 1 or 2
-   void probeArrival(const CPacket& pkt, bool unordered)
+   void probeArrival(const CPacket& pkt, bool unordered, const srt::sync::steady_clock::time_point& now)
    {
        const int inorder16 = pkt.m_iSeqNo & PUMASK_SEQNO_PROBE;
 
        // for probe1, we want 16th packet
        if (inorder16 == 0)
        {
-           probe1Arrival(pkt, unordered);
+           probe1Arrival(pkt, unordered, now);
        }
 
        if (unordered)
@@ -244,12 +246,12 @@ public:
        // for probe2, we want 17th packet
        if (inorder16 == 1)
        {
-           probe2Arrival(pkt);
+           probe2Arrival(pkt, now);
        }
    }
 
    /// Record the arrival time of the first probing packet.
-   void probe1Arrival(const CPacket& pkt, bool unordered)
+   void probe1Arrival(const CPacket& pkt, bool unordered, const srt::sync::steady_clock::time_point& now)
    {
        if (unordered && pkt.m_iSeqNo == m_Probe1Sequence)
        {
@@ -260,13 +262,13 @@ public:
            return;
        }
 
-       m_tsProbeTime = srt::sync::steady_clock::now();
+       m_tsProbeTime = now;
        m_Probe1Sequence = pkt.m_iSeqNo; // Record the sequence where 16th packet probe was taken
    }
 
    /// Record the arrival time of the second probing packet and the interval between packet pairs.
 
-   void probe2Arrival(const CPacket& pkt)
+   void probe2Arrival(const CPacket& pkt, const srt::sync::steady_clock::time_point& now)
    {
        // Reject probes that don't refer to the very next packet
        // towards the one that was lately notified by probe1Arrival.
@@ -279,11 +281,6 @@ public:
        if (m_Probe1Sequence == -1 || CSeqNo::incseq(m_Probe1Sequence) != pkt.m_iSeqNo)
            return;
 
-       // Grab the current time before trying to acquire
-       // a mutex. This might add extra delay and therefore
-       // screw up the measurement.
-       const srt::sync::steady_clock::time_point now = srt::sync::steady_clock::now();
-
        // Lock access to the packet Window
        srt::sync::CGuard cg(m_lockProbeWindow);
 
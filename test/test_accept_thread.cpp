@@ -0,0 +1,203 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+
+using namespace std;
+
+namespace
+{
+
+const char* const PASSPHRASE = "accept-storm-passphrase";
+
+struct StormResult
+{
+    int accepted;
+    int received;
+    double delay_p50_us;
+    double delay_p99_us;
+    double delay_max_us;
+};
+
+sockaddr_in LocalAddr(int port)
+{
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    return sa;
+}
+
+void SetupSocket(SRTSOCKET s)
+{
+    const bool no = false;
+    // Without TSBPD the packets are delivered as soon as they arrive,
+    // so the delay seen by the application is the one of the data path.
+    srt_setsockflag(s, SRTO_TSBPDMODE, &no, sizeof no);
+    srt_setsockflag(s, SRTO_PASSPHRASE, PASSPHRASE, strlen(PASSPHRASE));
+}
+
+// A stream of packets, one every millisecond, goes from a caller to the
+// socket accepted from the listener. While it runs, 'nclients' callers
+// connect to the same listener. Every packet carries the time when it was
+// sent and the receiver collects the time it took to deliver it.
+void RunStorm(bool accept_thread, int port, int nclients, StormResult& w_result)
+{
+    w_result = StormResult();
+
+    const sockaddr_in lsa = LocalAddr(port);
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    SetupSocket(listener);
+    ASSERT_NE(srt_setsockflag(listener, SRTO_ACCEPTTHREAD, &accept_thread, sizeof accept_thread), SRT_ERROR);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, nclients + 1), SRT_ERROR);
+
+    const SRTSOCKET stream_caller = srt_create_socket();
+    SetupSocket(stream_caller);
+    ASSERT_NE(srt_connect(stream_caller, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+    const SRTSOCKET stream_rcv = srt_accept(listener, NULL, NULL);
+    ASSERT_NE(stream_rcv, SRT_INVALID_SOCK);
+
+    atomic<int> accepted(0);
+    thread acceptor([&] {
+        while (accepted < nclients)
+        {
+            const SRTSOCKET s = srt_accept(listener, NULL, NULL);
+            if (s == SRT_INVALID_SOCK)
+                break;
+            ++accepted;
+        }
+    });
+
+    const int npackets = 1000;
+    vector<double> delays;
+    delays.reserve(npackets);
+    atomic<int> received(0);
+    thread receiver([&] {
+        char buf[1500];
+        for (int i = 0; i < npackets; ++i)
+        {
+            const int size = srt_recvmsg(stream_rcv, buf, sizeof buf);
+            if (size < int(sizeof(int64_t)))
+                break;
+            int64_t sent_us;
+            memcpy(&sent_us, buf, sizeof sent_us);
+            const int64_t now_us = chrono::duration_cast<chrono::microseconds>(
+                    chrono::steady_clock::now().time_since_epoch()).count();
+            delays.push_back(double(now_us - sent_us));
+            ++received;
+        }
+    });
+
+    // The callers share one local port, and so one multiplexer.
+    const sockaddr_in csa = LocalAddr(port + 1);
+    vector<SRTSOCKET> clients;
+    thread storm([&] {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        const bool no = false;
+        for (int i = 0; i < nclients; ++i)
+        {
+            const SRTSOCKET s = srt_create_socket();
+            SetupSocket(s);
+            srt_setsockflag(s, SRTO_RCVSYN, &no, sizeof no);
+            srt_bind(s, (sockaddr*)&csa, sizeof csa);
+            srt_connect(s, (sockaddr*)&lsa, sizeof lsa);
+            clients.push_back(s);
+        }
+    });
+
+    // No ASSERT from here on, the threads must be joined.
+    char payload[188] = {};
+    auto next = chrono::steady_clock::now();
+    for (int i = 0; i < npackets; ++i)
+    {
+        next += chrono::milliseconds(1);
+        this_thread::sleep_until(next);
+        const int64_t now_us = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count();
+        memcpy(payload, &now_us, sizeof now_us);
+        const int st = srt_sendmsg(stream_caller, payload, sizeof payload, -1, true);
+        EXPECT_NE(st, SRT_ERROR) << srt_getlasterror_str();
+        if (st == SRT_ERROR)
+            break;
+    }
+
+    // The last packets of the stream may still be on the way.
+    storm.join();
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    while ((accepted < nclients || received < npackets) && chrono::steady_clock::now() < deadline)
+        this_thread::sleep_for(chrono::milliseconds(10));
+
+    // Unblocks the acceptor and receiver, if still waiting.
+    srt_close(listener);
+    srt_close(stream_rcv);
+    acceptor.join();
+    receiver.join();
+
+    w_result.accepted = accepted;
+    w_result.received = int(delays.size());
+    sort(delays.begin(), delays.end());
+    if (delays.empty())
+        delays.push_back(0);
+    w_result.delay_p50_us = delays[delays.size() / 2];
+    w_result.delay_p99_us = delays[delays.size() * 99 / 100];
+    w_result.delay_max_us = delays.back();
+
+    srt_close(stream_caller);
+    for (size_t i = 0; i < clients.size(); ++i)
+        srt_close(clients[i]);
+}
+
+}
+
+// Measures the delivery delay of an established stream while a storm
+// of callers connect to the same listener, with the connection requests
+// processed in the receiver queue worker and in the acceptor thread.
+// Every caller must be accepted in both modes, but with the acceptor
+// thread the stream isn't delayed by creating the accepted sockets.
+TEST(AcceptThread, ExistingStreamJitter)
+{
+    const int nclients = 200;
+    const bool modes[] = { false, true };
+    StormResult results[2];
+
+    for (size_t m = 0; m < sizeof modes / sizeof modes[0]; ++m)
+    {
+        ASSERT_EQ(srt_startup(), 0);
+
+        StormResult& r = results[m];
+        RunStorm(modes[m], 5610 + 2 * int(m), nclients, (r));
+        printf("Accept thread %s: %d of %d callers accepted, stream delay p50=%.0fus p99=%.0fus max=%.0fus\n",
+                modes[m] ? "on " : "off", r.accepted, nclients, r.delay_p50_us, r.delay_p99_us, r.delay_max_us);
+
+        EXPECT_EQ(r.accepted, nclients);
+        EXPECT_EQ(r.received, 1000);
+
+        srt_cleanup();
+    }
+
+    EXPECT_LT(results[1].delay_p99_us, results[0].delay_p99_us / 2);
+}
@@ -0,0 +1,589 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+
+using namespace std;
+
+namespace
+{
+
+const int PAYLOAD_SIZE = 1316;
+
+// Binds the listener to the loopback and lets it accept the group members.
+// The other options must be set before.
+void ListenForGroups(SRTSOCKET listener, int port, int backlog, sockaddr_in& w_sa)
+{
+    const int yes = 1;
+    ASSERT_NE(srt_setsockflag(listener, SRTO_GROUPCONNECT, &yes, sizeof yes), SRT_ERROR);
+
+    memset(&w_sa, 0, sizeof w_sa);
+    w_sa.sin_family = AF_INET;
+    w_sa.sin_port = htons(port);
+    ASSERT_EQ(inet_pton(AF_INET, "127.0.0.1", &w_sa.sin_addr), 1);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&w_sa, sizeof w_sa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, backlog), SRT_ERROR);
+}
+
+// Connects the group with nlinks members to the same listener.
+void ConnectGroup(SRTSOCKET group, const sockaddr_in& sa, int nlinks)
+{
+    vector<SRT_SOCKGROUPDATA> targets(nlinks);
+    for (int i = 0; i < nlinks; ++i)
+        targets[i] = srt_prepare_endpoint(NULL, (const sockaddr*)&sa, sizeof sa);
+    ASSERT_NE(srt_connect_group(group, &targets[0], nlinks), SRT_ERROR);
+}
+
+// Waits up to 2 seconds until all nlinks members of the group are connected.
+void WaitConnected(SRTSOCKET group, int nlinks, SRT_SOCKGROUPDATA* w_members, size_t& w_nmembers)
+{
+    w_nmembers = 0;
+    for (int attempt = 0; attempt < 200; ++attempt)
+    {
+        w_nmembers = nlinks;
+        ASSERT_NE(srt_group_data(group, w_members, &w_nmembers), SRT_ERROR);
+        size_t nconnected = 0;
+        for (size_t i = 0; i < w_nmembers; ++i)
+            nconnected += w_members[i].status == SRTS_CONNECTED;
+        if (nconnected == size_t(nlinks))
+            break;
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    ASSERT_EQ(w_nmembers, size_t(nlinks));
+}
+
+// Sends the packets [from, to), each carrying its counter, one per interval
+// counted from start.
+template <class Duration>
+void SendCounters(SRTSOCKET group, int from, int to, chrono::steady_clock::time_point start, Duration interval)
+{
+    vector<char> payload(PAYLOAD_SIZE);
+    for (int i = from; i < to; ++i)
+    {
+        memcpy(&payload[0], &i, sizeof i);
+        ASSERT_EQ(srt_sendmsg(group, &payload[0], PAYLOAD_SIZE, -1, 1), PAYLOAD_SIZE) << srt_getlasterror_str();
+        this_thread::sleep_until(start + (i + 1) * interval);
+    }
+}
+
+struct ReceiveResult
+{
+    int received;
+    int disordered;    // packets coming after a later one, or repeated
+    int lost;          // packets skipped in the stream
+};
+
+// Reads the packets sent by SendCounters, until the last one comes or
+// nothing comes within timeout_ms.
+void ReceiveCounters(SRTSOCKET group, int npackets, int timeout_ms, ReceiveResult& w_result)
+{
+    w_result = ReceiveResult();
+    srt_setsockflag(group, SRTO_RCVTIMEO, &timeout_ms, sizeof timeout_ms);
+
+    char buf[1500];
+    int last = -1;
+    while (last < npackets - 1)
+    {
+        const int size = srt_recvmsg(group, buf, sizeof buf);
+        if (size == SRT_ERROR)
+            break;
+        int counter;
+        memcpy(&counter, buf, sizeof counter);
+        if (counter <= last)
+        {
+            ++w_result.disordered;
+            continue;
+        }
+        w_result.lost += counter - last - 1;
+        last = counter;
+        ++w_result.received;
+    }
+}
+
+}
+
+// Multipath over the loopback: a balancing group with three links to the
+// same listener, each link limited by SRTO_MAXBW, carries a stream that no
+// single link could carry. The receiver must get the stream complete and in
+// order, and the links must share it in proportion of their capacity.
+TEST(Bonding, BalancingAggregateThroughput)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const double stream_mbps = 5;
+    const int duration_s = 3;
+    const int npackets = int(stream_mbps * 1000000 / 8 / PAYLOAD_SIZE * duration_s);
+    // Bytes per second, including headers
+    const int64_t link_maxbw[] = { 500000, 250000, 250000 };
+    const int nlinks = 3;
+
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    sockaddr_in sa;
+    ASSERT_NO_FATAL_FAILURE(ListenForGroups(listener, 5555, nlinks, (sa)));
+
+    ReceiveResult result = ReceiveResult();
+    SRTSOCKET rcvgroup = SRT_INVALID_SOCK;
+    thread receiver([&] {
+        sockaddr_in peer;
+        int peerlen = sizeof peer;
+        const SRTSOCKET group = srt_accept(listener, (sockaddr*)&peer, &peerlen);
+        ASSERT_NE(group, SRT_INVALID_SOCK);
+        ASSERT_NE(group & SRTGROUP_MASK, 0);
+        rcvgroup = group;
+        ReceiveCounters(group, npackets, 1000, (result));
+    });
+
+    const SRTSOCKET group = srt_create_group(SRT_GTYPE_BALANCING);
+    ASSERT_NE(group, SRT_INVALID_SOCK);
+    ASSERT_NO_FATAL_FAILURE(ConnectGroup(group, sa, nlinks));
+
+    // Wait until all links are connected, then limit them.
+    SRT_SOCKGROUPDATA members[nlinks];
+    size_t nmembers;
+    ASSERT_NO_FATAL_FAILURE(WaitConnected(group, nlinks, members, (nmembers)));
+    for (int i = 0; i < nlinks; ++i)
+        ASSERT_NE(srt_setsockflag(members[i].id, SRTO_MAXBW, &link_maxbw[i], sizeof link_maxbw[i]), SRT_ERROR);
+
+    const auto start = chrono::steady_clock::now();
+    ASSERT_NO_FATAL_FAILURE(SendCounters(group, 0, npackets, start,
+                chrono::microseconds(int64_t(duration_s) * 1000000 / npackets)));
+
+    receiver.join();
+    const double elapsed_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int64_t sent[nlinks];
+    int64_t total_sent = 0;
+    for (int i = 0; i < nlinks; ++i)
+    {
+        SRT_TRACEBSTATS stats;
+        ASSERT_NE(srt_bstats(members[i].id, &stats, 0), SRT_ERROR);
+        sent[i] = stats.pktSentTotal - stats.pktRetransTotal;
+        total_sent += sent[i];
+    }
+
+    printf("Balancing: %d links, %.1f Mbps received (largest link %.1f Mbps), shares:",
+            nlinks, result.received * PAYLOAD_SIZE * 8 / elapsed_s / 1000000, link_maxbw[0] * 8 / 1000000.0);
+    for (int i = 0; i < nlinks; ++i)
+        printf(" %.0f%%", sent[i] * 100.0 / total_sent);
+    printf("\n");
+
+    EXPECT_EQ(result.disordered, 0);
+    EXPECT_EQ(result.received, npackets);
+    EXPECT_EQ(total_sent, npackets);
+    // The link with twice the capacity carries the most.
+    EXPECT_GT(sent[0], sent[1]);
+    EXPECT_GT(sent[0], sent[2]);
+    EXPECT_GT(sent[1], 0);
+    EXPECT_GT(sent[2], 0);
+
+    srt_close(group);
+    srt_close(rcvgroup);
+    srt_close(listener);
+    srt_cleanup();
+}
+
+namespace
+{
+
+// SRTO_GROUPSTABTIMEO of the backup groups, the default one.
+const int STABILITY_TIMEOUT_MS = 40;
+
+// Forwards UDP packets between the first client and the server,
+// until it's cut, then it drops them silently, like a failed link.
+// While it's held, it drops the packets from the server except for
+// the first one, so the client can't complete the handshake that the
+// server has already accepted.
+class UdpRelay
+{
+public:
+    UdpRelay(int port, const sockaddr_in& server)
+        : m_server(server)
+        , m_cut(false)
+        , m_held(false)
+        , m_done(false)
+    {
+        m_sock = socket(AF_INET, SOCK_DGRAM, 0);
+        memset(&m_addr, 0, sizeof m_addr);
+        m_addr.sin_family = AF_INET;
+        m_addr.sin_port = htons(port);
+        m_addr.sin_addr = server.sin_addr;
+        m_bound = bind(m_sock, (sockaddr*)&m_addr, sizeof m_addr) == 0;
+        timeval tv = { 0, 10000 };
+        setsockopt(m_sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+        m_thread = thread(&UdpRelay::run, this);
+    }
+
+    ~UdpRelay()
+    {
+        m_done = true;
+        m_thread.join();
+        close(m_sock);
+    }
+
+    bool bound() const { return m_bound; }
+    const sockaddr_in& addr() const { return m_addr; }
+    void cut() { m_cut = true; }
+    void hold() { m_held = true; }
+    void release() { m_held = false; }
+
+private:
+    void run()
+    {
+        sockaddr_in client;
+        bool have_client = false;
+        int nfrom_server = 0;
+        char buf[1500];
+        while (!m_done)
+        {
+            sockaddr_in from;
+            socklen_t fromlen = sizeof from;
+            const ssize_t size = recvfrom(m_sock, buf, sizeof buf, 0, (sockaddr*)&from, &fromlen);
+            if (size <= 0 || m_cut)
+                continue;
+
+            const bool from_server = from.sin_port == m_server.sin_port;
+            if (!from_server && !have_client)
+            {
+                client = from;
+                have_client = true;
+            }
+            if (from_server && !have_client)
+                continue;
+            if (from_server && nfrom_server++ > 0 && m_held)
+                continue;
+
+            const sockaddr_in& to = from_server ? client : m_server;
+            sendto(m_sock, buf, size, 0, (const sockaddr*)&to, sizeof to);
+        }
+    }
+
+    sockaddr_in m_server;
+    sockaddr_in m_addr;
+    int m_sock;
+    bool m_bound;
+    atomic<bool> m_cut;
+    atomic<bool> m_held;
+    atomic<bool> m_done;
+    thread m_thread;
+};
+
+struct FailoverResult
+{
+    ReceiveResult stream;
+    int switches;
+    double switch_ms;
+};
+
+// A backup group with the main link through a relay and the backup link
+// directly to the listener; the relay is cut in the middle of the stream.
+void RunBackupFailover(int port, bool fast, FailoverResult& w_result)
+{
+    w_result = FailoverResult();
+
+    const int npackets = 1500;
+    const int cut_at = 500;
+    const auto interval = chrono::milliseconds(1);
+
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    sockaddr_in sa;
+    ASSERT_NO_FATAL_FAILURE(ListenForGroups(listener, port, 2, (sa)));
+
+    UdpRelay relay(port + 1, sa);
+    ASSERT_TRUE(relay.bound());
+
+    SRTSOCKET rcvgroup = SRT_INVALID_SOCK;
+    thread receiver([&] {
+        sockaddr_in peer;
+        int peerlen = sizeof peer;
+        const SRTSOCKET group = srt_accept(listener, (sockaddr*)&peer, &peerlen);
+        ASSERT_NE(group, SRT_INVALID_SOCK);
+        rcvgroup = group;
+        ReceiveCounters(group, npackets, 1000, (w_result.stream));
+    });
+
+    const SRTSOCKET group = srt_create_group(SRT_GTYPE_BACKUP);
+    ASSERT_NE(group, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_setsockflag(group, SRTO_GROUPFASTSWITCH, &fast, sizeof fast), SRT_ERROR);
+    ASSERT_NE(srt_setsockflag(group, SRTO_GROUPSTABTIMEO, &STABILITY_TIMEOUT_MS, sizeof STABILITY_TIMEOUT_MS), SRT_ERROR);
+
+    SRT_SOCKGROUPDATA targets[2] = {
+        srt_prepare_endpoint(NULL, (const sockaddr*)&relay.addr(), sizeof relay.addr()),
+        srt_prepare_endpoint(NULL, (sockaddr*)&sa, sizeof sa)
+    };
+    targets[0].priority = 0;
+    targets[1].priority = 1;
+    ASSERT_NE(srt_connect_group(group, targets, 2), SRT_ERROR);
+
+    SRT_SOCKGROUPDATA members[2];
+    size_t nmembers;
+    ASSERT_NO_FATAL_FAILURE(WaitConnected(group, 2, members, (nmembers)));
+
+    const auto start = chrono::steady_clock::now();
+    ASSERT_NO_FATAL_FAILURE(SendCounters(group, 0, cut_at, start, interval));
+    relay.cut();
+    ASSERT_NO_FATAL_FAILURE(SendCounters(group, cut_at, npackets, start, interval));
+
+    receiver.join();
+
+    for (size_t i = 0; i < nmembers; ++i)
+    {
+        SRT_TRACEBSTATS stats;
+        if (srt_bstats(members[i].id, &stats, 0) == SRT_ERROR)
+            continue;
+        w_result.switches += stats.backupSwitchTotal;
+        if (stats.backupSwitchTotal)
+            w_result.switch_ms = stats.msBackupSwitch;
+    }
+
+    srt_close(group);
+    srt_close(rcvgroup);
+    srt_close(listener);
+}
+
+}
+
+// The main link of a backup group silently stops passing packets. The fast
+// switch mode detects it from the missing responses before the stability
+// timeout, and the stream continues over the backup link without loss.
+TEST(Bonding, BackupFastSwitch)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    FailoverResult regular, fast;
+    RunBackupFailover(5560, false, (regular));
+    RunBackupFailover(5570, true, (fast));
+
+    printf("Backup switch: regular %.1f ms (%d lost), fast %.1f ms (%d lost)\n",
+            regular.switch_ms, regular.stream.lost, fast.switch_ms, fast.stream.lost);
+
+    EXPECT_EQ(regular.switches, 1);
+    // A stall of the machine running both ends may delay the ACKs long
+    // enough to pass for a failure, so the switch may happen also earlier.
+    EXPECT_GE(fast.switches, 1);
+    EXPECT_EQ(fast.stream.lost, 0);
+    EXPECT_EQ(fast.stream.received, 1500);
+    EXPECT_LT(fast.switch_ms, STABILITY_TIMEOUT_MS);
+
+    srt_cleanup();
+}
+
+namespace
+{
+
+struct BroadcastResult
+{
+    ReceiveResult stream;
+    int stored;    // packets in the receiver buffers of all members
+};
+
+// A broadcast group with three links to the same listener. The receiver
+// buffers are checked while all the packets are waiting for their time
+// to play, then the stream is read. With close_member the receiving member
+// that stores the most packets is closed before reading.
+void RunBroadcastReceive(int port, bool shared, bool close_member, BroadcastResult& w_result)
+{
+    w_result = BroadcastResult();
+
+    const int npackets = 500;
+    const int latency_ms = 1000;
+    const int nlinks = 3;
+
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_setsockflag(listener, SRTO_GROUPSHAREDRCV, &shared, sizeof shared), SRT_ERROR);
+    ASSERT_NE(srt_setsockflag(listener, SRTO_RCVLATENCY, &latency_ms, sizeof latency_ms), SRT_ERROR);
+    sockaddr_in sa;
+    ASSERT_NO_FATAL_FAILURE(ListenForGroups(listener, port, nlinks, (sa)));
+
+    SRTSOCKET rcvgroup = SRT_INVALID_SOCK;
+    thread acceptor([&] {
+        sockaddr_in peer;
+        int peerlen = sizeof peer;
+        rcvgroup = srt_accept(listener, (sockaddr*)&peer, &peerlen);
+    });
+
+    const SRTSOCKET group = srt_create_group(SRT_GTYPE_BROADCAST);
+    EXPECT_NE(group, SRT_INVALID_SOCK);
+    if (group != SRT_INVALID_SOCK)
+    {
+        EXPECT_NO_FATAL_FAILURE(ConnectGroup(group, sa, nlinks));
+    }
+    acceptor.join();
+    ASSERT_NE(group, SRT_INVALID_SOCK);
+    ASSERT_NE(rcvgroup, SRT_INVALID_SOCK);
+
+    // The members on the receiving side are needed for their statistics,
+    // but the sending side may get connected a bit later.
+    SRT_SOCKGROUPDATA members[nlinks];
+    size_t nmembers;
+    ASSERT_NO_FATAL_FAILURE(WaitConnected(group, nlinks, members, (nmembers)));
+    ASSERT_NO_FATAL_FAILURE(WaitConnected(rcvgroup, nlinks, members, (nmembers)));
+
+    ASSERT_NO_FATAL_FAILURE(SendCounters(group, 0, npackets, chrono::steady_clock::now(), chrono::microseconds(500)));
+
+    // Let all the packets get acknowledged, still long before their time to play.
+    this_thread::sleep_for(chrono::milliseconds(100));
+    SRTSOCKET fullest = SRT_INVALID_SOCK;
+    int fullest_stored = -1;
+    for (size_t i = 0; i < nmembers; ++i)
+    {
+        SRT_TRACEBSTATS stats;
+        ASSERT_NE(srt_bistats(members[i].id, &stats, 0, 1), SRT_ERROR);
+        w_result.stored += stats.pktRcvBuf;
+        if (stats.pktRcvBuf > fullest_stored)
+        {
+            fullest = members[i].id;
+            fullest_stored = stats.pktRcvBuf;
+        }
+    }
+    if (close_member)
+    {
+        ASSERT_NE(srt_close(fullest), SRT_ERROR);
+    }
+
+    ReceiveCounters(rcvgroup, npackets, 2 * latency_ms, (w_result.stream));
+
+    srt_close(group);
+    srt_close(rcvgroup);
+    srt_close(listener);
+}
+
+}
+
+// Every link of a broadcast group carries the same packets. In the shared
+// receiving mode only one member stores each of them, while the stream is
+// delivered the same way.
+TEST(Bonding, BroadcastSharedReceive)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    BroadcastResult separate, shared;
+    RunBroadcastReceive(5580, false, false, (separate));
+    RunBroadcastReceive(5590, true, false, (shared));
+
+    printf("Broadcast receiver buffers: separate %d packets, shared %d packets\n",
+            separate.stored, shared.stored);
+
+    EXPECT_EQ(separate.stream.received, 500);
+    EXPECT_EQ(shared.stream.received, 500);
+    EXPECT_EQ(separate.stream.disordered, 0);
+    EXPECT_EQ(shared.stream.disordered, 0);
+    EXPECT_GE(separate.stored, 2 * 500);
+    EXPECT_LE(shared.stored, 500);
+
+    srt_cleanup();
+}
+
+// In the shared receiving mode the packets stored by a member that is
+// closed before their time to play are delivered from the group.
+TEST(Bonding, BroadcastSharedReceiveMemberClosed)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    BroadcastResult result;
+    RunBroadcastReceive(5595, true, true, (result));
+
+    EXPECT_EQ(result.stream.received, 500);
+    EXPECT_EQ(result.stream.lost, 0);
+    EXPECT_EQ(result.stream.disordered, 0);
+
+    srt_cleanup();
+}
+
+// The members of a broadcast group get connected in a different order on
+// both sides: the listener accepts the first link, but its handshake is
+// held up on the way back, so the caller gets the second link connected
+// first. All the members must still agree on the sequence numbers.
+TEST(Bonding, BroadcastConnectOrder)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const int npackets = 200;
+
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    sockaddr_in sa;
+    ASSERT_NO_FATAL_FAILURE(ListenForGroups(listener, 5600, 2, (sa)));
+
+    UdpRelay relay(5601, sa);
+    ASSERT_TRUE(relay.bound());
+    relay.hold();
+
+    // Don't block the connection until the first link is connected.
+    const SRTSOCKET group = srt_create_group(SRT_GTYPE_BROADCAST);
+    ASSERT_NE(group, SRT_INVALID_SOCK);
+    const int no = 0;
+    ASSERT_NE(srt_setsockflag(group, SRTO_RCVSYN, &no, sizeof no), SRT_ERROR);
+
+    SRT_SOCKGROUPDATA first = srt_prepare_endpoint(NULL, (const sockaddr*)&relay.addr(), sizeof relay.addr());
+    ASSERT_NE(srt_connect_group(group, &first, 1), SRT_ERROR);
+
+    sockaddr_in peer;
+    int peerlen = sizeof peer;
+    const SRTSOCKET rcvgroup = srt_accept(listener, (sockaddr*)&peer, &peerlen);
+    ASSERT_NE(rcvgroup, SRT_INVALID_SOCK);
+
+    ASSERT_NO_FATAL_FAILURE(ConnectGroup(group, sa, 1));
+    SRT_SOCKGROUPDATA members[2];
+    size_t nmembers = 2;
+    ASSERT_NE(srt_group_data(group, members, &nmembers), SRT_ERROR);
+    ASSERT_EQ(nmembers, size_t(2));
+    for (int attempt = 0; attempt < 200 && members[1].status != SRTS_CONNECTED; ++attempt)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        ASSERT_NE(srt_group_data(group, members, &nmembers), SRT_ERROR);
+    }
+    EXPECT_EQ(members[1].status, SRTS_CONNECTED);
+    EXPECT_NE(members[0].status, SRTS_CONNECTED);
+
+    relay.release();
+    ASSERT_NO_FATAL_FAILURE(WaitConnected(group, 2, members, (nmembers)));
+    ASSERT_NO_FATAL_FAILURE(WaitConnected(rcvgroup, 2, members, (nmembers)));
+
+    ReceiveResult result = ReceiveResult();
+    thread receiver([&] {
+        ReceiveCounters(rcvgroup, npackets, 1000, (result));
+    });
+    EXPECT_NO_FATAL_FAILURE(SendCounters(group, 0, npackets, chrono::steady_clock::now(), chrono::milliseconds(1)));
+    receiver.join();
+
+    EXPECT_EQ(result.received, npackets);
+    EXPECT_EQ(result.lost, 0);
+    EXPECT_EQ(result.disordered, 0);
+
+    // Both members on the receiving side got the stream.
+    for (size_t i = 0; i < nmembers; ++i)
+    {
+        SRT_TRACEBSTATS stats;
+        ASSERT_NE(srt_bstats(members[i].id, &stats, 0), SRT_ERROR);
+        EXPECT_EQ(stats.pktRecvTotal, npackets);
+    }
+
+    srt_close(group);
+    srt_close(rcvgroup);
+    srt_close(listener);
+
+    srt_cleanup();
+}
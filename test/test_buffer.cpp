@@ -158,3 +158,45 @@ TEST(CRcvBuffer, AddData)
 }
 
 
+
+
+// The blocks of both sender buffers refer to the same payload,
+// which remains valid until the last of them is acknowledged.
+TEST(CSndBuffer, SharedPayload)
+{
+    const int mss = 100;
+    const int len = 3 * mss + 10;
+    char data[len];
+    for (int i = 0; i < len; ++i)
+        data[i] = char(i);
+
+    CSndBuffer snd_a(8, mss);
+    CSndBuffer snd_b(8, mss);
+
+    CSharedPayload* shared = CSharedPayload::create(data, len);
+    SRT_MSGCTRL mc_a = srt_msgctrl_default;
+    SRT_MSGCTRL mc_b = srt_msgctrl_default;
+    snd_a.addBuffer(shared->data(), len, (mc_a), shared);
+    snd_b.addBuffer(shared->data(), len, (mc_b), shared);
+    shared->release();
+
+    EXPECT_EQ(snd_a.getCurrBufSize(), 4);
+    EXPECT_EQ(snd_b.getCurrBufSize(), 4);
+
+    CPacket pkt;
+    srt::sync::steady_clock::time_point origin;
+    ASSERT_EQ(snd_a.readData((pkt), (origin), 0), mss);
+    EXPECT_EQ(pkt.m_pcData, shared->data());
+    ASSERT_EQ(snd_b.readData((pkt), (origin), 0), mss);
+    EXPECT_EQ(pkt.m_pcData, shared->data());
+
+    snd_a.ackData(4);
+    EXPECT_EQ(snd_a.getCurrBufSize(), 0);
+
+    int msglen = 0;
+    ASSERT_EQ(snd_b.readData(3, (pkt), (origin), (msglen)), 10);
+    EXPECT_EQ(memcmp(pkt.m_pcData, data + 3 * mss, 10), 0);
+
+    snd_b.ackData(4);
+    EXPECT_EQ(snd_b.getCurrBufSize(), 0);
+}
@@ -0,0 +1,242 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+
+using namespace std;
+
+namespace
+{
+
+sockaddr_in LocalAddr(int port)
+{
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    return sa;
+}
+
+// Creates a non-blocking socket bound to the local port, so that all
+// the sockets bound to it share one multiplexer and one connector queue.
+SRTSOCKET CreateBound(const sockaddr_in& local)
+{
+    const SRTSOCKET s = srt_create_socket();
+    const bool no = false;
+    srt_setsockflag(s, SRTO_RCVSYN, &no, sizeof no);
+    if (srt_bind(s, (sockaddr*)&local, sizeof local) == SRT_ERROR)
+    {
+        srt_close(s);
+        return SRT_INVALID_SOCK;
+    }
+    return s;
+}
+
+// Waits until none of the sockets is connecting anymore; returns the
+// number of those that got connected.
+int WaitConnected(const vector<SRTSOCKET>& sockets, int timeout_ms)
+{
+    const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+    for (;;)
+    {
+        int connected = 0, connecting = 0;
+        for (size_t i = 0; i < sockets.size(); ++i)
+        {
+            const SRT_SOCKSTATUS st = srt_getsockstate(sockets[i]);
+            connected += st == SRTS_CONNECTED;
+            connecting += st == SRTS_CONNECTING;
+        }
+        if (connecting == 0 || chrono::steady_clock::now() > deadline)
+            return connected;
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+}
+
+// Sends the given number of bytes from one connected socket to the other
+// and returns the time in seconds it took until all were received.
+double Transfer(SRTSOCKET sender, SRTSOCKET receiver, int size)
+{
+    const auto start = chrono::steady_clock::now();
+    thread sending([&] {
+        vector<char> buf(1456 * 64);
+        for (int sent = 0; sent < size; )
+        {
+            const int n = srt_send(sender, &buf[0], int(min(buf.size(), size_t(size - sent))));
+            if (n <= 0)
+                break;
+            sent += n;
+        }
+    });
+
+    int received = 0;
+    vector<char> buf(1456 * 64);
+    while (received < size)
+    {
+        const int n = srt_recv(receiver, &buf[0], int(buf.size()));
+        if (n <= 0)
+            break;
+        received += n;
+    }
+    const double elapsed_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    sending.join();
+
+    EXPECT_EQ(received, size);
+    return elapsed_s;
+}
+
+}
+
+// The connector queue is updated after every packet received by the
+// multiplexer. Measures a file transfer received through a multiplexer
+// that also has many callers pending, with their peer not responding,
+// against the same transfer before the callers were added. Walking all
+// the callers per packet made it 10 times slower.
+TEST(ConnectorQueue, TransferWithPendingCallers)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const int npending = 2000;
+    const int conntimeo_ms = 20000;
+    const int size = 20 * 1000 * 1000;
+
+    const sockaddr_in lsa = LocalAddr(5650);
+    const sockaddr_in csa = LocalAddr(5651);
+    // Nobody listens there.
+    const sockaddr_in dead = LocalAddr(5649);
+
+    const int file = SRTT_FILE;
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_setsockflag(listener, SRTO_TRANSTYPE, &file, sizeof file), SRT_ERROR);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, 1), SRT_ERROR);
+
+    // The receiver buffer holds the whole file. When it fills up, the
+    // transfer may stall until the sender's retransmission timer, and that
+    // is not what is measured here.
+    const int fc = 16000;
+    const int rcvbuf = fc * 1456;
+    const SRTSOCKET receiver = srt_create_socket();
+    ASSERT_NE(srt_setsockflag(receiver, SRTO_TRANSTYPE, &file, sizeof file), SRT_ERROR);
+    ASSERT_NE(srt_setsockflag(receiver, SRTO_FC, &fc, sizeof fc), SRT_ERROR);
+    ASSERT_NE(srt_setsockflag(receiver, SRTO_RCVBUF, &rcvbuf, sizeof rcvbuf), SRT_ERROR);
+    ASSERT_NE(srt_bind(receiver, (sockaddr*)&csa, sizeof csa), SRT_ERROR);
+    ASSERT_NE(srt_connect(receiver, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+    const SRTSOCKET sender = srt_accept(listener, NULL, NULL);
+    ASSERT_NE(sender, SRT_INVALID_SOCK);
+
+    const double reference_s = Transfer(sender, receiver, size);
+
+    vector<SRTSOCKET> pending;
+    for (int i = 0; i < npending; ++i)
+    {
+        const SRTSOCKET s = CreateBound(csa);
+        ASSERT_NE(s, SRT_INVALID_SOCK);
+        ASSERT_NE(srt_setsockflag(s, SRTO_CONNTIMEO, &conntimeo_ms, sizeof conntimeo_ms), SRT_ERROR);
+        srt_connect(s, (sockaddr*)&dead, sizeof dead);
+        pending.push_back(s);
+    }
+
+    const double elapsed_s = Transfer(sender, receiver, size);
+
+    printf("Connector queue: received %d MB in %.2f s, with %d pending callers in %.2f s (%.0f Mbps)\n",
+            size / 1000000, reference_s, npending, elapsed_s, size * 8 / elapsed_s / 1e6);
+    // Leave some margin for the scheduling of the threads.
+    EXPECT_LT(elapsed_s, 3 * reference_s + 0.25);
+
+    srt_close(sender);
+    srt_close(receiver);
+    srt_close(listener);
+    for (size_t i = 0; i < pending.size(); ++i)
+        srt_close(pending[i]);
+
+    srt_cleanup();
+}
+
+// A rendezvous connection is found by the peer address among many other
+// connectors of the same multiplexer, which expire when they time out.
+TEST(ConnectorQueue, RendezvousAmongPendingCallers)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const sockaddr_in sa1 = LocalAddr(5652);
+    const sockaddr_in sa2 = LocalAddr(5653);
+    // Nobody listens there.
+    const sockaddr_in dead = LocalAddr(5654);
+    const int conntimeo_ms = 1500;
+
+    vector<SRTSOCKET> pending;
+    for (int i = 0; i < 200; ++i)
+    {
+        const SRTSOCKET s = CreateBound(sa1);
+        ASSERT_NE(s, SRT_INVALID_SOCK);
+        ASSERT_NE(srt_setsockflag(s, SRTO_CONNTIMEO, &conntimeo_ms, sizeof conntimeo_ms), SRT_ERROR);
+        srt_connect(s, (sockaddr*)&dead, sizeof dead);
+        pending.push_back(s);
+    }
+
+    const bool yes = true;
+    const SRTSOCKET r1 = CreateBound(sa1);
+    const SRTSOCKET r2 = CreateBound(sa2);
+    ASSERT_NE(r1, SRT_INVALID_SOCK);
+    ASSERT_NE(r2, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_setsockflag(r1, SRTO_RENDEZVOUS, &yes, sizeof yes), SRT_ERROR);
+    ASSERT_NE(srt_setsockflag(r2, SRTO_RENDEZVOUS, &yes, sizeof yes), SRT_ERROR);
+    srt_connect(r1, (sockaddr*)&sa2, sizeof sa2);
+    srt_connect(r2, (sockaddr*)&sa1, sizeof sa1);
+
+    vector<SRTSOCKET> pair;
+    pair.push_back(r1);
+    pair.push_back(r2);
+    EXPECT_EQ(WaitConnected(pair, 5000), 2);
+
+    const char message[] = "rendezvous";
+    EXPECT_EQ(srt_sendmsg(r1, message, sizeof message, -1, true), int(sizeof message));
+
+    // The sockets are non-blocking, so poll for the message.
+    char buf[1456];
+    int len = -1;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+    while (chrono::steady_clock::now() < deadline)
+    {
+        len = srt_recvmsg(r2, buf, sizeof buf);
+        if (len != SRT_ERROR || srt_getlasterror(NULL) != SRT_EASYNCRCV)
+            break;
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    ASSERT_EQ(len, int(sizeof message));
+    EXPECT_EQ(memcmp(buf, message, sizeof message), 0);
+
+    // The connectors to the dead address are removed after their timeout.
+    EXPECT_EQ(WaitConnected(pending, 5 * conntimeo_ms), 0);
+    for (size_t i = 0; i < pending.size(); ++i)
+        EXPECT_EQ(srt_getsockstate(pending[i]), SRTS_BROKEN);
+
+    for (size_t i = 0; i < pending.size(); ++i)
+        srt_close(pending[i]);
+    srt_close(r1);
+    srt_close(r2);
+
+    srt_cleanup();
+}
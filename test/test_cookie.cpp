@@ -0,0 +1,192 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+#include "common.h"
+#include "handshake.h"
+#include "netinet_any.h"
+
+using namespace std;
+
+// Reference vectors from the SipHash paper: key 00..0f, input 00..(len-1)
+TEST(CSipHash, ReferenceVectors)
+{
+    unsigned char key[CSipHash::KEY_SIZE];
+    unsigned char input[64];
+    for (size_t i = 0; i < sizeof key; ++i)
+        key[i] = (unsigned char)i;
+    for (size_t i = 0; i < sizeof input; ++i)
+        input[i] = (unsigned char)i;
+
+    EXPECT_EQ(CSipHash::compute(key, input, 0), 0x726fdb47dd0e0e31ULL);
+    EXPECT_EQ(CSipHash::compute(key, input, 7), 0xab0200f58b01d137ULL);
+    EXPECT_EQ(CSipHash::compute(key, input, 8), 0x93f5f5799a932462ULL);
+    EXPECT_EQ(CSipHash::compute(key, input, 15), 0xa129ca6149be45e5ULL);
+    EXPECT_EQ(CSipHash::compute(key, input, 63), 0x958a324ceb064572ULL);
+}
+
+namespace
+{
+
+// The way the cookies were baked before: the MD5 sum of the text
+// made of the host, port and time.
+int32_t BakeMD5(const sockaddr_any& addr, int64_t timestamp)
+{
+    char clienthost[NI_MAXHOST];
+    char clientport[NI_MAXSERV];
+    getnameinfo(addr.get(), addr.size(), clienthost, sizeof(clienthost), clientport, sizeof(clientport),
+            NI_NUMERICHOST | NI_NUMERICSERV);
+    stringstream cookiestr;
+    cookiestr << clienthost << ":" << clientport << ":" << timestamp;
+    union {
+        unsigned char cookie[16];
+        int32_t       cookie_val;
+    };
+    CMD5::compute(cookiestr.str().c_str(), cookie);
+    return cookie_val;
+}
+
+int32_t BakeSipHash(const unsigned char* key, const sockaddr_any& addr, int64_t epoch)
+{
+    unsigned char input[2 + 4 + 8];
+    memcpy(input, &addr.sin.sin_port, 2);
+    memcpy(input + 2, &addr.sin.sin_addr, 4);
+    for (int i = 0; i < 8; ++i)
+        input[6 + i] = (unsigned char)(uint64_t(epoch) >> (8 * i));
+    return int32_t(CSipHash::compute(key, input, sizeof input));
+}
+
+}
+
+// Baking a cookie happens for every induction request and up to twice
+// for every conclusion request in the RcvQ worker thread of the listener.
+TEST(SynCookie, BakeSpeed)
+{
+    const int n = 100000;
+    sockaddr_any addr(AF_INET);
+    addr.sin.sin_port = htons(5000);
+    ASSERT_EQ(inet_pton(AF_INET, "192.168.1.1", &addr.sin.sin_addr), 1);
+    unsigned char key[CSipHash::KEY_SIZE] = { 1, 2, 3 };
+
+    int32_t sum = 0;
+    const auto md5_start = chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        addr.sin.sin_port = htons(5000 + (i & 1023));
+        sum += BakeMD5(addr, 7);
+    }
+    const double md5_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - md5_start).count() / n;
+
+    const auto sip_start = chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        addr.sin.sin_port = htons(5000 + (i & 1023));
+        sum += BakeSipHash(key, addr, 7);
+    }
+    const double sip_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - sip_start).count() / n;
+
+    printf("Cookie baking: MD5 over text %.0f ns, SipHash %.0f ns (%d)\n", md5_ns, sip_ns, sum & 1);
+    EXPECT_LT(sip_ns, md5_ns);
+}
+
+// A caller that sends only induction requests, from one UDP socket and
+// with up to 'window' requests in flight, measures how many of them per
+// second the listener answers.
+TEST(SynCookie, ListenerInductionRate)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const int nrequests = 20000;
+    const int window = 32;
+
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(5600);
+    ASSERT_EQ(inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr), 1);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&sa, sizeof sa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, 1), SRT_ERROR);
+
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sock, 0);
+    timeval tv = { 0, 100000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+
+    CHandShake hs;
+    hs.m_iVersion = 4; // HSv4, as the caller starts with
+    hs.m_iType = UDT_DGRAM;
+    hs.m_iISN = 1000;
+    hs.m_iMSS = 1500;
+    hs.m_iFlightFlagSize = 8192;
+    hs.m_iReqType = URQ_INDUCTION;
+    hs.m_iID = 12345;
+    hs.m_iCookie = 0;
+
+    // Control packet header: handshake type, no socket ID.
+    uint32_t request[4 + CHandShake::m_iContentSize / 4] = { htonl(0x80000000) };
+    size_t hs_size = CHandShake::m_iContentSize;
+    ASSERT_EQ(hs.store_to((char*)&request[4], (hs_size)), 0);
+    for (size_t i = 4; i < sizeof request / sizeof request[0]; ++i)
+        request[i] = htonl(request[i]);
+
+    int sent = 0, received = 0, lost = 0;
+    int32_t first_cookie = 0;
+    bool same_cookie = true;
+    const auto start = chrono::steady_clock::now();
+    while (received + lost < nrequests)
+    {
+        while (sent < nrequests && sent - received - lost < window)
+        {
+            ASSERT_EQ(sendto(sock, (const char*)request, sizeof request, 0, (sockaddr*)&sa, sizeof sa), int(sizeof request));
+            ++sent;
+        }
+
+        uint32_t response[64];
+        const int size = recv(sock, (char*)response, sizeof response, 0);
+        if (size <= 0)
+        {
+            // Treat the requests in flight as lost.
+            lost = sent - received;
+            continue;
+        }
+        if (size < int(sizeof request))
+            continue;
+
+        ++received;
+        const int32_t cookie = ntohl(response[4 + 7]);
+        if (received == 1)
+            first_cookie = cookie;
+        same_cookie = same_cookie && cookie == first_cookie;
+    }
+    const double elapsed_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printf("Listener: %.0f induction handshakes/s (%d of %d answered)\n", received / elapsed_s, received, nrequests);
+
+    EXPECT_GT(received, nrequests / 2);
+    // The cookie depends only on the address, unless the epoch has just changed.
+    EXPECT_TRUE(same_cookie);
+
+    close(sock);
+    srt_close(listener);
+    srt_cleanup();
+}
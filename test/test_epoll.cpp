@@ -780,3 +780,89 @@ TEST_F(TestEPoll, SimpleAsync)
     srt_close(m_client_sock); // cannot close m_client_sock after srt_sendmsg because of issue in api.c:2346 
 }
 
+
+
+TEST(CEPoll, BulkStats)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(5300);
+    ASSERT_EQ(inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr), 1);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&sa, sizeof sa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, 1), SRT_ERROR);
+
+    auto accept_res = async(launch::async, [listener]() {
+        sockaddr_in peer;
+        int peerlen = sizeof peer;
+        return srt_accept(listener, (sockaddr*)&peer, &peerlen);
+    });
+
+    const SRTSOCKET caller = srt_create_socket();
+    ASSERT_NE(caller, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_connect(caller, (sockaddr*)&sa, sizeof sa), SRT_ERROR);
+    const SRTSOCKET accepted = accept_res.get();
+    ASSERT_NE(accepted, SRT_INVALID_SOCK);
+
+    const int messages = 10;
+    char buf[1316] = {};
+    for (int i = 0; i < messages; ++i)
+    {
+        ASSERT_EQ(srt_sendmsg(caller, buf, sizeof buf, -1, true), int(sizeof buf));
+        ASSERT_EQ(srt_recvmsg(accepted, buf, sizeof buf), int(sizeof buf));
+    }
+
+    const int eid = srt_epoll_create();
+    ASSERT_GE(eid, 0);
+    ASSERT_NE(srt_epoll_add_usock(eid, caller, NULL), SRT_ERROR);
+    ASSERT_NE(srt_epoll_add_usock(eid, accepted, NULL), SRT_ERROR);
+
+    SRT_SOCKSTATS st[4];
+    ASSERT_EQ(srt_bulkstats(SRT_STATS_EPOLL, eid, SRT_STATSF_ALL, st, 4, 0), 2);
+    int64_t sent = 0, recvd = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_TRUE(st[i].id == caller || st[i].id == accepted);
+        EXPECT_EQ(st[i].fields, SRT_STATSF_ALL);
+        EXPECT_GT(st[i].msRTT, 0);
+        sent += st[i].pktSentTotal;
+        recvd += st[i].pktRecvTotal;
+    }
+    EXPECT_GE(sent, messages);
+    EXPECT_GE(recvd, messages);
+
+    // Too small array: only the first record is filled, but all are counted.
+    memset(st, 0, sizeof st);
+    EXPECT_EQ(srt_bulkstats(SRT_STATS_EPOLL, eid, SRT_STATSF_TOTAL, st, 1, 0), 2);
+    EXPECT_NE(st[0].id, 0);
+    EXPECT_EQ(st[0].fields, SRT_STATSF_TOTAL);
+    EXPECT_EQ(st[0].msRTT, 0); // not requested, not calculated
+    EXPECT_EQ(st[1].id, 0);
+
+    // The listener and the accepted socket share the multiplexer.
+    // The listener isn't connected, so it has no statistics.
+    ASSERT_EQ(srt_bulkstats(SRT_STATS_MUXER, listener, SRT_STATSF_INTERVAL, st, 4, 1), 2);
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_TRUE(st[i].id == listener || st[i].id == accepted);
+        EXPECT_EQ(st[i].fields, st[i].id == accepted ? SRT_STATSF_INTERVAL : 0);
+    }
+    ASSERT_EQ(srt_bulkstats(SRT_STATS_MUXER, accepted, SRT_STATSF_INTERVAL, st, 4, 0), 2);
+    for (int i = 0; i < 2; ++i)
+        EXPECT_EQ(st[i].pktRecv, 0) << "interval counters not cleared";
+
+    EXPECT_EQ(srt_bulkstats(SRT_STATS_EPOLL, eid + 1, SRT_STATSF_ALL, st, 4, 0), SRT_ERROR);
+    EXPECT_EQ(srt_bulkstats(SRT_STATS_GROUP, caller, SRT_STATSF_ALL, st, 4, 0), SRT_ERROR);
+    EXPECT_EQ(srt_bulkstats(0, eid, SRT_STATSF_ALL, st, 4, 0), SRT_ERROR);
+
+    EXPECT_EQ(srt_epoll_release(eid), 0);
+    EXPECT_NE(srt_close(accepted), SRT_ERROR);
+    EXPECT_NE(srt_close(caller), SRT_ERROR);
+    EXPECT_NE(srt_close(listener), SRT_ERROR);
+    EXPECT_EQ(srt_cleanup(), 0);
+}
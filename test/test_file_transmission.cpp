@@ -0,0 +1,276 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Written by:
+ *             Haivision Systems Inc.
+ */
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+
+using namespace std;
+
+// Transfers a file through srt_sendfile/srt_recvfile over the loopback
+// and verifies that the received file is identical. The file spans many
+// sending blocks and its size is deliberately not a multiple of the payload
+// size. With encryption the payload is encrypted in place, which must not
+// modify the source file. The congestion controller, if given, is set
+// on both parties after the transmission type. The file is transferred
+// in the given number of consecutive ranges, each with its own call. The
+// destination file exists beforehand and is longer, so that it must be
+// truncated at the first range and kept intact at the others.
+static void TransmitFile(const char* passphrase, const char* congestion = NULL, int nranges = 1)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const char* const srcname = "file_transmission.src";
+    const char* const dstname = "file_transmission.dst";
+    const int64_t filesize = 8 * 1024 * 1024 + 777;
+
+    vector<char> content(filesize);
+    for (size_t i = 0; i < content.size(); ++i)
+        content[i] = char((i * 7 + i / 1500) & 0xFF);
+    {
+        ofstream src(srcname, ios::binary | ios::out | ios::trunc);
+        src.write(&content[0], content.size());
+        ofstream dst(dstname, ios::binary | ios::out | ios::trunc);
+        dst.seekp(filesize + 1000);
+        dst.put('x');
+    }
+    const int64_t rangesize = filesize / nranges + 1;
+
+    const int file_mode = SRTT_FILE;
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_setsockflag(listener, SRTO_TRANSTYPE, &file_mode, sizeof file_mode), SRT_ERROR);
+    if (passphrase)
+    {
+        ASSERT_NE(srt_setsockflag(listener, SRTO_PASSPHRASE, passphrase, strlen(passphrase)), SRT_ERROR);
+    }
+    if (congestion)
+    {
+        ASSERT_NE(srt_setsockflag(listener, SRTO_CONGESTION, congestion, strlen(congestion)), SRT_ERROR);
+    }
+
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(5555);
+    ASSERT_EQ(inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr), 1);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&sa, sizeof sa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, 1), SRT_ERROR);
+
+    thread sender([&] {
+        const SRTSOCKET caller = srt_create_socket();
+        srt_setsockflag(caller, SRTO_TRANSTYPE, &file_mode, sizeof file_mode);
+        if (passphrase)
+            srt_setsockflag(caller, SRTO_PASSPHRASE, passphrase, strlen(passphrase));
+        if (congestion)
+            srt_setsockflag(caller, SRTO_CONGESTION, congestion, strlen(congestion));
+        EXPECT_NE(srt_connect(caller, (sockaddr*)&sa, sizeof sa), SRT_ERROR);
+
+        int64_t offset = 0;
+        if (nranges == 1)
+        {
+            EXPECT_EQ(srt_sendfile(caller, srcname, &offset, -1, SRT_DEFAULT_SENDFILE_BLOCK), filesize);
+        }
+        while (offset < filesize)
+        {
+            const int64_t size = min(rangesize, filesize - offset);
+            if (srt_sendfile(caller, srcname, &offset, size, SRT_DEFAULT_SENDFILE_BLOCK) != size)
+            {
+                ADD_FAILURE() << "srt_sendfile: " << srt_getlasterror_str();
+                break;
+            }
+        }
+        EXPECT_EQ(offset, filesize);
+
+        // Wait until the receiver confirms reception.
+        char ack;
+        EXPECT_EQ(srt_recv(caller, &ack, 1), 1);
+        srt_close(caller);
+    });
+
+    // No ASSERT from here on, the sender thread must be joined.
+    sockaddr_in peer;
+    int peerlen = sizeof peer;
+    const SRTSOCKET accepted = srt_accept(listener, (sockaddr*)&peer, &peerlen);
+    EXPECT_NE(accepted, SRT_INVALID_SOCK);
+    if (accepted != SRT_INVALID_SOCK)
+    {
+        int64_t offset = 0;
+        while (offset < filesize)
+        {
+            const int64_t size = min(rangesize, filesize - offset);
+            if (srt_recvfile(accepted, dstname, &offset, size, SRT_DEFAULT_RECVFILE_BLOCK) != size)
+            {
+                ADD_FAILURE() << "srt_recvfile: " << srt_getlasterror_str();
+                break;
+            }
+        }
+        EXPECT_EQ(offset, filesize);
+
+        const char ack = 1;
+        EXPECT_EQ(srt_send(accepted, &ack, 1), 1);
+    }
+    else
+    {
+        // Closes the sender's connection, if it was made anyway.
+        srt_close(listener);
+    }
+    sender.join();
+
+    ifstream dst(dstname, ios::binary | ios::in);
+    vector<char> received(filesize + 1);
+    dst.read(&received[0], received.size());
+    EXPECT_EQ(dst.gcount(), filesize);
+    EXPECT_TRUE(equal(content.begin(), content.end(), received.begin()));
+    dst.close();
+
+    ifstream src(srcname, ios::binary | ios::in);
+    src.read(&received[0], received.size());
+    EXPECT_EQ(src.gcount(), filesize);
+    EXPECT_TRUE(equal(content.begin(), content.end(), received.begin()));
+    src.close();
+
+    srt_close(accepted);
+    srt_close(listener);
+    remove(srcname);
+    remove(dstname);
+
+    srt_cleanup();
+}
+
+TEST(FileTransmission, Upload)
+{
+    TransmitFile(NULL);
+}
+
+TEST(FileTransmission, UploadEncrypted)
+{
+    TransmitFile("file_transmission");
+}
+
+TEST(FileTransmission, UploadRanges)
+{
+    TransmitFile(NULL, NULL, 3);
+}
+
+TEST(FileTransmission, UploadBbr)
+{
+    TransmitFile(NULL, "bbr");
+}
+
+TEST(FileTransmission, UploadTraced)
+{
+    ASSERT_EQ(srt_trace_setup(-1), SRT_ERROR);
+    ASSERT_EQ(srt_trace_setup(1 << 16), 0);
+    TransmitFile(NULL);
+    ASSERT_EQ(srt_trace_setup(0), 0);
+
+    const char* const tracename = "file_transmission.trc";
+    const int count = srt_trace_dump(tracename);
+    ASSERT_GT(count, 0);
+
+    ifstream trace(tracename, ios::binary | ios::in);
+    SRT_TRACEHEADER hdr;
+    ASSERT_TRUE(trace.read((char*)&hdr, sizeof hdr));
+    EXPECT_EQ(memcmp(hdr.magic, "SRTTRACE", sizeof hdr.magic), 0);
+    EXPECT_EQ(hdr.event_size, (int)sizeof(SRT_TRACEEVENT));
+    EXPECT_GT(hdr.ticks_per_sec, 0);
+    ASSERT_EQ(hdr.count, count);
+
+    vector<SRT_TRACEEVENT> events(count);
+    ASSERT_TRUE(trace.read((char*)&events[0], sizeof(SRT_TRACEEVENT) * count));
+    trace.close();
+    remove(tracename);
+
+    vector<int> types(SRT_TRACE_E_SIZE);
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        ASSERT_LT(events[i].type, SRT_TRACE_E_SIZE);
+        ++types[events[i].type];
+        if (i > 0)
+        {
+            EXPECT_LE(events[i - 1].ts, events[i].ts);
+        }
+    }
+
+    // Every data packet is sent and received at least once.
+    const int packets = (8 * 1024 * 1024 + 777 + 1455) / 1456;
+    EXPECT_GE(types[SRT_TRACE_PKT_SENT], packets);
+    EXPECT_GE(types[SRT_TRACE_PKT_RECV], types[SRT_TRACE_PKT_SENT]);
+    EXPECT_GT(types[SRT_TRACE_ACK_SENT], 0);
+    EXPECT_GT(types[SRT_TRACE_ACK_RECV], 0);
+    EXPECT_GT(types[SRT_TRACE_ACKACK_RECV], 0);
+    EXPECT_GT(types[SRT_TRACE_CC_RATE], 0);
+}
+
+// A user-defined controller with a fixed window and pacing, which counts
+// the callbacks it received.
+struct UserCongctlStats
+{
+    int created;
+    int destroyed;
+    int acks;
+};
+
+static void* UserCongctlCreate(void* opaque, SRTSOCKET, SRT_CONGCTL_DATA* data)
+{
+    UserCongctlStats* stats = (UserCongctlStats*)opaque;
+    ++stats->created;
+    data->cwnd_size = 1000;
+    data->pkt_snd_period_us = 10;
+    return stats;
+}
+
+static void UserCongctlDestroy(void* state)
+{
+    ++((UserCongctlStats*)state)->destroyed;
+}
+
+static void UserCongctlAck(void* state, SRT_CONGCTL_DATA*, int32_t)
+{
+    ++((UserCongctlStats*)state)->acks;
+}
+
+TEST(FileTransmission, UploadUserCongctl)
+{
+    UserCongctlStats stats = UserCongctlStats();
+
+    SRT_CONGCTL_CALLBACKS cb;
+    memset(&cb, 0, sizeof cb);
+    cb.create = UserCongctlCreate;
+    cb.destroy = UserCongctlDestroy;
+    cb.on_ack = UserCongctlAck;
+    cb.quickack_on_short = 1;
+
+    // Builtin names can't be taken over
+    EXPECT_EQ(srt_register_congctl("file", &cb, &stats), SRT_ERROR);
+    EXPECT_EQ(srt_register_congctl("fixedrate", &cb, &stats), 0);
+    EXPECT_EQ(srt_register_congctl("fixedrate", &cb, &stats), SRT_ERROR);
+
+    TransmitFile(NULL, "fixedrate");
+
+    // One instance on each side
+    EXPECT_EQ(stats.created, 2);
+    EXPECT_EQ(stats.destroyed, 2);
+    EXPECT_GT(stats.acks, 0);
+}
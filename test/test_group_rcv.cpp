@@ -0,0 +1,198 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "api.h"
+#include "core.h"
+
+using namespace std;
+
+namespace
+{
+
+// The size of the group receiver buffer (CUDTGroup::GRP_RCV_SLOTS).
+const int RCV_SLOTS = 8192;
+// More than the reorder tolerance of the balancing group (CUDTGroup::GRP_RCV_REORDER_MS).
+const int REORDER_MS = 20;
+
+class TestGroupRcv : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(srt_startup(), 0);
+    }
+
+    void TearDown() override
+    {
+        srt_cleanup();
+    }
+
+    // The payload carries the key, so that it can be checked too.
+    static bool Put(CUDTGroup& g, int32_t seqno, int32_t msgno)
+    {
+        SRT_MSGCTRL mc = srt_msgctrl_default;
+        mc.pktseq = seqno;
+        mc.msgno = msgno;
+        char data[8];
+        memcpy(data, &seqno, 4);
+        memcpy(data + 4, &msgno, 4);
+        return g.rcvPut(data, sizeof data, mc);
+    }
+
+    static bool Put(CUDTGroup& g, int32_t seqno)
+    {
+        return Put(g, seqno, 1);
+    }
+
+    // Returns the sequence numbers of all the packets ready for reading.
+    static vector<int32_t> TakeAll(CUDTGroup& g, bool by_msgno = false)
+    {
+        vector<int32_t> out;
+        char buf[SRT_LIVE_MAX_PLSIZE];
+        SRT_MSGCTRL mc = srt_msgctrl_default;
+        int size;
+        while ((size = g.rcvTryExtract(buf, sizeof buf, (mc))) > 0)
+        {
+            EXPECT_EQ(size, 8);
+            int32_t seqno, msgno;
+            memcpy(&seqno, buf, 4);
+            memcpy(&msgno, buf + 4, 4);
+            EXPECT_EQ(seqno, mc.pktseq);
+            EXPECT_EQ(msgno, mc.msgno);
+            out.push_back(by_msgno ? msgno : seqno);
+        }
+        return out;
+    }
+};
+
+vector<int32_t> Seq(int32_t from, int count)
+{
+    vector<int32_t> v;
+    for (int i = 0; i < count; ++i)
+        v.push_back(CSeqNo::incseq(from, i));
+    return v;
+}
+
+}
+
+// Packets missing when the next one is ready were dropped on every link,
+// so they are skipped, and discarded if they come later anyway.
+TEST_F(TestGroupRcv, GapSkip)
+{
+    CUDTGroup g (SRT_GTYPE_BROADCAST);
+
+    EXPECT_TRUE(Put(g, 1000));
+    EXPECT_TRUE(Put(g, 1001));
+    EXPECT_EQ(TakeAll(g), Seq(1000, 2));
+
+    EXPECT_TRUE(Put(g, 1004));
+    EXPECT_TRUE(Put(g, 1003));
+    EXPECT_EQ(TakeAll(g), Seq(1003, 2));
+
+    // Behind the delivered ones, and a duplicate of the stored one
+    EXPECT_FALSE(Put(g, 1002));
+    EXPECT_TRUE(Put(g, 1005));
+    EXPECT_FALSE(Put(g, 1005));
+    EXPECT_EQ(TakeAll(g), Seq(1005, 1));
+}
+
+// The positions in the buffer wrap together with the sequence numbers.
+TEST_F(TestGroupRcv, SequenceWrap)
+{
+    CUDTGroup g (SRT_GTYPE_BROADCAST);
+
+    const int32_t first = CSeqNo::m_iMaxSeqNo - 2;
+    for (int i = 0; i < 6; ++i)
+        EXPECT_TRUE(Put(g, CSeqNo::incseq(first, i)));
+
+    EXPECT_EQ(TakeAll(g), Seq(first, 6));
+    EXPECT_FALSE(Put(g, CSeqNo::m_iMaxSeqNo));
+}
+
+// In the balancing group the packets are ordered by the message number,
+// which skips 0 when wrapping.
+TEST_F(TestGroupRcv, MessageNumberWrap)
+{
+    CUDTGroup g (SRT_GTYPE_BALANCING);
+
+    const int32_t msgnos [] = { MSGNO_SEQ_MAX - 1, MSGNO_SEQ_MAX, 1, 2 };
+    // Every link has its own sequence, so these don't matter.
+    const int32_t seqnos [] = { 500, 20, 501, 21 };
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(Put(g, seqnos[i], msgnos[i]));
+
+    // The first delivery waits for the packets that may still come.
+    this_thread::sleep_for(chrono::milliseconds(REORDER_MS));
+    EXPECT_EQ(TakeAll(g, true), vector<int32_t>(msgnos, msgnos + 4));
+}
+
+// In the balancing group the packets preceding the first one may come
+// a bit later over another link, and they are delivered first then.
+TEST_F(TestGroupRcv, ReorderBeforeFirstDelivery)
+{
+    CUDTGroup g (SRT_GTYPE_BALANCING);
+
+    EXPECT_TRUE(Put(g, 100, 12));
+    EXPECT_TRUE(Put(g, 30, 10));
+    EXPECT_TRUE(TakeAll(g, true).empty());
+
+    EXPECT_TRUE(Put(g, 31, 11));
+    this_thread::sleep_for(chrono::milliseconds(REORDER_MS));
+    const int32_t expected [] = { 10, 11, 12 };
+    EXPECT_EQ(TakeAll(g, true), vector<int32_t>(expected, expected + 3));
+
+    // Now it's too late for the preceding packets.
+    EXPECT_FALSE(Put(g, 32, 9));
+}
+
+// When the application doesn't read, the oldest packets are dropped to
+// make room for the new ones, as the members do with the late packets.
+TEST_F(TestGroupRcv, FullBufferDrop)
+{
+    CUDTGroup g (SRT_GTYPE_BROADCAST);
+
+    for (int i = 0; i < 10; ++i)
+        EXPECT_TRUE(Put(g, 1000 + i));
+
+    // The buffer now spans from 1007 to 1000 + RCV_SLOTS + 5.
+    const int32_t far = 1000 + RCV_SLOTS + 5;
+    EXPECT_TRUE(Put(g, far));
+
+    vector<int32_t> expected = Seq(1007, 3);
+    expected.push_back(far);
+    EXPECT_EQ(TakeAll(g), expected);
+
+    // A jump over twice the buffer size drops everything.
+    EXPECT_TRUE(Put(g, far + 1));
+    const int32_t farther = far + 3 * RCV_SLOTS;
+    EXPECT_TRUE(Put(g, farther));
+    EXPECT_EQ(TakeAll(g), Seq(farther, 1));
+}
+
+// After the reset the packets aren't readable anymore, and the next
+// packet defines the delivery sequence anew.
+TEST_F(TestGroupRcv, Reset)
+{
+    CUDTGroup g (SRT_GTYPE_BROADCAST);
+
+    EXPECT_TRUE(Put(g, 1000));
+    EXPECT_TRUE(Put(g, 1001));
+    g.setInitialRxSequence(0);
+    EXPECT_TRUE(TakeAll(g).empty());
+
+    EXPECT_TRUE(Put(g, 20));
+    EXPECT_EQ(TakeAll(g), Seq(20, 1));
+}
@@ -0,0 +1,320 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+#include "cache.h"
+
+using namespace std;
+
+namespace
+{
+
+CInfoBlock HostInfo(uint32_t ip)
+{
+    CInfoBlock ib;
+    ib.m_iIPversion = AF_INET;
+    ib.m_piIP[0] = ip;
+    return ib;
+}
+
+// The way the cache worked before: one mutex over a list in the LRU
+// order and an index of it, with an allocation for every new host.
+class MutexListCache
+{
+public:
+    explicit MutexListCache(size_t size): m_zMaxSize(size) {}
+
+    int lookup(CInfoBlock* data)
+    {
+        lock_guard<mutex> lk(m_Lock);
+        const map<uint32_t, list<CInfoBlock>::iterator>::iterator i = m_Index.find(data->m_piIP[0]);
+        if (i == m_Index.end())
+            return -1;
+        *data = *i->second;
+        return 0;
+    }
+
+    int update(const CInfoBlock* data)
+    {
+        lock_guard<mutex> lk(m_Lock);
+        const map<uint32_t, list<CInfoBlock>::iterator>::iterator i = m_Index.find(data->m_piIP[0]);
+        if (i != m_Index.end())
+            m_Items.erase(i->second);
+        m_Items.push_front(*data);
+        m_Index[data->m_piIP[0]] = m_Items.begin();
+        if (m_Items.size() > m_zMaxSize)
+        {
+            m_Index.erase(m_Items.back().m_piIP[0]);
+            m_Items.pop_back();
+        }
+        return 0;
+    }
+
+private:
+    size_t m_zMaxSize;
+    list<CInfoBlock> m_Items;
+    map<uint32_t, list<CInfoBlock>::iterator> m_Index;
+    mutex m_Lock;
+};
+
+// Every thread looks up random hosts and updates one in ten of them,
+// always with the bandwidth derived from the RTT. Returns the operations
+// per second; 'w_torn' counts the hits with values of different updates.
+template <class Cache>
+double RunChurn(Cache& cache, int nthreads, int nhosts, int nops, int& w_torn)
+{
+    atomic<int> torn(0);
+    vector<thread> threads;
+    const auto start = chrono::steady_clock::now();
+    for (int t = 0; t < nthreads; ++t)
+    {
+        threads.push_back(thread([&cache, &torn, t, nhosts, nops] {
+            uint32_t rnd = 2463534242u + t;
+            for (int i = 0; i < nops; ++i)
+            {
+                rnd ^= rnd << 13;
+                rnd ^= rnd >> 17;
+                rnd ^= rnd << 5;
+                CInfoBlock ib = HostInfo(rnd % nhosts + 1);
+                if (rnd % 10 == 0)
+                {
+                    ib.m_iRTT = int(rnd % 100000) + 1;
+                    ib.m_iBandwidth = ib.m_iRTT * 3;
+                    cache.update(&ib);
+                }
+                else if (cache.lookup(&ib) == 0 && ib.m_iBandwidth != ib.m_iRTT * 3)
+                {
+                    ++torn;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+    w_torn = torn;
+
+    const double elapsed_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return nthreads * double(nops) / elapsed_s;
+}
+
+}
+
+TEST(HostInfoCache, LookupAndUpdate)
+{
+    CInfoCache cache;
+
+    CInfoBlock ib = HostInfo(0x0100007f);
+    EXPECT_EQ(cache.lookup(&ib), -1);
+
+    ib.m_iRTT = 20000;
+    ib.m_iBandwidth = 5000;
+    ib.m_dInterval = 12.5;
+    ib.m_dCWnd = 300;
+    ASSERT_EQ(cache.update(&ib), 0);
+
+    CInfoBlock found = HostInfo(0x0100007f);
+    ASSERT_EQ(cache.lookup(&found), 0);
+    EXPECT_EQ(found.m_iRTT, 20000);
+    EXPECT_EQ(found.m_iBandwidth, 5000);
+    EXPECT_EQ(found.m_dInterval, 12.5);
+    EXPECT_EQ(found.m_dCWnd, 300);
+    EXPECT_GT(found.m_ullTimeStamp, 0u);
+
+    // Unknown (zero) values keep the cached ones.
+    CInfoBlock rtt_only = HostInfo(0x0100007f);
+    rtt_only.m_iRTT = 30000;
+    ASSERT_EQ(cache.update(&rtt_only), 0);
+    ASSERT_EQ(cache.lookup(&found), 0);
+    EXPECT_EQ(found.m_iRTT, 30000);
+    EXPECT_EQ(found.m_iBandwidth, 5000);
+    EXPECT_EQ(found.m_dInterval, 12.5);
+
+    // The same bits in an IPv6 address are another host.
+    CInfoBlock v6 = HostInfo(0x0100007f);
+    v6.m_iIPversion = AF_INET6;
+    EXPECT_EQ(cache.lookup(&v6), -1);
+
+    sockaddr_any addr(AF_INET6);
+    ASSERT_EQ(inet_pton(AF_INET6, "2001:db8::1", &addr.sin6.sin6_addr), 1);
+    v6.m_iIPversion = AF_INET6;
+    CInfoBlock::convert(addr, v6.m_piIP);
+    v6.m_iRTT = 40000;
+    ASSERT_EQ(cache.update(&v6), 0);
+    v6.m_iRTT = 0;
+    ASSERT_EQ(cache.lookup(&v6), 0);
+    EXPECT_EQ(v6.m_iRTT, 40000);
+}
+
+// With the size of one set, all hosts compete for the same slots.
+TEST(HostInfoCache, LeastRecentlyUsedReplaced)
+{
+    CInfoCache cache(CInfoCache::WAYS);
+
+    for (int i = 1; i <= CInfoCache::WAYS; ++i)
+    {
+        CInfoBlock ib = HostInfo(i);
+        ib.m_iRTT = i;
+        ASSERT_EQ(cache.update(&ib), 0);
+    }
+
+    // Now the first host is used more recently than the second one.
+    CInfoBlock first = HostInfo(1);
+    ASSERT_EQ(cache.lookup(&first), 0);
+
+    CInfoBlock added = HostInfo(100);
+    added.m_iRTT = 100;
+    ASSERT_EQ(cache.update(&added), 0);
+
+    CInfoBlock second = HostInfo(2);
+    EXPECT_EQ(cache.lookup(&second), -1);
+    EXPECT_EQ(cache.lookup(&first), 0);
+    EXPECT_EQ(first.m_iRTT, 1);
+    EXPECT_EQ(cache.lookup(&added), 0);
+    for (int i = 3; i <= CInfoCache::WAYS; ++i)
+    {
+        CInfoBlock ib = HostInfo(i);
+        EXPECT_EQ(cache.lookup(&ib), 0);
+        EXPECT_EQ(ib.m_iRTT, i);
+    }
+}
+
+// Lookups and updates from several threads, as by the connections of a
+// gateway with a constant churn, compared with a single mutex over a list.
+TEST(HostInfoCache, ConcurrentChurn)
+{
+    const int nhosts = 4096;
+    const int nops = 500000;
+    const int threads[] = { 1, 4 };
+
+    for (size_t i = 0; i < sizeof threads / sizeof threads[0]; ++i)
+    {
+        MutexListCache reference(1024);
+        CInfoCache cache(1024);
+        int torn_reference = 0, torn = 0;
+        const double reference_ops = RunChurn(reference, threads[i], nhosts, nops, (torn_reference));
+        const double ops = RunChurn(cache, threads[i], nhosts, nops, (torn));
+
+        printf("Host cache, %d threads: mutex+list %.1f Mops/s, sharded %.1f Mops/s\n",
+                threads[i], reference_ops / 1e6, ops / 1e6);
+        EXPECT_EQ(torn_reference, 0);
+        EXPECT_EQ(torn, 0);
+    }
+}
+
+namespace
+{
+
+sockaddr_in LocalAddr(int port)
+{
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    return sa;
+}
+
+// Sends 'size' bytes from the caller to the accepted socket and returns
+// the time it took until all was received.
+double Transfer(SRTSOCKET sender, SRTSOCKET receiver, int size)
+{
+    const auto start = chrono::steady_clock::now();
+    thread sending([&] {
+        vector<char> buf(1456 * 64);
+        for (int sent = 0; sent < size; )
+        {
+            const int n = srt_send(sender, &buf[0], int(min(buf.size(), size_t(size - sent))));
+            if (n <= 0)
+                break;
+            sent += n;
+        }
+    });
+
+    vector<char> buf(1456 * 64);
+    for (int received = 0; received < size; )
+    {
+        const int n = srt_recv(receiver, &buf[0], int(buf.size()));
+        if (n <= 0)
+            break;
+        received += n;
+    }
+    sending.join();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+}
+
+// A connection to the same host as a previous one, which has been
+// sending, starts with the congestion window and the sending period
+// that one has left in the cache, instead of the slow start, when
+// requested with SRTO_CCSEED. Without it every connection starts cold,
+// also the first one here after the other tests connecting to this host.
+TEST(HostInfoCache, SeedsCongestionControl)
+{
+    ASSERT_EQ(srt_startup(), 0);
+
+    const sockaddr_in lsa = LocalAddr(5660);
+    const int file = SRTT_FILE;
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    ASSERT_NE(srt_setsockflag(listener, SRTO_TRANSTYPE, &file, sizeof file), SRT_ERROR);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, 1), SRT_ERROR);
+
+    const int small = 2 * 1000 * 1000;
+    double small_ms[2];
+    SRT_TRACEBSTATS start_stats[2];
+    for (int round = 0; round < 2; ++round)
+    {
+        const SRTSOCKET caller = srt_create_socket();
+        const bool seed = round > 0;
+        ASSERT_NE(srt_setsockflag(caller, SRTO_TRANSTYPE, &file, sizeof file), SRT_ERROR);
+        ASSERT_NE(srt_setsockflag(caller, SRTO_CCSEED, &seed, sizeof seed), SRT_ERROR);
+        ASSERT_NE(srt_connect(caller, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+        const SRTSOCKET accepted = srt_accept(listener, NULL, NULL);
+        ASSERT_NE(accepted, SRT_INVALID_SOCK);
+
+        ASSERT_NE(srt_bstats(caller, &start_stats[round], 0), SRT_ERROR);
+        small_ms[round] = Transfer(caller, accepted, small);
+
+        // Lets the first connection get out of the slow start.
+        if (round == 0)
+            Transfer(caller, accepted, 20 * 1000 * 1000);
+
+        srt_close(caller);
+        srt_close(accepted);
+    }
+
+    printf("Host cache: first %d MB with initial cwnd=%d %.1f ms, with cwnd=%d sndperiod=%.1fus from the cache %.1f ms\n",
+            small / 1000000, start_stats[0].pktCongestionWindow, small_ms[0],
+            start_stats[1].pktCongestionWindow, start_stats[1].usPktSndPeriod, small_ms[1]);
+    // FileCC starts with 16 packets.
+    EXPECT_EQ(start_stats[0].pktCongestionWindow, 16);
+    EXPECT_GT(start_stats[1].pktCongestionWindow, 16);
+
+    srt_close(listener);
+    srt_cleanup();
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "srt.h"
+#include "udt.h"
+#include "logging.h"
+
+using namespace std;
+
+#if ENABLE_LOGGING && SRT_LOGGING_MIN_LEVEL >= LOG_ERR
+
+namespace
+{
+
+// Not used by the library.
+const int LOGFA_TEST = SRT_LOGFA_LASTNONE - 1;
+
+struct LogCollector
+{
+    mutex lock;
+    vector<int> last_line; // per thread
+    int lines;
+    int disordered;
+    atomic<bool> hold;
+
+    LogCollector(int nthreads)
+        : last_line(nthreads, -1)
+        , lines(0)
+        , disordered(0)
+        , hold(false)
+    {
+    }
+
+    static void handler(void* opaque, int, const char*, int, const char*, const char* message)
+    {
+        LogCollector* self = static_cast<LogCollector*>(opaque);
+        while (self->hold)
+            this_thread::sleep_for(chrono::milliseconds(1));
+
+        int thread = -1, line = -1;
+        const char* text = strstr(message, "thread ");
+        if (!text || sscanf(text, "thread %d line %d", &thread, &line) != 2)
+            return;
+
+        lock_guard<mutex> lk(self->lock);
+        ++self->lines;
+        if (thread < 0 || thread >= int(self->last_line.size()) || line <= self->last_line[thread])
+            ++self->disordered;
+        else
+            self->last_line[thread] = line;
+    }
+};
+
+class TestLogging : public ::testing::Test
+{
+protected:
+    srt_logging::Logger m_log;
+
+    TestLogging()
+        : m_log(LOGFA_TEST, srt_logger_config, "SRT.test")
+    {
+    }
+
+    void SetUp() override
+    {
+        ASSERT_EQ(srt_startup(), 0);
+        srt_setloglevel(srt_logging::LogLevel::note);
+        srt_addlogfa(LOGFA_TEST);
+    }
+
+    void TearDown() override
+    {
+        srt_setlogflags(0);
+        srt_setloghandler(NULL, NULL);
+        srt_dellogfa(LOGFA_TEST);
+        srt_setloglevel(srt_logging::LogLevel::warning);
+        srt_cleanup();
+    }
+};
+
+}
+
+// Every line logged from several threads is either written in order
+// by the writer thread or counted as dropped.
+TEST_F(TestLogging, AsyncAllLinesAccounted)
+{
+    const int nthreads = 4;
+    const int nlines = 500;
+
+    LogCollector col(nthreads);
+    srt_setloghandler(&col, &LogCollector::handler);
+    srt_setlogflags(SRT_LOGF_ASYNC);
+    const int64_t dropped_before = srt_getlogdropped();
+
+    vector<thread> threads;
+    for (int t = 0; t < nthreads; ++t)
+    {
+        threads.emplace_back([this, t, nlines] {
+            for (int i = 0; i < nlines; ++i)
+                m_log.Error() << "thread " << t << " line " << i << " value=" << 0.5 * i;
+        });
+    }
+
+    for (auto& th : threads)
+        th.join();
+
+    // Turning off the asynchronous mode writes out the remaining lines.
+    srt_setlogflags(0);
+
+    lock_guard<mutex> lk(col.lock);
+    EXPECT_EQ(col.disordered, 0);
+    EXPECT_EQ(col.lines + (srt_getlogdropped() - dropped_before), nthreads * nlines);
+    EXPECT_GT(col.lines, 0);
+}
+
+// A blocked writer doesn't block the logging threads, the
+// lines that don't fit in the queue are dropped instead.
+TEST_F(TestLogging, AsyncOverflowDrops)
+{
+    const int nlines = 5000;
+
+    LogCollector col(1);
+    col.hold = true;
+    srt_setloghandler(&col, &LogCollector::handler);
+    srt_setlogflags(SRT_LOGF_ASYNC);
+    const int64_t dropped_before = srt_getlogdropped();
+
+    const auto start = chrono::steady_clock::now();
+    for (int i = 0; i < nlines; ++i)
+        m_log.Error() << "thread 0 line " << i;
+    const auto elapsed = chrono::steady_clock::now() - start;
+
+    EXPECT_LT(elapsed, chrono::seconds(5));
+    EXPECT_GT(srt_getlogdropped() - dropped_before, 0);
+
+    col.hold = false;
+    srt_setlogflags(0);
+
+    lock_guard<mutex> lk(col.lock);
+    EXPECT_EQ(col.disordered, 0);
+    EXPECT_EQ(col.lines + (srt_getlogdropped() - dropped_before), nlines);
+}
+
+// Lines logged while the asynchronous mode is being turned off are either
+// written out before it's off or written synchronously, none stays queued.
+TEST_F(TestLogging, AsyncStopWhileLogging)
+{
+    const int nthreads = 4;
+    const int nlines = 2000;
+
+    LogCollector col(nthreads);
+    srt_setloghandler(&col, &LogCollector::handler);
+    srt_setlogflags(SRT_LOGF_ASYNC);
+    const int64_t dropped_before = srt_getlogdropped();
+
+    atomic<int> started(0);
+    vector<thread> threads;
+    for (int t = 0; t < nthreads; ++t)
+    {
+        threads.emplace_back([this, t, nlines, &started] {
+            ++started;
+            for (int i = 0; i < nlines; ++i)
+                m_log.Error() << "thread " << t << " line " << i;
+        });
+    }
+
+    while (started < nthreads)
+        this_thread::yield();
+    srt_setlogflags(0);
+
+    for (auto& th : threads)
+        th.join();
+
+    lock_guard<mutex> lk(col.lock);
+    EXPECT_EQ(col.lines + (srt_getlogdropped() - dropped_before), nthreads * nlines);
+}
+
+namespace
+{
+int Evaluate(int& w_count)
+{
+    return ++w_count;
+}
+}
+
+// Arguments of a disabled log site are never evaluated.
+TEST_F(TestLogging, DisabledSiteArgs)
+{
+    LogCollector col(1);
+    srt_setloghandler(&col, &LogCollector::handler);
+
+    int count = 0;
+    LOGC(m_log.Debug, log << "thread 0 line " << Evaluate(count));
+    LOGF(m_log.Debug, "thread 0 line %d", Evaluate(count));
+    EXPECT_EQ(count, 0);
+    EXPECT_FALSE(LOG_ENABLED(m_log.Debug));
+
+    LOGC(m_log.Error, log << "thread 0 line " << Evaluate(count));
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(col.lines, 1);
+    EXPECT_TRUE(LOG_ENABLED(m_log.Error));
+}
+
+#endif // ENABLE_LOGGING
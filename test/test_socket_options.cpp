@@ -121,3 +121,96 @@ TEST_F(TestSocketOptions, LossMaxTTL)
 }
 
 
+
+/// Checks that SRTO_PACINGDELAY is propagated to the accepted socket
+/// and that with the adaptive pacing bursts of input are smoothed,
+/// but no packet waits in the sender buffer longer than the pacing delay.
+TEST_F(TestSocketOptions, PacingDelay)
+{
+    const int invalid_delay = -1;
+    EXPECT_EQ(srt_setsockopt(m_listen_sock, 0, SRTO_PACINGDELAY, &invalid_delay, sizeof invalid_delay), SRT_ERROR);
+
+    const int pacing_delay = 40;
+    ASSERT_EQ(srt_setsockopt(m_listen_sock, 0, SRTO_PACINGDELAY, &pacing_delay, sizeof pacing_delay), SRT_SUCCESS);
+
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(5200);
+    ASSERT_EQ(inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr), 1);
+    sockaddr* psa = (sockaddr*)&sa;
+    ASSERT_NE(srt_bind(m_listen_sock, psa, sizeof sa), SRT_ERROR);
+
+    srt_listen(m_listen_sock, 1);
+
+    auto accept_async = [](SRTSOCKET listen_sock) {
+        sockaddr_in client_address;
+        int length = sizeof(sockaddr_in);
+        const SRTSOCKET accepted_socket = srt_accept(listen_sock, (sockaddr*)&client_address, &length);
+        return accepted_socket;
+    };
+    auto accept_res = async(launch::async, accept_async, m_listen_sock);
+
+    ASSERT_EQ(srt_connect(m_caller_sock, psa, sizeof sa), SRT_SUCCESS);
+
+    const SRTSOCKET accepted_sock = accept_res.get();
+    ASSERT_NE(accepted_sock, SRT_INVALID_SOCK);
+
+    int opt_val = 0;
+    int opt_len = sizeof opt_val;
+    ASSERT_EQ(srt_getsockopt(accepted_sock, 0, SRTO_PACINGDELAY, &opt_val, &opt_len), SRT_SUCCESS);
+    EXPECT_EQ(opt_val, pacing_delay);
+
+    // Bursts of 100 packets every 100ms, like large frames of a video stream.
+    const int bursts = 10;
+    const int burst_size = 100;
+    auto receive_async = [](SRTSOCKET sock, int count) {
+        char buf[1316];
+        int received = 0;
+        while (received < count && srt_recvmsg(sock, buf, sizeof buf) > 0)
+            ++received;
+        return received;
+    };
+    const int rcvtimeo = 3000;
+    ASSERT_EQ(srt_setsockopt(m_caller_sock, 0, SRTO_RCVTIMEO, &rcvtimeo, sizeof rcvtimeo), SRT_SUCCESS);
+    auto receive_res = async(launch::async, receive_async, m_caller_sock, bursts * burst_size);
+
+    char payload[1316] = {};
+    for (int i = 0; i < bursts; ++i)
+    {
+        for (int j = 0; j < burst_size; ++j)
+            ASSERT_EQ(srt_sendmsg(accepted_sock, payload, sizeof payload, -1, true), int(sizeof payload));
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+
+    EXPECT_EQ(receive_res.get(), bursts * burst_size);
+
+    SRT_TRACEBSTATS stats;
+    ASSERT_EQ(srt_bstats(accepted_sock, &stats, 0), SRT_SUCCESS);
+    EXPECT_EQ(stats.pktSndDrop, 0);
+    // A burst takes longer than the pacing delay at the input rate,
+    // so the packets must be delayed, but only up to the pacing delay.
+    // Leave some margin for the precision of the sending thread's sleep.
+    EXPECT_GT(stats.msSndPacingDelay, 1);
+    EXPECT_LT(stats.msSndPacingDelayMax, pacing_delay + pacing_delay / 2);
+
+    // Every packet sent and received is sampled in the delay histograms.
+    SRT_HISTSTATS hist;
+    ASSERT_EQ(srt_histstats(accepted_sock, &hist, 0), SRT_SUCCESS);
+    EXPECT_GE(int(hist.sndLag.count), bursts * burst_size);
+    ASSERT_EQ(srt_histstats(m_caller_sock, &hist, 1), SRT_SUCCESS);
+    EXPECT_EQ(int(hist.rcvTransit.count), bursts * burst_size);
+    EXPECT_EQ(int(hist.rcvBuffer.count), bursts * burst_size);
+    uint64_t in_buckets = 0;
+    for (int i = 0; i < SRT_HISTOGRAM_BUCKETS; ++i)
+        in_buckets += hist.rcvBuffer.buckets[i];
+    EXPECT_EQ(in_buckets, hist.rcvBuffer.count);
+    // Packets are delivered at the TSBPD time, so they stay in the buffer
+    // for about the latency (default 120ms) less the pacing delay.
+    EXPECT_GT(hist.rcvBuffer.usSum / hist.rcvBuffer.count, 50000u);
+    EXPECT_LT(hist.rcvBuffer.usMax, 500000u);
+    ASSERT_EQ(srt_histstats(m_caller_sock, &hist, 0), SRT_SUCCESS);
+    EXPECT_EQ(hist.rcvBuffer.count, 0u);
+
+    ASSERT_NE(srt_close(accepted_sock), SRT_ERROR);
+}
@@ -0,0 +1,158 @@
+/*
+ * SRT - Secure, Reliable, Transport
+ * Copyright (c) 2020 Haivision Systems Inc.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define INC__WIN_WINTIME // exclude gettimeofday from srt headers
+#endif
+
+#include "platform_sys.h"
+#include "srt.h"
+
+using namespace std;
+
+namespace
+{
+
+sockaddr_in LocalAddr(int port)
+{
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    return sa;
+}
+
+// Connects 'n' callers one after another to the listener and accepts
+// them. Every delay, from the creation of the caller socket until the
+// accepted socket is returned, is appended to 'w_delays_us'.
+void ConnectSeries(SRTSOCKET listener, const sockaddr_in& lsa, int n, vector<double>& w_delays_us)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        const auto start = chrono::steady_clock::now();
+        const SRTSOCKET caller = srt_create_socket();
+        ASSERT_NE(caller, SRT_INVALID_SOCK);
+        ASSERT_NE(srt_connect(caller, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+        const SRTSOCKET accepted = srt_accept(listener, NULL, NULL);
+        ASSERT_NE(accepted, SRT_INVALID_SOCK);
+        w_delays_us.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+
+        srt_close(caller);
+        srt_close(accepted);
+    }
+}
+
+}
+
+// The sockets closed in the first round are returned to the pool by the
+// GC thread, so the second round uses the reset objects. They must behave
+// like new ones: options inherited from the listener, data exchanged.
+TEST(SocketPool, ReusedSocketsWork)
+{
+    ASSERT_EQ(srt_setsocketpool(-1), SRT_ERROR);
+    ASSERT_EQ(srt_getlasterror(NULL), SRT_EINVPARAM);
+    ASSERT_EQ(srt_setsocketpool(8), 0);
+    ASSERT_EQ(srt_startup(), 0);
+
+    const sockaddr_in lsa = LocalAddr(5640);
+    const SRTSOCKET listener = srt_create_socket();
+    ASSERT_NE(listener, SRT_INVALID_SOCK);
+    const int latency = 345;
+    ASSERT_NE(srt_setsockflag(listener, SRTO_LATENCY, &latency, sizeof latency), SRT_ERROR);
+    ASSERT_NE(srt_bind(listener, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+    ASSERT_NE(srt_listen(listener, 4), SRT_ERROR);
+
+    for (int round = 0; round < 2; ++round)
+    {
+        vector<SRTSOCKET> sockets;
+        for (int i = 0; i < 3; ++i)
+        {
+            const SRTSOCKET caller = srt_create_socket();
+            ASSERT_NE(caller, SRT_INVALID_SOCK);
+            ASSERT_EQ(srt_getsockstate(caller), SRTS_INIT);
+            ASSERT_NE(srt_connect(caller, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+            const SRTSOCKET accepted = srt_accept(listener, NULL, NULL);
+            ASSERT_NE(accepted, SRT_INVALID_SOCK);
+
+            int rcvlatency = 0;
+            int optlen = sizeof rcvlatency;
+            ASSERT_NE(srt_getsockflag(accepted, SRTO_RCVLATENCY, &rcvlatency, &optlen), SRT_ERROR);
+            EXPECT_EQ(rcvlatency, latency);
+
+            const char message[] = "pooled";
+            ASSERT_EQ(srt_sendmsg(caller, message, sizeof message, -1, true), int(sizeof message));
+            char buf[1500];
+            ASSERT_EQ(srt_recvmsg(accepted, buf, sizeof buf), int(sizeof message));
+            EXPECT_EQ(memcmp(buf, message, sizeof message), 0);
+
+            sockets.push_back(caller);
+            sockets.push_back(accepted);
+        }
+
+        for (size_t i = 0; i < sockets.size(); ++i)
+            srt_close(sockets[i]);
+
+        // Closed sockets are removed by the GC about a second later.
+        this_thread::sleep_for(chrono::milliseconds(2500));
+    }
+
+    srt_close(listener);
+    EXPECT_EQ(srt_cleanup(), 0);
+    EXPECT_EQ(srt_setsocketpool(0), 0);
+}
+
+// Measures the time to create a caller socket, connect it and accept it
+// on the other side, without the pool and with the pool filled by the
+// sockets of a previous round.
+TEST(SocketPool, ConnectionSetupLatency)
+{
+    const int n = 200;
+    const int sizes[] = { 0, 2 * n };
+
+    for (size_t m = 0; m < sizeof sizes / sizeof sizes[0]; ++m)
+    {
+        ASSERT_EQ(srt_setsocketpool(sizes[m]), 0);
+        ASSERT_EQ(srt_startup(), 0);
+
+        const sockaddr_in lsa = LocalAddr(5642 + 2 * int(m));
+        const SRTSOCKET listener = srt_create_socket();
+        ASSERT_NE(listener, SRT_INVALID_SOCK);
+        ASSERT_NE(srt_bind(listener, (sockaddr*)&lsa, sizeof lsa), SRT_ERROR);
+        ASSERT_NE(srt_listen(listener, 4), SRT_ERROR);
+
+        // The warm-up round lets the GC return the connected sockets,
+        // with their loss lists, into the pool.
+        vector<double> delays;
+        ConnectSeries(listener, lsa, n, delays);
+        this_thread::sleep_for(chrono::milliseconds(2500));
+
+        delays.clear();
+        ConnectSeries(listener, lsa, n, delays);
+        ASSERT_EQ(delays.size(), size_t(n));
+
+        sort(delays.begin(), delays.end());
+        printf("Socket pool %4d: connection setup p50=%.0fus p90=%.0fus p99=%.0fus\n", sizes[m],
+                delays[n / 2], delays[n * 90 / 100], delays[n * 99 / 100]);
+
+        srt_close(listener);
+        srt_cleanup();
+    }
+
+    EXPECT_EQ(srt_setsocketpool(0), 0);
+}
@@ -4,6 +4,8 @@
 #include <future>
 #include <array>
 #include <numeric> // std::accumulate
+#include <algorithm>
+#include <ctime>
 #include <regex>   // Used in FormatTime test
 #include "sync.h"
 #include "common.h"
@@ -157,6 +159,68 @@ TEST(SyncDuration, OperatorMultIntEq)
     EXPECT_EQ(count_milliseconds(a), 7000);
 }
 
+/*****************************************************************************/
+/*
+ * Clock tests
+ */
+/*****************************************************************************/
+
+TEST(SyncClock, Accuracy)
+{
+    const int type = srt_clock_type();
+    EXPECT_GE(type, SRT_SYNC_CLOCK_GETTIME_MONOTONIC);
+    EXPECT_LE(type, SRT_SYNC_CLOCK_TSC);
+
+    const auto std_start = chrono::steady_clock::now();
+    const steady_clock::time_point start = steady_clock::now();
+    this_thread::sleep_for(chrono::milliseconds(200));
+    const steady_clock::time_point end = steady_clock::now();
+    const auto std_end = chrono::steady_clock::now();
+
+    const int64_t std_us = chrono::duration_cast<chrono::microseconds>(std_end - std_start).count();
+    const int64_t srt_us = count_microseconds(end - start);
+    // 1% covers an inaccurate TSC calibration and the order of the reads
+    EXPECT_NEAR(double(srt_us), double(std_us), std_us * 0.01);
+}
+
+// Reports the cost of reading the clock, compared to std::chrono.
+TEST(SyncClock, NowCost)
+{
+    const int calls = 1000000;
+    int backwards = 0;
+
+    const auto srt_start = chrono::steady_clock::now();
+    steady_clock::time_point prev = steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        const steady_clock::time_point now = steady_clock::now();
+        if (now < prev)
+            ++backwards;
+        prev = now;
+    }
+    const auto srt_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - srt_start).count();
+
+    const auto std_start = chrono::steady_clock::now();
+    chrono::steady_clock::time_point std_prev = std_start;
+    for (int i = 0; i < calls; ++i)
+    {
+        const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (now < std_prev)
+            ++backwards;
+        std_prev = now;
+    }
+    const auto std_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - std_start).count();
+
+    cerr << "steady_clock::now() (clock type " << srt_clock_type() << "): " << double(srt_ns) / calls
+        << " ns/call, std::chrono::steady_clock::now(): " << double(std_ns) / calls << " ns/call\n";
+
+    // gettimeofday may be adjusted by the system
+    if (srt_clock_type() != SRT_SYNC_CLOCK_POSIX_GETTIMEOFDAY)
+    {
+        EXPECT_EQ(backwards, 0);
+    }
+}
+
 /*****************************************************************************/
 /*
  * TimePoint tests
@@ -415,6 +479,112 @@ TEST(SyncEvent, WaitForNotifyAll)
     cond.destroy();
 }
 
+/*****************************************************************************/
+/*
+ * Timer tests
+ */
+/*****************************************************************************/
+TEST(SyncTimer, Interrupt)
+{
+    CTimer timer;
+    const steady_clock::time_point start = steady_clock::now();
+    auto sleep_async = async(launch::async, [&timer, start] {
+        return timer.sleep_until(start + seconds_from(10));
+    });
+
+    // tick() only makes it recheck the time
+    this_thread::sleep_for(chrono::milliseconds(50));
+    timer.tick();
+    ASSERT_EQ(sleep_async.wait_for(chrono::milliseconds(50)), future_status::timeout);
+
+    timer.interrupt();
+    ASSERT_EQ(sleep_async.wait_for(chrono::seconds(1)), future_status::ready);
+    EXPECT_TRUE(sleep_async.get());
+    EXPECT_LT(steady_clock::now() - start, seconds_from(2));
+}
+
+// Reports how late sleep_until() returns when pacing at fixed intervals
+// and how much CPU time it takes. See scripts/timer-bench.sh for comparing
+// the builds with USE_BUSY_WAITING and USE_TIMERFD.
+TEST(SyncTimer, PacingError)
+{
+    CTimer timer;
+    for (int interval_us : {20, 100, 1000})
+    {
+        const int count = 500000 / interval_us; // 0.5 s
+        vector<int64_t> late_us(count);
+
+        const clock_t cpu_start = clock();
+        const steady_clock::time_point start = steady_clock::now();
+        steady_clock::time_point next = start;
+        for (int i = 0; i < count; ++i)
+        {
+            next += microseconds_from(interval_us);
+            timer.sleep_until(next);
+            late_us[i] = count_microseconds(steady_clock::now() - next);
+        }
+        const double cpu_ms = double(clock() - cpu_start) * 1000 / CLOCKS_PER_SEC;
+        const double wall_ms = count_microseconds(steady_clock::now() - start) / 1000.0;
+
+        sort(late_us.begin(), late_us.end());
+        cerr << "CTimer pacing " << interval_us << "us: late p50=" << late_us[count / 2]
+            << "us p99=" << late_us[count * 99 / 100] << "us p99.9=" << late_us[count * 999 / 1000]
+            << "us max=" << late_us[count - 1] << "us, CPU " << int(100 * cpu_ms / wall_ms) << "%\n";
+
+        EXPECT_GE(late_us[0], 0) << "woken up before the time";
+    }
+}
+
+/*****************************************************************************/
+/*
+ * Atomic tests
+ */
+/*****************************************************************************/
+TEST(SyncAtomic, BasicOperations)
+{
+    srt::sync::atomic<int64_t> a(5);
+    EXPECT_EQ(a.load(), 5);
+    EXPECT_EQ(a.fetch_add(3), 5);
+    EXPECT_EQ(a.fetch_add(-1), 8);
+    EXPECT_EQ(a.exchange(10), 7);
+    a.fetch_max(4);
+    EXPECT_EQ(a.load(), 10);
+    a.fetch_max(12);
+    EXPECT_EQ(a.load(), 12);
+    a.store(0);
+    EXPECT_EQ(a.load(), 0);
+}
+
+TEST(SyncAtomic, ConcurrentCounting)
+{
+    srt::sync::atomic<int64_t> counter;
+    srt::sync::atomic<int64_t> maximum;
+    const int nthreads = 4;
+    const int nincrements = 100000;
+
+    auto count_async = [&](int id) {
+        for (int i = 0; i < nincrements; ++i)
+        {
+            counter.fetch_add(1);
+            maximum.fetch_max(int64_t(id) * nincrements + i);
+        }
+    };
+
+    // Read-and-reset, like bstats with clear, must not lose any counts
+    int64_t collected = 0;
+    vector<future<void>> workers;
+    for (int t = 0; t < nthreads; ++t)
+        workers.push_back(async(launch::async, count_async, t));
+    for (int i = 0; i < 100; ++i)
+        collected += counter.exchange(0);
+    for (size_t t = 0; t < workers.size(); ++t)
+        workers[t].wait();
+    collected += counter.exchange(0);
+
+    EXPECT_EQ(collected, int64_t(nthreads) * nincrements);
+    EXPECT_EQ(maximum.load(), int64_t(nthreads) * nincrements - 1);
+}
+
 /*****************************************************************************/
 /*
  * FormatTime
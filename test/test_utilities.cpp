@@ -211,3 +211,36 @@ TEST(CircularBuffer, Overall)
     IF_HEAVY_LOGGING(cerr << "DONE.\n");
 }
 
+
+TEST(LogHistogram, Buckets)
+{
+    // Every bucket starts at its floor and ends right before the next one's.
+    for (int i = 0; i < SRT_HISTOGRAM_BUCKETS - 1; ++i)
+    {
+        EXPECT_EQ(CLogHistogram::bucketOf(srt_histogram_floor(i)), i);
+        EXPECT_EQ(CLogHistogram::bucketOf(srt_histogram_floor(i + 1) - 1), i);
+    }
+    EXPECT_EQ(CLogHistogram::bucketOf(-5), 0);
+    EXPECT_EQ(CLogHistogram::bucketOf(int64_t(1) << 40), SRT_HISTOGRAM_BUCKETS - 1);
+
+    CLogHistogram hist;
+    hist.add(3);
+    hist.add(1000);
+    hist.add(1100);
+
+    SRT_HISTOGRAM out;
+    hist.get((out), true);
+    EXPECT_EQ(out.count, 3u);
+    EXPECT_EQ(out.usSum, 2103u);
+    EXPECT_EQ(out.usMax, 1100u);
+    EXPECT_EQ(out.buckets[3], 1u);
+    // 1000 and 1100 are in [896, 1024) and [1024, 1280)
+    EXPECT_EQ(out.buckets[CLogHistogram::bucketOf(1000)], 1u);
+    EXPECT_EQ(srt_histogram_floor(CLogHistogram::bucketOf(1000)), 896);
+    EXPECT_EQ(srt_histogram_floor(CLogHistogram::bucketOf(1100)), 1024);
+
+    // Cleared by the previous call
+    hist.get((out), false);
+    EXPECT_EQ(out.count, 0u);
+    EXPECT_EQ(out.usMax, 0u);
+}